@@ -0,0 +1,117 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <ModbusEmbedded/modbus_buffer.h>
+
+/**
+ * Datapoint lookup in modbus_Buffer_t: linear scan (no `pIndex`) against
+ * binary search over the sorted index. Built and run by Benchmark/run.sh.
+ */
+
+#define BENCH_DATAPOINT_COUNT		400
+#define BENCH_DATAPOINT_REGISTERS	2
+#define BENCH_LOOKUP_COUNT			4096
+#define BENCH_ROUNDS				200
+
+
+
+static modbus_Buffer_Datapoint_t s_pDatapoints[BENCH_DATAPOINT_COUNT];
+static uint32_t s_pValues[BENCH_DATAPOINT_COUNT];
+static uint16_t s_pIndex[BENCH_DATAPOINT_COUNT];
+static uint16_t s_pAddresses[BENCH_LOOKUP_COUNT];
+
+static volatile uint16_t s_sink;
+
+
+
+//------------------------------------------------------------------------------
+//
+static double bench_GetSeconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + ((double)now.tv_nsec * 1e-9);
+}
+
+//------------------------------------------------------------------------------
+// One register per request, as the per-register callbacks of the slave do it.
+static double bench_ReadRegister(const modbus_Buffer_t *pBuffer)
+{
+	uint16_t value = 0;
+	const double start = bench_GetSeconds();
+
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		for(uint32_t ctr = 0; ctr < BENCH_LOOKUP_COUNT; ctr++)
+		{
+			modbus_Buffer_ReadRegister(pBuffer, s_pAddresses[ctr], &value);
+			s_sink ^= value;
+		}
+	}
+
+	return (bench_GetSeconds() - start) * 1e9 / ((double)BENCH_ROUNDS * BENCH_LOOKUP_COUNT);
+}
+
+//------------------------------------------------------------------------------
+// Full 125 register read, the start address is looked up once.
+static double bench_ReadRange(const modbus_Buffer_t *pBuffer)
+{
+	const uint32_t lastStart = (BENCH_DATAPOINT_COUNT * BENCH_DATAPOINT_REGISTERS) - MODBUS_READ_REGISTER_MAX_QUANTITY;
+	uint16_t pRegisters[MODBUS_READ_REGISTER_MAX_QUANTITY];
+	const double start = bench_GetSeconds();
+
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		for(uint32_t ctr = 0; ctr < BENCH_LOOKUP_COUNT; ctr++)
+		{
+			// Datapoints are two registers wide, ranges start on a datapoint.
+			const uint16_t startAddress = (uint16_t)((s_pAddresses[ctr] % lastStart) & ~1u);
+			modbus_Buffer_ReadRange(pBuffer, startAddress, MODBUS_READ_REGISTER_MAX_QUANTITY, pRegisters);
+			s_sink ^= pRegisters[0];
+		}
+	}
+
+	return (bench_GetSeconds() - start) * 1e9 / ((double)BENCH_ROUNDS * BENCH_LOOKUP_COUNT);
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	// Declared in reverse, as hand-written maps rarely are in address order.
+	for(uint32_t ctr = 0; ctr < BENCH_DATAPOINT_COUNT; ctr++)
+	{
+		modbus_Buffer_Datapoint_t *pDatapoint = &s_pDatapoints[BENCH_DATAPOINT_COUNT - 1 - ctr];
+
+		s_pValues[ctr] = ctr;
+		pDatapoint->startAddress = (uint16_t)(ctr * BENCH_DATAPOINT_REGISTERS);
+		pDatapoint->accessType = MODBUS_BUFFER_ACCESS_READWRITE;
+		pDatapoint->pDataBuffer = (uint8_t *)&s_pValues[ctr];
+		pDatapoint->dataSizeBytes = sizeof(s_pValues[ctr]);
+		pDatapoint->byteOrder = MODBUS_BUFFER_BYTEORDER_NATIVE;
+	}
+
+	if(!modbus_Buffer_BuildIndex(s_pDatapoints, BENCH_DATAPOINT_COUNT, s_pIndex))
+	{
+		printf("modbus_Buffer_BuildIndex() failed.\n");
+		return 1;
+	}
+
+	srand(1);
+	for(uint32_t ctr = 0; ctr < BENCH_LOOKUP_COUNT; ctr++)
+	{
+		s_pAddresses[ctr] = (uint16_t)(rand() % (BENCH_DATAPOINT_COUNT * BENCH_DATAPOINT_REGISTERS));
+	}
+
+	const modbus_Buffer_t scan = { s_pDatapoints, BENCH_DATAPOINT_COUNT, NULL };
+	const modbus_Buffer_t indexed = { s_pDatapoints, BENCH_DATAPOINT_COUNT, s_pIndex };
+
+	printf("%u datapoints, ns per call:\n", BENCH_DATAPOINT_COUNT);
+	printf("  ReadRegister         scan %8.1f   index %8.1f\n", bench_ReadRegister(&scan), bench_ReadRegister(&indexed));
+	printf("  ReadRange (125 regs) scan %8.1f   index %8.1f\n", bench_ReadRange(&scan), bench_ReadRange(&indexed));
+
+	return 0;
+}
@@ -0,0 +1,70 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <ModbusEmbedded/modbus.h>
+
+/**
+ * Throughput of the compiled CRC engine. Benchmark/run.sh builds it once per engine.
+ */
+
+#define BENCH_BYTES			(256u * 1024u * 1024u)
+
+
+
+static uint8_t s_pData[4096];
+
+static volatile uint16_t s_sink;
+
+
+
+//------------------------------------------------------------------------------
+//
+static double bench_GetSeconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + ((double)now.tv_nsec * 1e-9);
+}
+
+//------------------------------------------------------------------------------
+//
+static double bench_Crc(uint32_t dataSize)
+{
+	const uint32_t rounds = BENCH_BYTES / dataSize;
+	uint16_t crc = modbus_CrcInit();
+	const double start = bench_GetSeconds();
+
+	for(uint32_t round = 0; round < rounds; round++)
+	{
+		crc = modbus_CrcUpdate(crc, s_pData, dataSize);
+	}
+
+	const double seconds = bench_GetSeconds() - start;
+	s_sink = crc;
+
+	return ((double)rounds * dataSize) / seconds / 1e6;
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	srand(1);
+	for(uint32_t ctr = 0; ctr < sizeof(s_pData); ctr++)
+	{
+		s_pData[ctr] = (uint8_t)rand();
+	}
+
+	// Shortest request, full RTU frame, replayed capture block.
+	const uint32_t pSizes[] = { 8, MODBUS_PAYLOAD_SIZE + 2, sizeof(s_pData) };
+
+	for(uint32_t ctr = 0; ctr < (sizeof(pSizes) / sizeof(pSizes[0])); ctr++)
+	{
+		printf("  %4u bytes  %8.1f MB/s\n", (unsigned)pSizes[ctr], bench_Crc(pSizes[ctr]));
+	}
+
+	return 0;
+}
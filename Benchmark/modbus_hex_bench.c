@@ -0,0 +1,157 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <ModbusEmbedded/modbus.h>
+
+/**
+ * Hex codec of the ASCII framing over full 253 byte PDUs, against the previous
+ * per-nibble encoder and strtoul() based decoder. Built and run by Benchmark/run.sh,
+ * with the SSE2 path and with the lookup tables only.
+ */
+
+#define BENCH_ROUNDS		200000
+
+
+
+static volatile uint8_t s_sink;
+
+
+
+//------------------------------------------------------------------------------
+//
+static double bench_GetSeconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + ((double)now.tv_nsec * 1e-9);
+}
+
+//------------------------------------------------------------------------------
+// Previous encoder, one branch per nibble.
+static inline void bench_OldByteToHex(uint8_t value, char *pBuffer)
+{
+	uint8_t digit = (value >> 4) & 0x0F;
+	if(digit >= 0x0A)
+	{
+		pBuffer[0] = (digit - 0x0A) + 'A';
+	}
+	else
+	{
+		pBuffer[0] = digit + '0';
+	}
+
+	digit = value & 0x0F;
+	if(digit >= 0x0A)
+	{
+		pBuffer[1] = (digit - 0x0A) + 'A';
+	}
+	else
+	{
+		pBuffer[1] = digit + '0';
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void bench_OldEncode(const uint8_t *pData, uint16_t dataSize, char *pBuffer)
+{
+	for(uint16_t ctr = 0; ctr < dataSize; ctr++)
+	{
+		bench_OldByteToHex(pData[ctr], &pBuffer[ctr * 2]);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Previous decoder, strtoul() on a 3 character buffer per byte.
+static void bench_OldDecode(const char *pBuffer, uint16_t charCount, uint8_t *pData)
+{
+	char hexstring_buf[3] = { 0 };
+
+	for(uint16_t ctr = 0; ctr < (charCount / 2); ctr++)
+	{
+		hexstring_buf[0] = pBuffer[ctr * 2];
+		hexstring_buf[1] = pBuffer[ctr * 2 + 1];
+		pData[ctr] = strtoul(hexstring_buf, NULL, 16) & 0xFF;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	modbus_Pdu_t pdu;
+	char pHex[MODBUS_PAYLOAD_SIZE * 2];
+	char pFrame[MODBUS_PAYLOAD_SIZE * 2 + 9];
+	uint8_t pDecoded[MODBUS_PAYLOAD_SIZE];
+
+	srand(1);
+	pdu.busAddress = 1;
+	pdu.functionCode = MODBUS_FUNCTION_WRITEMULT_REGS;
+	pdu.payloadSize = MODBUS_PAYLOAD_SIZE;
+	for(uint32_t ctr = 0; ctr < MODBUS_PAYLOAD_SIZE; ctr++)
+	{
+		pdu.pPayload[ctr] = (uint8_t)rand();
+	}
+
+	double start = bench_GetSeconds();
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		bench_OldEncode(pdu.pPayload, MODBUS_PAYLOAD_SIZE, pHex);
+		s_sink ^= (uint8_t)pHex[round % sizeof(pHex)];
+	}
+	const double oldEncodeNs = (bench_GetSeconds() - start) * 1e9 / BENCH_ROUNDS;
+
+	start = bench_GetSeconds();
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		modbus_HexEncode(pdu.pPayload, MODBUS_PAYLOAD_SIZE, pHex);
+		s_sink ^= (uint8_t)pHex[round % sizeof(pHex)];
+	}
+	const double newEncodeNs = (bench_GetSeconds() - start) * 1e9 / BENCH_ROUNDS;
+
+	start = bench_GetSeconds();
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		bench_OldDecode(pHex, sizeof(pHex), pDecoded);
+		s_sink ^= pDecoded[round % sizeof(pDecoded)];
+	}
+	const double oldDecodeNs = (bench_GetSeconds() - start) * 1e9 / BENCH_ROUNDS;
+
+	start = bench_GetSeconds();
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		modbus_HexDecode(pHex, sizeof(pHex), pDecoded);
+		s_sink ^= pDecoded[round % sizeof(pDecoded)];
+	}
+	const double newDecodeNs = (bench_GetSeconds() - start) * 1e9 / BENCH_ROUNDS;
+
+	// Complete frames, LRC and framing checks included.
+	const uint16_t frameSize = modbus_EncodeAscii(pFrame, sizeof(pFrame), &pdu);
+
+	start = bench_GetSeconds();
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		modbus_EncodeAscii(pFrame, sizeof(pFrame), &pdu);
+		s_sink ^= (uint8_t)pFrame[round % sizeof(pFrame)];
+	}
+	const double frameEncodeNs = (bench_GetSeconds() - start) * 1e9 / BENCH_ROUNDS;
+
+	modbus_Pdu_t decoded;
+	start = bench_GetSeconds();
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		modbus_DecodeAscii(pFrame, frameSize, &decoded);
+		s_sink ^= decoded.pPayload[round % MODBUS_PAYLOAD_SIZE];
+	}
+	const double frameDecodeNs = (bench_GetSeconds() - start) * 1e9 / BENCH_ROUNDS;
+
+	printf("%u byte payload, ns per call:\n", (unsigned)MODBUS_PAYLOAD_SIZE);
+	printf("  encode  previous %8.1f   modbus_HexEncode %8.1f   (%.1fx)\n", oldEncodeNs, newEncodeNs, oldEncodeNs / newEncodeNs);
+	printf("  decode  previous %8.1f   modbus_HexDecode %8.1f   (%.1fx)\n", oldDecodeNs, newDecodeNs, oldDecodeNs / newDecodeNs);
+	printf("  frame   modbus_EncodeAscii %8.1f   modbus_DecodeAscii %8.1f\n", frameEncodeNs, frameDecodeNs);
+
+	return 0;
+}
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <ModbusEmbedded/modbus_slave.hpp>
+
+/**
+ * modbus::Slave<Map> against the C callback path, both on the same 125 register
+ * holding table. Built and run by Benchmark/run.sh.
+ */
+
+#define BENCH_ROUNDS		200000
+#define BENCH_RUNS			5
+
+
+
+namespace
+{
+
+uint16_t s_pHolding[MODBUS_READ_REGISTER_MAX_QUANTITY];
+
+volatile uint8_t s_sink;
+
+struct Map
+{
+	modbus::Registers<0, MODBUS_READ_REGISTER_MAX_QUANTITY> holding;
+};
+
+//------------------------------------------------------------------------------
+//
+double bench_GetSeconds()
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + ((double)now.tv_nsec * 1e-9);
+}
+
+//------------------------------------------------------------------------------
+//
+void bench_GenericFunction(modbus_Pdu_t *pRequest, modbus_Pdu_t *pResponse)
+{
+	(void)pRequest;
+	modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
+}
+
+//------------------------------------------------------------------------------
+// Per-register callbacks, one indirect call per register.
+modbus_Exception_e bench_ReadRegister(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t *pValue)
+{
+	(void)functionCode;
+	if(address >= MODBUS_READ_REGISTER_MAX_QUANTITY)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	*pValue = s_pHolding[address];
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+modbus_Exception_e bench_WriteRegister(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+{
+	(void)functionCode;
+	if(address >= MODBUS_READ_REGISTER_MAX_QUANTITY)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	s_pHolding[address] = value;
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+// C block handlers, one indirect call per request.
+modbus_Exception_e bench_ReadRegisterBytes(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pBytes)
+{
+	(void)functionCode;
+	if(((uint32_t)startAddress + quantity) > MODBUS_READ_REGISTER_MAX_QUANTITY)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	for(uint16_t ctr = 0; ctr < quantity; ctr++)
+	{
+		pBytes[2 * ctr] = (uint8_t)(s_pHolding[startAddress + ctr] >> 8);
+		pBytes[2 * ctr + 1] = (uint8_t)s_pHolding[startAddress + ctr];
+	}
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+modbus_Exception_e bench_WriteRegisterBlock(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pData)
+{
+	(void)functionCode;
+	if(((uint32_t)startAddress + quantity) > MODBUS_READ_REGISTER_MAX_QUANTITY)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	for(uint16_t ctr = 0; ctr < quantity; ctr++)
+	{
+		s_pHolding[startAddress + ctr] = (uint16_t)((pData[2 * ctr] << 8) | pData[2 * ctr + 1]);
+	}
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+void bench_SetRequest(modbus_Pdu_t *pPdu, const modbus_Pdu_t *pRequest)
+{
+	pPdu->busAddress = pRequest->busAddress;
+	pPdu->functionCode = pRequest->functionCode;
+	pPdu->payloadSize = pRequest->payloadSize;
+	memcpy(pPdu->pPayload, pRequest->pPayload, pRequest->payloadSize);
+}
+
+//------------------------------------------------------------------------------
+// The response is built in place, so the request is set up again every round.
+template<typename Process>
+double bench_Run(modbus_Pdu_t *pPdu, const modbus_Pdu_t *pRequest, Process process)
+{
+	const double start = bench_GetSeconds();
+
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		bench_SetRequest(pPdu, pRequest);
+		process();
+		s_sink ^= pPdu->pPayload[round % pPdu->payloadSize];
+	}
+
+	const double ns = (bench_GetSeconds() - start) * 1e9 / BENCH_ROUNDS;
+
+	// An exception would make the numbers meaningless.
+	if((pPdu->functionCode & 0x80) != 0)
+	{
+		printf("Request failed with exception %u.\n", pPdu->pPayload[0]);
+		exit(1);
+	}
+
+	return ns;
+}
+
+//------------------------------------------------------------------------------
+//
+void bench_SetWords(modbus_Pdu_t *pPdu, modbus_FunctionCode_e functionCode, uint16_t first, uint16_t second)
+{
+	pPdu->busAddress = 1;
+	pPdu->functionCode = functionCode;
+	pPdu->payloadSize = 4;
+	pPdu->pPayload[0] = (uint8_t)(first >> 8);
+	pPdu->pPayload[1] = (uint8_t)first;
+	pPdu->pPayload[2] = (uint8_t)(second >> 8);
+	pPdu->pPayload[3] = (uint8_t)second;
+}
+
+} // namespace
+
+
+
+//------------------------------------------------------------------------------
+//
+int main()
+{
+	static const modbus_Handlers_t callbackHandlers =
+	{
+		&bench_GenericFunction, nullptr, nullptr,
+		nullptr, nullptr, &bench_ReadRegister, nullptr, nullptr, nullptr,
+		nullptr, &bench_WriteRegister,
+		nullptr, nullptr, nullptr, nullptr, nullptr
+	};
+
+	static const modbus_Handlers_t blockHandlers =
+	{
+		&bench_GenericFunction, nullptr, nullptr,
+		nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+		nullptr, &bench_WriteRegister,
+		nullptr, nullptr, &bench_ReadRegisterBytes, nullptr, &bench_WriteRegisterBlock
+	};
+
+	static modbus_t callbackInstance {};
+	callbackInstance.busAddress = 1;
+	callbackInstance.pHandlers = &callbackHandlers;
+
+	static modbus_t blockInstance {};
+	blockInstance.busAddress = 1;
+	blockInstance.pHandlers = &blockHandlers;
+
+	static Map map {};
+	static modbus::Slave<Map> slave(map, 1);
+
+	// Full-size FC 0x03 and FC 0x10, where the copy loop dominates, and
+	// single registers, where the dispatch does.
+	modbus_Pdu_t pRequests[4] {};
+	bench_SetWords(&pRequests[0], MODBUS_FUNCTION_READHOLDING, 0, MODBUS_READ_REGISTER_MAX_QUANTITY);
+	bench_SetWords(&pRequests[1], MODBUS_FUNCTION_WRITEMULT_REGS, 0, MODBUS_WRITE_REGISTER_MAX_QUANTITY);
+	pRequests[1].pPayload[4] = MODBUS_WRITE_REGISTER_MAX_QUANTITY * 2;
+	for(uint16_t ctr = 0; ctr < MODBUS_WRITE_REGISTER_MAX_QUANTITY * 2; ctr++)
+	{
+		pRequests[1].pPayload[5 + ctr] = (uint8_t)ctr;
+	}
+	pRequests[1].payloadSize = 5 + MODBUS_WRITE_REGISTER_MAX_QUANTITY * 2;
+	bench_SetWords(&pRequests[2], MODBUS_FUNCTION_READHOLDING, 7, 1);
+	bench_SetWords(&pRequests[3], MODBUS_FUNCTION_WRITESINGLE_REG, 7, 0x1234);
+
+	static const char *const ppNames[4] =
+	{
+		"FC 0x03, 125 registers", "FC 0x10, 123 registers", "FC 0x03, 1 register", "FC 0x06"
+	};
+
+	modbus_Pdu_t *pCallbackPdu = MODBUS_REQUEST_PDU(&callbackInstance);
+	modbus_Pdu_t *pBlockPdu = MODBUS_REQUEST_PDU(&blockInstance);
+	modbus_Pdu_t *pSlavePdu = MODBUS_REQUEST_PDU(&slave.instance());
+
+	// Best of a few interleaved runs, so noise and frequency changes hit all three alike.
+	for(int ctr = 0; ctr < 4; ctr++)
+	{
+		double pBest[3] = { 1e9, 1e9, 1e9 };
+
+		for(uint32_t run = 0; run < BENCH_RUNS; run++)
+		{
+			const double pNs[3] =
+			{
+				bench_Run(pCallbackPdu, &pRequests[ctr], []() { modbus_ProcessData(&callbackInstance); }),
+				bench_Run(pBlockPdu, &pRequests[ctr], []() { modbus_ProcessData(&blockInstance); }),
+				bench_Run(pSlavePdu, &pRequests[ctr], []() { slave.process(); })
+			};
+
+			for(int index = 0; index < 3; index++)
+			{
+				pBest[index] = (pNs[index] < pBest[index]) ? pNs[index] : pBest[index];
+			}
+		}
+
+		printf("  %-22s callbacks %8.1f   block handlers %8.1f   Slave<Map> %8.1f   ns\n", ppNames[ctr], pBest[0], pBest[1], pBest[2]);
+	}
+
+	return 0;
+}
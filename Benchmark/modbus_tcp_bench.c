@@ -0,0 +1,333 @@
+// syscall()
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include <ModbusEmbedded/modbus.h>
+#include <ModbusEmbedded/modbus_tcp_server.h>
+#include <ModbusEmbedded/modbus_tcp_uring.h>
+
+/**
+ * Same loopback client load against the epoll server and, built with
+ * MODBUS_TCP_URING, against the io_uring backend. The server runs in its own
+ * thread. Its system calls are counted through the linker's --wrap, so
+ * Benchmark/run.sh links this with the WRAP flags listed there.
+ */
+
+#define BENCH_SINGLE_REQUESTS		20000
+#define BENCH_CONNECTIONS			64
+#define BENCH_DEPTH					8
+#define BENCH_ROUNDS				500
+#define BENCH_QUANTITY				10
+#define BENCH_REQUEST_SIZE			(MODBUS_TCP_HEADER_SIZE + 5)
+#define BENCH_RESPONSE_SIZE			(MODBUS_TCP_HEADER_SIZE + 2 + (2 * BENCH_QUANTITY))
+
+#ifdef MODBUS_TCP_URING
+#define BENCH_BACKEND				"io_uring"
+typedef modbus_TcpUring_t bench_Server_t;
+typedef modbus_TcpUring_Connection_t bench_Connection_t;
+#define bench_ServerInit			modbus_TcpUring_Init
+#define bench_ServerPoll			modbus_TcpUring_Poll
+#define bench_ServerGetPort			modbus_TcpUring_GetPort
+#define bench_ServerClose			modbus_TcpUring_Close
+#else
+#define BENCH_BACKEND				"epoll"
+typedef modbus_TcpServer_t bench_Server_t;
+typedef modbus_TcpServer_Connection_t bench_Connection_t;
+#define bench_ServerInit			modbus_TcpServer_Init
+#define bench_ServerPoll			modbus_TcpServer_Poll
+#define bench_ServerGetPort			modbus_TcpServer_GetPort
+#define bench_ServerClose			modbus_TcpServer_Close
+#endif
+
+
+
+static uint16_t s_pRegisters[BENCH_QUANTITY];
+static bench_Connection_t s_pConnections[BENCH_CONNECTIONS];
+static bench_Server_t s_server;
+static int s_pClients[BENCH_CONNECTIONS];
+
+static bool s_stop = false;
+static uint64_t s_syscallCount = 0;
+static __thread bool s_isServerThread = false;
+
+
+
+/**
+ * Counting wrappers, only calls made by the server thread are counted.
+ */
+int __real_epoll_wait(int fd, struct epoll_event *pEvents, int maxEvents, int timeout);
+int __real_epoll_ctl(int fd, int operation, int targetFd, struct epoll_event *pEvent);
+ssize_t __real_recv(int fd, void *pBuffer, size_t size, int flags);
+ssize_t __real___recv_chk(int fd, void *pBuffer, size_t size, size_t bufferSize, int flags);
+ssize_t __real_send(int fd, const void *pBuffer, size_t size, int flags);
+int __real_accept4(int fd, struct sockaddr *pAddress, socklen_t *pAddressSize, int flags);
+int __real_setsockopt(int fd, int level, int name, const void *pValue, socklen_t valueSize);
+int __real_shutdown(int fd, int how);
+int __real_close(int fd);
+long __real_syscall(long number, ...);
+
+//------------------------------------------------------------------------------
+//
+static void bench_CountSyscall(void)
+{
+	if(s_isServerThread)
+	{
+		__atomic_add_fetch(&s_syscallCount, 1, __ATOMIC_RELAXED);
+	}
+}
+
+int __wrap_epoll_wait(int fd, struct epoll_event *pEvents, int maxEvents, int timeout) { bench_CountSyscall(); return __real_epoll_wait(fd, pEvents, maxEvents, timeout); }
+int __wrap_epoll_ctl(int fd, int operation, int targetFd, struct epoll_event *pEvent) { bench_CountSyscall(); return __real_epoll_ctl(fd, operation, targetFd, pEvent); }
+ssize_t __wrap_recv(int fd, void *pBuffer, size_t size, int flags) { bench_CountSyscall(); return __real_recv(fd, pBuffer, size, flags); }
+ssize_t __wrap___recv_chk(int fd, void *pBuffer, size_t size, size_t bufferSize, int flags) { bench_CountSyscall(); return __real___recv_chk(fd, pBuffer, size, bufferSize, flags); }
+ssize_t __wrap_send(int fd, const void *pBuffer, size_t size, int flags) { bench_CountSyscall(); return __real_send(fd, pBuffer, size, flags); }
+int __wrap_accept4(int fd, struct sockaddr *pAddress, socklen_t *pAddressSize, int flags) { bench_CountSyscall(); return __real_accept4(fd, pAddress, pAddressSize, flags); }
+int __wrap_setsockopt(int fd, int level, int name, const void *pValue, socklen_t valueSize) { bench_CountSyscall(); return __real_setsockopt(fd, level, name, pValue, valueSize); }
+int __wrap_shutdown(int fd, int how) { bench_CountSyscall(); return __real_shutdown(fd, how); }
+int __wrap_close(int fd) { bench_CountSyscall(); return __real_close(fd); }
+
+//------------------------------------------------------------------------------
+// The backends pass at most six arguments, all of them integers or pointers.
+long __wrap_syscall(long number, ...)
+{
+	va_list arguments;
+	long pArguments[6];
+
+	va_start(arguments, number);
+	for(uint32_t ctr = 0; ctr < 6; ctr++)
+	{
+		pArguments[ctr] = va_arg(arguments, long);
+	}
+	va_end(arguments);
+
+	bench_CountSyscall();
+	return __real_syscall(number, pArguments[0], pArguments[1], pArguments[2], pArguments[3], pArguments[4], pArguments[5]);
+}
+
+//------------------------------------------------------------------------------
+//
+static double bench_GetSeconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + ((double)now.tv_nsec * 1e-9);
+}
+
+//------------------------------------------------------------------------------
+//
+static void bench_GenericFunction(modbus_Pdu_t *pRequest, modbus_Pdu_t *pResponse)
+{
+	(void)pRequest;
+	modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e bench_ReadRegisters(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint16_t *pValues)
+{
+	(void)functionCode;
+
+	if(((uint32_t)startAddress + quantity) > BENCH_QUANTITY)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	memcpy(pValues, &s_pRegisters[startAddress], quantity * sizeof(uint16_t));
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+static const modbus_Handlers_t s_handlers =
+{
+	.pGenericFunctionHandler = bench_GenericFunction,
+	.pReadRegisterBlockHandler = bench_ReadRegisters,
+};
+
+//------------------------------------------------------------------------------
+//
+static void *bench_ServerThread(void *pArgument)
+{
+	(void)pArgument;
+	s_isServerThread = true;
+
+	while(!__atomic_load_n(&s_stop, __ATOMIC_RELAXED))
+	{
+		bench_ServerPoll(&s_server, 10);
+	}
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+//
+static int bench_Connect(uint16_t port)
+{
+	const int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if((fd < 0) || (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0))
+	{
+		printf("connect() failed.\n");
+		exit(1);
+	}
+
+	const int enable = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+	return fd;
+}
+
+//------------------------------------------------------------------------------
+// `count` back-to-back FC 0x03 requests.
+static uint32_t bench_BuildRequests(uint8_t *pBuffer, uint32_t count)
+{
+	uint32_t size = 0;
+
+	for(uint32_t ctr = 0; ctr < count; ctr++)
+	{
+		modbus_Pdu_t request;
+		request.busAddress = 1;
+		request.functionCode = MODBUS_FUNCTION_READHOLDING;
+		request.pPayload[0] = 0;
+		request.pPayload[1] = 0;
+		request.pPayload[2] = 0;
+		request.pPayload[3] = BENCH_QUANTITY;
+		request.payloadSize = 4;
+
+		size += modbus_EncodeTcp(&pBuffer[size], MODBUS_TCP_FRAME_SIZE, (uint16_t)ctr, &request);
+	}
+
+	return size;
+}
+
+//------------------------------------------------------------------------------
+//
+static void bench_Exchange(int fd, const uint8_t *pRequests, uint32_t requestSize, uint32_t responseSize)
+{
+	uint8_t pResponses[BENCH_DEPTH * BENCH_RESPONSE_SIZE];
+
+	if(send(fd, pRequests, requestSize, MSG_NOSIGNAL) != (ssize_t)requestSize)
+	{
+		printf("send() failed.\n");
+		exit(1);
+	}
+
+	for(uint32_t received = 0; received < responseSize;)
+	{
+		const ssize_t size = recv(fd, &pResponses[received], responseSize - received, 0);
+		if(size <= 0)
+		{
+			printf("recv() failed.\n");
+			exit(1);
+		}
+		received += (uint32_t)size;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void bench_Report(const char *pName, double seconds, uint64_t syscallCount, uint32_t requestCount)
+{
+	printf("  %-22s %7.2f us per request   %5.2f syscalls per request\n",
+		pName, seconds * 1e6 / requestCount, (double)syscallCount / requestCount);
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	modbus_t instance;
+	memset(&instance, 0, sizeof(instance));
+	instance.busAddress = 1;
+	instance.pHandlers = &s_handlers;
+
+	if(!bench_ServerInit(&s_server, &instance, "127.0.0.1", 0, s_pConnections, BENCH_CONNECTIONS))
+	{
+		printf("%s backend not available.\n", BENCH_BACKEND);
+		return 0;
+	}
+
+	const uint16_t port = bench_ServerGetPort(&s_server);
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, bench_ServerThread, NULL);
+
+	for(uint32_t ctr = 0; ctr < BENCH_CONNECTIONS; ctr++)
+	{
+		s_pClients[ctr] = bench_Connect(port);
+	}
+
+	uint8_t pRequests[BENCH_DEPTH * BENCH_REQUEST_SIZE];
+	uint32_t requestSize = bench_BuildRequests(pRequests, 1);
+
+	// Warm-up, also makes sure every connection has been accepted.
+	for(uint32_t ctr = 0; ctr < BENCH_CONNECTIONS; ctr++)
+	{
+		bench_Exchange(s_pClients[ctr], pRequests, requestSize, BENCH_RESPONSE_SIZE);
+	}
+
+	// Round trip of a single request, one connection.
+	uint64_t syscallCount = __atomic_load_n(&s_syscallCount, __ATOMIC_RELAXED);
+	double start = bench_GetSeconds();
+
+	for(uint32_t ctr = 0; ctr < BENCH_SINGLE_REQUESTS; ctr++)
+	{
+		bench_Exchange(s_pClients[0], pRequests, requestSize, BENCH_RESPONSE_SIZE);
+	}
+
+	printf("%s backend:\n", BENCH_BACKEND);
+	bench_Report("1 in flight",
+		bench_GetSeconds() - start, __atomic_load_n(&s_syscallCount, __ATOMIC_RELAXED) - syscallCount, BENCH_SINGLE_REQUESTS);
+
+	// All connections write BENCH_DEPTH requests at once, then all responses are read.
+	requestSize = bench_BuildRequests(pRequests, BENCH_DEPTH);
+	syscallCount = __atomic_load_n(&s_syscallCount, __ATOMIC_RELAXED);
+	start = bench_GetSeconds();
+
+	for(uint32_t round = 0; round < BENCH_ROUNDS; round++)
+	{
+		for(uint32_t ctr = 0; ctr < BENCH_CONNECTIONS; ctr++)
+		{
+			if(send(s_pClients[ctr], pRequests, requestSize, MSG_NOSIGNAL) != (ssize_t)requestSize)
+			{
+				printf("send() failed.\n");
+				return 1;
+			}
+		}
+
+		for(uint32_t ctr = 0; ctr < BENCH_CONNECTIONS; ctr++)
+		{
+			bench_Exchange(s_pClients[ctr], pRequests, 0, BENCH_DEPTH * BENCH_RESPONSE_SIZE);
+		}
+	}
+
+	bench_Report("64 connections x 8",
+		bench_GetSeconds() - start, __atomic_load_n(&s_syscallCount, __ATOMIC_RELAXED) - syscallCount, BENCH_ROUNDS * BENCH_CONNECTIONS * BENCH_DEPTH);
+
+	__atomic_store_n(&s_stop, true, __ATOMIC_RELAXED);
+	pthread_join(thread, NULL);
+
+	for(uint32_t ctr = 0; ctr < BENCH_CONNECTIONS; ctr++)
+	{
+		close(s_pClients[ctr]);
+	}
+	bench_ServerClose(&s_server);
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+#!/bin/sh
+#
+# Builds and runs the benchmarks with the host compiler.
+# Usage: Benchmark/run.sh [additional compiler flags, e.g. -march=native]
+#
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+# The sources include <ModbusEmbedded/...>, which is the checkout itself.
+mkdir -p "$BUILD/include"
+ln -s "$ROOT" "$BUILD/include/ModbusEmbedded"
+
+CC=${CC:-cc}
+CXX=${CXX:-c++}
+CFLAGS="-std=gnu11 -O2 -I$BUILD/include $*"
+
+$CC $CFLAGS -o "$BUILD/buffer" "$ROOT/Benchmark/modbus_buffer_bench.c" "$ROOT/Src/modbus_Buffer.c"
+echo "== modbus_Buffer lookup"
+"$BUILD/buffer"
+
+# Once per CRC engine.
+for ENGINE in "" "-DMODBUS_CRC_SLICING8" "-DMODBUS_CRC_CLMUL" "-DMODBUS_CRC_SLICING8 -DMODBUS_CRC_CLMUL"
+do
+	$CC $CFLAGS $ENGINE -o "$BUILD/checksum" "$ROOT/Benchmark/modbus_checksum_bench.c" "$ROOT/Src/modbus_checksum.c" "$ROOT/Src/modbus.c"
+	echo "== CRC ${ENGINE:-(table)}"
+	"$BUILD/checksum"
+done
+
+# With the SSE2 path (where available) and with the lookup tables only.
+for HEX_FLAGS in "" "-U__SSE2__"
+do
+	$CC $CFLAGS $HEX_FLAGS -o "$BUILD/hex" "$ROOT/Benchmark/modbus_hex_bench.c" "$ROOT/Src/modbus_hex.c" "$ROOT/Src/modbus_data_frames.c" "$ROOT/Src/modbus_checksum.c" "$ROOT/Src/modbus.c"
+	echo "== ASCII hex codec ${HEX_FLAGS:-(default)}"
+	"$BUILD/hex"
+done
+
+$CC $CFLAGS -c -o "$BUILD/modbus.o" "$ROOT/Src/modbus.c"
+$CC $CFLAGS -c -o "$BUILD/modbus_Bits.o" "$ROOT/Src/modbus_Bits.c"
+$CXX -std=c++17 -O2 -I"$BUILD/include" "$@" -o "$BUILD/slave" "$ROOT/Benchmark/modbus_slave_bench.cpp" "$BUILD/modbus.o" "$BUILD/modbus_Bits.o"
+echo "== modbus::Slave<Map> against the C callback path"
+"$BUILD/slave"
+
+# Both TCP backends under the same loopback client load. The server thread's
+# system calls are counted by wrapping the calls the backends make.
+CORE="$ROOT/Src/modbus.c $ROOT/Src/modbus_Bits.c $ROOT/Src/modbus_data_frames.c $ROOT/Src/modbus_checksum.c $ROOT/Src/modbus_hex.c"
+WRAP="-Wl,--wrap=epoll_wait,--wrap=epoll_ctl,--wrap=recv,--wrap=__recv_chk,--wrap=send,--wrap=accept4,--wrap=setsockopt,--wrap=shutdown,--wrap=close,--wrap=syscall"
+for BACKEND in "" "-DMODBUS_TCP_URING"
+do
+	$CC $CFLAGS $BACKEND -pthread $WRAP -o "$BUILD/tcp" "$ROOT/Benchmark/modbus_tcp_bench.c" "$ROOT/Src/modbus_TcpServer.c" "$ROOT/Src/modbus_TcpUring.c" $CORE
+	echo "== TCP server ${BACKEND:-(epoll)}"
+	"$BUILD/tcp"
+done
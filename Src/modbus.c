@@ -1,6 +1,7 @@
 
 #include <stdio.h>
 #include <stddef.h>
+#include <string.h>
 
 #include <ModbusEmbedded/modbus.h>
 #include <ModbusEmbedded/modbus_function.h>
@@ -8,27 +9,63 @@
 
 
 
-static void modbus_ProcessRead(modbus_t *pInstance);
-static void modbus_ProcessReadBit(modbus_Pdu_t *pResponsePdu, modbus_ReadCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity);
-static void modbus_ProcessReadRegister(modbus_Pdu_t *pResponsePdu, modbus_ReadCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity);
+static bool modbus_IsAddressed(const modbus_t *pInstance, const modbus_PduView_t *pRequest);
+static void modbus_CallGenericFunctionHandler(modbus_t *pInstance, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse);
 
-static void modbus_ProcessWriteSingle(modbus_t *pInstance);
+static void modbus_ProcessRead(modbus_t *pInstance, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse);
+static void modbus_ProcessReadBit(modbus_PduView_t *pResponsePdu, modbus_ReadCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity);
+static void modbus_ProcessReadBitBlock(modbus_PduView_t *pResponsePdu, modbus_ReadBitBlockCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity);
+static void modbus_ProcessReadRegister(modbus_PduView_t *pResponsePdu, modbus_ReadCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity);
+static void modbus_ProcessReadRegisterBlock(modbus_PduView_t *pResponsePdu, modbus_ReadBlockCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity);
+static void modbus_ProcessReadRegisterBytes(modbus_PduView_t *pResponsePdu, modbus_ReadBytesCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity);
 
-static void modbus_ProcessWriteMultiple(modbus_t *pInstance);
-static void modbus_ProcessWriteMultipleBits(modbus_Pdu_t *pResponsePdu, modbus_WriteCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer);
-static void modbus_ProcessWriteMultipleRegisters(modbus_Pdu_t *pResponsePdu, modbus_WriteCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer);
+static void modbus_ProcessWriteSingle(modbus_t *pInstance, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse);
+
+static void modbus_ProcessWriteMultiple(modbus_t *pInstance, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse);
+static void modbus_ProcessWriteMultipleBits(modbus_PduView_t *pResponsePdu, modbus_WriteCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer);
+static void modbus_ProcessWriteMultipleRegisters(modbus_PduView_t *pResponsePdu, modbus_WriteCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer);
+static void modbus_ProcessWriteMultipleBlock(modbus_PduView_t *pResponsePdu, modbus_WriteBlockCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pByteBuffer);
 
 //------------------------------------------------------------------------------
 //
-void modbus_ProcessData(modbus_t *pInstance)
+bool modbus_ProcessData(modbus_t *pInstance)
 {
 	MODBUS_ASSERT(pInstance != NULL);
-	MODBUS_ASSERT(pInstance->pGenericFunctionHandler != NULL);
 
-	pInstance->pduResponse.functionCode = pInstance->pduRequest.functionCode;
-	pInstance->pduResponse.busAddress = pInstance->pduRequest.busAddress;
+	modbus_PduView_t request = modbus_GetPduView(MODBUS_REQUEST_PDU(pInstance));
+	modbus_PduView_t response = modbus_GetPduView(MODBUS_RESPONSE_PDU(pInstance));
+
+	if(!modbus_ProcessView(pInstance, &request, &response))
+	{
+		return false;
+	}
+
+	MODBUS_RESPONSE_PDU(pInstance)->busAddress = response.busAddress;
+	MODBUS_RESPONSE_PDU(pInstance)->functionCode = response.functionCode;
+	MODBUS_RESPONSE_PDU(pInstance)->payloadSize = response.payloadSize;
+	return true;
+}
 
-    switch(pInstance->pduRequest.functionCode)
+//------------------------------------------------------------------------------
+//
+bool modbus_ProcessView(modbus_t *pInstance, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse)
+{
+	MODBUS_ASSERT(pInstance != NULL);
+	MODBUS_ASSERT(pInstance->pHandlers != NULL);
+	MODBUS_ASSERT(pInstance->pHandlers->pGenericFunctionHandler != NULL);
+	MODBUS_ASSERT(pRequest != NULL);
+	MODBUS_ASSERT(pResponse != NULL);
+	MODBUS_ASSERT(pResponse->payloadCapacity >= MODBUS_PAYLOAD_SIZE);
+
+	if(!modbus_IsAddressed(pInstance, pRequest))
+	{
+		return false;
+	}
+
+	pResponse->functionCode = pRequest->functionCode;
+	pResponse->busAddress = pRequest->busAddress;
+
+    switch(pRequest->functionCode)
     {
         // Read Functions
         case MODBUS_FUNCTION_READCOILS:
@@ -36,7 +73,7 @@ void modbus_ProcessData(modbus_t *pInstance)
         case MODBUS_FUNCTION_READHOLDING:
         case MODBUS_FUNCTION_READINPUT:
         {
-            modbus_ProcessRead(pInstance);
+            modbus_ProcessRead(pInstance, pRequest, pResponse);
             break;
         }
 
@@ -47,7 +84,7 @@ void modbus_ProcessData(modbus_t *pInstance)
         case MODBUS_FUNCTION_WRITESINGLE_COIL:
         case MODBUS_FUNCTION_WRITESINGLE_REG:
         {
-        	modbus_ProcessWriteSingle(pInstance);
+        	modbus_ProcessWriteSingle(pInstance, pRequest, pResponse);
             break;
         }
 
@@ -55,29 +92,65 @@ void modbus_ProcessData(modbus_t *pInstance)
         case MODBUS_FUNCTION_WRITEMULT_COILS:
         case MODBUS_FUNCTION_WRITEMULT_REGS:
         {
-        	modbus_ProcessWriteMultiple(pInstance);
+        	modbus_ProcessWriteMultiple(pInstance, pRequest, pResponse);
             break;
         }
 
         default:
         {
             // Illegal Function Exception
-            printf("Function [%02u] not implemented yet.\n", pInstance->pduRequest.functionCode);
-            modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, &pInstance->pduResponse);
+            printf("Function [%02u] not implemented yet.\n", pRequest->functionCode);
+            modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
             break;
         }
     }
+
+    // Broadcasts are applied, but never answered.
+    return (pRequest->busAddress != MODBUS_BROADCAST_ADDRESS) || pInstance->noBroadcast;
 }
 
 //------------------------------------------------------------------------------
 //
 void modbus_SetExceptionResponse(modbus_Exception_e exceptionCode, modbus_Pdu_t *pResponsePdu)
 {
+	MODBUS_ASSERT(pResponsePdu != NULL);
+
+	modbus_PduView_t view = modbus_GetPduView(pResponsePdu);
+	modbus_SetExceptionView(exceptionCode, &view);
+
+	pResponsePdu->functionCode = (uint8_t)view.functionCode;
+	pResponsePdu->payloadSize = view.payloadSize;
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_SetExceptionView(modbus_Exception_e exceptionCode, modbus_PduView_t *pResponsePdu)
+{
+	MODBUS_ASSERT(pResponsePdu != NULL);
+
 	pResponsePdu->functionCode |= 0x80;
 	pResponsePdu->pPayload[0] = (uint8_t)exceptionCode;
 	pResponsePdu->payloadSize = 1;
 }
 
+//------------------------------------------------------------------------------
+//
+modbus_PduView_t modbus_GetPduView(modbus_Pdu_t *pPdu)
+{
+	MODBUS_ASSERT(pPdu != NULL);
+
+	modbus_PduView_t view =
+	{
+		.busAddress = pPdu->busAddress,
+		.functionCode = pPdu->functionCode,
+		.pPayload = pPdu->pPayload,
+		.payloadSize = pPdu->payloadSize,
+		.payloadCapacity = MODBUS_PAYLOAD_SIZE
+	};
+
+	return view;
+}
+
 
 
 //------------------------------------------------------------------------------
@@ -91,63 +164,135 @@ __attribute__((weak)) void modbus_AssertFailedHandler(const char *pFileName, uin
 
 
 
+//------------------------------------------------------------------------------
+// Broadcasts only make sense for writes, reads would have nobody to answer to.
+// Without broadcasts (Modbus TCP), address 0 is the instance itself.
+static bool modbus_IsAddressed(const modbus_t *pInstance, const modbus_PduView_t *pRequest)
+{
+	if((pRequest->busAddress == MODBUS_BROADCAST_ADDRESS) && pInstance->noBroadcast)
+	{
+		return true;
+	}
+
+	if(pRequest->busAddress != MODBUS_BROADCAST_ADDRESS)
+	{
+		return (pInstance->busAddress == MODBUS_BROADCAST_ADDRESS) || (pRequest->busAddress == pInstance->busAddress);
+	}
+
+	switch(pRequest->functionCode)
+	{
+		case MODBUS_FUNCTION_WRITESINGLE_COIL:
+		case MODBUS_FUNCTION_WRITESINGLE_REG:
+		case MODBUS_FUNCTION_WRITEMULT_COILS:
+		case MODBUS_FUNCTION_WRITEMULT_REGS:
+		{
+			return true;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
 //------------------------------------------------------------------------------
 //
-static void modbus_ProcessRead(modbus_t *pInstance)
+static void modbus_CallGenericFunctionHandler(modbus_t *pInstance, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse)
+{
+	MODBUS_ASSERT(pInstance->pHandlers->pGenericFunctionHandler != NULL);
+
+	// The generic handler works on separate full PDUs, while the instance builds responses
+	// in place over the request. The request goes through a copy on the stack.
+	modbus_Pdu_t request;
+	request.busAddress = pRequest->busAddress;
+	request.functionCode = pRequest->functionCode;
+	request.payloadSize = pRequest->payloadSize;
+	memcpy(request.pPayload, pRequest->pPayload, pRequest->payloadSize);
+
+	modbus_Pdu_t *pResponsePdu = MODBUS_RESPONSE_PDU(pInstance);
+	pResponsePdu->busAddress = pResponse->busAddress;
+	pResponsePdu->functionCode = pResponse->functionCode;
+	pResponsePdu->payloadSize = 0;
+
+	pInstance->pHandlers->pGenericFunctionHandler(&request, pResponsePdu);
+
+	MODBUS_ASSERT(pResponsePdu->payloadSize <= pResponse->payloadCapacity);
+
+	pResponse->functionCode = pResponsePdu->functionCode;
+	pResponse->payloadSize = pResponsePdu->payloadSize;
+	if(pResponse->pPayload != pResponsePdu->pPayload)
+	{
+		memcpy(pResponse->pPayload, pResponsePdu->pPayload, pResponsePdu->payloadSize);
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_ProcessRead(modbus_t *pInstance, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse)
 {
 	MODBUS_ASSERT(pInstance != NULL);
-	MODBUS_ASSERT(pInstance->pGenericFunctionHandler != NULL);
+	MODBUS_ASSERT(pInstance->pHandlers->pGenericFunctionHandler != NULL);
 
-	if(pInstance->pduRequest.payloadSize != 4)
+	if(pRequest->payloadSize != 4)
 	{
-		modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &pInstance->pduResponse);
+		modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
 		return;
 	}
 
     modbus_ReadCallback_t pCallback = NULL;
-    switch(pInstance->pduRequest.functionCode)
+    modbus_ReadBlockCallback_t pBlockCallback = NULL;
+    modbus_ReadBitBlockCallback_t pBitBlockCallback = NULL;
+    modbus_ReadBytesCallback_t pBytesCallback = NULL;
+    switch(pRequest->functionCode)
     {
         case MODBUS_FUNCTION_READCOILS:
         {
-        	pCallback = pInstance->pReadCoilHandler;
+        	pCallback = pInstance->pHandlers->pReadCoilHandler;
+        	pBitBlockCallback = pInstance->pHandlers->pReadBitBlockHandler;
             break;
         }
 
         case MODBUS_FUNCTION_READDISCRETE:
         {
-        	pCallback = pInstance->pReadDiscreteHandler;
+        	pCallback = pInstance->pHandlers->pReadDiscreteHandler;
+        	pBitBlockCallback = pInstance->pHandlers->pReadBitBlockHandler;
             break;
         }
 
         case MODBUS_FUNCTION_READHOLDING:
         {
-        	pCallback = pInstance->pReadHoldingRegisterHandler;
+        	pCallback = pInstance->pHandlers->pReadHoldingRegisterHandler;
+        	pBlockCallback = pInstance->pHandlers->pReadRegisterBlockHandler;
+        	pBytesCallback = pInstance->pHandlers->pReadRegisterBytesHandler;
             break;
         }
 
         case MODBUS_FUNCTION_READINPUT:
         {
-        	pCallback = pInstance->pReadInputRegisterHandler;
+        	pCallback = pInstance->pHandlers->pReadInputRegisterHandler;
+        	pBlockCallback = pInstance->pHandlers->pReadRegisterBlockHandler;
+        	pBytesCallback = pInstance->pHandlers->pReadRegisterBytesHandler;
             break;
         }
 
         default:
         {
-        	modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, &pInstance->pduResponse);
+        	modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
         	return;
         }
     }
 
-    if(pCallback == NULL)
+    if((pCallback == NULL) && (pBlockCallback == NULL) && (pBitBlockCallback == NULL) && (pBytesCallback == NULL))
     {
-        if(pInstance->pGenericReadHandler == NULL)
+        if(pInstance->pHandlers->pGenericReadHandler == NULL)
         {
-        	pInstance->pGenericFunctionHandler(&pInstance->pduRequest, &pInstance->pduResponse);
+        	modbus_CallGenericFunctionHandler(pInstance, pRequest, pResponse);
         	return;
         }
         else
         {
-        	pCallback = pInstance->pGenericReadHandler;
+        	pCallback = pInstance->pHandlers->pGenericReadHandler;
         }
     }
 
@@ -156,23 +301,27 @@ static void modbus_ProcessRead(modbus_t *pInstance)
     uint16_t startAddress = 0;
     uint16_t quantity = 0;
 
-    startAddress |= (uint16_t)pInstance->pduRequest.pPayload[0] << 8;
-    startAddress |= (uint16_t)pInstance->pduRequest.pPayload[1];
+    startAddress |= (uint16_t)pRequest->pPayload[0] << 8;
+    startAddress |= (uint16_t)pRequest->pPayload[1];
 
-    quantity |= (uint16_t)pInstance->pduRequest.pPayload[2] << 8;
-    quantity |= (uint16_t)pInstance->pduRequest.pPayload[3];
+    quantity |= (uint16_t)pRequest->pPayload[2] << 8;
+    quantity |= (uint16_t)pRequest->pPayload[3];
 
-    if(pInstance->pduRequest.functionCode == MODBUS_FUNCTION_READCOILS ||
-    	pInstance->pduRequest.functionCode == MODBUS_FUNCTION_READDISCRETE)
+    if(pRequest->functionCode == MODBUS_FUNCTION_READCOILS ||
+    	pRequest->functionCode == MODBUS_FUNCTION_READDISCRETE)
     {
         if(quantity < 0x0001 || quantity > MODBUS_READ_BIT_MAX_QUANTITY)
         {
             // Illegal data value
-            modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &pInstance->pduResponse);
+            modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
+        }
+        else if(pBitBlockCallback != NULL)
+        {
+            modbus_ProcessReadBitBlock(pResponse, pBitBlockCallback, pRequest->functionCode, startAddress, quantity);
         }
         else
         {
-            modbus_ProcessReadBit(&pInstance->pduResponse, pCallback, pInstance->pduRequest.functionCode, startAddress, quantity);
+            modbus_ProcessReadBit(pResponse, pCallback, pRequest->functionCode, startAddress, quantity);
         }
     }
     else
@@ -180,18 +329,26 @@ static void modbus_ProcessRead(modbus_t *pInstance)
         if(quantity < 0x0001 || quantity > MODBUS_READ_REGISTER_MAX_QUANTITY)
         {
             // Illegal data value
-            modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &pInstance->pduResponse);
+            modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
+        }
+        else if(pBytesCallback != NULL)
+        {
+            modbus_ProcessReadRegisterBytes(pResponse, pBytesCallback, pRequest->functionCode, startAddress, quantity);
+        }
+        else if(pBlockCallback != NULL)
+        {
+            modbus_ProcessReadRegisterBlock(pResponse, pBlockCallback, pRequest->functionCode, startAddress, quantity);
         }
         else
         {
-            modbus_ProcessReadRegister(&pInstance->pduResponse, pCallback, pInstance->pduRequest.functionCode, startAddress, quantity);
+            modbus_ProcessReadRegister(pResponse, pCallback, pRequest->functionCode, startAddress, quantity);
         }
     }
 }
 
 //------------------------------------------------------------------------------
 //
-static void modbus_ProcessReadBit(modbus_Pdu_t *pResponsePdu, modbus_ReadCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
+static void modbus_ProcessReadBit(modbus_PduView_t *pResponsePdu, modbus_ReadCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
 {
     MODBUS_ASSERT(pResponsePdu != NULL);
     MODBUS_ASSERT(pCallback != NULL);
@@ -206,12 +363,12 @@ static void modbus_ProcessReadBit(modbus_Pdu_t *pResponsePdu, modbus_ReadCallbac
 
     while(((pResponsePdu->payloadSize - 1) * 8 + bitCtr) < quantity)
     {
-        const uint16_t address = (pResponsePdu->payloadSize - 1) * 8 + bitCtr;
+        const uint16_t address = startAddress + (pResponsePdu->payloadSize - 1) * 8 + bitCtr;
 
         ret = pCallback(functionCode, address, &valueBuffer);
         if(ret != MODBUS_EXCEPTION_SUCCESS)
         {
-            modbus_SetExceptionResponse(ret, pResponsePdu);
+            modbus_SetExceptionView(ret, pResponsePdu);
             return;
         }
 
@@ -229,12 +386,46 @@ static void modbus_ProcessReadBit(modbus_Pdu_t *pResponsePdu, modbus_ReadCallbac
         }
     }
 
+    if(bitCtr > 0)
+    {
+        pResponsePdu->payloadSize++;
+    }
+
     pResponsePdu->pPayload[0] = (pResponsePdu->payloadSize - 1);
 }
 
 //------------------------------------------------------------------------------
 //
-static void modbus_ProcessReadRegister(modbus_Pdu_t *pResponsePdu, modbus_ReadCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
+static void modbus_ProcessReadBitBlock(modbus_PduView_t *pResponsePdu, modbus_ReadBitBlockCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
+{
+    MODBUS_ASSERT(pResponsePdu != NULL);
+    MODBUS_ASSERT(pCallback != NULL);
+    MODBUS_ASSERT(quantity <= MODBUS_READ_BIT_MAX_QUANTITY);
+
+    const uint16_t byteCount = (quantity + 7) / 8;
+    uint8_t *pByteBuffer = &pResponsePdu->pPayload[1];
+
+    memset(pByteBuffer, 0, byteCount);
+
+    modbus_Exception_e ret = pCallback(functionCode, startAddress, quantity, pByteBuffer);
+    if(ret != MODBUS_EXCEPTION_SUCCESS)
+    {
+        modbus_SetExceptionView(ret, pResponsePdu);
+        return;
+    }
+
+    if((quantity % 8) != 0)
+    {
+        pByteBuffer[byteCount - 1] &= (uint8_t)((1 << (quantity % 8)) - 1);
+    }
+
+    pResponsePdu->pPayload[0] = (uint8_t)byteCount;
+    pResponsePdu->payloadSize = 1 + byteCount;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_ProcessReadRegister(modbus_PduView_t *pResponsePdu, modbus_ReadCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
 {
     MODBUS_ASSERT(pResponsePdu != NULL);
     MODBUS_ASSERT(pCallback != NULL);
@@ -250,7 +441,7 @@ static void modbus_ProcessReadRegister(modbus_Pdu_t *pResponsePdu, modbus_ReadCa
         ret = pCallback(functionCode, startAddress + ctr, &valueBuffer);
         if(ret != MODBUS_EXCEPTION_SUCCESS)
         {
-            modbus_SetExceptionResponse(ret, pResponsePdu);
+            modbus_SetExceptionView(ret, pResponsePdu);
             return;
         }
 
@@ -260,52 +451,99 @@ static void modbus_ProcessReadRegister(modbus_Pdu_t *pResponsePdu, modbus_ReadCa
     }
 }
 
+//------------------------------------------------------------------------------
+//
+static void modbus_ProcessReadRegisterBlock(modbus_PduView_t *pResponsePdu, modbus_ReadBlockCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
+{
+    MODBUS_ASSERT(pResponsePdu != NULL);
+    MODBUS_ASSERT(pCallback != NULL);
+    MODBUS_ASSERT(quantity <= MODBUS_READ_REGISTER_MAX_QUANTITY);
+
+    uint16_t pValueBuffer[MODBUS_READ_REGISTER_MAX_QUANTITY];
+
+    modbus_Exception_e ret = pCallback(functionCode, startAddress, quantity, pValueBuffer);
+    if(ret != MODBUS_EXCEPTION_SUCCESS)
+    {
+        modbus_SetExceptionView(ret, pResponsePdu);
+        return;
+    }
+
+    uint8_t *pByteBuffer = &pResponsePdu->pPayload[1];
+    for(uint16_t ctr = 0; ctr < quantity; ctr++)
+    {
+        pByteBuffer[ctr * 2] = (uint8_t)((pValueBuffer[ctr] >> 8) & 0xFF);
+        pByteBuffer[ctr * 2 + 1] = (uint8_t)(pValueBuffer[ctr] & 0xFF);
+    }
+
+    pResponsePdu->pPayload[0] = (uint8_t)(2 * quantity);
+    pResponsePdu->payloadSize = 1 + (2 * quantity);
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_ProcessReadRegisterBytes(modbus_PduView_t *pResponsePdu, modbus_ReadBytesCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
+{
+    MODBUS_ASSERT(pResponsePdu != NULL);
+    MODBUS_ASSERT(pCallback != NULL);
+    MODBUS_ASSERT(quantity <= MODBUS_READ_REGISTER_MAX_QUANTITY);
+
+    modbus_Exception_e ret = pCallback(functionCode, startAddress, quantity, &pResponsePdu->pPayload[1]);
+    if(ret != MODBUS_EXCEPTION_SUCCESS)
+    {
+        modbus_SetExceptionView(ret, pResponsePdu);
+        return;
+    }
+
+    pResponsePdu->pPayload[0] = (uint8_t)(2 * quantity);
+    pResponsePdu->payloadSize = 1 + (2 * quantity);
+}
+
 
 //------------------------------------------------------------------------------
 //
-static void modbus_ProcessWriteSingle(modbus_t *pInstance)
+static void modbus_ProcessWriteSingle(modbus_t *pInstance, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse)
 {
 	MODBUS_ASSERT(pInstance != NULL);
-	MODBUS_ASSERT(pInstance->pGenericFunctionHandler != NULL);
+	MODBUS_ASSERT(pInstance->pHandlers->pGenericFunctionHandler != NULL);
 
-	if(pInstance->pduRequest.payloadSize != 4)
+	if(pRequest->payloadSize != 4)
 	{
-		modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &pInstance->pduResponse);
+		modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
 		return;
 	}
 
 	modbus_WriteCallback_t pCallback = NULL;
-	switch(pInstance->pduRequest.functionCode)
+	switch(pRequest->functionCode)
 	{
 		case MODBUS_FUNCTION_WRITESINGLE_COIL:
 		{
-			pCallback = pInstance->pWriteCoilHandler;
+			pCallback = pInstance->pHandlers->pWriteCoilHandler;
 			break;
 		}
 
 		case MODBUS_FUNCTION_WRITESINGLE_REG:
 		{
-			pCallback = pInstance->pWriteRegisterHandler;
+			pCallback = pInstance->pHandlers->pWriteRegisterHandler;
 			break;
 		}
 
 		default:
 		{
-			modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, &pInstance->pduResponse);
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
 			return;
 		}
 	}
 
 	if(pCallback == NULL)
 	{
-		if(pInstance->pGenericWriteHandler == NULL)
+		if(pInstance->pHandlers->pGenericWriteHandler == NULL)
 		{
-			pInstance->pGenericFunctionHandler(&pInstance->pduRequest, &pInstance->pduResponse);
+			modbus_CallGenericFunctionHandler(pInstance, pRequest, pResponse);
 			return;
 		}
 		else
 		{
-			pCallback = pInstance->pGenericWriteHandler;
+			pCallback = pInstance->pHandlers->pGenericWriteHandler;
 		}
 	}
 
@@ -314,80 +552,84 @@ static void modbus_ProcessWriteSingle(modbus_t *pInstance)
 	uint16_t address = 0;
 	uint16_t value = 0;
 
-	address |= (uint16_t)pInstance->pduRequest.pPayload[0] << 8;
-	address |= (uint16_t)pInstance->pduRequest.pPayload[1];
+	address |= (uint16_t)pRequest->pPayload[0] << 8;
+	address |= (uint16_t)pRequest->pPayload[1];
 
-	value |= (uint16_t)pInstance->pduRequest.pPayload[2] << 8;
-	value |= (uint16_t)pInstance->pduRequest.pPayload[3];
+	value |= (uint16_t)pRequest->pPayload[2] << 8;
+	value |= (uint16_t)pRequest->pPayload[3];
 
-	if(pInstance->pduRequest.functionCode == MODBUS_FUNCTION_WRITESINGLE_COIL)
+	if(pRequest->functionCode == MODBUS_FUNCTION_WRITESINGLE_COIL)
 	{
 		if((value != MODBUS_BIT_ON) && (value != MODBUS_BIT_OFF))
 		{
-			modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &pInstance->pduResponse);
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
 			return;
 		}
 	}
 
-	modbus_Exception_e ret = pCallback(pInstance->pduRequest.functionCode, address, value);
+	modbus_Exception_e ret = pCallback(pRequest->functionCode, address, value);
 	if(ret != MODBUS_EXCEPTION_SUCCESS)
 	{
-		modbus_SetExceptionResponse(ret, &pInstance->pduResponse);
+		modbus_SetExceptionView(ret, pResponse);
+		return;
 	}
 
-	pInstance->pduResponse.functionCode = pInstance->pduRequest.functionCode;
-	pInstance->pduResponse.payloadSize = 4;
-	pInstance->pduResponse.pPayload[0] = (address >> 8) & 0xFF;
-	pInstance->pduResponse.pPayload[1] = address & 0xFF;
-	pInstance->pduResponse.pPayload[2] = (value >> 8) & 0xFF;
-	pInstance->pduResponse.pPayload[3] = value & 0xFF;
+	pResponse->functionCode = pRequest->functionCode;
+	pResponse->payloadSize = 4;
+	pResponse->pPayload[0] = (address >> 8) & 0xFF;
+	pResponse->pPayload[1] = address & 0xFF;
+	pResponse->pPayload[2] = (value >> 8) & 0xFF;
+	pResponse->pPayload[3] = value & 0xFF;
 }
 
 //------------------------------------------------------------------------------
 //
-static void modbus_ProcessWriteMultiple(modbus_t *pInstance)
+static void modbus_ProcessWriteMultiple(modbus_t *pInstance, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse)
 {
 	MODBUS_ASSERT(pInstance != NULL);
-	MODBUS_ASSERT(pInstance->pGenericFunctionHandler != NULL);
+	MODBUS_ASSERT(pInstance->pHandlers->pGenericFunctionHandler != NULL);
 
-	if(pInstance->pduRequest.payloadSize < 5)
+	if(pRequest->payloadSize < 5)
 	{
-		modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &pInstance->pduResponse);
+		modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
 		return;
 	}
 
 	modbus_WriteCallback_t pCallback = NULL;
-	switch(pInstance->pduRequest.functionCode)
+	modbus_WriteBlockCallback_t pBlockCallback = NULL;
+	switch(pRequest->functionCode)
 	{
 		case MODBUS_FUNCTION_WRITEMULT_COILS:
 		{
-			pCallback = pInstance->pWriteCoilHandler;
+			pCallback = pInstance->pHandlers->pWriteCoilHandler;
+			pBlockCallback = pInstance->pHandlers->pWriteCoilBlockHandler;
 			break;
 		}
 
 		case MODBUS_FUNCTION_WRITEMULT_REGS:
 		{
-			pCallback = pInstance->pWriteRegisterHandler;
+			pCallback = pInstance->pHandlers->pWriteRegisterHandler;
+			pBlockCallback = pInstance->pHandlers->pWriteRegisterBlockHandler;
 			break;
 		}
 
 		default:
 		{
-			modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, &pInstance->pduResponse);
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
 			return;
 		}
 	}
 
-	if(pCallback == NULL)
+	if((pCallback == NULL) && (pBlockCallback == NULL))
 	{
-		if(pInstance->pGenericWriteHandler == NULL)
+		if(pInstance->pHandlers->pGenericWriteHandler == NULL)
 		{
-			pInstance->pGenericFunctionHandler(&pInstance->pduRequest, &pInstance->pduResponse);
+			modbus_CallGenericFunctionHandler(pInstance, pRequest, pResponse);
 			return;
 		}
 		else
 		{
-			pCallback = pInstance->pGenericWriteHandler;
+			pCallback = pInstance->pHandlers->pGenericWriteHandler;
 		}
 	}
 
@@ -397,55 +639,67 @@ static void modbus_ProcessWriteMultiple(modbus_t *pInstance)
 	uint16_t quantity = 0;
 	uint8_t byteCount = 0;
 
-	startAddress |= (uint16_t)pInstance->pduRequest.pPayload[0] << 8;
-	startAddress |= (uint16_t)pInstance->pduRequest.pPayload[1];
+	startAddress |= (uint16_t)pRequest->pPayload[0] << 8;
+	startAddress |= (uint16_t)pRequest->pPayload[1];
 
-	quantity |= (uint16_t)pInstance->pduRequest.pPayload[2] << 8;
-	quantity |= (uint16_t)pInstance->pduRequest.pPayload[3];
+	quantity |= (uint16_t)pRequest->pPayload[2] << 8;
+	quantity |= (uint16_t)pRequest->pPayload[3];
 
-	byteCount = pInstance->pduRequest.pPayload[4];
+	byteCount = pRequest->pPayload[4];
 
-	if(pInstance->pduRequest.functionCode == MODBUS_FUNCTION_WRITEMULT_COILS)
+	if(pRequest->payloadSize != (5 + byteCount))
 	{
-		if(
-			(quantity > (byteCount * 8)) ||
-			(quantity < (byteCount * 8 - 1)))
+		modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
+		return;
+	}
+
+	if(pRequest->functionCode == MODBUS_FUNCTION_WRITEMULT_COILS)
+	{
+		if(byteCount != ((quantity + 7) / 8))
 		{
-			modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &pInstance->pduResponse);
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
 			return;
 		}
 		else if(quantity < 1 || quantity > MODBUS_WRITE_BIT_MAX_QUANTITY)
 		{
-			modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &pInstance->pduResponse);
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
 			return;
 		}
+		else if(pBlockCallback != NULL)
+		{
+			modbus_ProcessWriteMultipleBlock(pResponse, pBlockCallback, pRequest->functionCode, startAddress, quantity, &pRequest->pPayload[5]);
+		}
 		else
 		{
-			modbus_ProcessWriteMultipleBits(&pInstance->pduResponse, pCallback, pInstance->pduRequest.functionCode, startAddress, quantity, &pInstance->pduRequest.pPayload[5]);
+			modbus_ProcessWriteMultipleBits(pResponse, pCallback, pRequest->functionCode, startAddress, quantity, &pRequest->pPayload[5]);
 		}
 	}
 	else
 	{
-		if(quantity != (byteCount / 2))
+		if(byteCount != (quantity * 2))
 		{
-			modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &pInstance->pduResponse);
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
 			return;
 		}
 		else if(quantity < 1 || quantity > MODBUS_WRITE_REGISTER_MAX_QUANTITY)
 		{
-			modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &pInstance->pduResponse);
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, pResponse);
 			return;
 		}
+		else if(pBlockCallback != NULL)
+		{
+			modbus_ProcessWriteMultipleBlock(pResponse, pBlockCallback, pRequest->functionCode, startAddress, quantity, &pRequest->pPayload[5]);
+		}
 		else
 		{
-			modbus_ProcessWriteMultipleRegisters(&pInstance->pduResponse, pCallback, pInstance->pduRequest.functionCode, startAddress, quantity, &pInstance->pduRequest.pPayload[5]);
+			modbus_ProcessWriteMultipleRegisters(pResponse, pCallback, pRequest->functionCode, startAddress, quantity, &pRequest->pPayload[5]);
 		}
 	}
 }
 
 //------------------------------------------------------------------------------
 //
-static void modbus_ProcessWriteMultipleBits(modbus_Pdu_t *pResponsePdu, modbus_WriteCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer)
+static void modbus_ProcessWriteMultipleBits(modbus_PduView_t *pResponsePdu, modbus_WriteCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer)
 {
 	MODBUS_ASSERT(pResponsePdu != NULL);
 	MODBUS_ASSERT(pCallback != NULL);
@@ -464,7 +718,7 @@ static void modbus_ProcessWriteMultipleBits(modbus_Pdu_t *pResponsePdu, modbus_W
 		ret = pCallback(functionCode, address, valueBuffer);
 		if(ret != MODBUS_EXCEPTION_SUCCESS)
 		{
-			modbus_SetExceptionResponse(ret, pResponsePdu);
+			modbus_SetExceptionView(ret, pResponsePdu);
 			return;
 		}
 
@@ -486,7 +740,7 @@ static void modbus_ProcessWriteMultipleBits(modbus_Pdu_t *pResponsePdu, modbus_W
 
 //------------------------------------------------------------------------------
 //
-static void modbus_ProcessWriteMultipleRegisters(modbus_Pdu_t *pResponsePdu, modbus_WriteCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer)
+static void modbus_ProcessWriteMultipleRegisters(modbus_PduView_t *pResponsePdu, modbus_WriteCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer)
 {
 	MODBUS_ASSERT(pResponsePdu != NULL);
 	MODBUS_ASSERT(pCallback != NULL);
@@ -505,7 +759,7 @@ static void modbus_ProcessWriteMultipleRegisters(modbus_Pdu_t *pResponsePdu, mod
 		ret = pCallback(functionCode, address, valueBuffer);
 		if(ret != MODBUS_EXCEPTION_SUCCESS)
 		{
-			modbus_SetExceptionResponse(ret, pResponsePdu);
+			modbus_SetExceptionView(ret, pResponsePdu);
 			return;
 		}
 	}
@@ -518,4 +772,27 @@ static void modbus_ProcessWriteMultipleRegisters(modbus_Pdu_t *pResponsePdu, mod
 	pResponsePdu->pPayload[3] = quantity & 0xFF;
 }
 
+//------------------------------------------------------------------------------
+//
+static void modbus_ProcessWriteMultipleBlock(modbus_PduView_t *pResponsePdu, modbus_WriteBlockCallback_t pCallback, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pByteBuffer)
+{
+	MODBUS_ASSERT(pResponsePdu != NULL);
+	MODBUS_ASSERT(pCallback != NULL);
+	MODBUS_ASSERT(pByteBuffer != NULL);
+
+	modbus_Exception_e ret = pCallback(functionCode, startAddress, quantity, pByteBuffer);
+	if(ret != MODBUS_EXCEPTION_SUCCESS)
+	{
+		modbus_SetExceptionView(ret, pResponsePdu);
+		return;
+	}
+
+	pResponsePdu->functionCode = functionCode;
+	pResponsePdu->payloadSize = 4;
+	pResponsePdu->pPayload[0] = (startAddress >> 8) & 0xFF;
+	pResponsePdu->pPayload[1] = startAddress & 0xFF;
+	pResponsePdu->pPayload[2] = (quantity >> 8) & 0xFF;
+	pResponsePdu->pPayload[3] = quantity & 0xFF;
+}
+
 
@@ -0,0 +1,196 @@
+
+#include <ModbusEmbedded/modbus_ascii.h>
+#include <stddef.h>
+
+
+
+static modbus_Ascii_Event_e modbus_Ascii_DropFrame(modbus_Ascii_Receiver_t *pReceiver);
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_Ascii_Init(modbus_Ascii_Receiver_t *pReceiver, uint32_t timeoutMs)
+{
+	MODBUS_ASSERT(pReceiver != NULL);
+
+	pReceiver->timeoutMs = timeoutMs;
+
+	pReceiver->state = MODBUS_ASCII_STATE_IDLE;
+	pReceiver->lastCharMs = 0;
+	pReceiver->highNibble = 0;
+	pReceiver->highNibbleValid = false;
+	pReceiver->lrc = modbus_LrcInit();
+	pReceiver->frameSize = 0;
+
+	pReceiver->frameCount = 0;
+	pReceiver->lrcErrorCount = 0;
+	pReceiver->frameErrorCount = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Ascii_Event_e modbus_Ascii_PutChar(modbus_Ascii_Receiver_t *pReceiver, char value, uint32_t timestampMs)
+{
+	MODBUS_ASSERT(pReceiver != NULL);
+
+	modbus_Ascii_Event_e event = MODBUS_ASCII_EVENT_NONE;
+
+	if(pReceiver->state == MODBUS_ASCII_STATE_READY)
+	{
+		modbus_Ascii_ReleaseFrame(pReceiver);
+	}
+
+	if((pReceiver->state != MODBUS_ASCII_STATE_IDLE) && ((timestampMs - pReceiver->lastCharMs) > pReceiver->timeoutMs))
+	{
+		event = modbus_Ascii_DropFrame(pReceiver);
+	}
+	pReceiver->lastCharMs = timestampMs;
+
+	if(value == ':')
+	{
+		// Start of frame, also resyncs a frame in progress.
+		if(pReceiver->state != MODBUS_ASCII_STATE_IDLE)
+		{
+			event = modbus_Ascii_DropFrame(pReceiver);
+		}
+
+		pReceiver->state = MODBUS_ASCII_STATE_RECEPTION;
+		pReceiver->highNibbleValid = false;
+		pReceiver->lrc = modbus_LrcInit();
+		pReceiver->frameSize = 0;
+		return event;
+	}
+
+	switch(pReceiver->state)
+	{
+		case MODBUS_ASCII_STATE_IDLE:
+		{
+			// Noise between frames.
+			break;
+		}
+
+		case MODBUS_ASCII_STATE_RECEPTION:
+		{
+			if(value == '\r')
+			{
+				pReceiver->state = MODBUS_ASCII_STATE_WAITEND;
+				break;
+			}
+
+			const int8_t nibble = modbus_HexToNibble(value);
+			if((nibble < 0) || (pReceiver->frameSize >= sizeof(pReceiver->pFrame)))
+			{
+				event = modbus_Ascii_DropFrame(pReceiver);
+				break;
+			}
+
+			if(!pReceiver->highNibbleValid)
+			{
+				pReceiver->highNibble = (uint8_t)nibble;
+				pReceiver->highNibbleValid = true;
+				break;
+			}
+
+			const uint8_t byte = (uint8_t)((pReceiver->highNibble << 4) | nibble);
+			pReceiver->highNibbleValid = false;
+			pReceiver->pFrame[pReceiver->frameSize++] = byte;
+			pReceiver->lrc = modbus_LrcUpdateByte(pReceiver->lrc, byte);
+			break;
+		}
+
+		case MODBUS_ASCII_STATE_WAITEND:
+		{
+			if((value != '\n') || pReceiver->highNibbleValid || (pReceiver->frameSize < 3))
+			{
+				event = modbus_Ascii_DropFrame(pReceiver);
+				break;
+			}
+
+			if(pReceiver->lrc != MODBUS_LRC_RESIDUE)
+			{
+				pReceiver->lrcErrorCount++;
+				pReceiver->state = MODBUS_ASCII_STATE_IDLE;
+				event = MODBUS_ASCII_EVENT_ERROR;
+				break;
+			}
+
+			pReceiver->frameCount++;
+			pReceiver->state = MODBUS_ASCII_STATE_READY;
+			event = MODBUS_ASCII_EVENT_FRAME;
+			break;
+		}
+
+		default:
+		{
+			MODBUS_ASSERT(0);
+			break;
+		}
+	}
+
+	return event;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Ascii_Event_e modbus_Ascii_Poll(modbus_Ascii_Receiver_t *pReceiver, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pReceiver != NULL);
+
+	if((pReceiver->state != MODBUS_ASCII_STATE_RECEPTION) && (pReceiver->state != MODBUS_ASCII_STATE_WAITEND))
+	{
+		return MODBUS_ASCII_EVENT_NONE;
+	}
+
+	if((nowMs - pReceiver->lastCharMs) <= pReceiver->timeoutMs)
+	{
+		return MODBUS_ASCII_EVENT_NONE;
+	}
+
+	return modbus_Ascii_DropFrame(pReceiver);
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Ascii_GetFrame(modbus_Ascii_Receiver_t *pReceiver, modbus_PduView_t *pView)
+{
+	MODBUS_ASSERT(pReceiver != NULL);
+	MODBUS_ASSERT(pView != NULL);
+
+	if(pReceiver->state != MODBUS_ASCII_STATE_READY)
+	{
+		return false;
+	}
+
+	pView->busAddress = pReceiver->pFrame[0];
+	pView->functionCode = (modbus_FunctionCode_e)pReceiver->pFrame[1];
+	pView->pPayload = &pReceiver->pFrame[2];
+	pView->payloadSize = pReceiver->frameSize - 3;
+	pView->payloadCapacity = sizeof(pReceiver->pFrame) - 3;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_Ascii_ReleaseFrame(modbus_Ascii_Receiver_t *pReceiver)
+{
+	MODBUS_ASSERT(pReceiver != NULL);
+
+	if(pReceiver->state == MODBUS_ASCII_STATE_READY)
+	{
+		pReceiver->state = MODBUS_ASCII_STATE_IDLE;
+	}
+}
+
+
+
+//------------------------------------------------------------------------------
+//
+static modbus_Ascii_Event_e modbus_Ascii_DropFrame(modbus_Ascii_Receiver_t *pReceiver)
+{
+	pReceiver->frameErrorCount++;
+	pReceiver->state = MODBUS_ASCII_STATE_IDLE;
+
+	return MODBUS_ASCII_EVENT_ERROR;
+}
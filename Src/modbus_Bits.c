@@ -0,0 +1,156 @@
+
+#include <ModbusEmbedded/modbus_bits.h>
+#include <stddef.h>
+
+
+
+static bool modbus_Bits_IsInRange(const modbus_Bits_t *pBits, uint16_t startAddress, uint16_t quantity);
+
+
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e modbus_Bits_Read(const modbus_Bits_t *pBits, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer)
+{
+	if ((pBits == NULL) || (pBits->pBitmap == NULL) || (pByteBuffer == NULL))
+	{
+		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
+	}
+	if (!modbus_Bits_IsInRange(pBits, startAddress, quantity))
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	const uint32_t bitOffset = startAddress - pBits->startAddress;
+	const uint32_t srcIndex = bitOffset / 8;
+	const uint8_t shift = bitOffset % 8;
+	const uint32_t srcSize = ((uint32_t)pBits->bitCount + 7) / 8;
+	const uint32_t byteCount = ((uint32_t)quantity + 7) / 8;
+
+	if (shift == 0)
+	{
+		for (uint32_t ctr = 0; ctr < byteCount; ctr++)
+		{
+			pByteBuffer[ctr] = pBits->pBitmap[srcIndex + ctr];
+		}
+	}
+	else
+	{
+		for (uint32_t ctr = 0; ctr < byteCount; ctr++)
+		{
+			uint16_t window = pBits->pBitmap[srcIndex + ctr];
+			if ((srcIndex + ctr + 1) < srcSize)
+			{
+				window |= (uint16_t)pBits->pBitmap[srcIndex + ctr + 1] << 8;
+			}
+
+			pByteBuffer[ctr] = (uint8_t)(window >> shift);
+		}
+	}
+
+	if ((quantity % 8) != 0)
+	{
+		pByteBuffer[byteCount - 1] &= (uint8_t)((1 << (quantity % 8)) - 1);
+	}
+
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e modbus_Bits_Write(const modbus_Bits_t *pBits, uint16_t startAddress, uint16_t quantity, const uint8_t *pByteBuffer)
+{
+	if ((pBits == NULL) || (pBits->pBitmap == NULL) || (pByteBuffer == NULL))
+	{
+		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
+	}
+	if (!modbus_Bits_IsInRange(pBits, startAddress, quantity))
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	const uint32_t bitOffset = startAddress - pBits->startAddress;
+	const uint32_t dstIndex = bitOffset / 8;
+	const uint8_t shift = bitOffset % 8;
+	const uint32_t byteCount = ((uint32_t)quantity + 7) / 8;
+
+	for (uint32_t ctr = 0; ctr < byteCount; ctr++)
+	{
+		const uint8_t bitsInByte = ((ctr + 1) < byteCount || (quantity % 8) == 0) ? 8 : (quantity % 8);
+		const uint16_t mask = (uint16_t)(((1u << bitsInByte) - 1) << shift);
+		const uint16_t value = ((uint16_t)pByteBuffer[ctr] << shift) & mask;
+
+		uint8_t *pDst = &pBits->pBitmap[dstIndex + ctr];
+		pDst[0] = (pDst[0] & ~(uint8_t)mask) | (uint8_t)value;
+		if ((mask >> 8) != 0)
+		{
+			pDst[1] = (pDst[1] & ~(uint8_t)(mask >> 8)) | (uint8_t)(value >> 8);
+		}
+	}
+
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e modbus_Bits_ReadBit(const modbus_Bits_t *pBits, uint16_t address, uint16_t *pValue)
+{
+	if ((pBits == NULL) || (pBits->pBitmap == NULL) || (pValue == NULL))
+	{
+		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
+	}
+	if (!modbus_Bits_IsInRange(pBits, address, 1))
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	const uint32_t bitOffset = address - pBits->startAddress;
+
+	*pValue = (pBits->pBitmap[bitOffset / 8] & (1 << (bitOffset % 8))) ? MODBUS_BIT_ON : MODBUS_BIT_OFF;
+
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e modbus_Bits_WriteBit(const modbus_Bits_t *pBits, uint16_t address, uint16_t value)
+{
+	if ((pBits == NULL) || (pBits->pBitmap == NULL))
+	{
+		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
+	}
+	if (!modbus_Bits_IsInRange(pBits, address, 1))
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+	if ((value != MODBUS_BIT_ON) && (value != MODBUS_BIT_OFF))
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAVALUE;
+	}
+
+	const uint32_t bitOffset = address - pBits->startAddress;
+
+	if (value == MODBUS_BIT_ON)
+	{
+		pBits->pBitmap[bitOffset / 8] |= (uint8_t)(1 << (bitOffset % 8));
+	}
+	else
+	{
+		pBits->pBitmap[bitOffset / 8] &= (uint8_t)~(1 << (bitOffset % 8));
+	}
+
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_Bits_IsInRange(const modbus_Bits_t *pBits, uint16_t startAddress, uint16_t quantity)
+{
+	const uint32_t endAddress = (uint32_t)startAddress + quantity;
+
+	return (quantity > 0) &&
+		(startAddress >= pBits->startAddress) &&
+		(endAddress <= ((uint32_t)pBits->startAddress + pBits->bitCount));
+}
@@ -1,13 +1,55 @@
 
-#include <ModbusEmbedded/modbus_Buffer.h>
+#include <ModbusEmbedded/modbus_buffer.h>
 #include <stddef.h>
+#include <string.h>
 
 
 
-static const modbus_Buffer_Datapoint_t *modbus_Buffer_GetDatapoint(const modbus_Buffer_t *pBuffer, uint16_t registerAddress);
+static const modbus_Buffer_Datapoint_t *modbus_Buffer_GetDatapoint(const modbus_Buffer_t *pBuffer, uint16_t registerAddress, uint32_t *pIndexPosition);
+static const modbus_Buffer_Datapoint_t *modbus_Buffer_GetNextDatapoint(const modbus_Buffer_t *pBuffer, const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t *pIndexPosition);
+static const modbus_Buffer_Datapoint_t *modbus_Buffer_SearchIndex(const modbus_Buffer_t *pBuffer, uint16_t registerAddress, uint32_t *pIndexPosition);
+static modbus_Exception_e modbus_Buffer_CheckAccess(const modbus_Buffer_Datapoint_t *pDatapoint, modbus_Buffer_Access_e deniedAccess);
+static modbus_Exception_e modbus_Buffer_ReadRangeInternal(const modbus_Buffer_t *pBuffer, uint16_t startAddress, uint16_t quantity, uint16_t *pRegisterBuffer, uint8_t *pByteBuffer);
+static void modbus_Buffer_CopyToRegisters(const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t registerIndex, uint32_t count, uint16_t *pRegisterBuffer);
+static void modbus_Buffer_CopyToBytes(const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t registerIndex, uint32_t count, uint8_t *pByteBuffer);
+static void modbus_Buffer_CopyFromBytes(const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t registerIndex, uint32_t count, const uint8_t *pByteBuffer);
+static inline uint32_t modbus_Buffer_GetEndAddress(const modbus_Buffer_Datapoint_t *pDatapoint);
 
 
 
+//------------------------------------------------------------------------------
+//
+bool modbus_Buffer_BuildIndex(const modbus_Buffer_Datapoint_t *pArray, uint32_t arraySize, uint16_t *pIndex)
+{
+	if ((pArray == NULL) || (pIndex == NULL) || (arraySize > UINT16_MAX))
+	{
+		return false;
+	}
+
+	// Insertion sort, run once at startup and usually on an almost sorted table.
+	for (uint32_t ctr = 0; ctr < arraySize; ctr++)
+	{
+		uint32_t pos = ctr;
+		while ((pos > 0) && (pArray[pIndex[pos - 1]].startAddress > pArray[ctr].startAddress))
+		{
+			pIndex[pos] = pIndex[pos - 1];
+			pos--;
+		}
+		pIndex[pos] = (uint16_t)ctr;
+	}
+
+	// Overlapping datapoints would make the lookup ambiguous.
+	for (uint32_t ctr = 1; ctr < arraySize; ctr++)
+	{
+		if (modbus_Buffer_GetEndAddress(&pArray[pIndex[ctr - 1]]) >= pArray[pIndex[ctr]].startAddress)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 //------------------------------------------------------------------------------
 //
 modbus_Exception_e modbus_Buffer_ReadRegister(const modbus_Buffer_t *pBuffer, uint16_t registerAddress, uint16_t *pRegisterBuffer)
@@ -17,72 +59,243 @@ modbus_Exception_e modbus_Buffer_ReadRegister(const modbus_Buffer_t *pBuffer, ui
 		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
 	}
 
-	const modbus_Buffer_Datapoint_t *pDatapoint = modbus_Buffer_GetDatapoint(pBuffer, registerAddress);
+	const modbus_Buffer_Datapoint_t *pDatapoint = modbus_Buffer_GetDatapoint(pBuffer, registerAddress, NULL);
 	if (pDatapoint == NULL)
 	{
 		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
 	}
-	if (pDatapoint->accessType >= MODBUS_BUFFER_ACCESS_LIMIT)
+
+	const modbus_Exception_e ret = modbus_Buffer_CheckAccess(pDatapoint, MODBUS_BUFFER_ACCESS_WRITEONLY);
+	if (ret != MODBUS_EXCEPTION_SUCCESS)
+	{
+		return ret;
+	}
+
+	modbus_Buffer_CopyToRegisters(pDatapoint, registerAddress - pDatapoint->startAddress, 1, pRegisterBuffer);
+
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e modbus_Buffer_WriteRegister(const modbus_Buffer_t *pBuffer, uint16_t registerAddress, uint16_t registerValue)
+{
+	if ((pBuffer == NULL) || (pBuffer->pArray == NULL))
 	{
 		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
 	}
-	if (pDatapoint->accessType == MODBUS_BUFFER_ACCESS_WRITEONLY)
+
+	const modbus_Buffer_Datapoint_t *pDatapoint = modbus_Buffer_GetDatapoint(pBuffer, registerAddress, NULL);
+	if (pDatapoint == NULL)
 	{
 		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
 	}
 
-	const uint32_t registerIndex = registerAddress - pDatapoint->startAddress;
-	const uint32_t byteOffset = (pDatapoint->dataSizeBytes - 2) - (registerIndex * 2);
+	const modbus_Exception_e ret = modbus_Buffer_CheckAccess(pDatapoint, MODBUS_BUFFER_ACCESS_READONLY);
+	if (ret != MODBUS_EXCEPTION_SUCCESS)
+	{
+		return ret;
+	}
 
-	*pRegisterBuffer = ((uint16_t)pDatapoint->pDataBuffer[byteOffset+1] << 8) | (uint16_t)pDatapoint->pDataBuffer[byteOffset];
+	const uint8_t pByteBuffer[2] = { (uint8_t)((registerValue >> 8) & 0x00FF), (uint8_t)(registerValue & 0x00FF) };
+	modbus_Buffer_CopyFromBytes(pDatapoint, registerAddress - pDatapoint->startAddress, 1, pByteBuffer);
 
 	return MODBUS_EXCEPTION_SUCCESS;
 }
 
+
 //------------------------------------------------------------------------------
 //
-modbus_Exception_e modbus_Buffer_WriteRegister(const modbus_Buffer_t *pBuffer, uint16_t registerAddress, uint16_t registerValue)
+modbus_Exception_e modbus_Buffer_ReadRange(const modbus_Buffer_t *pBuffer, uint16_t startAddress, uint16_t quantity, uint16_t *pRegisterBuffer)
 {
-	if ((pBuffer == NULL) || (pBuffer->pArray == NULL))
+	if ((pBuffer == NULL) || (pBuffer->pArray == NULL) || (pRegisterBuffer == NULL))
 	{
 		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
 	}
 
-	const modbus_Buffer_Datapoint_t *pDatapoint = modbus_Buffer_GetDatapoint(pBuffer, registerAddress);
-	if (pDatapoint == NULL)
+	return modbus_Buffer_ReadRangeInternal(pBuffer, startAddress, quantity, pRegisterBuffer, NULL);
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e modbus_Buffer_ReadRangeBytes(const modbus_Buffer_t *pBuffer, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer)
+{
+	if ((pBuffer == NULL) || (pBuffer->pArray == NULL) || (pByteBuffer == NULL))
 	{
-		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
 	}
-	if (pDatapoint->accessType >= MODBUS_BUFFER_ACCESS_LIMIT)
+
+	return modbus_Buffer_ReadRangeInternal(pBuffer, startAddress, quantity, NULL, pByteBuffer);
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e modbus_Buffer_WriteRange(const modbus_Buffer_t *pBuffer, uint16_t startAddress, uint16_t quantity, const uint8_t *pByteBuffer)
+{
+	if ((pBuffer == NULL) || (pBuffer->pArray == NULL) || (pByteBuffer == NULL))
 	{
 		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
 	}
-	if (pDatapoint->accessType == MODBUS_BUFFER_ACCESS_READONLY)
+
+	uint32_t indexPosition = 0;
+	const uint32_t endAddress = (uint32_t)startAddress + quantity;
+
+	const modbus_Buffer_Datapoint_t *pFirstDatapoint = modbus_Buffer_GetDatapoint(pBuffer, startAddress, &indexPosition);
+	const uint32_t firstIndexPosition = indexPosition;
+
+	// Check the whole range first, so a failing request leaves the buffer untouched.
+	const modbus_Buffer_Datapoint_t *pDatapoint = pFirstDatapoint;
+	while (true)
 	{
-		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+		if (pDatapoint == NULL)
+		{
+			return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+		}
+
+		const modbus_Exception_e ret = modbus_Buffer_CheckAccess(pDatapoint, MODBUS_BUFFER_ACCESS_READONLY);
+		if (ret != MODBUS_EXCEPTION_SUCCESS)
+		{
+			return ret;
+		}
+
+		if ((modbus_Buffer_GetEndAddress(pDatapoint) + 1) >= endAddress)
+		{
+			break;
+		}
+
+		pDatapoint = modbus_Buffer_GetNextDatapoint(pBuffer, pDatapoint, &indexPosition);
 	}
 
-	const uint32_t registerIndex = registerAddress - pDatapoint->startAddress;
-	const uint32_t byteOffset = (pDatapoint->dataSizeBytes - 2) - (registerIndex * 2);
+	uint32_t address = startAddress;
+	indexPosition = firstIndexPosition;
+	pDatapoint = pFirstDatapoint;
+	while (address < endAddress)
+	{
+		const uint32_t registerIndex = address - pDatapoint->startAddress;
+		const uint32_t lastAddress = modbus_Buffer_GetEndAddress(pDatapoint);
+		const uint32_t count = ((lastAddress < endAddress) ? (lastAddress + 1) : endAddress) - address;
 
-	pDatapoint->pDataBuffer[byteOffset] = (uint8_t)(registerValue & 0x00FF);
-	pDatapoint->pDataBuffer[byteOffset+1] = (uint8_t)((registerValue >> 8) & 0x00FF);
+		modbus_Buffer_CopyFromBytes(pDatapoint, registerIndex, count, pByteBuffer);
+		pByteBuffer += count * 2;
+		address += count;
+
+		if (address < endAddress)
+		{
+			pDatapoint = modbus_Buffer_GetNextDatapoint(pBuffer, pDatapoint, &indexPosition);
+		}
+	}
 
 	return MODBUS_EXCEPTION_SUCCESS;
 }
 
+//------------------------------------------------------------------------------
+//
+bool modbus_Buffer_GetValue(const modbus_Buffer_Datapoint_t *pDatapoint, void *pValue, uint32_t valueSize)
+{
+	if ((pDatapoint == NULL) || (pDatapoint->pDataBuffer == NULL) || (pValue == NULL) || (pDatapoint->dataSizeBytes != valueSize))
+	{
+		return false;
+	}
+
+	uint8_t *pDst = (uint8_t *)pValue;
+	if (pDatapoint->byteOrder == MODBUS_BUFFER_BYTEORDER_WIRE)
+	{
+		for (uint32_t ctr = 0; ctr < valueSize; ctr++)
+		{
+			pDst[ctr] = pDatapoint->pDataBuffer[valueSize - 1 - ctr];
+		}
+	}
+	else
+	{
+		memcpy(pDst, pDatapoint->pDataBuffer, valueSize);
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Buffer_SetValue(const modbus_Buffer_Datapoint_t *pDatapoint, const void *pValue, uint32_t valueSize)
+{
+	if ((pDatapoint == NULL) || (pDatapoint->pDataBuffer == NULL) || (pValue == NULL) || (pDatapoint->dataSizeBytes != valueSize))
+	{
+		return false;
+	}
+
+	const uint8_t *pSrc = (const uint8_t *)pValue;
+	if (pDatapoint->byteOrder == MODBUS_BUFFER_BYTEORDER_WIRE)
+	{
+		for (uint32_t ctr = 0; ctr < valueSize; ctr++)
+		{
+			pDatapoint->pDataBuffer[valueSize - 1 - ctr] = pSrc[ctr];
+		}
+	}
+	else
+	{
+		memcpy(pDatapoint->pDataBuffer, pSrc, valueSize);
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Buffer_GetFloat(const modbus_Buffer_Datapoint_t *pDatapoint, float *pValue)
+{
+	return modbus_Buffer_GetValue(pDatapoint, pValue, sizeof(float));
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Buffer_SetFloat(const modbus_Buffer_Datapoint_t *pDatapoint, float value)
+{
+	return modbus_Buffer_SetValue(pDatapoint, &value, sizeof(float));
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Buffer_GetInt32(const modbus_Buffer_Datapoint_t *pDatapoint, int32_t *pValue)
+{
+	return modbus_Buffer_GetValue(pDatapoint, pValue, sizeof(int32_t));
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Buffer_SetInt32(const modbus_Buffer_Datapoint_t *pDatapoint, int32_t value)
+{
+	return modbus_Buffer_SetValue(pDatapoint, &value, sizeof(int32_t));
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Buffer_GetUint32(const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t *pValue)
+{
+	return modbus_Buffer_GetValue(pDatapoint, pValue, sizeof(uint32_t));
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Buffer_SetUint32(const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t value)
+{
+	return modbus_Buffer_SetValue(pDatapoint, &value, sizeof(uint32_t));
+}
 
 
 //------------------------------------------------------------------------------
 //
 __attribute__ ((optimize("-Ofast")))
-static const modbus_Buffer_Datapoint_t *modbus_Buffer_GetDatapoint(const modbus_Buffer_t *pBuffer, uint16_t registerAddress)
+static const modbus_Buffer_Datapoint_t *modbus_Buffer_GetDatapoint(const modbus_Buffer_t *pBuffer, uint16_t registerAddress, uint32_t *pIndexPosition)
 {
 	if ((pBuffer == NULL) || (pBuffer->pArray == NULL))
 	{
 		return NULL;
 	}
 
+	if (pBuffer->pIndex != NULL)
+	{
+		return modbus_Buffer_SearchIndex(pBuffer, registerAddress, pIndexPosition);
+	}
+
 	for (uint32_t ctr = 0; ctr < pBuffer->arraySize; ctr++)
 	{
 		const uint16_t startAddress = pBuffer->pArray[ctr].startAddress;
@@ -97,4 +310,210 @@ static const modbus_Buffer_Datapoint_t *modbus_Buffer_GetDatapoint(const modbus_
 	return NULL;
 }
 
+//------------------------------------------------------------------------------
+//
+static const modbus_Buffer_Datapoint_t *modbus_Buffer_SearchIndex(const modbus_Buffer_t *pBuffer, uint16_t registerAddress, uint32_t *pIndexPosition)
+{
+	// Find the last datapoint starting at or below registerAddress.
+	uint32_t low = 0;
+	uint32_t high = pBuffer->arraySize;
 
+	while (low < high)
+	{
+		const uint32_t mid = low + (high - low) / 2;
+
+		if (pBuffer->pArray[pBuffer->pIndex[mid]].startAddress <= registerAddress)
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+
+	if (low == 0)
+	{
+		return NULL;
+	}
+
+	const modbus_Buffer_Datapoint_t *pDatapoint = &pBuffer->pArray[pBuffer->pIndex[low - 1]];
+	if (registerAddress > modbus_Buffer_GetEndAddress(pDatapoint))
+	{
+		return NULL;
+	}
+
+	if (pIndexPosition != NULL)
+	{
+		*pIndexPosition = low - 1;
+	}
+
+	return pDatapoint;
+}
+
+//------------------------------------------------------------------------------
+//
+static inline uint32_t modbus_Buffer_GetEndAddress(const modbus_Buffer_Datapoint_t *pDatapoint)
+{
+	return (uint32_t)pDatapoint->startAddress + (pDatapoint->dataSizeBytes / 2) - 1;
+}
+
+//------------------------------------------------------------------------------
+//
+static const modbus_Buffer_Datapoint_t *modbus_Buffer_GetNextDatapoint(const modbus_Buffer_t *pBuffer, const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t *pIndexPosition)
+{
+	const uint32_t nextAddress = modbus_Buffer_GetEndAddress(pDatapoint) + 1;
+	if (nextAddress > UINT16_MAX)
+	{
+		return NULL;
+	}
+
+	if (pBuffer->pIndex == NULL)
+	{
+		return modbus_Buffer_GetDatapoint(pBuffer, (uint16_t)nextAddress, NULL);
+	}
+
+	(*pIndexPosition)++;
+	if (*pIndexPosition >= pBuffer->arraySize)
+	{
+		return NULL;
+	}
+
+	const modbus_Buffer_Datapoint_t *pNext = &pBuffer->pArray[pBuffer->pIndex[*pIndexPosition]];
+	if (pNext->startAddress != nextAddress)
+	{
+		return NULL;
+	}
+
+	return pNext;
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e modbus_Buffer_CheckAccess(const modbus_Buffer_Datapoint_t *pDatapoint, modbus_Buffer_Access_e deniedAccess)
+{
+	if (pDatapoint->accessType >= MODBUS_BUFFER_ACCESS_LIMIT)
+	{
+		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
+	}
+	if (pDatapoint->byteOrder >= MODBUS_BUFFER_BYTEORDER_LIMIT)
+	{
+		return MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
+	}
+	if (pDatapoint->accessType == deniedAccess)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e modbus_Buffer_ReadRangeInternal(const modbus_Buffer_t *pBuffer, uint16_t startAddress, uint16_t quantity, uint16_t *pRegisterBuffer, uint8_t *pByteBuffer)
+{
+	uint32_t indexPosition = 0;
+	uint32_t address = startAddress;
+	const uint32_t endAddress = (uint32_t)startAddress + quantity;
+
+	const modbus_Buffer_Datapoint_t *pDatapoint = modbus_Buffer_GetDatapoint(pBuffer, startAddress, &indexPosition);
+	while (address < endAddress)
+	{
+		if (pDatapoint == NULL)
+		{
+			return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+		}
+
+		const modbus_Exception_e ret = modbus_Buffer_CheckAccess(pDatapoint, MODBUS_BUFFER_ACCESS_WRITEONLY);
+		if (ret != MODBUS_EXCEPTION_SUCCESS)
+		{
+			return ret;
+		}
+
+		const uint32_t registerIndex = address - pDatapoint->startAddress;
+		const uint32_t lastAddress = modbus_Buffer_GetEndAddress(pDatapoint);
+		const uint32_t count = ((lastAddress < endAddress) ? (lastAddress + 1) : endAddress) - address;
+
+		if (pRegisterBuffer != NULL)
+		{
+			modbus_Buffer_CopyToRegisters(pDatapoint, registerIndex, count, pRegisterBuffer);
+			pRegisterBuffer += count;
+		}
+		else
+		{
+			modbus_Buffer_CopyToBytes(pDatapoint, registerIndex, count, pByteBuffer);
+			pByteBuffer += count * 2;
+		}
+		address += count;
+
+		if (address < endAddress)
+		{
+			pDatapoint = modbus_Buffer_GetNextDatapoint(pBuffer, pDatapoint, &indexPosition);
+		}
+	}
+
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Buffer_CopyToRegisters(const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t registerIndex, uint32_t count, uint16_t *pRegisterBuffer)
+{
+	if (pDatapoint->byteOrder == MODBUS_BUFFER_BYTEORDER_WIRE)
+	{
+		const uint8_t *pData = &pDatapoint->pDataBuffer[registerIndex * 2];
+		for (uint32_t ctr = 0; ctr < count; ctr++)
+		{
+			pRegisterBuffer[ctr] = ((uint16_t)pData[ctr * 2] << 8) | (uint16_t)pData[ctr * 2 + 1];
+		}
+	}
+	else
+	{
+		const uint8_t *pData = &pDatapoint->pDataBuffer[pDatapoint->dataSizeBytes - 2 - registerIndex * 2];
+		for (uint32_t ctr = 0; ctr < count; ctr++)
+		{
+			pRegisterBuffer[ctr] = ((uint16_t)pData[1] << 8) | (uint16_t)pData[0];
+			pData -= 2;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Buffer_CopyToBytes(const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t registerIndex, uint32_t count, uint8_t *pByteBuffer)
+{
+	if (pDatapoint->byteOrder == MODBUS_BUFFER_BYTEORDER_WIRE)
+	{
+		memcpy(pByteBuffer, &pDatapoint->pDataBuffer[registerIndex * 2], count * 2);
+	}
+	else
+	{
+		const uint8_t *pData = &pDatapoint->pDataBuffer[pDatapoint->dataSizeBytes - 2 - registerIndex * 2];
+		for (uint32_t ctr = 0; ctr < count; ctr++)
+		{
+			pByteBuffer[ctr * 2] = pData[1];
+			pByteBuffer[ctr * 2 + 1] = pData[0];
+			pData -= 2;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Buffer_CopyFromBytes(const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t registerIndex, uint32_t count, const uint8_t *pByteBuffer)
+{
+	if (pDatapoint->byteOrder == MODBUS_BUFFER_BYTEORDER_WIRE)
+	{
+		memcpy(&pDatapoint->pDataBuffer[registerIndex * 2], pByteBuffer, count * 2);
+	}
+	else
+	{
+		uint8_t *pData = &pDatapoint->pDataBuffer[pDatapoint->dataSizeBytes - 2 - registerIndex * 2];
+		for (uint32_t ctr = 0; ctr < count; ctr++)
+		{
+			pData[1] = pByteBuffer[ctr * 2];
+			pData[0] = pByteBuffer[ctr * 2 + 1];
+			pData -= 2;
+		}
+	}
+}
@@ -0,0 +1,143 @@
+
+#include <ModbusEmbedded/modbus_host.h>
+#include <stddef.h>
+#include <string.h>
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_Host_Init(modbus_Host_t *pHost)
+{
+	MODBUS_ASSERT(pHost != NULL);
+
+	pHost->instance.busAddress = MODBUS_BROADCAST_ADDRESS;
+	pHost->instance.noBroadcast = false;
+	pHost->instance.pHandlers = NULL;
+	pHost->pActiveUnit = NULL;
+
+	pHost->gatewayExceptions = false;
+
+	pHost->requestCount = 0;
+	pHost->unknownUnitCount = 0;
+
+	for(uint16_t ctr = 0; ctr < MODBUS_HOST_UNIT_COUNT; ctr++)
+	{
+		pHost->ppUnits[ctr] = NULL;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_Host_SetUnit(modbus_Host_t *pHost, uint8_t busAddress, modbus_Host_Unit_t *pUnit)
+{
+	MODBUS_ASSERT(pHost != NULL);
+	MODBUS_ASSERT((pUnit == NULL) || (pUnit->pHandlers != NULL));
+
+	pHost->ppUnits[busAddress] = pUnit;
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Host_ProcessView(modbus_Host_t *pHost, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse)
+{
+	MODBUS_ASSERT(pHost != NULL);
+	MODBUS_ASSERT(pRequest != NULL);
+	MODBUS_ASSERT(pResponse != NULL);
+
+	if((pRequest->busAddress == MODBUS_BROADCAST_ADDRESS) && !pHost->instance.noBroadcast)
+	{
+		// Every unit applies the write, `pResponse` only serves as scratch. The request may
+		// share its memory with `pResponse` or the instance PDU, so every unit works on a copy
+		// that a previous unit's exception or generic handler cannot overwrite.
+		modbus_Pdu_t requestCopy;
+		requestCopy.busAddress = pRequest->busAddress;
+		requestCopy.functionCode = pRequest->functionCode;
+		requestCopy.payloadSize = pRequest->payloadSize;
+		memcpy(requestCopy.pPayload, pRequest->pPayload, pRequest->payloadSize);
+
+		const modbus_PduView_t request = modbus_GetPduView(&requestCopy);
+
+		pHost->instance.busAddress = MODBUS_BROADCAST_ADDRESS;
+
+		// A unit at address 0 is not reachable by broadcasts.
+		for(uint16_t ctr = 1; ctr < MODBUS_HOST_UNIT_COUNT; ctr++)
+		{
+			if(pHost->ppUnits[ctr] != NULL)
+			{
+				pHost->instance.pHandlers = pHost->ppUnits[ctr]->pHandlers;
+				pHost->pActiveUnit = pHost->ppUnits[ctr];
+				modbus_ProcessView(&pHost->instance, &request, pResponse);
+			}
+		}
+
+		pHost->pActiveUnit = NULL;
+		pHost->requestCount++;
+		return false;
+	}
+
+	const modbus_Host_Unit_t *pUnit = pHost->ppUnits[pRequest->busAddress];
+
+	if(pUnit == NULL)
+	{
+		pHost->unknownUnitCount++;
+
+		if(!pHost->gatewayExceptions)
+		{
+			return false;
+		}
+
+		pResponse->busAddress = pRequest->busAddress;
+		pResponse->functionCode = pRequest->functionCode | 0x80;
+		pResponse->pPayload[0] = (uint8_t)MODBUS_EXCEPTION_GATEWAYDEVICEFAILEDTORESP;
+		pResponse->payloadSize = 1;
+		return true;
+	}
+
+	pHost->requestCount++;
+
+	pHost->instance.busAddress = pRequest->busAddress;
+	pHost->instance.pHandlers = pUnit->pHandlers;
+	pHost->pActiveUnit = pUnit;
+
+	const bool respond = modbus_ProcessView(&pHost->instance, pRequest, pResponse);
+
+	pHost->pActiveUnit = NULL;
+	return respond;
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Host_Process(void *pContext, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse)
+{
+	return modbus_Host_ProcessView((modbus_Host_t *)pContext, pRequest, pResponse);
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Host_ProcessData(modbus_Host_t *pHost)
+{
+	MODBUS_ASSERT(pHost != NULL);
+
+	modbus_PduView_t request = modbus_GetPduView(MODBUS_REQUEST_PDU(&pHost->instance));
+	modbus_PduView_t response = modbus_GetPduView(MODBUS_RESPONSE_PDU(&pHost->instance));
+
+	if(!modbus_Host_ProcessView(pHost, &request, &response))
+	{
+		return false;
+	}
+
+	MODBUS_RESPONSE_PDU(&pHost->instance)->busAddress = response.busAddress;
+	MODBUS_RESPONSE_PDU(&pHost->instance)->functionCode = response.functionCode;
+	MODBUS_RESPONSE_PDU(&pHost->instance)->payloadSize = response.payloadSize;
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+const modbus_Host_Unit_t *modbus_Host_GetActiveUnit(const modbus_Host_t *pHost)
+{
+	MODBUS_ASSERT(pHost != NULL);
+
+	return pHost->pActiveUnit;
+}
@@ -0,0 +1,750 @@
+
+#include <ModbusEmbedded/modbus_master.h>
+#include <stddef.h>
+#include <string.h>
+
+
+
+static uint16_t modbus_Master_GetRequestSize(const modbus_Master_Request_t *pRequest);
+static bool modbus_Master_IsValidRange(uint16_t startAddress, uint16_t quantity, uint16_t maxQuantity);
+static bool modbus_Master_IsWrite(modbus_FunctionCode_e functionCode);
+static uint16_t modbus_Master_GetSingleValue(const modbus_Master_Request_t *pRequest);
+static modbus_Master_Result_e modbus_Master_ParseRegisters(modbus_Master_Request_t *pRequest, const modbus_PduView_t *pResponse);
+static modbus_Master_Result_e modbus_Master_ParseBits(modbus_Master_Request_t *pRequest, const modbus_PduView_t *pResponse);
+static modbus_Master_Result_e modbus_Master_ParseEcho(modbus_Master_Request_t *pRequest, const modbus_PduView_t *pResponse, uint16_t value);
+static modbus_Master_Result_e modbus_Master_SetResult(modbus_Master_Request_t *pRequest, modbus_Master_Result_e result);
+
+static void modbus_Master_Track(modbus_Master_t *pMaster, modbus_Master_Request_t *pRequest, uint32_t nowMs);
+static modbus_Master_Request_t *modbus_Master_Untrack(modbus_Master_t *pMaster, uint16_t slot);
+static uint32_t modbus_Master_GetTimeout(const modbus_Master_t *pMaster, const modbus_Master_Request_t *pRequest, uint32_t timeoutMs);
+static void modbus_Master_UpdateUnit(modbus_Master_t *pMaster, const modbus_Master_Request_t *pRequest, uint32_t nowMs);
+static void modbus_Master_FailUnit(modbus_Master_t *pMaster, const modbus_Master_Request_t *pRequest, uint32_t nowMs);
+
+static inline void modbus_Master_PutWord(uint8_t *pBuffer, uint16_t value);
+static inline uint16_t modbus_Master_GetWord(const uint8_t *pBuffer);
+
+
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Master_BuildRequest(const modbus_Master_Request_t *pRequest, modbus_PduView_t *pView)
+{
+	MODBUS_ASSERT(pRequest != NULL);
+	MODBUS_ASSERT(pView != NULL);
+
+	const uint16_t payloadSize = modbus_Master_GetRequestSize(pRequest);
+	if((payloadSize == 0) || (payloadSize > pView->payloadCapacity))
+	{
+		return false;
+	}
+
+	pView->busAddress = pRequest->busAddress;
+	pView->functionCode = pRequest->functionCode;
+	pView->payloadSize = payloadSize;
+
+	uint8_t *pPayload = pView->pPayload;
+	modbus_Master_PutWord(&pPayload[0], pRequest->startAddress);
+
+	switch(pRequest->functionCode)
+	{
+		case MODBUS_FUNCTION_READCOILS:
+		case MODBUS_FUNCTION_READDISCRETE:
+		case MODBUS_FUNCTION_READHOLDING:
+		case MODBUS_FUNCTION_READINPUT:
+		{
+			modbus_Master_PutWord(&pPayload[2], pRequest->quantity);
+			break;
+		}
+
+		case MODBUS_FUNCTION_WRITESINGLE_COIL:
+		case MODBUS_FUNCTION_WRITESINGLE_REG:
+		{
+			modbus_Master_PutWord(&pPayload[2], modbus_Master_GetSingleValue(pRequest));
+			break;
+		}
+
+		case MODBUS_FUNCTION_WRITEMULT_COILS:
+		{
+			const uint8_t byteCount = (pRequest->quantity + 7) / 8;
+
+			modbus_Master_PutWord(&pPayload[2], pRequest->quantity);
+			pPayload[4] = byteCount;
+			memcpy(&pPayload[5], pRequest->pData, byteCount);
+
+			if((pRequest->quantity % 8) != 0)
+			{
+				pPayload[4 + byteCount] &= (uint8_t)((1 << (pRequest->quantity % 8)) - 1);
+			}
+			break;
+		}
+
+		case MODBUS_FUNCTION_WRITEMULT_REGS:
+		{
+			const uint16_t *pValues = pRequest->pData;
+
+			modbus_Master_PutWord(&pPayload[2], pRequest->quantity);
+			pPayload[4] = (uint8_t)(pRequest->quantity * 2);
+
+			for(uint16_t ctr = 0; ctr < pRequest->quantity; ctr++)
+			{
+				modbus_Master_PutWord(&pPayload[5 + ctr*2], pValues[ctr]);
+			}
+			break;
+		}
+
+		case MODBUS_FUNCTION_RWREG_MULT:
+		{
+			modbus_Master_PutWord(&pPayload[2], pRequest->quantity);
+			modbus_Master_PutWord(&pPayload[4], pRequest->writeStartAddress);
+			modbus_Master_PutWord(&pPayload[6], pRequest->writeQuantity);
+			pPayload[8] = (uint8_t)(pRequest->writeQuantity * 2);
+
+			for(uint16_t ctr = 0; ctr < pRequest->writeQuantity; ctr++)
+			{
+				modbus_Master_PutWord(&pPayload[9 + ctr*2], pRequest->pWriteData[ctr]);
+			}
+			break;
+		}
+
+		default:
+		{
+			// Rejected by modbus_Master_GetRequestSize().
+			break;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Master_Result_e modbus_Master_ParseResponse(modbus_Master_Request_t *pRequest, const modbus_PduView_t *pResponse)
+{
+	MODBUS_ASSERT(pRequest != NULL);
+	MODBUS_ASSERT(pResponse != NULL);
+
+	if(pResponse->busAddress != pRequest->busAddress)
+	{
+		return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_INVALIDRESPONSE);
+	}
+
+	if((uint8_t)pResponse->functionCode == ((uint8_t)pRequest->functionCode | 0x80))
+	{
+		if(pResponse->payloadSize != 1)
+		{
+			return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_INVALIDRESPONSE);
+		}
+
+		pRequest->exception = (modbus_Exception_e)pResponse->pPayload[0];
+		return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_EXCEPTION);
+	}
+
+	if(pResponse->functionCode != pRequest->functionCode)
+	{
+		return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_INVALIDRESPONSE);
+	}
+
+	switch(pRequest->functionCode)
+	{
+		case MODBUS_FUNCTION_READCOILS:
+		case MODBUS_FUNCTION_READDISCRETE:
+		{
+			return modbus_Master_ParseBits(pRequest, pResponse);
+		}
+
+		case MODBUS_FUNCTION_READHOLDING:
+		case MODBUS_FUNCTION_READINPUT:
+		case MODBUS_FUNCTION_RWREG_MULT:
+		{
+			return modbus_Master_ParseRegisters(pRequest, pResponse);
+		}
+
+		case MODBUS_FUNCTION_WRITESINGLE_COIL:
+		case MODBUS_FUNCTION_WRITESINGLE_REG:
+		{
+			return modbus_Master_ParseEcho(pRequest, pResponse, modbus_Master_GetSingleValue(pRequest));
+		}
+
+		case MODBUS_FUNCTION_WRITEMULT_COILS:
+		case MODBUS_FUNCTION_WRITEMULT_REGS:
+		{
+			return modbus_Master_ParseEcho(pRequest, pResponse, pRequest->quantity);
+		}
+
+		default:
+		{
+			return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_INVALIDRESPONSE);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_Master_Init(modbus_Master_t *pMaster, modbus_Master_Request_t **ppSlots, uint16_t slotCount)
+{
+	MODBUS_ASSERT(pMaster != NULL);
+	MODBUS_ASSERT((ppSlots != NULL) || (slotCount == 0));
+
+	pMaster->ppSlots = ppSlots;
+	pMaster->slotCount = slotCount;
+	pMaster->inFlightCount = 0;
+
+	pMaster->nextTransactionId = 0;
+	pMaster->nextSequence = 0;
+
+	pMaster->pUnits = NULL;
+	pMaster->minTimeoutMs = 0;
+	pMaster->maxTimeoutMs = 0;
+
+	pMaster->requestCount = 0;
+	pMaster->timeoutCount = 0;
+	pMaster->unmatchedCount = 0;
+
+	for(uint16_t ctr = 0; ctr < slotCount; ctr++)
+	{
+		ppSlots[ctr] = NULL;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_Master_SetUnits(modbus_Master_t *pMaster, modbus_Master_Unit_t *pUnits, uint32_t minTimeoutMs, uint32_t maxTimeoutMs)
+{
+	MODBUS_ASSERT(pMaster != NULL);
+	MODBUS_ASSERT(pUnits != NULL);
+	MODBUS_ASSERT((minTimeoutMs > 0) && (minTimeoutMs <= maxTimeoutMs));
+
+	pMaster->pUnits = pUnits;
+	pMaster->minTimeoutMs = minTimeoutMs;
+	pMaster->maxTimeoutMs = maxTimeoutMs;
+
+	for(uint16_t ctr = 0; ctr < MODBUS_MASTER_UNIT_COUNT; ctr++)
+	{
+		modbus_Master_Unit_t *pUnit = &pUnits[ctr];
+
+		pUnit->srttMs8 = 0;
+		pUnit->rttvarMs4 = 0;
+		pUnit->timeoutMs = maxTimeoutMs;
+		pUnit->sampleCount = 0;
+
+		pUnit->lastRttMs = 0;
+		pUnit->minRttMs = UINT32_MAX;
+		pUnit->maxRttMs = 0;
+
+		pUnit->timeoutCount = 0;
+		pUnit->retryCount = 0;
+		pUnit->failCount = 0;
+		pUnit->backoffUntilMs = 0;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Master_IsUnitReady(const modbus_Master_t *pMaster, uint8_t busAddress, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pMaster != NULL);
+
+	if(pMaster->pUnits == NULL)
+	{
+		return true;
+	}
+
+	const modbus_Master_Unit_t *pUnit = &pMaster->pUnits[busAddress];
+	return (pUnit->failCount == 0) || ((int32_t)(nowMs - pUnit->backoffUntilMs) >= 0);
+}
+
+//------------------------------------------------------------------------------
+//
+uint16_t modbus_Master_EncodeTcp(modbus_Master_t *pMaster, modbus_Master_Request_t *pRequest, uint8_t *pBuffer, uint16_t bufferSize, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pMaster != NULL);
+	MODBUS_ASSERT(pRequest != NULL);
+	MODBUS_ASSERT(pBuffer != NULL);
+
+	if((pMaster->inFlightCount == pMaster->slotCount) || (bufferSize < (MODBUS_TCP_HEADER_SIZE + 1)))
+	{
+		return 0;
+	}
+
+	modbus_PduView_t view;
+	modbus_PrepareTcpView(pBuffer, bufferSize, &view);
+
+	if(!modbus_Master_BuildRequest(pRequest, &view))
+	{
+		return 0;
+	}
+
+	pRequest->transactionId = pMaster->nextTransactionId++;
+	modbus_Master_Track(pMaster, pRequest, nowMs);
+
+	return modbus_EncodeTcpView(pBuffer, pRequest->transactionId, &view);
+}
+
+//------------------------------------------------------------------------------
+//
+uint16_t modbus_Master_EncodeRtu(modbus_Master_t *pMaster, modbus_Master_Request_t *pRequest, uint8_t *pBuffer, uint16_t bufferSize, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pMaster != NULL);
+	MODBUS_ASSERT(pRequest != NULL);
+	MODBUS_ASSERT(pBuffer != NULL);
+
+	if((pMaster->inFlightCount == pMaster->slotCount) || (bufferSize < 4))
+	{
+		return 0;
+	}
+
+	// A broadcast read would have nobody to answer it.
+	if((pRequest->busAddress == MODBUS_BROADCAST_ADDRESS) && !modbus_Master_IsWrite(pRequest->functionCode))
+	{
+		return 0;
+	}
+
+	modbus_PduView_t view;
+	modbus_PrepareRtuView(pBuffer, bufferSize, &view);
+
+	if(!modbus_Master_BuildRequest(pRequest, &view))
+	{
+		return 0;
+	}
+
+	if(pRequest->busAddress == MODBUS_BROADCAST_ADDRESS)
+	{
+		// No response will follow.
+		pRequest->sentMs = nowMs;
+		modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_SUCCESS);
+		pMaster->requestCount++;
+	}
+	else
+	{
+		modbus_Master_Track(pMaster, pRequest, nowMs);
+	}
+
+	return modbus_EncodeRtuView(pBuffer, &view);
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Master_Request_t *modbus_Master_MatchTcp(modbus_Master_t *pMaster, uint16_t transactionId, const modbus_PduView_t *pResponse, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pMaster != NULL);
+	MODBUS_ASSERT(pResponse != NULL);
+
+	for(uint16_t ctr = 0; ctr < pMaster->slotCount; ctr++)
+	{
+		if((pMaster->ppSlots[ctr] != NULL) && (pMaster->ppSlots[ctr]->transactionId == transactionId))
+		{
+			modbus_Master_Request_t *pRequest = modbus_Master_Untrack(pMaster, ctr);
+			modbus_Master_ParseResponse(pRequest, pResponse);
+			modbus_Master_UpdateUnit(pMaster, pRequest, nowMs);
+			return pRequest;
+		}
+	}
+
+	// Late response to a request that already timed out, or garbage.
+	pMaster->unmatchedCount++;
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Master_Request_t *modbus_Master_MatchRtu(modbus_Master_t *pMaster, const modbus_PduView_t *pResponse, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pMaster != NULL);
+	MODBUS_ASSERT(pResponse != NULL);
+
+	uint16_t oldest = pMaster->slotCount;
+
+	for(uint16_t ctr = 0; ctr < pMaster->slotCount; ctr++)
+	{
+		if(
+			(pMaster->ppSlots[ctr] != NULL) &&
+			((oldest == pMaster->slotCount) || ((int32_t)(pMaster->ppSlots[ctr]->sequence - pMaster->ppSlots[oldest]->sequence) < 0))
+		)
+		{
+			oldest = ctr;
+		}
+	}
+
+	if((oldest == pMaster->slotCount) || (pMaster->ppSlots[oldest]->busAddress != pResponse->busAddress))
+	{
+		// Not an answer to the request on the bus.
+		pMaster->unmatchedCount++;
+		return NULL;
+	}
+
+	modbus_Master_Request_t *pRequest = modbus_Master_Untrack(pMaster, oldest);
+	modbus_Master_ParseResponse(pRequest, pResponse);
+	modbus_Master_UpdateUnit(pMaster, pRequest, nowMs);
+	return pRequest;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Master_Request_t *modbus_Master_Expire(modbus_Master_t *pMaster, uint32_t nowMs, uint32_t timeoutMs)
+{
+	MODBUS_ASSERT(pMaster != NULL);
+
+	for(uint16_t ctr = 0; (ctr < pMaster->slotCount) && (pMaster->inFlightCount > 0); ctr++)
+	{
+		modbus_Master_Request_t *pRequest = pMaster->ppSlots[ctr];
+
+		if((pRequest != NULL) && ((nowMs - pRequest->sentMs) >= modbus_Master_GetTimeout(pMaster, pRequest, timeoutMs)))
+		{
+			modbus_Master_Untrack(pMaster, ctr);
+			pMaster->timeoutCount++;
+
+			modbus_Master_Unit_t *pUnit = (pMaster->pUnits != NULL) ? &pMaster->pUnits[pRequest->busAddress] : NULL;
+			if(pUnit != NULL)
+			{
+				pUnit->timeoutCount++;
+			}
+
+			// A unit already failing gets no retries, only the probe after its backoff.
+			if((pRequest->retryCount < pRequest->maxRetries) && ((pUnit == NULL) || (pUnit->failCount == 0)))
+			{
+				pRequest->retryCount++;
+				pRequest->resend = true;
+				if(pUnit != NULL)
+				{
+					pUnit->retryCount++;
+				}
+				return pRequest;
+			}
+
+			modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_TIMEOUT);
+			modbus_Master_FailUnit(pMaster, pRequest, nowMs);
+			return pRequest;
+		}
+	}
+
+	return NULL;
+}
+
+
+
+//------------------------------------------------------------------------------
+//
+static uint16_t modbus_Master_GetRequestSize(const modbus_Master_Request_t *pRequest)
+{
+	switch(pRequest->functionCode)
+	{
+		case MODBUS_FUNCTION_READCOILS:
+		case MODBUS_FUNCTION_READDISCRETE:
+		{
+			return ((pRequest->pData != NULL) && modbus_Master_IsValidRange(pRequest->startAddress, pRequest->quantity, MODBUS_READ_BIT_MAX_QUANTITY)) ? 4 : 0;
+		}
+
+		case MODBUS_FUNCTION_READHOLDING:
+		case MODBUS_FUNCTION_READINPUT:
+		{
+			return ((pRequest->pData != NULL) && modbus_Master_IsValidRange(pRequest->startAddress, pRequest->quantity, MODBUS_READ_REGISTER_MAX_QUANTITY)) ? 4 : 0;
+		}
+
+		case MODBUS_FUNCTION_WRITESINGLE_COIL:
+		case MODBUS_FUNCTION_WRITESINGLE_REG:
+		{
+			return (pRequest->pData != NULL) ? 4 : 0;
+		}
+
+		case MODBUS_FUNCTION_WRITEMULT_COILS:
+		{
+			if((pRequest->pData == NULL) || !modbus_Master_IsValidRange(pRequest->startAddress, pRequest->quantity, MODBUS_WRITE_BIT_MAX_QUANTITY))
+			{
+				return 0;
+			}
+			return 5 + ((pRequest->quantity + 7) / 8);
+		}
+
+		case MODBUS_FUNCTION_WRITEMULT_REGS:
+		{
+			if((pRequest->pData == NULL) || !modbus_Master_IsValidRange(pRequest->startAddress, pRequest->quantity, MODBUS_WRITE_REGISTER_MAX_QUANTITY))
+			{
+				return 0;
+			}
+			return 5 + (pRequest->quantity * 2);
+		}
+
+		case MODBUS_FUNCTION_RWREG_MULT:
+		{
+			if(
+				(pRequest->pData == NULL) ||
+				(pRequest->pWriteData == NULL) ||
+				!modbus_Master_IsValidRange(pRequest->startAddress, pRequest->quantity, MODBUS_READ_REGISTER_MAX_QUANTITY) ||
+				!modbus_Master_IsValidRange(pRequest->writeStartAddress, pRequest->writeQuantity, MODBUS_RW_WRITE_REGISTER_MAX_QUANTITY)
+			)
+			{
+				return 0;
+			}
+			return 9 + (pRequest->writeQuantity * 2);
+		}
+
+		default:
+		{
+			return 0;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_Master_IsValidRange(uint16_t startAddress, uint16_t quantity, uint16_t maxQuantity)
+{
+	return (quantity > 0) && (quantity <= maxQuantity) && (((uint32_t)startAddress + quantity) <= 0x10000);
+}
+
+//------------------------------------------------------------------------------
+// 0x17 reads as well, so it does not count.
+static bool modbus_Master_IsWrite(modbus_FunctionCode_e functionCode)
+{
+	switch(functionCode)
+	{
+		case MODBUS_FUNCTION_WRITESINGLE_COIL:
+		case MODBUS_FUNCTION_WRITESINGLE_REG:
+		case MODBUS_FUNCTION_WRITEMULT_COILS:
+		case MODBUS_FUNCTION_WRITEMULT_REGS:
+		{
+			return true;
+		}
+
+		default:
+		{
+			return false;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static uint16_t modbus_Master_GetSingleValue(const modbus_Master_Request_t *pRequest)
+{
+	const uint16_t value = *(const uint16_t *)pRequest->pData;
+
+	if(pRequest->functionCode == MODBUS_FUNCTION_WRITESINGLE_COIL)
+	{
+		return (value != 0) ? MODBUS_BIT_ON : MODBUS_BIT_OFF;
+	}
+
+	return value;
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Master_Result_e modbus_Master_ParseRegisters(modbus_Master_Request_t *pRequest, const modbus_PduView_t *pResponse)
+{
+	const uint16_t byteCount = pRequest->quantity * 2;
+
+	if((pResponse->payloadSize != (byteCount + 1)) || (pResponse->pPayload[0] != byteCount))
+	{
+		return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_INVALIDRESPONSE);
+	}
+
+	uint16_t *pValues = pRequest->pData;
+	for(uint16_t ctr = 0; ctr < pRequest->quantity; ctr++)
+	{
+		pValues[ctr] = modbus_Master_GetWord(&pResponse->pPayload[1 + ctr*2]);
+	}
+
+	return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_SUCCESS);
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Master_Result_e modbus_Master_ParseBits(modbus_Master_Request_t *pRequest, const modbus_PduView_t *pResponse)
+{
+	const uint16_t byteCount = (pRequest->quantity + 7) / 8;
+
+	if((pResponse->payloadSize != (byteCount + 1)) || (pResponse->pPayload[0] != byteCount))
+	{
+		return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_INVALIDRESPONSE);
+	}
+
+	uint8_t *pBits = pRequest->pData;
+	memcpy(pBits, &pResponse->pPayload[1], byteCount);
+
+	if((pRequest->quantity % 8) != 0)
+	{
+		pBits[byteCount - 1] &= (uint8_t)((1 << (pRequest->quantity % 8)) - 1);
+	}
+
+	return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_SUCCESS);
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Master_Result_e modbus_Master_ParseEcho(modbus_Master_Request_t *pRequest, const modbus_PduView_t *pResponse, uint16_t value)
+{
+	if(
+		(pResponse->payloadSize != 4) ||
+		(modbus_Master_GetWord(&pResponse->pPayload[0]) != pRequest->startAddress) ||
+		(modbus_Master_GetWord(&pResponse->pPayload[2]) != value)
+	)
+	{
+		return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_INVALIDRESPONSE);
+	}
+
+	return modbus_Master_SetResult(pRequest, MODBUS_MASTER_RESULT_SUCCESS);
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Master_Result_e modbus_Master_SetResult(modbus_Master_Request_t *pRequest, modbus_Master_Result_e result)
+{
+	pRequest->result = result;
+
+	if(result != MODBUS_MASTER_RESULT_EXCEPTION)
+	{
+		pRequest->exception = MODBUS_EXCEPTION_SUCCESS;
+	}
+
+	return result;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Master_Track(modbus_Master_t *pMaster, modbus_Master_Request_t *pRequest, uint32_t nowMs)
+{
+	for(uint16_t ctr = 0; ctr < pMaster->slotCount; ctr++)
+	{
+		if(pMaster->ppSlots[ctr] == NULL)
+		{
+			if(!pRequest->resend)
+			{
+				// New transaction, not a retry handed back by modbus_Master_Expire().
+				pRequest->retryCount = 0;
+			}
+
+			pRequest->resend = false;
+
+			pRequest->sequence = pMaster->nextSequence++;
+			pRequest->sentMs = nowMs;
+			pRequest->result = MODBUS_MASTER_RESULT_PENDING;
+			pRequest->exception = MODBUS_EXCEPTION_SUCCESS;
+
+			pMaster->ppSlots[ctr] = pRequest;
+			pMaster->inFlightCount++;
+			pMaster->requestCount++;
+			return;
+		}
+	}
+
+	// Callers check for a free slot before building the frame.
+	MODBUS_ASSERT(0);
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Master_Request_t *modbus_Master_Untrack(modbus_Master_t *pMaster, uint16_t slot)
+{
+	modbus_Master_Request_t *pRequest = pMaster->ppSlots[slot];
+
+	pMaster->ppSlots[slot] = NULL;
+	pMaster->inFlightCount--;
+
+	return pRequest;
+}
+
+//------------------------------------------------------------------------------
+// Doubled for each retry, like the TCP retransmission timer.
+static uint32_t modbus_Master_GetTimeout(const modbus_Master_t *pMaster, const modbus_Master_Request_t *pRequest, uint32_t timeoutMs)
+{
+	if(pMaster->pUnits == NULL)
+	{
+		return timeoutMs;
+	}
+
+	const uint32_t unitTimeoutMs = pMaster->pUnits[pRequest->busAddress].timeoutMs;
+	const uint8_t shift = (pRequest->retryCount < MODBUS_MASTER_MAX_BACKOFF_SHIFT) ? pRequest->retryCount : MODBUS_MASTER_MAX_BACKOFF_SHIFT;
+
+	return ((unitTimeoutMs << shift) < pMaster->maxTimeoutMs) ? (unitTimeoutMs << shift) : pMaster->maxTimeoutMs;
+}
+
+//------------------------------------------------------------------------------
+// RFC 6298 in fixed point: SRTT += (R - SRTT) / 8, RTTVAR += (|R - SRTT| - RTTVAR) / 4.
+static void modbus_Master_UpdateUnit(modbus_Master_t *pMaster, const modbus_Master_Request_t *pRequest, uint32_t nowMs)
+{
+	if(
+		(pMaster->pUnits == NULL) ||
+		((pRequest->result != MODBUS_MASTER_RESULT_SUCCESS) && (pRequest->result != MODBUS_MASTER_RESULT_EXCEPTION))
+	)
+	{
+		return;
+	}
+
+	modbus_Master_Unit_t *pUnit = &pMaster->pUnits[pRequest->busAddress];
+
+	pUnit->failCount = 0;
+
+	// Karn: the response to a retried request may belong to any of its attempts.
+	if(pRequest->retryCount > 0)
+	{
+		return;
+	}
+
+	const uint32_t rttMs = nowMs - pRequest->sentMs;
+
+	if(pUnit->sampleCount == 0)
+	{
+		pUnit->srttMs8 = rttMs << 3;
+		pUnit->rttvarMs4 = rttMs << 1;
+	}
+	else
+	{
+		const int32_t deltaMs = (int32_t)rttMs - (int32_t)(pUnit->srttMs8 >> 3);
+		const uint32_t deviationMs = (deltaMs < 0) ? (uint32_t)(-deltaMs) : (uint32_t)deltaMs;
+
+		pUnit->srttMs8 = (uint32_t)((int32_t)pUnit->srttMs8 + deltaMs);
+		pUnit->rttvarMs4 = pUnit->rttvarMs4 - (pUnit->rttvarMs4 >> 2) + deviationMs;
+	}
+
+	pUnit->sampleCount++;
+	pUnit->lastRttMs = rttMs;
+	if(rttMs < pUnit->minRttMs)
+	{
+		pUnit->minRttMs = rttMs;
+	}
+	if(rttMs > pUnit->maxRttMs)
+	{
+		pUnit->maxRttMs = rttMs;
+	}
+
+	const uint32_t timeoutMs = (pUnit->srttMs8 >> 3) + ((pUnit->rttvarMs4 > 0) ? pUnit->rttvarMs4 : 1);
+	pUnit->timeoutMs =
+		(timeoutMs < pMaster->minTimeoutMs) ? pMaster->minTimeoutMs :
+		(timeoutMs > pMaster->maxTimeoutMs) ? pMaster->maxTimeoutMs :
+		timeoutMs;
+}
+
+//------------------------------------------------------------------------------
+// Backoff doubles with every failure in a row, starting at the maximum timeout.
+static void modbus_Master_FailUnit(modbus_Master_t *pMaster, const modbus_Master_Request_t *pRequest, uint32_t nowMs)
+{
+	if(pMaster->pUnits == NULL)
+	{
+		return;
+	}
+
+	modbus_Master_Unit_t *pUnit = &pMaster->pUnits[pRequest->busAddress];
+
+	const uint8_t shift = (pUnit->failCount < MODBUS_MASTER_MAX_BACKOFF_SHIFT) ? pUnit->failCount : MODBUS_MASTER_MAX_BACKOFF_SHIFT;
+	if(pUnit->failCount < UINT8_MAX)
+	{
+		pUnit->failCount++;
+	}
+
+	pUnit->backoffUntilMs = nowMs + (pMaster->maxTimeoutMs << shift);
+}
+
+//------------------------------------------------------------------------------
+//
+static inline void modbus_Master_PutWord(uint8_t *pBuffer, uint16_t value)
+{
+	pBuffer[0] = (value >> 8) & 0xFF;
+	pBuffer[1] = value & 0xFF;
+}
+
+//------------------------------------------------------------------------------
+//
+static inline uint16_t modbus_Master_GetWord(const uint8_t *pBuffer)
+{
+	return ((uint16_t)pBuffer[0] << 8) | pBuffer[1];
+}
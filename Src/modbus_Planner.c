@@ -0,0 +1,345 @@
+
+#include <ModbusEmbedded/modbus_planner.h>
+#include <ModbusEmbedded/modbus_bits.h>
+#include <stddef.h>
+
+
+
+static int32_t modbus_Planner_Compare(const modbus_Planner_Range_t *pA, const modbus_Planner_Range_t *pB);
+static uint16_t modbus_Planner_GetMaxQuantity(modbus_FunctionCode_e functionCode);
+static bool modbus_Planner_IsBitFunction(modbus_FunctionCode_e functionCode);
+static bool modbus_Planner_HitsHole(const modbus_Planner_t *pPlanner, const modbus_Planner_Range_t *pRange, uint32_t startAddress, uint32_t endAddress);
+static bool modbus_Planner_StartRequest(modbus_Planner_t *pPlanner, const modbus_Planner_Range_t *pRange, uint32_t *pBufferUsed);
+static bool modbus_Planner_FinishRequest(modbus_Planner_t *pPlanner, uint32_t *pBufferUsed);
+static void modbus_Planner_LearnHoles(modbus_Planner_t *pPlanner, uint16_t requestIndex);
+
+
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Planner_Build(modbus_Planner_t *pPlanner)
+{
+	MODBUS_ASSERT(pPlanner != NULL);
+	MODBUS_ASSERT((pPlanner->pItems != NULL) || (pPlanner->itemCount == 0));
+	MODBUS_ASSERT((pPlanner->pOrder != NULL) || (pPlanner->itemCount == 0));
+
+	pPlanner->requestCount = 0;
+	pPlanner->replan = false;
+
+	// Insertion sort, item lists are short and rarely change between builds.
+	for(uint16_t ctr = 0; ctr < pPlanner->itemCount; ctr++)
+	{
+		uint16_t pos = ctr;
+		while((pos > 0) && (modbus_Planner_Compare(&pPlanner->pItems[pPlanner->pOrder[pos - 1]].range, &pPlanner->pItems[ctr].range) > 0))
+		{
+			pPlanner->pOrder[pos] = pPlanner->pOrder[pos - 1];
+			pos--;
+		}
+		pPlanner->pOrder[pos] = ctr;
+	}
+
+	uint32_t bufferUsed = 0;
+
+	for(uint16_t ctr = 0; ctr < pPlanner->itemCount; ctr++)
+	{
+		modbus_Planner_Item_t *pItem = &pPlanner->pItems[pPlanner->pOrder[ctr]];
+		const modbus_Planner_Range_t *pRange = &pItem->range;
+
+		const uint16_t maxQuantity = modbus_Planner_GetMaxQuantity(pRange->functionCode);
+		if(
+			(maxQuantity == 0) ||
+			(pItem->pData == NULL) ||
+			(pRange->quantity == 0) ||
+			(pRange->quantity > maxQuantity) ||
+			(((uint32_t)pRange->startAddress + pRange->quantity) > 0x10000)
+		)
+		{
+			return false;
+		}
+
+		pItem->result = MODBUS_MASTER_RESULT_PENDING;
+		pItem->exception = MODBUS_EXCEPTION_SUCCESS;
+
+		bool merge = false;
+
+		if(pPlanner->requestCount > 0)
+		{
+			const modbus_Master_Request_t *pRequest = &pPlanner->pRequests[pPlanner->requestCount - 1];
+			const uint32_t requestEnd = (uint32_t)pRequest->startAddress + pRequest->quantity;
+			const uint32_t itemEnd = (uint32_t)pRange->startAddress + pRange->quantity;
+			const uint32_t mergedEnd = (itemEnd > requestEnd) ? itemEnd : requestEnd;
+
+			merge =
+				(pRequest->busAddress == pRange->busAddress) &&
+				(pRequest->functionCode == pRange->functionCode) &&
+				(pRange->startAddress <= (requestEnd + pPlanner->maxGap)) &&
+				((mergedEnd - pRequest->startAddress) <= maxQuantity) &&
+				!modbus_Planner_HitsHole(pPlanner, pRange, requestEnd, pRange->startAddress);
+
+			if(merge)
+			{
+				pPlanner->pRequests[pPlanner->requestCount - 1].quantity = (uint16_t)(mergedEnd - pRequest->startAddress);
+			}
+		}
+
+		if(!merge)
+		{
+			if(
+				((pPlanner->requestCount > 0) && !modbus_Planner_FinishRequest(pPlanner, &bufferUsed)) ||
+				!modbus_Planner_StartRequest(pPlanner, pRange, &bufferUsed)
+			)
+			{
+				return false;
+			}
+		}
+
+		pItem->requestIndex = pPlanner->requestCount - 1;
+	}
+
+	return (pPlanner->requestCount == 0) || modbus_Planner_FinishRequest(pPlanner, &bufferUsed);
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_Planner_Scatter(modbus_Planner_t *pPlanner, const modbus_Master_Request_t *pRequest)
+{
+	MODBUS_ASSERT(pPlanner != NULL);
+	MODBUS_ASSERT(pRequest != NULL);
+	MODBUS_ASSERT((pRequest >= pPlanner->pRequests) && (pRequest < &pPlanner->pRequests[pPlanner->requestCount]));
+
+	const uint16_t requestIndex = (uint16_t)(pRequest - pPlanner->pRequests);
+
+	if(
+		(pRequest->result == MODBUS_MASTER_RESULT_EXCEPTION) &&
+		(pRequest->exception == MODBUS_EXCEPTION_ILLEGALDATAADDRESS)
+	)
+	{
+		modbus_Planner_LearnHoles(pPlanner, requestIndex);
+	}
+
+	const modbus_Bits_t bits =
+	{
+		.startAddress = pRequest->startAddress,
+		.bitCount = pRequest->quantity,
+		.pBitmap = pRequest->pData
+	};
+
+	for(uint16_t ctr = 0; ctr < pPlanner->itemCount; ctr++)
+	{
+		modbus_Planner_Item_t *pItem = &pPlanner->pItems[ctr];
+		if(pItem->requestIndex != requestIndex)
+		{
+			continue;
+		}
+
+		pItem->result = pRequest->result;
+		pItem->exception = pRequest->exception;
+
+		if(pRequest->result != MODBUS_MASTER_RESULT_SUCCESS)
+		{
+			continue;
+		}
+
+		if(modbus_Planner_IsBitFunction(pRequest->functionCode))
+		{
+			modbus_Bits_Read(&bits, pItem->range.startAddress, pItem->range.quantity, pItem->pData);
+		}
+		else
+		{
+			const uint16_t *pSource = &((const uint16_t *)pRequest->pData)[pItem->range.startAddress - pRequest->startAddress];
+			uint16_t *pDestination = pItem->pData;
+
+			for(uint16_t valueCtr = 0; valueCtr < pItem->range.quantity; valueCtr++)
+			{
+				pDestination[valueCtr] = pSource[valueCtr];
+			}
+		}
+	}
+}
+
+
+
+//------------------------------------------------------------------------------
+//
+static int32_t modbus_Planner_Compare(const modbus_Planner_Range_t *pA, const modbus_Planner_Range_t *pB)
+{
+	if(pA->busAddress != pB->busAddress)
+	{
+		return (int32_t)pA->busAddress - pB->busAddress;
+	}
+
+	if(pA->functionCode != pB->functionCode)
+	{
+		return (int32_t)pA->functionCode - (int32_t)pB->functionCode;
+	}
+
+	return (int32_t)pA->startAddress - pB->startAddress;
+}
+
+//------------------------------------------------------------------------------
+//
+static uint16_t modbus_Planner_GetMaxQuantity(modbus_FunctionCode_e functionCode)
+{
+	switch(functionCode)
+	{
+		case MODBUS_FUNCTION_READCOILS:
+		case MODBUS_FUNCTION_READDISCRETE:
+		{
+			return MODBUS_READ_BIT_MAX_QUANTITY;
+		}
+
+		case MODBUS_FUNCTION_READHOLDING:
+		case MODBUS_FUNCTION_READINPUT:
+		{
+			return MODBUS_READ_REGISTER_MAX_QUANTITY;
+		}
+
+		default:
+		{
+			return 0;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_Planner_IsBitFunction(modbus_FunctionCode_e functionCode)
+{
+	return (functionCode == MODBUS_FUNCTION_READCOILS) || (functionCode == MODBUS_FUNCTION_READDISCRETE);
+}
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_Planner_HitsHole(const modbus_Planner_t *pPlanner, const modbus_Planner_Range_t *pRange, uint32_t startAddress, uint32_t endAddress)
+{
+	// Gap [startAddress, endAddress) that would be read additionally, empty for adjacent or overlapping items.
+	if(startAddress >= endAddress)
+	{
+		return false;
+	}
+
+	for(uint16_t ctr = 0; ctr < pPlanner->holeCount; ctr++)
+	{
+		const modbus_Planner_Range_t *pHole = &pPlanner->pHoles[ctr];
+
+		if(
+			(pHole->busAddress == pRange->busAddress) &&
+			(pHole->functionCode == pRange->functionCode) &&
+			(pHole->startAddress < endAddress) &&
+			(((uint32_t)pHole->startAddress + pHole->quantity) > startAddress)
+		)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_Planner_StartRequest(modbus_Planner_t *pPlanner, const modbus_Planner_Range_t *pRange, uint32_t *pBufferUsed)
+{
+	if(pPlanner->requestCount >= pPlanner->maxRequests)
+	{
+		return false;
+	}
+
+	modbus_Master_Request_t *pRequest = &pPlanner->pRequests[pPlanner->requestCount];
+
+	pRequest->busAddress = pRange->busAddress;
+	pRequest->functionCode = pRange->functionCode;
+	pRequest->startAddress = pRange->startAddress;
+	pRequest->quantity = pRange->quantity;
+	pRequest->pData = &pPlanner->pBuffer[*pBufferUsed];
+	pRequest->writeStartAddress = 0;
+	pRequest->writeQuantity = 0;
+	pRequest->pWriteData = NULL;
+	pRequest->pContext = pPlanner;
+	pRequest->maxRetries = pPlanner->maxRetries;
+	pRequest->retryCount = 0;
+	pRequest->resend = false;
+	pRequest->result = MODBUS_MASTER_RESULT_PENDING;
+	pRequest->exception = MODBUS_EXCEPTION_SUCCESS;
+
+	pPlanner->requestCount++;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_Planner_FinishRequest(modbus_Planner_t *pPlanner, uint32_t *pBufferUsed)
+{
+	// Buffer space is only known once the request stopped growing.
+	const modbus_Master_Request_t *pRequest = &pPlanner->pRequests[pPlanner->requestCount - 1];
+
+	const uint32_t size = modbus_Planner_IsBitFunction(pRequest->functionCode) ?
+		(((uint32_t)pRequest->quantity + 15) / 16) :
+		pRequest->quantity;
+
+	if((pPlanner->pBuffer == NULL) || ((*pBufferUsed + size) > pPlanner->bufferSize))
+	{
+		return false;
+	}
+
+	*pBufferUsed += size;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Planner_LearnHoles(modbus_Planner_t *pPlanner, uint16_t requestIndex)
+{
+	// Which address failed is unknown, so one hole covers all gaps read on top of the items.
+	// Items inside it still merge when they are adjacent or overlap.
+	const modbus_Planner_Range_t *pFirst = NULL;
+	uint32_t coveredEnd = 0;
+	uint32_t holeStart = 0;
+	uint32_t holeEnd = 0;
+
+	for(uint16_t ctr = 0; ctr < pPlanner->itemCount; ctr++)
+	{
+		const modbus_Planner_Item_t *pItem = &pPlanner->pItems[pPlanner->pOrder[ctr]];
+		if(pItem->requestIndex != requestIndex)
+		{
+			continue;
+		}
+
+		const uint32_t end = (uint32_t)pItem->range.startAddress + pItem->range.quantity;
+
+		if(pFirst == NULL)
+		{
+			pFirst = &pItem->range;
+		}
+		else if(pItem->range.startAddress > coveredEnd)
+		{
+			if(holeEnd == 0)
+			{
+				holeStart = coveredEnd;
+			}
+			holeEnd = pItem->range.startAddress;
+		}
+
+		if(end > coveredEnd)
+		{
+			coveredEnd = end;
+		}
+	}
+
+	if((holeEnd == 0) || (pPlanner->holeCount >= pPlanner->maxHoles))
+	{
+		// No gaps, one of the items itself is not readable.
+		return;
+	}
+
+	modbus_Planner_Range_t *pHole = &pPlanner->pHoles[pPlanner->holeCount++];
+
+	pHole->busAddress = pFirst->busAddress;
+	pHole->functionCode = pFirst->functionCode;
+	pHole->startAddress = (uint16_t)holeStart;
+	pHole->quantity = (uint16_t)(holeEnd - holeStart);
+
+	pPlanner->replan = true;
+}
@@ -0,0 +1,239 @@
+
+#include <ModbusEmbedded/modbus_rtu.h>
+#include <stddef.h>
+
+
+
+#define MODBUS_RTU_BITS_PER_CHAR		11
+#define MODBUS_RTU_FIXED_TIMING_BAUD	19200
+#define MODBUS_RTU_FIXED_T15_US			750
+#define MODBUS_RTU_FIXED_T35_US			1750
+
+
+
+static void modbus_Rtu_StartFrame(modbus_Rtu_Receiver_t *pReceiver, uint8_t value, uint32_t timestampUs);
+static modbus_Rtu_Event_e modbus_Rtu_EndFrame(modbus_Rtu_Receiver_t *pReceiver);
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_Rtu_Init(modbus_Rtu_Receiver_t *pReceiver, uint32_t baudRate, uint32_t nowUs)
+{
+	MODBUS_ASSERT(pReceiver != NULL);
+	MODBUS_ASSERT(baudRate > 0);
+
+	pReceiver->charTimeUs = (MODBUS_RTU_BITS_PER_CHAR * 1000000UL) / baudRate;
+
+	// Above 19200 baud the spec fixes the timers, instead of scaling them further down.
+	if(baudRate > MODBUS_RTU_FIXED_TIMING_BAUD)
+	{
+		pReceiver->t15Us = MODBUS_RTU_FIXED_T15_US;
+		pReceiver->t35Us = MODBUS_RTU_FIXED_T35_US;
+	}
+	else
+	{
+		pReceiver->t15Us = (pReceiver->charTimeUs * 3) / 2;
+		pReceiver->t35Us = (pReceiver->charTimeUs * 7) / 2;
+	}
+
+	pReceiver->state = MODBUS_RTU_STATE_INIT;
+	pReceiver->lastByteUs = nowUs;
+	pReceiver->frameError = false;
+	pReceiver->pendingValid = false;
+	pReceiver->crc = modbus_CrcInit();
+	pReceiver->frameSize = 0;
+
+	pReceiver->frameCount = 0;
+	pReceiver->crcErrorCount = 0;
+	pReceiver->frameErrorCount = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Rtu_Event_e modbus_Rtu_PutByte(modbus_Rtu_Receiver_t *pReceiver, uint8_t value, uint32_t timestampUs)
+{
+	MODBUS_ASSERT(pReceiver != NULL);
+
+	// Timestamps mark the end of a character, so the gap includes one character time.
+	const uint32_t gapUs = timestampUs - pReceiver->lastByteUs;
+	const uint32_t silenceUs = (gapUs > pReceiver->charTimeUs) ? (gapUs - pReceiver->charTimeUs) : 0;
+
+	switch(pReceiver->state)
+	{
+		case MODBUS_RTU_STATE_INIT:
+		{
+			// Bus has to be silent for t3.5 before the first frame.
+			if(silenceUs >= pReceiver->t35Us)
+			{
+				modbus_Rtu_StartFrame(pReceiver, value, timestampUs);
+			}
+			else
+			{
+				pReceiver->lastByteUs = timestampUs;
+			}
+			return MODBUS_RTU_EVENT_NONE;
+		}
+
+		case MODBUS_RTU_STATE_READY:
+		{
+			// Frame was not released, it is dropped in favour of the new one.
+			modbus_Rtu_ReleaseFrame(pReceiver);
+			if(pReceiver->state == MODBUS_RTU_STATE_RECEPTION)
+			{
+				return modbus_Rtu_PutByte(pReceiver, value, timestampUs);
+			}
+
+			modbus_Rtu_StartFrame(pReceiver, value, timestampUs);
+			return MODBUS_RTU_EVENT_NONE;
+		}
+
+		case MODBUS_RTU_STATE_IDLE:
+		{
+			modbus_Rtu_StartFrame(pReceiver, value, timestampUs);
+			return MODBUS_RTU_EVENT_NONE;
+		}
+
+		case MODBUS_RTU_STATE_RECEPTION:
+		{
+			if(silenceUs >= pReceiver->t35Us)
+			{
+				// Previous frame ended, this byte starts the next one.
+				modbus_Rtu_Event_e event = modbus_Rtu_EndFrame(pReceiver);
+				if(event == MODBUS_RTU_EVENT_FRAME)
+				{
+					pReceiver->pendingValid = true;
+					pReceiver->pendingByte = value;
+					pReceiver->pendingByteUs = timestampUs;
+				}
+				else
+				{
+					modbus_Rtu_StartFrame(pReceiver, value, timestampUs);
+				}
+				return event;
+			}
+
+			if((silenceUs > pReceiver->t15Us) || (pReceiver->frameSize >= MODBUS_RTU_FRAME_SIZE))
+			{
+				// Broken frame, keep consuming bytes until the bus is silent again.
+				pReceiver->frameError = true;
+			}
+			else
+			{
+				pReceiver->pFrame[pReceiver->frameSize++] = value;
+				pReceiver->crc = modbus_CrcUpdateByte(pReceiver->crc, value);
+			}
+
+			pReceiver->lastByteUs = timestampUs;
+			return MODBUS_RTU_EVENT_NONE;
+		}
+
+		default:
+		{
+			MODBUS_ASSERT(0);
+			return MODBUS_RTU_EVENT_NONE;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Rtu_Event_e modbus_Rtu_Poll(modbus_Rtu_Receiver_t *pReceiver, uint32_t nowUs)
+{
+	MODBUS_ASSERT(pReceiver != NULL);
+
+	const uint32_t silenceUs = nowUs - pReceiver->lastByteUs;
+	if(silenceUs < pReceiver->t35Us)
+	{
+		return MODBUS_RTU_EVENT_NONE;
+	}
+
+	if(pReceiver->state == MODBUS_RTU_STATE_INIT)
+	{
+		pReceiver->state = MODBUS_RTU_STATE_IDLE;
+	}
+	else if(pReceiver->state == MODBUS_RTU_STATE_RECEPTION)
+	{
+		return modbus_Rtu_EndFrame(pReceiver);
+	}
+
+	return MODBUS_RTU_EVENT_NONE;
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Rtu_GetFrame(modbus_Rtu_Receiver_t *pReceiver, modbus_PduView_t *pView)
+{
+	MODBUS_ASSERT(pReceiver != NULL);
+	MODBUS_ASSERT(pView != NULL);
+
+	if(pReceiver->state != MODBUS_RTU_STATE_READY)
+	{
+		return false;
+	}
+
+	pView->busAddress = pReceiver->pFrame[0];
+	pView->functionCode = (modbus_FunctionCode_e)pReceiver->pFrame[1];
+	pView->pPayload = &pReceiver->pFrame[2];
+	pView->payloadSize = pReceiver->frameSize - 4;
+	pView->payloadCapacity = MODBUS_RTU_FRAME_SIZE - 4;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_Rtu_ReleaseFrame(modbus_Rtu_Receiver_t *pReceiver)
+{
+	MODBUS_ASSERT(pReceiver != NULL);
+
+	if(pReceiver->state != MODBUS_RTU_STATE_READY)
+	{
+		return;
+	}
+
+	pReceiver->state = MODBUS_RTU_STATE_IDLE;
+	if(pReceiver->pendingValid)
+	{
+		pReceiver->pendingValid = false;
+		modbus_Rtu_StartFrame(pReceiver, pReceiver->pendingByte, pReceiver->pendingByteUs);
+	}
+}
+
+
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Rtu_StartFrame(modbus_Rtu_Receiver_t *pReceiver, uint8_t value, uint32_t timestampUs)
+{
+	pReceiver->state = MODBUS_RTU_STATE_RECEPTION;
+	pReceiver->frameError = false;
+	pReceiver->lastByteUs = timestampUs;
+
+	pReceiver->pFrame[0] = value;
+	pReceiver->frameSize = 1;
+	pReceiver->crc = modbus_CrcUpdateByte(modbus_CrcInit(), value);
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Rtu_Event_e modbus_Rtu_EndFrame(modbus_Rtu_Receiver_t *pReceiver)
+{
+	pReceiver->state = MODBUS_RTU_STATE_IDLE;
+
+	if(pReceiver->frameError || (pReceiver->frameSize < 4))
+	{
+		pReceiver->frameErrorCount++;
+		return MODBUS_RTU_EVENT_ERROR;
+	}
+
+	if(pReceiver->crc != MODBUS_CRC_RESIDUE)
+	{
+		pReceiver->crcErrorCount++;
+		return MODBUS_RTU_EVENT_ERROR;
+	}
+
+	pReceiver->frameCount++;
+	pReceiver->state = MODBUS_RTU_STATE_READY;
+	return MODBUS_RTU_EVENT_FRAME;
+}
@@ -0,0 +1,399 @@
+
+#include <ModbusEmbedded/modbus_scheduler.h>
+#include <stddef.h>
+
+
+
+static inline bool modbus_Scheduler_IsBefore(uint32_t aMs, uint32_t bMs);
+static uint32_t modbus_Scheduler_GetPhase(uint16_t index, uint32_t periodMs);
+
+static void modbus_Scheduler_Push(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask);
+static void modbus_Scheduler_RemoveAt(modbus_Scheduler_t *pScheduler, uint16_t index);
+static void modbus_Scheduler_SiftUp(modbus_Scheduler_t *pScheduler, uint16_t index);
+static void modbus_Scheduler_SiftDown(modbus_Scheduler_t *pScheduler, uint16_t index);
+static inline void modbus_Scheduler_Place(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask, uint16_t index);
+
+static void modbus_Scheduler_Unlink(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask);
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_Scheduler_Init(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t **ppHeap, uint16_t heapSize)
+{
+	MODBUS_ASSERT(pScheduler != NULL);
+	MODBUS_ASSERT((ppHeap != NULL) || (heapSize == 0));
+
+	pScheduler->ppHeap = ppHeap;
+	pScheduler->heapSize = heapSize;
+	pScheduler->heapCount = 0;
+	pScheduler->periodicCount = 0;
+
+	pScheduler->pUrgentHead = NULL;
+	pScheduler->pUrgentTail = NULL;
+
+	pScheduler->addCount = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Scheduler_Add(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pScheduler != NULL);
+	MODBUS_ASSERT(pTask != NULL);
+	MODBUS_ASSERT(pTask->pRequest != NULL);
+
+	if(
+		(pTask->state != MODBUS_SCHEDULER_STATE_IDLE) ||
+		(pTask->periodMs == 0) ||
+		(pScheduler->periodicCount >= pScheduler->heapSize)
+	)
+	{
+		return false;
+	}
+
+	pScheduler->periodicCount++;
+	pTask->periodic = true;
+	pTask->dueMs = nowMs + modbus_Scheduler_GetPhase(pScheduler->addCount++, pTask->periodMs);
+	modbus_Scheduler_Push(pScheduler, pTask);
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_Scheduler_Submit(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask)
+{
+	MODBUS_ASSERT(pScheduler != NULL);
+	MODBUS_ASSERT(pTask != NULL);
+	MODBUS_ASSERT(pTask->pRequest != NULL);
+
+	if(pTask->state == MODBUS_SCHEDULER_STATE_SCHEDULED)
+	{
+		modbus_Scheduler_RemoveAt(pScheduler, pTask->heapIndex);
+	}
+	else if(pTask->state != MODBUS_SCHEDULER_STATE_IDLE)
+	{
+		return false;
+	}
+
+	pTask->state = MODBUS_SCHEDULER_STATE_URGENT;
+	pTask->pNextUrgent = NULL;
+
+	if(pScheduler->pUrgentTail != NULL)
+	{
+		pScheduler->pUrgentTail->pNextUrgent = pTask;
+	}
+	else
+	{
+		pScheduler->pUrgentHead = pTask;
+	}
+	pScheduler->pUrgentTail = pTask;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_Scheduler_Remove(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask)
+{
+	MODBUS_ASSERT(pScheduler != NULL);
+	MODBUS_ASSERT(pTask != NULL);
+
+	switch(pTask->state)
+	{
+		case MODBUS_SCHEDULER_STATE_SCHEDULED:
+		{
+			modbus_Scheduler_RemoveAt(pScheduler, pTask->heapIndex);
+			break;
+		}
+
+		case MODBUS_SCHEDULER_STATE_URGENT:
+		{
+			modbus_Scheduler_Unlink(pScheduler, pTask);
+			break;
+		}
+
+		default:
+		{
+			break;
+		}
+	}
+
+	if(pTask->periodic)
+	{
+		pScheduler->periodicCount--;
+	}
+
+	pTask->state = MODBUS_SCHEDULER_STATE_IDLE;
+	pTask->periodic = false;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Scheduler_Task_t *modbus_Scheduler_Next(modbus_Scheduler_t *pScheduler, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pScheduler != NULL);
+
+	modbus_Scheduler_Task_t *pTask = pScheduler->pUrgentHead;
+
+	if(pTask != NULL)
+	{
+		pScheduler->pUrgentHead = pTask->pNextUrgent;
+		if(pScheduler->pUrgentHead == NULL)
+		{
+			pScheduler->pUrgentTail = NULL;
+		}
+		pTask->pNextUrgent = NULL;
+	}
+	else if((pScheduler->heapCount > 0) && !modbus_Scheduler_IsBefore(nowMs, pScheduler->ppHeap[0]->dueMs))
+	{
+		pTask = pScheduler->ppHeap[0];
+		modbus_Scheduler_RemoveAt(pScheduler, 0);
+
+		const uint32_t lateMs = nowMs - pTask->dueMs;
+		if(lateMs > pTask->maxLateMs)
+		{
+			pTask->maxLateMs = lateMs;
+		}
+	}
+	else
+	{
+		return NULL;
+	}
+
+	pTask->state = MODBUS_SCHEDULER_STATE_RUNNING;
+	return pTask;
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_Scheduler_Complete(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pScheduler != NULL);
+	MODBUS_ASSERT(pTask != NULL);
+
+	if(pTask->pRequest->result == MODBUS_MASTER_RESULT_SUCCESS)
+	{
+		if(pTask->updateCount > 0)
+		{
+			const uint32_t ageMs = nowMs - pTask->lastUpdateMs;
+			if(ageMs > pTask->maxAgeMs)
+			{
+				pTask->maxAgeMs = ageMs;
+			}
+		}
+
+		pTask->lastUpdateMs = nowMs;
+		pTask->updateCount++;
+	}
+	else
+	{
+		pTask->failCount++;
+	}
+
+	if(pTask->state != MODBUS_SCHEDULER_STATE_RUNNING)
+	{
+		return;
+	}
+
+	pTask->state = MODBUS_SCHEDULER_STATE_IDLE;
+
+	if(!pTask->periodic)
+	{
+		return;
+	}
+
+	// Stay on the grid. A poll that ran late skips the cycles it missed,
+	// instead of firing them back-to-back and bursting the bus.
+	if(!modbus_Scheduler_IsBefore(nowMs, pTask->dueMs))
+	{
+		const uint32_t cycles = ((nowMs - pTask->dueMs) / pTask->periodMs) + 1;
+		pTask->dueMs += cycles * pTask->periodMs;
+		pTask->missCount += cycles - 1;
+	}
+
+	modbus_Scheduler_Push(pScheduler, pTask);
+}
+
+//------------------------------------------------------------------------------
+//
+uint32_t modbus_Scheduler_GetWaitMs(const modbus_Scheduler_t *pScheduler, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pScheduler != NULL);
+
+	if(pScheduler->pUrgentHead != NULL)
+	{
+		return 0;
+	}
+
+	if(pScheduler->heapCount == 0)
+	{
+		return UINT32_MAX;
+	}
+
+	const uint32_t dueMs = pScheduler->ppHeap[0]->dueMs;
+	return modbus_Scheduler_IsBefore(nowMs, dueMs) ? (dueMs - nowMs) : 0;
+}
+
+//------------------------------------------------------------------------------
+//
+uint32_t modbus_Scheduler_GetAge(const modbus_Scheduler_Task_t *pTask, uint32_t nowMs)
+{
+	MODBUS_ASSERT(pTask != NULL);
+
+	return (pTask->updateCount > 0) ? (nowMs - pTask->lastUpdateMs) : UINT32_MAX;
+}
+
+
+
+//------------------------------------------------------------------------------
+// Millisecond ticks wrap after ~49 days, compare by difference.
+static inline bool modbus_Scheduler_IsBefore(uint32_t aMs, uint32_t bMs)
+{
+	return (int32_t)(aMs - bMs) < 0;
+}
+
+//------------------------------------------------------------------------------
+// Bit-reversed add counter as fraction of the period: 0, 1/2, 1/4, 3/4, 1/8, ...
+// Consecutive indices land evenly spread over the period.
+static uint32_t modbus_Scheduler_GetPhase(uint16_t index, uint32_t periodMs)
+{
+	uint16_t reversed = 0;
+	for(uint8_t ctr = 0; ctr < 16; ctr++)
+	{
+		reversed = (uint16_t)((reversed << 1) | ((index >> ctr) & 1));
+	}
+
+	return (uint32_t)(((uint64_t)periodMs * reversed) >> 16);
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Scheduler_Push(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask)
+{
+	MODBUS_ASSERT(pScheduler->heapCount < pScheduler->heapSize);
+
+	pTask->state = MODBUS_SCHEDULER_STATE_SCHEDULED;
+	modbus_Scheduler_Place(pScheduler, pTask, pScheduler->heapCount++);
+	modbus_Scheduler_SiftUp(pScheduler, pTask->heapIndex);
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Scheduler_RemoveAt(modbus_Scheduler_t *pScheduler, uint16_t index)
+{
+	MODBUS_ASSERT(index < pScheduler->heapCount);
+
+	pScheduler->ppHeap[index]->state = MODBUS_SCHEDULER_STATE_IDLE;
+
+	pScheduler->heapCount--;
+	if(index == pScheduler->heapCount)
+	{
+		return;
+	}
+
+	// The last task fills the gap and moves whichever way its deadline asks for.
+	modbus_Scheduler_Task_t *pMoved = pScheduler->ppHeap[pScheduler->heapCount];
+	modbus_Scheduler_Place(pScheduler, pMoved, index);
+	modbus_Scheduler_SiftUp(pScheduler, index);
+	modbus_Scheduler_SiftDown(pScheduler, pMoved->heapIndex);
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Scheduler_SiftUp(modbus_Scheduler_t *pScheduler, uint16_t index)
+{
+	modbus_Scheduler_Task_t *pTask = pScheduler->ppHeap[index];
+
+	while(index > 0)
+	{
+		const uint16_t parent = (uint16_t)((index - 1) / 2);
+		if(!modbus_Scheduler_IsBefore(pTask->dueMs, pScheduler->ppHeap[parent]->dueMs))
+		{
+			break;
+		}
+
+		modbus_Scheduler_Place(pScheduler, pScheduler->ppHeap[parent], index);
+		index = parent;
+	}
+
+	modbus_Scheduler_Place(pScheduler, pTask, index);
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Scheduler_SiftDown(modbus_Scheduler_t *pScheduler, uint16_t index)
+{
+	modbus_Scheduler_Task_t *pTask = pScheduler->ppHeap[index];
+
+	for(;;)
+	{
+		uint32_t child = (2 * (uint32_t)index) + 1;
+		if(child >= pScheduler->heapCount)
+		{
+			break;
+		}
+
+		if(
+			((child + 1) < pScheduler->heapCount) &&
+			modbus_Scheduler_IsBefore(pScheduler->ppHeap[child + 1]->dueMs, pScheduler->ppHeap[child]->dueMs)
+		)
+		{
+			child++;
+		}
+
+		if(!modbus_Scheduler_IsBefore(pScheduler->ppHeap[child]->dueMs, pTask->dueMs))
+		{
+			break;
+		}
+
+		modbus_Scheduler_Place(pScheduler, pScheduler->ppHeap[child], index);
+		index = (uint16_t)child;
+	}
+
+	modbus_Scheduler_Place(pScheduler, pTask, index);
+}
+
+//------------------------------------------------------------------------------
+//
+static inline void modbus_Scheduler_Place(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask, uint16_t index)
+{
+	pScheduler->ppHeap[index] = pTask;
+	pTask->heapIndex = index;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_Scheduler_Unlink(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask)
+{
+	modbus_Scheduler_Task_t *pPrevious = NULL;
+	modbus_Scheduler_Task_t *pCurrent = pScheduler->pUrgentHead;
+
+	while((pCurrent != NULL) && (pCurrent != pTask))
+	{
+		pPrevious = pCurrent;
+		pCurrent = pCurrent->pNextUrgent;
+	}
+
+	if(pCurrent == NULL)
+	{
+		return;
+	}
+
+	if(pPrevious != NULL)
+	{
+		pPrevious->pNextUrgent = pTask->pNextUrgent;
+	}
+	else
+	{
+		pScheduler->pUrgentHead = pTask->pNextUrgent;
+	}
+
+	if(pScheduler->pUrgentTail == pTask)
+	{
+		pScheduler->pUrgentTail = pPrevious;
+	}
+
+	pTask->pNextUrgent = NULL;
+}
@@ -0,0 +1,443 @@
+
+#ifdef __linux__
+
+// accept4()
+#define _GNU_SOURCE
+
+#include <ModbusEmbedded/modbus_tcp_server.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+
+
+static void modbus_TcpServer_Accept(modbus_TcpServer_t *pServer);
+static void modbus_TcpServer_CloseConnection(modbus_TcpServer_t *pServer, modbus_TcpServer_Connection_t *pConnection);
+static bool modbus_TcpServer_Receive(modbus_TcpServer_t *pServer, modbus_TcpServer_Connection_t *pConnection);
+static bool modbus_TcpServer_Send(modbus_TcpServer_Connection_t *pConnection);
+static bool modbus_TcpServer_Flush(modbus_TcpServer_t *pServer, modbus_TcpServer_Connection_t *pConnection);
+static int32_t modbus_TcpServer_Process(modbus_TcpServer_t *pServer, modbus_TcpServer_Connection_t *pConnection);
+static bool modbus_TcpServer_UpdateEvents(modbus_TcpServer_t *pServer, modbus_TcpServer_Connection_t *pConnection);
+
+
+
+//------------------------------------------------------------------------------
+//
+bool modbus_TcpServer_Init(modbus_TcpServer_t *pServer, modbus_t *pInstance, const char *pBindAddress, uint16_t port, modbus_TcpServer_Connection_t *pConnections, uint32_t maxConnections)
+{
+	MODBUS_ASSERT(pServer != NULL);
+	MODBUS_ASSERT(pInstance != NULL);
+	MODBUS_ASSERT((pConnections != NULL) || (maxConnections == 0));
+
+	pServer->pInstance = pInstance;
+	pServer->pProcessHandler = NULL;
+	pServer->pProcessContext = NULL;
+	pServer->listenFd = -1;
+	pServer->epollFd = -1;
+	pServer->pConnections = pConnections;
+	pServer->maxConnections = maxConnections;
+	pServer->pFreeConnections = NULL;
+
+	pServer->connectionCount = 0;
+	pServer->requestCount = 0;
+	pServer->rejectedCount = 0;
+	pServer->protocolErrorCount = 0;
+
+	for(uint32_t ctr = maxConnections; ctr > 0; ctr--)
+	{
+		pConnections[ctr - 1].fd = -1;
+		pConnections[ctr - 1].pNextFree = pServer->pFreeConnections;
+		pServer->pFreeConnections = &pConnections[ctr - 1];
+	}
+
+	pServer->epollFd = epoll_create1(EPOLL_CLOEXEC);
+	pServer->listenFd = modbus_TcpServer_Listen(pBindAddress, port);
+	if((pServer->epollFd < 0) || (pServer->listenFd < 0))
+	{
+		modbus_TcpServer_Close(pServer);
+		return false;
+	}
+
+	// The listening socket is registered with a NULL pointer, connections with their slot.
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+
+	if(epoll_ctl(pServer->epollFd, EPOLL_CTL_ADD, pServer->listenFd, &event) != 0)
+	{
+		modbus_TcpServer_Close(pServer);
+		return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_TcpServer_Close(modbus_TcpServer_t *pServer)
+{
+	MODBUS_ASSERT(pServer != NULL);
+
+	for(uint32_t ctr = 0; ctr < pServer->maxConnections; ctr++)
+	{
+		if(pServer->pConnections[ctr].fd >= 0)
+		{
+			modbus_TcpServer_CloseConnection(pServer, &pServer->pConnections[ctr]);
+		}
+	}
+
+	if(pServer->listenFd >= 0)
+	{
+		close(pServer->listenFd);
+		pServer->listenFd = -1;
+	}
+
+	if(pServer->epollFd >= 0)
+	{
+		close(pServer->epollFd);
+		pServer->epollFd = -1;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+int modbus_TcpServer_Listen(const char *pBindAddress, uint16_t port)
+{
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	if((pBindAddress != NULL) && (inet_pton(AF_INET, pBindAddress, &address.sin_addr) != 1))
+	{
+		return -1;
+	}
+
+	const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(fd < 0)
+	{
+		return -1;
+	}
+
+	const int enable = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+	if(
+		(bind(fd, (struct sockaddr *)&address, sizeof(address)) != 0) ||
+		(listen(fd, SOMAXCONN) != 0)
+	)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+//------------------------------------------------------------------------------
+//
+uint16_t modbus_TcpServer_GetPort(const modbus_TcpServer_t *pServer)
+{
+	MODBUS_ASSERT(pServer != NULL);
+
+	struct sockaddr_in address;
+	socklen_t addressSize = sizeof(address);
+
+	if(getsockname(pServer->listenFd, (struct sockaddr *)&address, &addressSize) != 0)
+	{
+		return 0;
+	}
+
+	return ntohs(address.sin_port);
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_TcpServer_Poll(modbus_TcpServer_t *pServer, int timeoutMs)
+{
+	MODBUS_ASSERT(pServer != NULL);
+
+	struct epoll_event pEvents[MODBUS_TCP_SERVER_MAX_EVENTS];
+
+	const int eventCount = epoll_wait(pServer->epollFd, pEvents, MODBUS_TCP_SERVER_MAX_EVENTS, timeoutMs);
+	if(eventCount < 0)
+	{
+		return (errno == EINTR);
+	}
+
+	for(int ctr = 0; ctr < eventCount; ctr++)
+	{
+		modbus_TcpServer_Connection_t *pConnection = pEvents[ctr].data.ptr;
+
+		if(pConnection == NULL)
+		{
+			modbus_TcpServer_Accept(pServer);
+			continue;
+		}
+
+		bool keepOpen = ((pEvents[ctr].events & (EPOLLERR | EPOLLHUP)) == 0);
+
+		if(keepOpen && ((pEvents[ctr].events & EPOLLIN) != 0))
+		{
+			keepOpen = modbus_TcpServer_Receive(pServer, pConnection);
+		}
+
+		// Also covers EPOLLOUT.
+		if(keepOpen)
+		{
+			keepOpen = modbus_TcpServer_Flush(pServer, pConnection);
+		}
+
+		if(!keepOpen || !modbus_TcpServer_UpdateEvents(pServer, pConnection))
+		{
+			modbus_TcpServer_CloseConnection(pServer, pConnection);
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+int32_t modbus_TcpServer_ProcessConnection(modbus_t *pInstance, modbus_ProcessCallback_t pProcessHandler, void *pProcessContext, modbus_TcpServer_Connection_t *pConnection)
+{
+	MODBUS_ASSERT(pInstance != NULL);
+	MODBUS_ASSERT(pConnection != NULL);
+
+	// Modbus TCP addresses the server by its IP address, unit 0 is a plain direct request.
+	pInstance->noBroadcast = true;
+
+	int32_t requestCount = 0;
+	uint32_t rxOffset = 0;
+
+	while((MODBUS_TCP_SERVER_TX_BUFFER_SIZE - pConnection->txSize) >= MODBUS_TCP_FRAME_SIZE)
+	{
+		uint16_t transactionId;
+		modbus_PduView_t request;
+
+		const modbus_TcpSplit_e result = modbus_SplitTcp(pConnection->pRx, pConnection->rxSize, &rxOffset, &transactionId, &request);
+		if(result == MODBUS_TCP_SPLIT_ERROR)
+		{
+			return -1;
+		}
+
+		if(result == MODBUS_TCP_SPLIT_INCOMPLETE)
+		{
+			break;
+		}
+
+		uint8_t *pFrame = &pConnection->pTx[pConnection->txSize];
+		modbus_PduView_t response;
+
+		modbus_PrepareTcpView(pFrame, MODBUS_TCP_SERVER_TX_BUFFER_SIZE - pConnection->txSize, &response);
+		const bool respond = (pProcessHandler != NULL) ?
+			pProcessHandler(pProcessContext, &request, &response) :
+			modbus_ProcessView(pInstance, &request, &response);
+
+		if(respond)
+		{
+			pConnection->txSize += modbus_EncodeTcpView(pFrame, transactionId, &response);
+		}
+
+		requestCount++;
+	}
+
+	if(rxOffset > 0)
+	{
+		memmove(pConnection->pRx, &pConnection->pRx[rxOffset], pConnection->rxSize - rxOffset);
+		pConnection->rxSize -= rxOffset;
+	}
+
+	return requestCount;
+}
+
+
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpServer_Accept(modbus_TcpServer_t *pServer)
+{
+	while(1)
+	{
+		const int fd = accept4(pServer->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if(fd < 0)
+		{
+			// EAGAIN once the backlog is empty, other errors are left to the next attempt.
+			return;
+		}
+
+		modbus_TcpServer_Connection_t *pConnection = pServer->pFreeConnections;
+		if(pConnection == NULL)
+		{
+			// No free slot.
+			close(fd);
+			pServer->rejectedCount++;
+			continue;
+		}
+
+		// Responses are complete frames, waiting for more data would only add latency.
+		const int enable = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+		pConnection->fd = fd;
+		pConnection->events = EPOLLIN;
+		pConnection->rxSize = 0;
+		pConnection->txOffset = 0;
+		pConnection->txSize = 0;
+
+		struct epoll_event event = { .events = pConnection->events, .data.ptr = pConnection };
+		if(epoll_ctl(pServer->epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+		{
+			close(fd);
+			pConnection->fd = -1;
+			pServer->rejectedCount++;
+			continue;
+		}
+
+		pServer->pFreeConnections = pConnection->pNextFree;
+		pConnection->pNextFree = NULL;
+		pServer->connectionCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpServer_CloseConnection(modbus_TcpServer_t *pServer, modbus_TcpServer_Connection_t *pConnection)
+{
+	// Closing the descriptor also removes it from the epoll set.
+	close(pConnection->fd);
+	pConnection->fd = -1;
+
+	pConnection->pNextFree = pServer->pFreeConnections;
+	pServer->pFreeConnections = pConnection;
+	pServer->connectionCount--;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_TcpServer_Receive(modbus_TcpServer_t *pServer, modbus_TcpServer_Connection_t *pConnection)
+{
+	while(pConnection->rxSize < MODBUS_TCP_SERVER_RX_BUFFER_SIZE)
+	{
+		const ssize_t size = recv(pConnection->fd, &pConnection->pRx[pConnection->rxSize], MODBUS_TCP_SERVER_RX_BUFFER_SIZE - pConnection->rxSize, 0);
+		if(size == 0)
+		{
+			// Closed by the client.
+			return false;
+		}
+
+		if(size < 0)
+		{
+			return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR));
+		}
+
+		pConnection->rxSize += (uint32_t)size;
+
+		if(modbus_TcpServer_Process(pServer, pConnection) < 0)
+		{
+			return false;
+		}
+	}
+
+	// Receive buffer is full of requests waiting for room in pTx.
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_TcpServer_Send(modbus_TcpServer_Connection_t *pConnection)
+{
+	while(pConnection->txOffset < pConnection->txSize)
+	{
+		const ssize_t size = send(pConnection->fd, &pConnection->pTx[pConnection->txOffset], pConnection->txSize - pConnection->txOffset, MSG_NOSIGNAL);
+		if(size < 0)
+		{
+			return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR));
+		}
+
+		pConnection->txOffset += (uint32_t)size;
+	}
+
+	pConnection->txOffset = 0;
+	pConnection->txSize = 0;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_TcpServer_Flush(modbus_TcpServer_t *pServer, modbus_TcpServer_Connection_t *pConnection)
+{
+	while(1)
+	{
+		if(!modbus_TcpServer_Send(pConnection))
+		{
+			return false;
+		}
+
+		if(pConnection->txSize > 0)
+		{
+			// Socket buffer is full, continued on EPOLLOUT.
+			return true;
+		}
+
+		// Everything was sent, requests that did not fit into pTx before can be answered now.
+		const int32_t requestCount = modbus_TcpServer_Process(pServer, pConnection);
+		if(requestCount <= 0)
+		{
+			return (requestCount == 0);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static int32_t modbus_TcpServer_Process(modbus_TcpServer_t *pServer, modbus_TcpServer_Connection_t *pConnection)
+{
+	const int32_t requestCount = modbus_TcpServer_ProcessConnection(pServer->pInstance, pServer->pProcessHandler, pServer->pProcessContext, pConnection);
+	if(requestCount < 0)
+	{
+		pServer->protocolErrorCount++;
+	}
+	else
+	{
+		pServer->requestCount += (uint32_t)requestCount;
+	}
+
+	return requestCount;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_TcpServer_UpdateEvents(modbus_TcpServer_t *pServer, modbus_TcpServer_Connection_t *pConnection)
+{
+	uint32_t events = 0;
+
+	// Stop reading while the receive buffer is full, until responses have been sent.
+	if(pConnection->rxSize < MODBUS_TCP_SERVER_RX_BUFFER_SIZE)
+	{
+		events |= EPOLLIN;
+	}
+
+	if(pConnection->txSize > pConnection->txOffset)
+	{
+		events |= EPOLLOUT;
+	}
+
+	if(events == pConnection->events)
+	{
+		return true;
+	}
+
+	pConnection->events = events;
+
+	struct epoll_event event = { .events = events, .data.ptr = pConnection };
+	return (epoll_ctl(pServer->epollFd, EPOLL_CTL_MOD, pConnection->fd, &event) == 0);
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,704 @@
+
+#if defined(__linux__) && defined(MODBUS_TCP_URING)
+
+// syscall(), MAP_ANONYMOUS
+#define _GNU_SOURCE
+
+#include <ModbusEmbedded/modbus_tcp_uring.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+
+
+/**
+ * Completions carry the connection slot with the operation in the low bits.
+ * Accept has no slot.
+ */
+#define MODBUS_TCP_URING_OP_ACCEPT		0
+#define MODBUS_TCP_URING_OP_RECV		1
+#define MODBUS_TCP_URING_OP_SEND		2
+#define MODBUS_TCP_URING_OP_CANCEL		3
+#define MODBUS_TCP_URING_OP_MASK		3
+
+#define MODBUS_TCP_URING_BUFFER_GROUP	0
+
+
+
+static bool modbus_TcpUring_SetupRing(modbus_TcpUring_t *pServer);
+static bool modbus_TcpUring_SetupBuffers(modbus_TcpUring_t *pServer);
+static void modbus_TcpUring_RecycleBuffer(modbus_TcpUring_t *pServer, uint16_t bufferId);
+
+static struct io_uring_sqe *modbus_TcpUring_GetSqe(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection, uint64_t operation);
+static int modbus_TcpUring_Enter(modbus_TcpUring_t *pServer, uint32_t minComplete, int timeoutMs);
+
+static void modbus_TcpUring_SubmitAccept(modbus_TcpUring_t *pServer);
+static void modbus_TcpUring_SubmitRecv(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection);
+static void modbus_TcpUring_SubmitSend(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection);
+static void modbus_TcpUring_SubmitCancel(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection);
+
+static void modbus_TcpUring_HandleAccept(modbus_TcpUring_t *pServer, const struct io_uring_cqe *pCqe);
+static void modbus_TcpUring_HandleRecv(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection, const struct io_uring_cqe *pCqe);
+static void modbus_TcpUring_HandleSend(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection, const struct io_uring_cqe *pCqe);
+
+static void modbus_TcpUring_Drain(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection);
+static void modbus_TcpUring_Update(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection);
+static void modbus_TcpUring_BeginClose(modbus_TcpUring_Connection_t *pConnection);
+static void modbus_TcpUring_ReleaseConnection(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection);
+
+
+
+//------------------------------------------------------------------------------
+//
+bool modbus_TcpUring_Init(modbus_TcpUring_t *pServer, modbus_t *pInstance, const char *pBindAddress, uint16_t port, modbus_TcpUring_Connection_t *pConnections, uint32_t maxConnections)
+{
+	MODBUS_ASSERT(pServer != NULL);
+	MODBUS_ASSERT(pInstance != NULL);
+	MODBUS_ASSERT((pConnections != NULL) || (maxConnections == 0));
+
+	memset(pServer, 0, sizeof(*pServer));
+	pServer->pInstance = pInstance;
+	pServer->listenFd = -1;
+	pServer->ringFd = -1;
+	pServer->pConnections = pConnections;
+	pServer->maxConnections = maxConnections;
+
+	for(uint32_t ctr = maxConnections; ctr > 0; ctr--)
+	{
+		pConnections[ctr - 1].base.fd = -1;
+		pConnections[ctr - 1].pNextFree = pServer->pFreeConnections;
+		pServer->pFreeConnections = &pConnections[ctr - 1];
+	}
+
+	pServer->listenFd = modbus_TcpServer_Listen(pBindAddress, port);
+	if(
+		(pServer->listenFd < 0) ||
+		!modbus_TcpUring_SetupRing(pServer) ||
+		!modbus_TcpUring_SetupBuffers(pServer)
+	)
+	{
+		modbus_TcpUring_Close(pServer);
+		return false;
+	}
+
+	// Transmit buffers as fixed buffer, this pins the memory and may exceed RLIMIT_MEMLOCK.
+	struct iovec transmitMemory =
+	{
+		.iov_base = pConnections,
+		.iov_len = maxConnections * sizeof(modbus_TcpUring_Connection_t)
+	};
+
+	pServer->fixedBuffers = (maxConnections > 0) &&
+		(syscall(__NR_io_uring_register, pServer->ringFd, IORING_REGISTER_BUFFERS, &transmitMemory, 1) == 0);
+
+	modbus_TcpUring_SubmitAccept(pServer);
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_TcpUring_Close(modbus_TcpUring_t *pServer)
+{
+	MODBUS_ASSERT(pServer != NULL);
+
+	// Tearing down the ring cancels everything still in flight.
+	if(pServer->ringFd >= 0)
+	{
+		close(pServer->ringFd);
+		pServer->ringFd = -1;
+	}
+
+	if(pServer->pRingMemory != NULL)
+	{
+		munmap(pServer->pRingMemory, pServer->ringMemorySize);
+		pServer->pRingMemory = NULL;
+	}
+
+	if(pServer->pSqeMemory != NULL)
+	{
+		munmap(pServer->pSqeMemory, pServer->sqeMemorySize);
+		pServer->pSqeMemory = NULL;
+	}
+
+	if(pServer->pBufferRing != NULL)
+	{
+		munmap(pServer->pBufferRing, (MODBUS_TCP_URING_BUFFER_COUNT * sizeof(struct io_uring_buf)) + (MODBUS_TCP_URING_BUFFER_COUNT * MODBUS_TCP_URING_BUFFER_SIZE));
+		pServer->pBufferRing = NULL;
+		pServer->pBuffers = NULL;
+	}
+
+	for(uint32_t ctr = 0; ctr < pServer->maxConnections; ctr++)
+	{
+		if(pServer->pConnections[ctr].base.fd >= 0)
+		{
+			close(pServer->pConnections[ctr].base.fd);
+			pServer->pConnections[ctr].base.fd = -1;
+		}
+	}
+	pServer->connectionCount = 0;
+
+	if(pServer->listenFd >= 0)
+	{
+		close(pServer->listenFd);
+		pServer->listenFd = -1;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+uint16_t modbus_TcpUring_GetPort(const modbus_TcpUring_t *pServer)
+{
+	MODBUS_ASSERT(pServer != NULL);
+
+	struct sockaddr_in address;
+	socklen_t addressSize = sizeof(address);
+
+	if(getsockname(pServer->listenFd, (struct sockaddr *)&address, &addressSize) != 0)
+	{
+		return 0;
+	}
+
+	return ntohs(address.sin_port);
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_TcpUring_Poll(modbus_TcpUring_t *pServer, int timeoutMs)
+{
+	MODBUS_ASSERT(pServer != NULL);
+
+	// Everything queued by the previous round is submitted together with the wait.
+	if(modbus_TcpUring_Enter(pServer, 1, timeoutMs) < 0)
+	{
+		if((errno != ETIME) && (errno != EINTR) && (errno != EBUSY))
+		{
+			return false;
+		}
+	}
+
+	uint32_t cqHead = *pServer->pCqHead;
+	const uint32_t cqTail = __atomic_load_n(pServer->pCqTail, __ATOMIC_ACQUIRE);
+
+	for(; cqHead != cqTail; cqHead++)
+	{
+		const struct io_uring_cqe cqe = pServer->pCqes[cqHead & pServer->cqMask];
+
+		const uint64_t operation = cqe.user_data & MODBUS_TCP_URING_OP_MASK;
+		modbus_TcpUring_Connection_t *pConnection = (modbus_TcpUring_Connection_t *)(uintptr_t)(cqe.user_data & ~(uint64_t)MODBUS_TCP_URING_OP_MASK);
+
+		switch(operation)
+		{
+			case MODBUS_TCP_URING_OP_ACCEPT:
+			{
+				modbus_TcpUring_HandleAccept(pServer, &cqe);
+				break;
+			}
+
+			case MODBUS_TCP_URING_OP_RECV:
+			{
+				modbus_TcpUring_HandleRecv(pServer, pConnection, &cqe);
+				break;
+			}
+
+			case MODBUS_TCP_URING_OP_SEND:
+			{
+				modbus_TcpUring_HandleSend(pServer, pConnection, &cqe);
+				break;
+			}
+
+			case MODBUS_TCP_URING_OP_CANCEL:
+			default:
+			{
+				pConnection->cancelActive = false;
+				modbus_TcpUring_Update(pServer, pConnection);
+				break;
+			}
+		}
+	}
+
+	__atomic_store_n(pServer->pCqHead, cqHead, __ATOMIC_RELEASE);
+
+	if(!pServer->acceptActive)
+	{
+		modbus_TcpUring_SubmitAccept(pServer);
+	}
+
+	return true;
+}
+
+
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_TcpUring_SetupRing(modbus_TcpUring_t *pServer)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	pServer->ringFd = (int)syscall(__NR_io_uring_setup, MODBUS_TCP_URING_QUEUE_SIZE, &params);
+	if(pServer->ringFd < 0)
+	{
+		return false;
+	}
+
+	const uint32_t requiredFeatures = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+	if((params.features & requiredFeatures) != requiredFeatures)
+	{
+		return false;
+	}
+
+	// Submission and completion ring share one mapping.
+	const uint32_t sqSize = params.sq_off.array + (params.sq_entries * sizeof(uint32_t));
+	const uint32_t cqSize = params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+	pServer->ringMemorySize = (sqSize > cqSize) ? sqSize : cqSize;
+
+	pServer->pRingMemory = mmap(NULL, pServer->ringMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, pServer->ringFd, IORING_OFF_SQ_RING);
+	if(pServer->pRingMemory == MAP_FAILED)
+	{
+		pServer->pRingMemory = NULL;
+		return false;
+	}
+
+	pServer->sqeMemorySize = params.sq_entries * sizeof(struct io_uring_sqe);
+	pServer->pSqeMemory = mmap(NULL, pServer->sqeMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, pServer->ringFd, IORING_OFF_SQES);
+	if(pServer->pSqeMemory == MAP_FAILED)
+	{
+		pServer->pSqeMemory = NULL;
+		return false;
+	}
+
+	uint8_t *pRing = pServer->pRingMemory;
+
+	pServer->pSqHead = (uint32_t *)&pRing[params.sq_off.head];
+	pServer->pSqTail = (uint32_t *)&pRing[params.sq_off.tail];
+	pServer->sqMask = *(uint32_t *)&pRing[params.sq_off.ring_mask];
+	pServer->sqEntries = params.sq_entries;
+	pServer->sqTail = *pServer->pSqTail;
+	pServer->sqPending = 0;
+	pServer->pSqes = pServer->pSqeMemory;
+
+	// Submission entries are always used in ring order.
+	uint32_t *pSqArray = (uint32_t *)&pRing[params.sq_off.array];
+	for(uint32_t ctr = 0; ctr < params.sq_entries; ctr++)
+	{
+		pSqArray[ctr] = ctr;
+	}
+
+	pServer->pCqHead = (uint32_t *)&pRing[params.cq_off.head];
+	pServer->pCqTail = (uint32_t *)&pRing[params.cq_off.tail];
+	pServer->cqMask = *(uint32_t *)&pRing[params.cq_off.ring_mask];
+	pServer->pCqes = (struct io_uring_cqe *)&pRing[params.cq_off.cqes];
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool modbus_TcpUring_SetupBuffers(modbus_TcpUring_t *pServer)
+{
+	const size_t ringSize = MODBUS_TCP_URING_BUFFER_COUNT * sizeof(struct io_uring_buf);
+	const size_t bufferSize = MODBUS_TCP_URING_BUFFER_COUNT * MODBUS_TCP_URING_BUFFER_SIZE;
+
+	// Ring and buffers in one page aligned mapping, ring first.
+	void *pMemory = mmap(NULL, ringSize + bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(pMemory == MAP_FAILED)
+	{
+		return false;
+	}
+
+	pServer->pBufferRing = pMemory;
+	pServer->pBuffers = (uint8_t *)pMemory + ringSize;
+	pServer->bufferTail = 0;
+
+	struct io_uring_buf_reg registration;
+	memset(&registration, 0, sizeof(registration));
+	registration.ring_addr = (uint64_t)(uintptr_t)pMemory;
+	registration.ring_entries = MODBUS_TCP_URING_BUFFER_COUNT;
+	registration.bgid = MODBUS_TCP_URING_BUFFER_GROUP;
+
+	if(syscall(__NR_io_uring_register, pServer->ringFd, IORING_REGISTER_PBUF_RING, &registration, 1) != 0)
+	{
+		return false;
+	}
+
+	for(uint16_t ctr = 0; ctr < MODBUS_TCP_URING_BUFFER_COUNT; ctr++)
+	{
+		modbus_TcpUring_RecycleBuffer(pServer, ctr);
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_RecycleBuffer(modbus_TcpUring_t *pServer, uint16_t bufferId)
+{
+	struct io_uring_buf *pBuffer = &pServer->pBufferRing->bufs[pServer->bufferTail & (MODBUS_TCP_URING_BUFFER_COUNT - 1)];
+
+	pBuffer->addr = (uint64_t)(uintptr_t)&pServer->pBuffers[bufferId * MODBUS_TCP_URING_BUFFER_SIZE];
+	pBuffer->len = MODBUS_TCP_URING_BUFFER_SIZE;
+	pBuffer->bid = bufferId;
+
+	pServer->bufferTail++;
+	__atomic_store_n(&pServer->pBufferRing->tail, pServer->bufferTail, __ATOMIC_RELEASE);
+}
+
+//------------------------------------------------------------------------------
+//
+static struct io_uring_sqe *modbus_TcpUring_GetSqe(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection, uint64_t operation)
+{
+	// Submission queue full, hand it to the kernel without waiting.
+	while((pServer->sqTail - __atomic_load_n(pServer->pSqHead, __ATOMIC_ACQUIRE)) >= pServer->sqEntries)
+	{
+		modbus_TcpUring_Enter(pServer, 0, 0);
+	}
+
+	struct io_uring_sqe *pSqe = &pServer->pSqes[pServer->sqTail & pServer->sqMask];
+	memset(pSqe, 0, sizeof(*pSqe));
+	pSqe->user_data = (uint64_t)(uintptr_t)pConnection | operation;
+
+	pServer->sqTail++;
+	pServer->sqPending++;
+
+	return pSqe;
+}
+
+//------------------------------------------------------------------------------
+//
+static int modbus_TcpUring_Enter(modbus_TcpUring_t *pServer, uint32_t minComplete, int timeoutMs)
+{
+	__atomic_store_n(pServer->pSqTail, pServer->sqTail, __ATOMIC_RELEASE);
+
+	struct __kernel_timespec timeout =
+	{
+		.tv_sec = timeoutMs / 1000,
+		.tv_nsec = (timeoutMs % 1000) * 1000000L
+	};
+
+	struct io_uring_getevents_arg argument;
+	memset(&argument, 0, sizeof(argument));
+	argument.ts = (timeoutMs >= 0) ? (uint64_t)(uintptr_t)&timeout : 0;
+
+	uint32_t flags = IORING_ENTER_EXT_ARG;
+	if(minComplete > 0)
+	{
+		flags |= IORING_ENTER_GETEVENTS;
+	}
+
+	const int result = (int)syscall(__NR_io_uring_enter, pServer->ringFd, pServer->sqPending, minComplete, flags, &argument, sizeof(argument));
+	pServer->enterCount++;
+
+	// Without SQPOLL the kernel has consumed the entries once the call returns.
+	pServer->sqPending = pServer->sqTail - __atomic_load_n(pServer->pSqHead, __ATOMIC_ACQUIRE);
+
+	return result;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_SubmitAccept(modbus_TcpUring_t *pServer)
+{
+	struct io_uring_sqe *pSqe = modbus_TcpUring_GetSqe(pServer, NULL, MODBUS_TCP_URING_OP_ACCEPT);
+
+	pSqe->opcode = IORING_OP_ACCEPT;
+	pSqe->fd = pServer->listenFd;
+	pSqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	pSqe->accept_flags = SOCK_CLOEXEC;
+
+	pServer->acceptActive = true;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_SubmitRecv(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection)
+{
+	struct io_uring_sqe *pSqe = modbus_TcpUring_GetSqe(pServer, pConnection, MODBUS_TCP_URING_OP_RECV);
+
+	pSqe->opcode = IORING_OP_RECV;
+	pSqe->fd = pConnection->base.fd;
+	pSqe->ioprio = IORING_RECV_MULTISHOT;
+	pSqe->flags = IOSQE_BUFFER_SELECT;
+	pSqe->buf_group = MODBUS_TCP_URING_BUFFER_GROUP;
+
+	pConnection->recvActive = true;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_SubmitSend(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection)
+{
+	struct io_uring_sqe *pSqe = modbus_TcpUring_GetSqe(pServer, pConnection, MODBUS_TCP_URING_OP_SEND);
+
+	pSqe->opcode = IORING_OP_SEND;
+	pSqe->fd = pConnection->base.fd;
+	pSqe->addr = (uint64_t)(uintptr_t)&pConnection->base.pTx[pConnection->base.txOffset];
+	pSqe->len = pConnection->base.txSize - pConnection->base.txOffset;
+	pSqe->msg_flags = MSG_NOSIGNAL;
+
+	if(pServer->fixedBuffers)
+	{
+		pSqe->ioprio = IORING_RECVSEND_FIXED_BUF;
+		pSqe->buf_index = 0;
+	}
+
+	pConnection->sendActive = true;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_SubmitCancel(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection)
+{
+	struct io_uring_sqe *pSqe = modbus_TcpUring_GetSqe(pServer, pConnection, MODBUS_TCP_URING_OP_CANCEL);
+
+	pSqe->opcode = IORING_OP_ASYNC_CANCEL;
+	pSqe->fd = -1;
+	pSqe->addr = (uint64_t)(uintptr_t)pConnection | MODBUS_TCP_URING_OP_RECV;
+
+	pConnection->cancelActive = true;
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_HandleAccept(modbus_TcpUring_t *pServer, const struct io_uring_cqe *pCqe)
+{
+	if((pCqe->flags & IORING_CQE_F_MORE) == 0)
+	{
+		// Re-armed at the end of modbus_TcpUring_Poll().
+		pServer->acceptActive = false;
+	}
+
+	if(pCqe->res < 0)
+	{
+		return;
+	}
+
+	modbus_TcpUring_Connection_t *pConnection = pServer->pFreeConnections;
+	if(pConnection == NULL)
+	{
+		// No free slot.
+		close(pCqe->res);
+		pServer->rejectedCount++;
+		return;
+	}
+
+	pServer->pFreeConnections = pConnection->pNextFree;
+	pConnection->pNextFree = NULL;
+	pServer->connectionCount++;
+
+	// Responses are complete frames, waiting for more data would only add latency.
+	const int enable = 1;
+	setsockopt(pCqe->res, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+	pConnection->base.fd = pCqe->res;
+	pConnection->base.rxSize = 0;
+	pConnection->base.txOffset = 0;
+	pConnection->base.txSize = 0;
+
+	pConnection->recvActive = false;
+	pConnection->sendActive = false;
+	pConnection->cancelActive = false;
+	pConnection->closing = false;
+	pConnection->stashHead = 0;
+	pConnection->stashCount = 0;
+
+	modbus_TcpUring_SubmitRecv(pServer, pConnection);
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_HandleRecv(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection, const struct io_uring_cqe *pCqe)
+{
+	if((pCqe->flags & IORING_CQE_F_MORE) == 0)
+	{
+		pConnection->recvActive = false;
+	}
+
+	if(pCqe->res > 0)
+	{
+		const uint16_t bufferId = pCqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+		if(pConnection->closing || (pConnection->stashCount == MODBUS_TCP_URING_STASH_SIZE))
+		{
+			// Client keeps sending without reading the responses.
+			modbus_TcpUring_RecycleBuffer(pServer, bufferId);
+			modbus_TcpUring_BeginClose(pConnection);
+		}
+		else
+		{
+			modbus_TcpUring_Stash_t *pStash = &pConnection->pStash[(pConnection->stashHead + pConnection->stashCount) % MODBUS_TCP_URING_STASH_SIZE];
+			pStash->bufferId = bufferId;
+			pStash->offset = 0;
+			pStash->size = (uint16_t)pCqe->res;
+			pConnection->stashCount++;
+
+			modbus_TcpUring_Drain(pServer, pConnection);
+		}
+	}
+	else if((pCqe->res != -ENOBUFS) && (pCqe->res != -ECANCELED))
+	{
+		// Closed by the client or failed.
+		modbus_TcpUring_BeginClose(pConnection);
+	}
+
+	modbus_TcpUring_Update(pServer, pConnection);
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_HandleSend(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection, const struct io_uring_cqe *pCqe)
+{
+	pConnection->sendActive = false;
+
+	if((pCqe->res == -EINVAL) && pServer->fixedBuffers)
+	{
+		// Kernel without fixed buffers for plain sends, continue without them.
+		pServer->fixedBuffers = false;
+	}
+	else if(pCqe->res < 0)
+	{
+		modbus_TcpUring_BeginClose(pConnection);
+	}
+	else
+	{
+		pConnection->base.txOffset += (uint32_t)pCqe->res;
+
+		if(pConnection->base.txOffset == pConnection->base.txSize)
+		{
+			pConnection->base.txOffset = 0;
+			pConnection->base.txSize = 0;
+
+			// Requests that did not fit into pTx before can be answered now.
+			modbus_TcpUring_Drain(pServer, pConnection);
+		}
+	}
+
+	modbus_TcpUring_Update(pServer, pConnection);
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_Drain(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection)
+{
+	modbus_TcpServer_Connection_t *pBase = &pConnection->base;
+
+	while(!pConnection->closing)
+	{
+		while((pConnection->stashCount > 0) && (pBase->rxSize < MODBUS_TCP_SERVER_RX_BUFFER_SIZE))
+		{
+			modbus_TcpUring_Stash_t *pStash = &pConnection->pStash[pConnection->stashHead];
+
+			uint32_t size = pStash->size - pStash->offset;
+			if(size > (MODBUS_TCP_SERVER_RX_BUFFER_SIZE - pBase->rxSize))
+			{
+				size = MODBUS_TCP_SERVER_RX_BUFFER_SIZE - pBase->rxSize;
+			}
+
+			memcpy(&pBase->pRx[pBase->rxSize], &pServer->pBuffers[(pStash->bufferId * MODBUS_TCP_URING_BUFFER_SIZE) + pStash->offset], size);
+			pBase->rxSize += size;
+			pStash->offset += size;
+
+			if(pStash->offset == pStash->size)
+			{
+				modbus_TcpUring_RecycleBuffer(pServer, pStash->bufferId);
+				pConnection->stashHead = (pConnection->stashHead + 1) % MODBUS_TCP_URING_STASH_SIZE;
+				pConnection->stashCount--;
+			}
+		}
+
+		const int32_t requestCount = modbus_TcpServer_ProcessConnection(pServer->pInstance, pServer->pProcessHandler, pServer->pProcessContext, pBase);
+		if(requestCount < 0)
+		{
+			pServer->protocolErrorCount++;
+			modbus_TcpUring_BeginClose(pConnection);
+			return;
+		}
+
+		pServer->requestCount += (uint32_t)requestCount;
+
+		if((requestCount == 0) || (pConnection->stashCount == 0))
+		{
+			return;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_Update(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection)
+{
+	if(pConnection->closing)
+	{
+		if(!pConnection->recvActive && !pConnection->sendActive && !pConnection->cancelActive)
+		{
+			modbus_TcpUring_ReleaseConnection(pServer, pConnection);
+		}
+		return;
+	}
+
+	if(!pConnection->sendActive && (pConnection->base.txSize > pConnection->base.txOffset))
+	{
+		modbus_TcpUring_SubmitSend(pServer, pConnection);
+	}
+
+	if(pConnection->cancelActive)
+	{
+		// A new recv would carry the same user_data and could be hit by the pending cancel.
+		return;
+	}
+
+	if(pConnection->stashCount > 0)
+	{
+		// Stop receiving until the stashed data has been processed.
+		if(pConnection->recvActive)
+		{
+			modbus_TcpUring_SubmitCancel(pServer, pConnection);
+		}
+	}
+	else if(!pConnection->recvActive)
+	{
+		modbus_TcpUring_SubmitRecv(pServer, pConnection);
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_BeginClose(modbus_TcpUring_Connection_t *pConnection)
+{
+	if(!pConnection->closing)
+	{
+		// Ends the multishot recv and any pending send, the slot is released once they completed.
+		pConnection->closing = true;
+		shutdown(pConnection->base.fd, SHUT_RDWR);
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void modbus_TcpUring_ReleaseConnection(modbus_TcpUring_t *pServer, modbus_TcpUring_Connection_t *pConnection)
+{
+	while(pConnection->stashCount > 0)
+	{
+		modbus_TcpUring_RecycleBuffer(pServer, pConnection->pStash[pConnection->stashHead].bufferId);
+		pConnection->stashHead = (pConnection->stashHead + 1) % MODBUS_TCP_URING_STASH_SIZE;
+		pConnection->stashCount--;
+	}
+
+	close(pConnection->base.fd);
+	pConnection->base.fd = -1;
+
+	pConnection->pNextFree = pServer->pFreeConnections;
+	pServer->pFreeConnections = pConnection;
+	pServer->connectionCount--;
+}
+
+#endif /* __linux__ && MODBUS_TCP_URING */
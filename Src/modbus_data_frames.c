@@ -1,34 +1,12 @@
 
 #include <stdio.h>
-#include <stdlib.h>
 #include <string.h>
 
 #include <ModbusEmbedded/modbus.h>
 
 
 
-static inline void modbus_byte_to_hexstr(uint8_t value, char *pBuffer)
-{
-	uint8_t digit = (value >> 4) & 0x0F;
-	if(digit >= 0x0A)
-	{
-		pBuffer[0] = (digit - 0x0A) + 'A';
-	}
-	else
-	{
-		pBuffer[0] = digit + '0';
-	}
-
-	digit = value & 0x0F;
-	if(digit >= 0x0A)
-	{
-		pBuffer[1] = (digit - 0x0A) + 'A';
-	}
-	else
-	{
-		pBuffer[1] = digit + '0';
-	}
-}
+static uint16_t modbus_GetTcpFrameSize(const uint8_t *pData);
 
 
 
@@ -39,37 +17,24 @@ uint16_t modbus_EncodeAscii(char *pBuffer, uint16_t bufferSize, modbus_Pdu_t *pP
 	MODBUS_ASSERT(pBuffer != NULL);
 	MODBUS_ASSERT(pPdu != NULL);
 
-	if(bufferSize < (pPdu->payloadSize + 9))
+	if(bufferSize < (pPdu->payloadSize*2 + 9))
 	{
 		// Buffer too small for PDU
 		return 0;
 	}
 
-	char hexstring_buf[2] = { 0 };
 	pBuffer[0] = ':';
 
-	// Address
-	modbus_byte_to_hexstr(pPdu->busAddress, (char *)hexstring_buf);
-	pBuffer[1] = hexstring_buf[0];
-	pBuffer[2] = hexstring_buf[1];
-
-	// Function Code
-	modbus_byte_to_hexstr((uint8_t)pPdu->functionCode, (char *)hexstring_buf);
-	pBuffer[3] = hexstring_buf[0];
-	pBuffer[4] = hexstring_buf[1];
+	// Address, Function Code
+	const uint8_t pHeader[2] = { pPdu->busAddress, (uint8_t)pPdu->functionCode };
+	modbus_HexEncode(pHeader, sizeof(pHeader), &pBuffer[1]);
 
 	// Payload
-	for(uint16_t ctr = 0; ctr < pPdu->payloadSize; ctr++)
-	{
-		modbus_byte_to_hexstr(pPdu->pPayload[ctr], (char *)hexstring_buf);
-		pBuffer[2*ctr + 5] = hexstring_buf[0];
-		pBuffer[2*ctr + 6] = hexstring_buf[1];
-	}
+	modbus_HexEncode(pPdu->pPayload, pPdu->payloadSize, &pBuffer[5]);
 
 	// LRC Checksum
-	modbus_byte_to_hexstr(modbus_GenerateLrc(pPdu), (char *)hexstring_buf);
-	pBuffer[pPdu->payloadSize*2 + 5] = hexstring_buf[0];
-	pBuffer[pPdu->payloadSize*2 + 6] = hexstring_buf[1];
+	const uint8_t checksum = modbus_GenerateLrc(pPdu);
+	modbus_HexEncode(&checksum, 1, &pBuffer[pPdu->payloadSize*2 + 5]);
 
 	// Stop Characters
 	pBuffer[pPdu->payloadSize*2 + 7] = '\r';
@@ -100,39 +65,30 @@ bool modbus_DecodeAscii(const char *pData, uint16_t dataSize, modbus_Pdu_t *pPdu
 		return false;
 	}
 
-	char hexstring_buf[3] = { 0 };
-	uint32_t byte_buf = 0;
-
-	// Checksum
-	hexstring_buf[0] = pData[dataSize - 4];
-	hexstring_buf[1] = pData[dataSize - 3];
-	byte_buf = strtoul((char *)hexstring_buf, NULL, 16);
-	uint8_t checksum = byte_buf & 0xFF;
-
-	// Address
-	hexstring_buf[0] = pData[1];
-	hexstring_buf[1] = pData[2];
-	byte_buf = strtoul((char *)hexstring_buf, NULL, 16);
-	pPdu->busAddress = byte_buf & 0xFF;
+	const uint16_t payloadChars = dataSize - 9;
+	if(((payloadChars % 2) != 0) || ((payloadChars / 2) > MODBUS_PAYLOAD_SIZE))
+	{
+		// Invalid Format.
+		return false;
+	}
 
-	// Function Code
-	hexstring_buf[0] = pData[3];
-	hexstring_buf[1] = pData[4];
-	byte_buf = strtoul((char *)hexstring_buf, NULL, 16);
-	pPdu->functionCode = (modbus_FunctionCode_e)(byte_buf & 0xFF);
+	uint8_t pHeader[2];
+	uint8_t checksum = 0;
 
-	// Payload
-	pPdu->payloadSize = 0;
-	for(uint16_t ctr = 5; ctr < (dataSize - 4); ctr += 2)
+	if(
+		!modbus_HexDecode(&pData[1], 4, pHeader) ||
+		!modbus_HexDecode(&pData[5], payloadChars, pPdu->pPayload) ||
+		!modbus_HexDecode(&pData[dataSize - 4], 2, &checksum)
+	)
 	{
-		hexstring_buf[0] = pData[ctr];
-		hexstring_buf[1] = pData[ctr+1];
-		byte_buf = strtoul(hexstring_buf, NULL, 16);
-
-		pPdu->pPayload[pPdu->payloadSize] = (uint8_t)byte_buf;
-		pPdu->payloadSize++;
+		// Invalid Characters.
+		return false;
 	}
 
+	pPdu->busAddress = pHeader[0];
+	pPdu->functionCode = (modbus_FunctionCode_e)pHeader[1];
+	pPdu->payloadSize = payloadChars / 2;
+
 	if(modbus_GenerateLrc(pPdu) != checksum)
 	{
 		// Checksum does not match.
@@ -177,8 +133,15 @@ bool modbus_DecodeRtu(const uint8_t *pData, uint16_t dataSize, modbus_Pdu_t *pPd
 	MODBUS_ASSERT(pData != NULL);
 	MODBUS_ASSERT(pPdu != NULL);
 
-	if(dataSize < 5)
+	if((dataSize < 5) || ((dataSize - 4) > MODBUS_PAYLOAD_SIZE))
+	{
+		return false;
+	}
+
+	// Check the frame in place (including the transmitted CRC), before copying anything.
+	if(modbus_CrcUpdate(modbus_CrcInit(), pData, dataSize) != MODBUS_CRC_RESIDUE)
 	{
+		// Checksum does not match.
 		return false;
 	}
 
@@ -186,18 +149,241 @@ bool modbus_DecodeRtu(const uint8_t *pData, uint16_t dataSize, modbus_Pdu_t *pPd
 	pPdu->busAddress = pData[0];
 	pPdu->functionCode = (modbus_FunctionCode_e)pData[1];
 
-	uint16_t checksum = (uint16_t)pData[dataSize-2] | ((uint16_t)pData[dataSize-1] << 8);
+	memcpy(pPdu->pPayload, &pData[2], pPdu->payloadSize);
+
+	return true;
+}
 
-	for(uint16_t ctr = 0; ctr < (dataSize-4); ctr++)
+//------------------------------------------------------------------------------
+//
+bool modbus_DecodeRtuAddressed(const uint8_t *pData, uint16_t dataSize, uint8_t busAddress, modbus_Pdu_t *pPdu)
+{
+	MODBUS_ASSERT(pData != NULL);
+	MODBUS_ASSERT(pPdu != NULL);
+
+	if((dataSize == 0) || ((pData[0] != busAddress) && (pData[0] != MODBUS_BROADCAST_ADDRESS)))
+	{
+		// Frame for another slave.
+		return false;
+	}
+
+	return modbus_DecodeRtu(pData, dataSize, pPdu);
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_DecodeRtuView(uint8_t *pData, uint16_t dataSize, modbus_PduView_t *pView)
+{
+	MODBUS_ASSERT(pData != NULL);
+	MODBUS_ASSERT(pView != NULL);
+
+	if((dataSize < 5) || ((dataSize - 4) > MODBUS_PAYLOAD_SIZE))
 	{
-		pPdu->pPayload[ctr] = pData[ctr+2];
+		return false;
 	}
 
-	if(modbus_GenerateCrc(pPdu) != checksum)
+	if(modbus_CrcUpdate(modbus_CrcInit(), pData, dataSize) != MODBUS_CRC_RESIDUE)
 	{
 		// Checksum does not match.
 		return false;
 	}
 
+	pView->busAddress = pData[0];
+	pView->functionCode = (modbus_FunctionCode_e)pData[1];
+	pView->pPayload = &pData[2];
+	pView->payloadSize = dataSize - 4;
+	pView->payloadCapacity = dataSize - 4;
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+void modbus_PrepareRtuView(uint8_t *pBuffer, uint16_t bufferSize, modbus_PduView_t *pView)
+{
+	MODBUS_ASSERT(pBuffer != NULL);
+	MODBUS_ASSERT(pView != NULL);
+	MODBUS_ASSERT(bufferSize >= 4);
+
+	pView->pPayload = &pBuffer[2];
+	pView->payloadSize = 0;
+	pView->payloadCapacity = bufferSize - 4;
+}
+
+//------------------------------------------------------------------------------
+//
+uint16_t modbus_EncodeRtuView(uint8_t *pBuffer, const modbus_PduView_t *pView)
+{
+	MODBUS_ASSERT(pBuffer != NULL);
+	MODBUS_ASSERT(pView != NULL);
+	MODBUS_ASSERT(pView->pPayload == &pBuffer[2]);
+	MODBUS_ASSERT(pView->payloadSize <= pView->payloadCapacity);
+
+	pBuffer[0] = pView->busAddress;
+	pBuffer[1] = (uint8_t)pView->functionCode;
+
+	uint16_t checksum = modbus_CrcUpdate(modbus_CrcInit(), pBuffer, pView->payloadSize + 2);
+	pBuffer[pView->payloadSize+2] = checksum & 0xFF;
+	pBuffer[pView->payloadSize+3] = (checksum >> 8) & 0xFF;
+
+	return (pView->payloadSize + 4);
+}
+
+//------------------------------------------------------------------------------
+//
+uint16_t modbus_EncodeTcp(uint8_t *pBuffer, uint16_t bufferSize, uint16_t transactionId, modbus_Pdu_t *pPdu)
+{
+	MODBUS_ASSERT(pBuffer != NULL);
+	MODBUS_ASSERT(pPdu != NULL);
+
+	if(bufferSize < (pPdu->payloadSize + MODBUS_TCP_HEADER_SIZE + 1))
+	{
+		// Buffer too small for PDU
+		return 0;
+	}
+
+	modbus_PduView_t view = modbus_GetPduView(pPdu);
+	memcpy(&pBuffer[MODBUS_TCP_HEADER_SIZE + 1], pPdu->pPayload, pPdu->payloadSize);
+	view.pPayload = &pBuffer[MODBUS_TCP_HEADER_SIZE + 1];
+
+	return modbus_EncodeTcpView(pBuffer, transactionId, &view);
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_DecodeTcp(const uint8_t *pData, uint16_t dataSize, uint16_t *pTransactionId, modbus_Pdu_t *pPdu)
+{
+	MODBUS_ASSERT(pData != NULL);
+	MODBUS_ASSERT(pTransactionId != NULL);
+	MODBUS_ASSERT(pPdu != NULL);
+
+	if((dataSize < (MODBUS_TCP_HEADER_SIZE + 1)) || (modbus_GetTcpFrameSize(pData) != dataSize))
+	{
+		return false;
+	}
+
+	*pTransactionId = ((uint16_t)pData[0] << 8) | pData[1];
+
+	pPdu->busAddress = pData[6];
+	pPdu->functionCode = (modbus_FunctionCode_e)pData[7];
+	pPdu->payloadSize = dataSize - (MODBUS_TCP_HEADER_SIZE + 1);
+
+	memcpy(pPdu->pPayload, &pData[MODBUS_TCP_HEADER_SIZE + 1], pPdu->payloadSize);
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_DecodeTcpView(uint8_t *pData, uint16_t dataSize, uint16_t *pTransactionId, modbus_PduView_t *pView)
+{
+	MODBUS_ASSERT(pData != NULL);
+	MODBUS_ASSERT(pTransactionId != NULL);
+	MODBUS_ASSERT(pView != NULL);
+
+	if((dataSize < (MODBUS_TCP_HEADER_SIZE + 1)) || (modbus_GetTcpFrameSize(pData) != dataSize))
+	{
+		return false;
+	}
+
+	*pTransactionId = ((uint16_t)pData[0] << 8) | pData[1];
+
+	pView->busAddress = pData[6];
+	pView->functionCode = (modbus_FunctionCode_e)pData[7];
+	pView->pPayload = &pData[MODBUS_TCP_HEADER_SIZE + 1];
+	pView->payloadSize = dataSize - (MODBUS_TCP_HEADER_SIZE + 1);
+	pView->payloadCapacity = pView->payloadSize;
+
 	return true;
 }
+
+//------------------------------------------------------------------------------
+//
+void modbus_PrepareTcpView(uint8_t *pBuffer, uint16_t bufferSize, modbus_PduView_t *pView)
+{
+	MODBUS_ASSERT(pBuffer != NULL);
+	MODBUS_ASSERT(pView != NULL);
+	MODBUS_ASSERT(bufferSize >= (MODBUS_TCP_HEADER_SIZE + 1));
+
+	pView->pPayload = &pBuffer[MODBUS_TCP_HEADER_SIZE + 1];
+	pView->payloadSize = 0;
+	pView->payloadCapacity = bufferSize - (MODBUS_TCP_HEADER_SIZE + 1);
+}
+
+//------------------------------------------------------------------------------
+//
+uint16_t modbus_EncodeTcpView(uint8_t *pBuffer, uint16_t transactionId, const modbus_PduView_t *pView)
+{
+	MODBUS_ASSERT(pBuffer != NULL);
+	MODBUS_ASSERT(pView != NULL);
+	MODBUS_ASSERT(pView->pPayload == &pBuffer[MODBUS_TCP_HEADER_SIZE + 1]);
+	MODBUS_ASSERT(pView->payloadSize <= pView->payloadCapacity);
+
+	// Length counts unit identifier, function code and payload.
+	const uint16_t length = pView->payloadSize + 2;
+
+	pBuffer[0] = (transactionId >> 8) & 0xFF;
+	pBuffer[1] = transactionId & 0xFF;
+	pBuffer[2] = (MODBUS_TCP_PROTOCOL_ID >> 8) & 0xFF;
+	pBuffer[3] = MODBUS_TCP_PROTOCOL_ID & 0xFF;
+	pBuffer[4] = (length >> 8) & 0xFF;
+	pBuffer[5] = length & 0xFF;
+	pBuffer[6] = pView->busAddress;
+	pBuffer[7] = (uint8_t)pView->functionCode;
+
+	return (pView->payloadSize + MODBUS_TCP_HEADER_SIZE + 1);
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_TcpSplit_e modbus_SplitTcp(uint8_t *pData, uint32_t dataSize, uint32_t *pOffset, uint16_t *pTransactionId, modbus_PduView_t *pView)
+{
+	MODBUS_ASSERT(pData != NULL);
+	MODBUS_ASSERT(pOffset != NULL);
+	MODBUS_ASSERT(*pOffset <= dataSize);
+
+	const uint32_t available = dataSize - *pOffset;
+	if(available < MODBUS_TCP_HEADER_SIZE)
+	{
+		return MODBUS_TCP_SPLIT_INCOMPLETE;
+	}
+
+	uint8_t *pFrame = &pData[*pOffset];
+	const uint16_t frameSize = modbus_GetTcpFrameSize(pFrame);
+	if(frameSize == 0)
+	{
+		return MODBUS_TCP_SPLIT_ERROR;
+	}
+
+	if(available < frameSize)
+	{
+		return MODBUS_TCP_SPLIT_INCOMPLETE;
+	}
+
+	modbus_DecodeTcpView(pFrame, frameSize, pTransactionId, pView);
+	*pOffset += frameSize;
+
+	return MODBUS_TCP_SPLIT_FRAME;
+}
+
+
+
+//------------------------------------------------------------------------------
+//
+static uint16_t modbus_GetTcpFrameSize(const uint8_t *pData)
+{
+	const uint16_t protocolId = ((uint16_t)pData[2] << 8) | pData[3];
+	const uint16_t length = ((uint16_t)pData[4] << 8) | pData[5];
+
+	if(
+		(protocolId != MODBUS_TCP_PROTOCOL_ID) ||
+		(length < 2) ||
+		(length > (MODBUS_PAYLOAD_SIZE + 2))
+	)
+	{
+		// Invalid MBAP header.
+		return 0;
+	}
+
+	return (length + MODBUS_TCP_HEADER_SIZE - 1);
+}
@@ -0,0 +1,186 @@
+
+#include <stddef.h>
+
+#include <ModbusEmbedded/modbus.h>
+
+#if defined(__SSE2__)
+#define MODBUS_HEX_SSE2
+#include <emmintrin.h>
+#endif
+
+
+
+static const char HEX_DIGITS[16] =
+{
+	'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+/**
+ * Nibble value of each character, -1 for anything that is not a hex digit.
+ */
+static const int8_t HEX_NIBBLES[256] =
+{
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+#ifdef MODBUS_HEX_SSE2
+static inline void modbus_HexEncode16(const uint8_t *pData, char *pBuffer);
+static inline bool modbus_HexDecode16(const char *pBuffer, uint8_t *pData);
+#endif
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_HexEncode(const uint8_t *pData, uint16_t dataSize, char *pBuffer)
+{
+	MODBUS_ASSERT((pData != NULL) || (dataSize == 0));
+	MODBUS_ASSERT((pBuffer != NULL) || (dataSize == 0));
+
+	uint16_t ctr = 0;
+
+#ifdef MODBUS_HEX_SSE2
+	for(; (ctr + 16) <= dataSize; ctr += 16)
+	{
+		modbus_HexEncode16(&pData[ctr], &pBuffer[ctr * 2]);
+	}
+#endif
+
+	for(; ctr < dataSize; ctr++)
+	{
+		pBuffer[ctr * 2] = HEX_DIGITS[(pData[ctr] >> 4) & 0x0F];
+		pBuffer[ctr * 2 + 1] = HEX_DIGITS[pData[ctr] & 0x0F];
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+bool modbus_HexDecode(const char *pBuffer, uint16_t charCount, uint8_t *pData)
+{
+	MODBUS_ASSERT((pBuffer != NULL) || (charCount == 0));
+	MODBUS_ASSERT((pData != NULL) || (charCount == 0));
+
+	if((charCount % 2) != 0)
+	{
+		return false;
+	}
+
+	const uint16_t dataSize = charCount / 2;
+	uint16_t ctr = 0;
+
+#ifdef MODBUS_HEX_SSE2
+	for(; (ctr + 16) <= dataSize; ctr += 16)
+	{
+		if(!modbus_HexDecode16(&pBuffer[ctr * 2], &pData[ctr]))
+		{
+			return false;
+		}
+	}
+#endif
+
+	for(; ctr < dataSize; ctr++)
+	{
+		const int8_t high = HEX_NIBBLES[(uint8_t)pBuffer[ctr * 2]];
+		const int8_t low = HEX_NIBBLES[(uint8_t)pBuffer[ctr * 2 + 1]];
+		if((high | low) < 0)
+		{
+			return false;
+		}
+
+		pData[ctr] = (uint8_t)((high << 4) | low);
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+int8_t modbus_HexToNibble(char value)
+{
+	return HEX_NIBBLES[(uint8_t)value];
+}
+
+
+
+#ifdef MODBUS_HEX_SSE2
+//------------------------------------------------------------------------------
+//
+static inline __m128i modbus_HexNibblesToChars(__m128i nibbles)
+{
+	// '0'..'9' for 0..9, 'A'..'F' for 10..15.
+	const __m128i letterOffset = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('A' - '0' - 10));
+
+	return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letterOffset);
+}
+
+//------------------------------------------------------------------------------
+//
+static inline void modbus_HexEncode16(const uint8_t *pData, char *pBuffer)
+{
+	const __m128i mask = _mm_set1_epi8(0x0F);
+	const __m128i data = _mm_loadu_si128((const __m128i *)pData);
+
+	const __m128i high = modbus_HexNibblesToChars(_mm_and_si128(_mm_srli_epi16(data, 4), mask));
+	const __m128i low = modbus_HexNibblesToChars(_mm_and_si128(data, mask));
+
+	_mm_storeu_si128((__m128i *)&pBuffer[0], _mm_unpacklo_epi8(high, low));
+	_mm_storeu_si128((__m128i *)&pBuffer[16], _mm_unpackhi_epi8(high, low));
+}
+
+//------------------------------------------------------------------------------
+//
+static inline __m128i modbus_HexCharsToNibbles(__m128i chars, __m128i *pValid)
+{
+	// Out of range characters wrap around to large unsigned values.
+	const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+	const __m128i letter = _mm_sub_epi8(_mm_or_si128(chars, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+
+	const __m128i isDigit = _mm_cmpeq_epi8(_mm_max_epu8(digit, _mm_set1_epi8(9)), _mm_set1_epi8(9));
+	const __m128i isLetter = _mm_cmpeq_epi8(_mm_max_epu8(letter, _mm_set1_epi8(5)), _mm_set1_epi8(5));
+
+	*pValid = _mm_and_si128(*pValid, _mm_or_si128(isDigit, isLetter));
+
+	return _mm_or_si128(
+		_mm_and_si128(isDigit, digit),
+		_mm_and_si128(isLetter, _mm_add_epi8(letter, _mm_set1_epi8(10))));
+}
+
+//------------------------------------------------------------------------------
+//
+static inline bool modbus_HexDecode16(const char *pBuffer, uint8_t *pData)
+{
+	__m128i valid = _mm_set1_epi8((char)0xFF);
+
+	const __m128i nibbles0 = modbus_HexCharsToNibbles(_mm_loadu_si128((const __m128i *)&pBuffer[0]), &valid);
+	const __m128i nibbles1 = modbus_HexCharsToNibbles(_mm_loadu_si128((const __m128i *)&pBuffer[16]), &valid);
+
+	if(_mm_movemask_epi8(valid) != 0xFFFF)
+	{
+		return false;
+	}
+
+	// Each 16 bit lane holds (low nibble << 8) | high nibble.
+	const __m128i lowByte = _mm_set1_epi16(0x00FF);
+	const __m128i bytes0 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nibbles0, lowByte), 4), _mm_srli_epi16(nibbles0, 8));
+	const __m128i bytes1 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nibbles1, lowByte), 4), _mm_srli_epi16(nibbles1, 8));
+
+	_mm_storeu_si128((__m128i *)pData, _mm_packus_epi16(bytes0, bytes1));
+
+	return true;
+}
+#endif /* MODBUS_HEX_SSE2 */
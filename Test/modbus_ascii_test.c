@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus_ascii.h>
+
+/**
+ * Checks the character-fed ASCII receiver: random frames up to the maximum
+ * size in mixed case with the LRC checked incrementally, corrupted LRCs,
+ * resync on a ':' within a frame, odd hex digit counts, invalid characters,
+ * oversized frames, CR without LF and the inter-character timeout, also
+ * across the timestamp wrap.
+ */
+
+#define TEST_FRAME_CAPACITY		(MODBUS_PAYLOAD_SIZE + 3)
+#define TEST_LINE_SIZE			(1 + (2 * (TEST_FRAME_CAPACITY + 1)) + 2 + 1)
+#define TEST_RANDOM_ROUNDS		5000
+#define TEST_TIMEOUT_MS			100
+
+
+
+typedef struct
+{
+	uint32_t frameEvents;
+	uint32_t errorEvents;
+	uint32_t lastEventIndex;				/**< Index of the character that raised the last event. */
+} test_Feed_t;
+
+
+
+static uint32_t s_failCount = 0;
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s\n", pName);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Writes ":<hex of pData><hex of LRC>\r\n", returns the number of characters.
+static uint16_t test_BuildLine(const uint8_t *pData, uint16_t dataSize, bool lowerCase, char *pLine)
+{
+	const uint8_t lrc = modbus_LrcFinal(modbus_LrcUpdate(modbus_LrcInit(), pData, dataSize));
+	uint16_t size = 0;
+
+	pLine[size++] = ':';
+	modbus_HexEncode(pData, dataSize, &pLine[size]);
+	size += 2 * dataSize;
+	modbus_HexEncode(&lrc, 1, &pLine[size]);
+	size += 2;
+
+	if(lowerCase)
+	{
+		for(uint16_t ctr = 1; ctr < size; ctr++)
+		{
+			if((pLine[ctr] >= 'A') && (pLine[ctr] <= 'F'))
+			{
+				pLine[ctr] = (char)(pLine[ctr] - 'A' + 'a');
+			}
+		}
+	}
+
+	pLine[size++] = '\r';
+	pLine[size++] = '\n';
+	pLine[size] = '\0';
+	return size;
+}
+
+//------------------------------------------------------------------------------
+// Feeds the characters one `stepMs` apart, starting at `*pNowMs`.
+static test_Feed_t test_Feed(modbus_Ascii_Receiver_t *pReceiver, const char *pLine, uint16_t size, uint32_t *pNowMs, uint32_t stepMs)
+{
+	test_Feed_t feed = { 0, 0, UINT32_MAX };
+
+	for(uint16_t ctr = 0; ctr < size; ctr++)
+	{
+		const modbus_Ascii_Event_e event = modbus_Ascii_PutChar(pReceiver, pLine[ctr], *pNowMs);
+		*pNowMs += stepMs;
+
+		if(event != MODBUS_ASCII_EVENT_NONE)
+		{
+			feed.lastEventIndex = ctr;
+		}
+		feed.frameEvents += (event == MODBUS_ASCII_EVENT_FRAME);
+		feed.errorEvents += (event == MODBUS_ASCII_EVENT_ERROR);
+	}
+
+	return feed;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool test_CheckFrame(modbus_Ascii_Receiver_t *pReceiver, const uint8_t *pData, uint16_t dataSize)
+{
+	modbus_PduView_t view;
+
+	return
+		modbus_Ascii_GetFrame(pReceiver, &view) &&
+		(view.busAddress == pData[0]) &&
+		(view.functionCode == pData[1]) &&
+		(view.payloadSize == (dataSize - 2)) &&
+		(view.payloadCapacity == (TEST_FRAME_CAPACITY - 3)) &&
+		(memcmp(view.pPayload, &pData[2], dataSize - 2) == 0);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_RandomData(uint8_t *pData, uint16_t dataSize)
+{
+	for(uint16_t ctr = 0; ctr < dataSize; ctr++)
+	{
+		pData[ctr] = (uint8_t)rand();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Random frames, the LRC is tracked byte by byte and the frame is ready on LF.
+static void test_Random(void)
+{
+	modbus_Ascii_Receiver_t receiver;
+	uint8_t pData[TEST_FRAME_CAPACITY];
+	char pLine[TEST_LINE_SIZE];
+	uint32_t nowMs = UINT32_MAX - 20000;
+	uint32_t lrcErrors = 0;
+
+	modbus_Ascii_Init(&receiver, TEST_TIMEOUT_MS);
+
+	for(uint32_t round = 0; round < TEST_RANDOM_ROUNDS; round++)
+	{
+		// Without the LRC byte, which the receiver keeps in the frame.
+		const uint16_t dataSize = (uint16_t)(2 + (rand() % (TEST_FRAME_CAPACITY - 2)));
+		test_RandomData(pData, dataSize);
+
+		const uint16_t size = test_BuildLine(pData, dataSize, (rand() % 2) == 0, pLine);
+		const bool corrupt = (rand() % 8) == 0;
+		if(corrupt)
+		{
+			// One hex digit changed, the LRC catches any single changed byte.
+			const uint16_t index = (uint16_t)(1 + (rand() % (2 * dataSize)));
+			pLine[index] = (pLine[index] == '0') ? '1' : '0';
+			lrcErrors++;
+		}
+
+		// Noise between frames is ignored.
+		const test_Feed_t noise = test_Feed(&receiver, "x\r\n0", 4, &nowMs, 1);
+		test_Check((noise.frameEvents == 0) && (noise.errorEvents == 0), "noise ignored");
+
+		// The LRC follows every decoded byte.
+		bool lrcMatch = true;
+		uint32_t events = 0;
+		for(uint16_t ctr = 0; ctr < (size - 1); ctr++)
+		{
+			events += (modbus_Ascii_PutChar(&receiver, pLine[ctr], nowMs++) != MODBUS_ASCII_EVENT_NONE);
+
+			if((ctr > 0) && ((ctr % 2) == 0) && (ctr <= (2 * (dataSize + 1))))
+			{
+				const uint8_t *pReceived = receiver.pFrame;
+				lrcMatch = lrcMatch && (receiver.frameSize == (ctr / 2)) && (receiver.lrc == modbus_LrcUpdate(modbus_LrcInit(), pReceived, ctr / 2));
+			}
+		}
+		test_Check(lrcMatch, "incremental LRC");
+		test_Check((events == 0) && (receiver.state == MODBUS_ASCII_STATE_WAITEND), "waiting for LF");
+
+		const modbus_Ascii_Event_e event = modbus_Ascii_PutChar(&receiver, '\n', nowMs++);
+		if(corrupt)
+		{
+			test_Check(event == MODBUS_ASCII_EVENT_ERROR, "LRC error");
+			test_Check(!modbus_Ascii_GetFrame(&receiver, &(modbus_PduView_t){ 0 }), "no frame on LRC error");
+		}
+		else
+		{
+			test_Check(event == MODBUS_ASCII_EVENT_FRAME, "frame on LF");
+			test_Check(test_CheckFrame(&receiver, pData, dataSize), "frame contents");
+		}
+	}
+
+	test_Check(receiver.frameCount == (TEST_RANDOM_ROUNDS - lrcErrors), "frame count");
+	test_Check((receiver.lrcErrorCount == lrcErrors) && (receiver.frameErrorCount == 0), "error counts");
+}
+
+//------------------------------------------------------------------------------
+// A ':' within a frame drops it and starts over.
+static void test_Resync(void)
+{
+	modbus_Ascii_Receiver_t receiver;
+	uint8_t pData[8] = { 0x11, 0x03, 0x00, 0x6B, 0x00, 0x03 };
+	char pLine[TEST_LINE_SIZE];
+	uint32_t nowMs = 0;
+
+	modbus_Ascii_Init(&receiver, TEST_TIMEOUT_MS);
+	const uint16_t size = test_BuildLine(pData, 6, false, pLine);
+
+	// Broken off after the function code, and after CR.
+	test_Feed_t feed = test_Feed(&receiver, pLine, 5, &nowMs, 1);
+	test_Check((feed.frameEvents == 0) && (feed.errorEvents == 0), "partial frame");
+	feed = test_Feed(&receiver, pLine, size, &nowMs, 1);
+	test_Check((feed.errorEvents == 1) && (feed.lastEventIndex == (size - 1)) && (feed.frameEvents == 1), "resync on ':'");
+	test_Check(test_CheckFrame(&receiver, pData, 6), "resynced frame");
+
+	feed = test_Feed(&receiver, pLine, size - 1, &nowMs, 1);
+	feed = test_Feed(&receiver, pLine, size, &nowMs, 1);
+	test_Check((feed.errorEvents == 1) && (feed.frameEvents == 1), "resync after CR");
+
+	// Releasing the frame, a ':' right after it or any other character is no error.
+	modbus_Ascii_ReleaseFrame(&receiver);
+	test_Check(!modbus_Ascii_GetFrame(&receiver, &(modbus_PduView_t){ 0 }), "released");
+	feed = test_Feed(&receiver, pLine, size, &nowMs, 1);
+	feed = test_Feed(&receiver, pLine, size, &nowMs, 1);
+	test_Check((feed.errorEvents == 0) && (feed.frameEvents == 1), "':' after a frame");
+	feed = test_Feed(&receiver, "?", 1, &nowMs, 1);
+	test_Check((feed.errorEvents == 0) && !modbus_Ascii_GetFrame(&receiver, &(modbus_PduView_t){ 0 }), "next character releases");
+
+	test_Check((receiver.frameErrorCount == 2) && (receiver.frameCount == 4), "resync counts");
+}
+
+//------------------------------------------------------------------------------
+// Odd hex digit counts, invalid characters, short frames and CR without LF.
+static void test_Malformed(void)
+{
+	modbus_Ascii_Receiver_t receiver;
+	uint8_t pData[8] = { 0x11, 0x06, 0x00, 0x01, 0x00, 0x03 };
+	char pLine[TEST_LINE_SIZE];
+	char pBroken[TEST_LINE_SIZE];
+	uint32_t nowMs = 0;
+
+	modbus_Ascii_Init(&receiver, TEST_TIMEOUT_MS);
+	const uint16_t size = test_BuildLine(pData, 6, false, pLine);
+
+	// One hex digit dropped: odd count at CR LF.
+	memcpy(pBroken, pLine, size);
+	memmove(&pBroken[3], &pBroken[4], size - 4);
+	test_Feed_t feed = test_Feed(&receiver, pBroken, size - 1, &nowMs, 1);
+	test_Check((feed.errorEvents == 1) && (feed.lastEventIndex == (size - 2)) && (feed.frameEvents == 0), "odd hex digits");
+
+	// Invalid characters drop the frame at once, the rest up to the next ':' is ignored.
+	const char pInvalid[] = { 'G', ' ', 'x', '\n', '\0', (char)0xC1 };
+	for(uint16_t ctr = 0; ctr < sizeof(pInvalid); ctr++)
+	{
+		memcpy(pBroken, pLine, size);
+		pBroken[7] = pInvalid[ctr];
+		feed = test_Feed(&receiver, pBroken, size, &nowMs, 1);
+		test_Check((feed.errorEvents == 1) && (feed.lastEventIndex == 7) && (feed.frameEvents == 0), "invalid character");
+	}
+
+	// Fewer than three bytes: address, function code and LRC.
+	feed = test_Feed(&receiver, ":1100\r\n", 7, &nowMs, 1);
+	test_Check((feed.errorEvents == 1) && (feed.frameEvents == 0), "short frame");
+	feed = test_Feed(&receiver, ":\r\n", 3, &nowMs, 1);
+	test_Check((feed.errorEvents == 1) && (feed.frameEvents == 0), "empty frame");
+
+	// CR followed by anything but LF, also a second CR.
+	memcpy(pBroken, pLine, size);
+	pBroken[size - 1] = '0';
+	feed = test_Feed(&receiver, pBroken, size, &nowMs, 1);
+	test_Check((feed.errorEvents == 1) && (feed.lastEventIndex == (size - 1)), "CR without LF");
+	pBroken[size - 1] = '\r';
+	feed = test_Feed(&receiver, pBroken, size, &nowMs, 1);
+	test_Check((feed.errorEvents == 1) && (feed.lastEventIndex == (size - 1)), "CR CR");
+	feed = test_Feed(&receiver, "\n", 1, &nowMs, 1);
+	test_Check((feed.errorEvents == 0) && (feed.frameEvents == 0), "late LF ignored");
+
+	// LF without CR.
+	memcpy(pBroken, pLine, size);
+	pBroken[size - 2] = '\n';
+	feed = test_Feed(&receiver, pBroken, size - 1, &nowMs, 1);
+	test_Check((feed.errorEvents == 1) && (feed.frameEvents == 0), "LF without CR");
+
+	// And the receiver still takes the intact frame.
+	feed = test_Feed(&receiver, pLine, size, &nowMs, 1);
+	test_Check((feed.errorEvents == 0) && (feed.frameEvents == 1) && test_CheckFrame(&receiver, pData, 6), "intact after errors");
+	test_Check((receiver.frameErrorCount == 12) && (receiver.lrcErrorCount == 0), "malformed counts");
+}
+
+//------------------------------------------------------------------------------
+// The largest frame fits, one byte more is dropped as soon as it starts.
+static void test_Oversized(void)
+{
+	modbus_Ascii_Receiver_t receiver;
+	uint8_t pData[TEST_FRAME_CAPACITY];
+	char pLine[TEST_LINE_SIZE];
+	uint32_t nowMs = 0;
+
+	modbus_Ascii_Init(&receiver, TEST_TIMEOUT_MS);
+	test_RandomData(pData, sizeof(pData));
+
+	uint16_t size = test_BuildLine(pData, TEST_FRAME_CAPACITY - 1, false, pLine);
+	test_Feed_t feed = test_Feed(&receiver, pLine, size, &nowMs, 1);
+	test_Check((feed.frameEvents == 1) && test_CheckFrame(&receiver, pData, TEST_FRAME_CAPACITY - 1), "largest frame");
+
+	size = test_BuildLine(pData, TEST_FRAME_CAPACITY, false, pLine);
+	feed = test_Feed(&receiver, pLine, size, &nowMs, 1);
+	test_Check((feed.frameEvents == 0) && (feed.errorEvents == 1), "oversized frame");
+	test_Check(feed.lastEventIndex == (1 + (2 * TEST_FRAME_CAPACITY)), "dropped at the first extra digit");
+}
+
+//------------------------------------------------------------------------------
+// Gaps longer than the timeout drop the frame, on the next character or in Poll().
+static void test_Timeout(void)
+{
+	modbus_Ascii_Receiver_t receiver;
+	uint8_t pData[8] = { 0x01, 0x04, 0x00, 0x00, 0x00, 0x0A };
+	char pLine[TEST_LINE_SIZE];
+	uint32_t nowMs = UINT32_MAX - 3;
+
+	modbus_Ascii_Init(&receiver, TEST_TIMEOUT_MS);
+	const uint16_t size = test_BuildLine(pData, 6, false, pLine);
+
+	// Every gap exactly at the timeout, across the wrap.
+	test_Feed_t feed = test_Feed(&receiver, pLine, size, &nowMs, TEST_TIMEOUT_MS);
+	test_Check((feed.frameEvents == 1) && (feed.errorEvents == 0), "gaps at the timeout");
+
+	// One millisecond more in the middle of the frame.
+	feed = test_Feed(&receiver, pLine, 6, &nowMs, 1);
+	nowMs += TEST_TIMEOUT_MS;
+	feed = test_Feed(&receiver, &pLine[6], size - 6, &nowMs, 1);
+	test_Check((feed.frameEvents == 0) && (feed.errorEvents == 1) && (feed.lastEventIndex == 0), "gap over the timeout");
+
+	// Poll() drops a stalled frame, but not an idle receiver or a ready frame.
+	feed = test_Feed(&receiver, pLine, 6, &nowMs, 1);
+	const uint32_t lastMs = nowMs - 1;
+	test_Check(modbus_Ascii_Poll(&receiver, lastMs + TEST_TIMEOUT_MS) == MODBUS_ASCII_EVENT_NONE, "poll within the timeout");
+	test_Check(modbus_Ascii_Poll(&receiver, lastMs + TEST_TIMEOUT_MS + 1) == MODBUS_ASCII_EVENT_ERROR, "poll after the timeout");
+	test_Check(modbus_Ascii_Poll(&receiver, lastMs + TEST_TIMEOUT_MS + 2) == MODBUS_ASCII_EVENT_NONE, "poll idle");
+
+	feed = test_Feed(&receiver, pLine, size - 1, &nowMs, 1);
+	test_Check(modbus_Ascii_Poll(&receiver, nowMs + TEST_TIMEOUT_MS) == MODBUS_ASCII_EVENT_ERROR, "poll while waiting for LF");
+
+	feed = test_Feed(&receiver, pLine, size, &nowMs, 1);
+	test_Check(modbus_Ascii_Poll(&receiver, nowMs + TEST_TIMEOUT_MS) == MODBUS_ASCII_EVENT_NONE, "poll ready frame");
+	test_Check(test_CheckFrame(&receiver, pData, 6), "ready frame kept");
+
+	test_Check((receiver.frameErrorCount == 3) && (receiver.frameCount == 2), "timeout counts");
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	srand(1);
+
+	test_Random();
+	test_Resync();
+	test_Malformed();
+	test_Oversized();
+	test_Timeout();
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
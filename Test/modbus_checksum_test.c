@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus.h>
+
+/**
+ * Checks the compiled CRC engine against a bitwise reference, over random
+ * lengths, alignments and start values. Test/run.sh builds it once per engine.
+ */
+
+#define TEST_ROUNDS			20000
+#define TEST_MAX_SIZE		4096
+#define TEST_MAX_OFFSET		16
+
+// Address, function code, full payload and CRC.
+#define TEST_FRAME_SIZE		(MODBUS_PAYLOAD_SIZE + 4)
+
+
+
+static uint8_t s_pData[TEST_MAX_SIZE + TEST_MAX_OFFSET];
+static uint32_t s_failCount = 0;
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+// CRC-16/MODBUS one bit at a time: reflected polynomial 0xA001, no final XOR.
+static uint16_t test_ReferenceCrc(uint16_t crc, const uint8_t *pData, uint32_t dataSize)
+{
+	for(uint32_t ctr = 0; ctr < dataSize; ctr++)
+	{
+		crc ^= pData[ctr];
+		for(uint8_t bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 1) ? (uint16_t)((crc >> 1) ^ 0xA001) : (uint16_t)(crc >> 1);
+		}
+	}
+
+	return crc;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName, uint32_t round, uint32_t dataSize)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s (round %u, size %u)\n", pName, (unsigned)round, (unsigned)dataSize);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	srand(1);
+	for(uint32_t ctr = 0; ctr < sizeof(s_pData); ctr++)
+	{
+		s_pData[ctr] = (uint8_t)rand();
+	}
+
+	// Check value of the CRC-16/MODBUS catalogue entry.
+	test_Check(modbus_CrcUpdate(modbus_CrcInit(), (const uint8_t *)"123456789", 9) == 0x4B37, "check value", 0, 9);
+
+	for(uint32_t round = 0; round < TEST_ROUNDS; round++)
+	{
+		// Mostly PDU sized buffers, every tenth one long enough for all folding paths.
+		const uint32_t dataSize = ((round % 10) == 0) ? (uint32_t)(rand() % (TEST_MAX_SIZE + 1)) : (uint32_t)(rand() % (TEST_FRAME_SIZE + 1));
+		const uint8_t *pData = &s_pData[rand() % TEST_MAX_OFFSET];
+		const uint16_t init = (uint16_t)rand();
+		const uint16_t expected = test_ReferenceCrc(init, pData, dataSize);
+
+		test_Check(modbus_CrcUpdate(init, pData, dataSize) == expected, "modbus_CrcUpdate", round, dataSize);
+
+		// Streaming in two chunks gives the same result.
+		const uint32_t split = (dataSize > 0) ? (uint32_t)(rand() % (dataSize + 1)) : 0;
+		const uint16_t chunked = modbus_CrcUpdate(modbus_CrcUpdate(init, pData, split), &pData[split], dataSize - split);
+		test_Check(chunked == expected, "modbus_CrcUpdate chunked", round, dataSize);
+
+		if(dataSize <= TEST_FRAME_SIZE)
+		{
+			uint16_t crc = init;
+			for(uint32_t ctr = 0; ctr < dataSize; ctr++)
+			{
+				crc = modbus_CrcUpdateByte(crc, pData[ctr]);
+			}
+			test_Check(crc == expected, "modbus_CrcUpdateByte", round, dataSize);
+		}
+
+		// Whole PDU, and the residue of a frame with its CRC appended.
+		if(dataSize <= MODBUS_PAYLOAD_SIZE)
+		{
+			modbus_Pdu_t pdu;
+			pdu.busAddress = pData[0];
+			pdu.functionCode = pData[1];
+			pdu.payloadSize = (uint16_t)dataSize;
+			memcpy(pdu.pPayload, pData, dataSize);
+
+			uint8_t pFrame[TEST_FRAME_SIZE];
+			pFrame[0] = pdu.busAddress;
+			pFrame[1] = pdu.functionCode;
+			memcpy(&pFrame[2], pdu.pPayload, dataSize);
+
+			const uint16_t crc = modbus_GenerateCrc(&pdu);
+			test_Check(crc == test_ReferenceCrc(0xFFFF, pFrame, dataSize + 2), "modbus_GenerateCrc", round, dataSize);
+
+			pFrame[dataSize + 2] = (uint8_t)(crc & 0xFF);
+			pFrame[dataSize + 3] = (uint8_t)(crc >> 8);
+			test_Check(modbus_CrcUpdate(modbus_CrcInit(), pFrame, dataSize + 4) == MODBUS_CRC_RESIDUE, "residue", round, dataSize);
+		}
+	}
+
+	printf("%s: %u rounds, %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)TEST_ROUNDS, (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
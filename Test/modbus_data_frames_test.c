@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus.h>
+
+/**
+ * Checks the Modbus TCP framing: streams of random back-to-back ADUs fed in
+ * random chunk sizes through modbus_SplitTcp() the way a server reads them,
+ * and the MBAP header checks, protocol identifier and the length limits,
+ * for modbus_SplitTcp() and modbus_DecodeTcpView().
+ */
+
+#define TEST_FRAME_COUNT		2000
+#define TEST_STREAM_ROUNDS		20
+#define TEST_RX_BUFFER_SIZE		(4 * MODBUS_TCP_FRAME_SIZE)
+
+
+
+typedef struct
+{
+	uint16_t transactionId;
+	uint8_t busAddress;
+	uint8_t functionCode;
+	uint16_t payloadSize;
+	uint32_t offset;						/**< Of the payload in the stream. */
+} test_Frame_t;
+
+
+
+static uint32_t s_failCount = 0;
+
+static uint8_t s_pStream[TEST_FRAME_COUNT * MODBUS_TCP_FRAME_SIZE];
+static test_Frame_t s_pFrames[TEST_FRAME_COUNT];
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s\n", pName);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Concatenates random ADUs, short ones more often than long ones. Returns the stream size.
+static uint32_t test_BuildStream(void)
+{
+	uint32_t size = 0;
+
+	for(uint32_t ctr = 0; ctr < TEST_FRAME_COUNT; ctr++)
+	{
+		test_Frame_t *pFrame = &s_pFrames[ctr];
+		uint8_t *pBuffer = &s_pStream[size];
+		modbus_PduView_t view;
+
+		pFrame->transactionId = (uint16_t)rand();
+		pFrame->busAddress = (uint8_t)rand();
+		pFrame->functionCode = (uint8_t)rand();
+		pFrame->payloadSize = (uint16_t)(((rand() % 4) == 0) ? (rand() % (MODBUS_PAYLOAD_SIZE + 1)) : (rand() % 12));
+
+		modbus_PrepareTcpView(pBuffer, MODBUS_TCP_FRAME_SIZE, &view);
+		view.busAddress = pFrame->busAddress;
+		view.functionCode = (modbus_FunctionCode_e)pFrame->functionCode;
+		view.payloadSize = pFrame->payloadSize;
+		for(uint16_t index = 0; index < view.payloadSize; index++)
+		{
+			view.pPayload[index] = (uint8_t)rand();
+		}
+
+		pFrame->offset = size + MODBUS_TCP_HEADER_SIZE + 1;
+		size += modbus_EncodeTcpView(pBuffer, pFrame->transactionId, &view);
+	}
+
+	return size;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool test_CheckFrame(uint32_t index, uint16_t transactionId, const modbus_PduView_t *pView)
+{
+	const test_Frame_t *pFrame = &s_pFrames[index];
+
+	return
+		(transactionId == pFrame->transactionId) &&
+		(pView->busAddress == pFrame->busAddress) &&
+		(pView->functionCode == pFrame->functionCode) &&
+		(pView->payloadSize == pFrame->payloadSize) &&
+		(memcmp(pView->pPayload, &s_pStream[pFrame->offset], pFrame->payloadSize) == 0);
+}
+
+//------------------------------------------------------------------------------
+// Reads the stream in random chunks into a receive buffer, splits off what is
+// complete and keeps the rest for the next read.
+static void test_Stream(void)
+{
+	static uint8_t s_pRx[TEST_RX_BUFFER_SIZE];
+
+	for(uint32_t round = 0; round < TEST_STREAM_ROUNDS; round++)
+	{
+		const uint32_t streamSize = test_BuildStream();
+		const uint32_t maxChunk = (round % 2) ? 3 : (uint32_t)(1 + (rand() % (TEST_RX_BUFFER_SIZE - MODBUS_TCP_FRAME_SIZE)));
+
+		uint32_t streamOffset = 0;
+		uint32_t rxSize = 0;
+		uint32_t frameCount = 0;
+		bool match = true;
+		bool error = false;
+
+		while(streamOffset < streamSize)
+		{
+			// Never more than what is left of the receive buffer, which always holds a full ADU.
+			uint32_t chunk = 1 + (rand() % maxChunk);
+			chunk = (chunk < (streamSize - streamOffset)) ? chunk : (streamSize - streamOffset);
+			chunk = (chunk < (TEST_RX_BUFFER_SIZE - rxSize)) ? chunk : (TEST_RX_BUFFER_SIZE - rxSize);
+
+			memcpy(&s_pRx[rxSize], &s_pStream[streamOffset], chunk);
+			streamOffset += chunk;
+			rxSize += chunk;
+
+			uint32_t rxOffset = 0;
+			for(;;)
+			{
+				uint16_t transactionId = 0;
+				modbus_PduView_t view;
+				const uint32_t previousOffset = rxOffset;
+
+				const modbus_TcpSplit_e result = modbus_SplitTcp(s_pRx, rxSize, &rxOffset, &transactionId, &view);
+				if(result == MODBUS_TCP_SPLIT_INCOMPLETE)
+				{
+					match = match && (rxOffset == previousOffset);
+					break;
+				}
+
+				if(result != MODBUS_TCP_SPLIT_FRAME)
+				{
+					error = true;
+					break;
+				}
+
+				match = match && (frameCount < TEST_FRAME_COUNT) && test_CheckFrame(frameCount, transactionId, &view);
+				match = match && (view.pPayload == &s_pRx[previousOffset + MODBUS_TCP_HEADER_SIZE + 1]);
+				match = match && (rxOffset == (previousOffset + MODBUS_TCP_HEADER_SIZE + 1 + view.payloadSize));
+				frameCount++;
+			}
+
+			if(error)
+			{
+				break;
+			}
+
+			rxSize -= rxOffset;
+			memmove(s_pRx, &s_pRx[rxOffset], rxSize);
+		}
+
+		test_Check(!error, "stream without errors");
+		test_Check(match, "stream frames");
+		test_Check((frameCount == TEST_FRAME_COUNT) && (rxSize == 0), "stream complete");
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_PutHeader(uint8_t *pBuffer, uint16_t protocolId, uint16_t length)
+{
+	pBuffer[0] = 0x12;
+	pBuffer[1] = 0x34;
+	pBuffer[2] = (uint8_t)(protocolId >> 8);
+	pBuffer[3] = (uint8_t)protocolId;
+	pBuffer[4] = (uint8_t)(length >> 8);
+	pBuffer[5] = (uint8_t)length;
+	pBuffer[6] = 17;
+	pBuffer[7] = MODBUS_FUNCTION_READHOLDING;
+}
+
+//------------------------------------------------------------------------------
+// The protocol identifier and length are checked as soon as the header is in.
+static void test_Header(void)
+{
+	static uint8_t s_pBuffer[2 * MODBUS_TCP_FRAME_SIZE];
+
+	uint16_t transactionId = 0;
+	modbus_PduView_t view;
+	uint32_t offset;
+
+	memset(s_pBuffer, 0xA5, sizeof(s_pBuffer));
+
+	// Header incomplete: whatever it holds, more bytes are needed.
+	test_PutHeader(s_pBuffer, 0x0001, 0);
+	for(uint32_t size = 0; size < MODBUS_TCP_HEADER_SIZE; size++)
+	{
+		offset = 0;
+		test_Check(modbus_SplitTcp(s_pBuffer, size, &offset, &transactionId, &view) == MODBUS_TCP_SPLIT_INCOMPLETE, "header incomplete");
+	}
+
+	// Any protocol identifier but 0.
+	const uint16_t pProtocolIds[4] = { 0x0001, 0x0100, 0x8000, 0xFFFF };
+	for(uint16_t ctr = 0; ctr < 4; ctr++)
+	{
+		test_PutHeader(s_pBuffer, pProtocolIds[ctr], 6);
+
+		offset = 0;
+		test_Check(modbus_SplitTcp(s_pBuffer, MODBUS_TCP_HEADER_SIZE, &offset, &transactionId, &view) == MODBUS_TCP_SPLIT_ERROR, "protocol id, header only");
+		test_Check(modbus_SplitTcp(s_pBuffer, MODBUS_TCP_HEADER_SIZE + 5, &offset, &transactionId, &view) == MODBUS_TCP_SPLIT_ERROR, "protocol id");
+		test_Check(offset == 0, "error keeps the offset");
+		test_Check(!modbus_DecodeTcpView(s_pBuffer, MODBUS_TCP_HEADER_SIZE + 5, &transactionId, &view), "protocol id decode");
+	}
+
+	// Length counts unit identifier and function code, 2 up to the full payload.
+	for(uint32_t length = 0; length <= 0xFFFF; length++)
+	{
+		const bool valid = (length >= 2) && (length <= (MODBUS_PAYLOAD_SIZE + 2));
+		const uint32_t frameSize = length + MODBUS_TCP_HEADER_SIZE - 1;
+
+		test_PutHeader(s_pBuffer, MODBUS_TCP_PROTOCOL_ID, (uint16_t)length);
+
+		offset = 0;
+		const modbus_TcpSplit_e header = modbus_SplitTcp(s_pBuffer, MODBUS_TCP_HEADER_SIZE, &offset, &transactionId, &view);
+		if(!valid)
+		{
+			test_Check(header == MODBUS_TCP_SPLIT_ERROR, "length out of range");
+			continue;
+		}
+
+		test_Check(header == MODBUS_TCP_SPLIT_INCOMPLETE, "length header only");
+
+		offset = 0;
+		test_Check(modbus_SplitTcp(s_pBuffer, frameSize - 1, &offset, &transactionId, &view) == MODBUS_TCP_SPLIT_INCOMPLETE, "one byte short");
+
+		offset = 0;
+		test_Check(modbus_SplitTcp(s_pBuffer, frameSize + 3, &offset, &transactionId, &view) == MODBUS_TCP_SPLIT_FRAME, "length in range");
+		test_Check((offset == frameSize) && (view.payloadSize == (length - 2)) && (transactionId == 0x1234), "length frame");
+		test_Check((view.busAddress == 17) && (view.functionCode == MODBUS_FUNCTION_READHOLDING), "length frame header");
+
+		test_Check(modbus_DecodeTcpView(s_pBuffer, (uint16_t)frameSize, &transactionId, &view), "decode exact size");
+		test_Check(!modbus_DecodeTcpView(s_pBuffer, (uint16_t)(frameSize + 1), &transactionId, &view), "decode too long");
+		test_Check(!modbus_DecodeTcpView(s_pBuffer, (uint16_t)(frameSize - 1), &transactionId, &view), "decode too short");
+	}
+
+	// A broken header behind a good ADU: the good one first, then the error.
+	test_PutHeader(s_pBuffer, MODBUS_TCP_PROTOCOL_ID, 6);
+	test_PutHeader(&s_pBuffer[12], MODBUS_TCP_PROTOCOL_ID, MODBUS_PAYLOAD_SIZE + 3);
+
+	offset = 0;
+	test_Check(modbus_SplitTcp(s_pBuffer, 12 + MODBUS_TCP_HEADER_SIZE, &offset, &transactionId, &view) == MODBUS_TCP_SPLIT_FRAME, "good before broken");
+	test_Check(offset == 12, "behind the good one");
+	test_Check(modbus_SplitTcp(s_pBuffer, 12 + MODBUS_TCP_HEADER_SIZE, &offset, &transactionId, &view) == MODBUS_TCP_SPLIT_ERROR, "broken behind good");
+	test_Check(offset == 12, "error keeps the offset behind the good one");
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	srand(1);
+
+	test_Stream();
+	test_Header();
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus.h>
+
+/**
+ * Checks the hex codec of the ASCII framing against a plain scalar reference.
+ * Test/run.sh builds it with the SSE2 path and with the lookup tables only.
+ */
+
+#define TEST_MAX_SIZE		(MODBUS_PAYLOAD_SIZE + 3)
+
+
+
+static uint32_t s_failCount = 0;
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+static int8_t test_ReferenceNibble(char value)
+{
+	if((value >= '0') && (value <= '9'))
+	{
+		return (int8_t)(value - '0');
+	}
+	if((value >= 'A') && (value <= 'F'))
+	{
+		return (int8_t)(value - 'A' + 10);
+	}
+	if((value >= 'a') && (value <= 'f'))
+	{
+		return (int8_t)(value - 'a' + 10);
+	}
+	return -1;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName, uint32_t dataSize, uint32_t position)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s (size %u, position %u)\n", pName, (unsigned)dataSize, (unsigned)position);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	static const char HEX_UPPER[] = "0123456789ABCDEF";
+	static const char HEX_LOWER[] = "0123456789abcdef";
+
+	uint8_t pData[TEST_MAX_SIZE];
+	uint8_t pDecoded[TEST_MAX_SIZE];
+	char pEncoded[TEST_MAX_SIZE * 2];
+	char pExpected[TEST_MAX_SIZE * 2];
+
+	for(uint32_t value = 0; value < 256; value++)
+	{
+		test_Check(modbus_HexToNibble((char)value) == test_ReferenceNibble((char)value), "modbus_HexToNibble", 1, value);
+	}
+
+	srand(1);
+
+	// Every size covers whole 16 byte blocks, the scalar tail, and both together.
+	for(uint32_t dataSize = 0; dataSize <= TEST_MAX_SIZE; dataSize++)
+	{
+		for(uint32_t ctr = 0; ctr < dataSize; ctr++)
+		{
+			pData[ctr] = (uint8_t)rand();
+			pExpected[ctr * 2] = HEX_UPPER[pData[ctr] >> 4];
+			pExpected[ctr * 2 + 1] = HEX_UPPER[pData[ctr] & 0x0F];
+		}
+
+		modbus_HexEncode(pData, (uint16_t)dataSize, pEncoded);
+		test_Check(memcmp(pEncoded, pExpected, dataSize * 2) == 0, "modbus_HexEncode", dataSize, 0);
+
+		memset(pDecoded, 0, sizeof(pDecoded));
+		test_Check(modbus_HexDecode(pEncoded, (uint16_t)(dataSize * 2), pDecoded), "modbus_HexDecode", dataSize, 0);
+		test_Check(memcmp(pDecoded, pData, dataSize) == 0, "modbus_HexDecode value", dataSize, 0);
+
+		// Lower and mixed case decode to the same bytes.
+		for(uint32_t ctr = 0; ctr < dataSize * 2; ctr++)
+		{
+			const int8_t nibble = test_ReferenceNibble(pEncoded[ctr]);
+			pEncoded[ctr] = ((rand() % 2) == 0) ? HEX_LOWER[nibble] : HEX_UPPER[nibble];
+		}
+
+		memset(pDecoded, 0, sizeof(pDecoded));
+		test_Check(modbus_HexDecode(pEncoded, (uint16_t)(dataSize * 2), pDecoded), "modbus_HexDecode mixed case", dataSize, 0);
+		test_Check(memcmp(pDecoded, pData, dataSize) == 0, "modbus_HexDecode mixed case value", dataSize, 0);
+
+		if(dataSize > 0)
+		{
+			test_Check(!modbus_HexDecode(pEncoded, (uint16_t)(dataSize * 2 - 1), pDecoded), "modbus_HexDecode odd count", dataSize, 0);
+		}
+	}
+
+	// Every character value at every position of a full PDU, in and out of the SIMD blocks.
+	const uint32_t dataSize = MODBUS_PAYLOAD_SIZE;
+	modbus_HexEncode(pData, (uint16_t)dataSize, pEncoded);
+
+	for(uint32_t position = 0; position < dataSize * 2; position++)
+	{
+		const char original = pEncoded[position];
+
+		for(uint32_t value = 0; value < 256; value++)
+		{
+			pEncoded[position] = (char)value;
+			const bool valid = (test_ReferenceNibble((char)value) >= 0);
+
+			test_Check(modbus_HexDecode(pEncoded, (uint16_t)(dataSize * 2), pDecoded) == valid, "modbus_HexDecode invalid character", dataSize, position);
+		}
+
+		pEncoded[position] = original;
+	}
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
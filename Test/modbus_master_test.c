@@ -0,0 +1,1055 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus_master.h>
+
+/**
+ * Runs master requests of every function code against modbus_ProcessView(),
+ * over TCP and RTU framing, and feeds the master malformed and mismatched
+ * responses, TCP responses out of order, several RTU requests in flight,
+ * broadcasts and a full slot table. The response time estimator, retries and
+ * backoff are stepped through with explicit timestamps.
+ */
+
+#define TEST_BUS_ADDRESS		17
+#define TEST_BIT_COUNT			2100
+#define TEST_REGISTER_COUNT		300
+#define TEST_SLOT_COUNT			4
+#define TEST_RANDOM_ROUNDS		5000
+#define TEST_FRAME_SIZE			(MODBUS_PAYLOAD_SIZE + MODBUS_TCP_HEADER_SIZE + 4)
+
+
+
+static uint32_t s_failCount = 0;
+
+static uint16_t s_pCoils[TEST_BIT_COUNT];
+static uint16_t s_pDiscrete[TEST_BIT_COUNT];
+static uint16_t s_pHolding[TEST_REGISTER_COUNT];
+static uint16_t s_pInput[TEST_REGISTER_COUNT];
+
+static modbus_t s_slave;
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s\n", pName);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_GenericFunction(modbus_Pdu_t *pRequest, modbus_Pdu_t *pResponse)
+{
+	(void)pRequest;
+	modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e test_Read(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t *pValue)
+{
+	switch(functionCode)
+	{
+		case MODBUS_FUNCTION_READCOILS:
+		case MODBUS_FUNCTION_READDISCRETE:
+		{
+			if(address >= TEST_BIT_COUNT)
+			{
+				return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+			}
+			*pValue = (functionCode == MODBUS_FUNCTION_READCOILS) ? s_pCoils[address] : s_pDiscrete[address];
+			return MODBUS_EXCEPTION_SUCCESS;
+		}
+
+		default:
+		{
+			if(address >= TEST_REGISTER_COUNT)
+			{
+				return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+			}
+			*pValue = (functionCode == MODBUS_FUNCTION_READINPUT) ? s_pInput[address] : s_pHolding[address];
+			return MODBUS_EXCEPTION_SUCCESS;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e test_WriteCoil(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+{
+	(void)functionCode;
+
+	if(address >= TEST_BIT_COUNT)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+	s_pCoils[address] = value;
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e test_WriteRegister(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+{
+	(void)functionCode;
+
+	if(address >= TEST_REGISTER_COUNT)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+	s_pHolding[address] = value;
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+static const modbus_Handlers_t s_handlers =
+{
+	.pGenericFunctionHandler = test_GenericFunction,
+	.pReadCoilHandler = test_Read,
+	.pReadDiscreteHandler = test_Read,
+	.pReadHoldingRegisterHandler = test_Read,
+	.pReadInputRegisterHandler = test_Read,
+	.pWriteCoilHandler = test_WriteCoil,
+	.pWriteRegisterHandler = test_WriteRegister,
+};
+
+//------------------------------------------------------------------------------
+//
+static void test_InitSlave(void)
+{
+	memset(&s_slave, 0, sizeof(s_slave));
+	s_slave.busAddress = TEST_BUS_ADDRESS;
+	s_slave.pHandlers = &s_handlers;
+
+	for(uint32_t ctr = 0; ctr < TEST_BIT_COUNT; ctr++)
+	{
+		s_pCoils[ctr] = (rand() & 1) ? MODBUS_BIT_ON : MODBUS_BIT_OFF;
+		s_pDiscrete[ctr] = (rand() & 1) ? MODBUS_BIT_ON : MODBUS_BIT_OFF;
+	}
+	for(uint32_t ctr = 0; ctr < TEST_REGISTER_COUNT; ctr++)
+	{
+		s_pHolding[ctr] = (uint16_t)rand();
+		s_pInput[ctr] = (uint16_t)rand();
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static bool test_GetBit(const uint8_t *pBits, uint32_t index)
+{
+	return (pBits[index / 8] >> (index % 8)) & 1;
+}
+
+//------------------------------------------------------------------------------
+// Runs one frame through the slave and returns the response frame size, 0 if there is none.
+static uint16_t test_Serve(uint8_t *pFrame, uint16_t frameSize, bool tcp, uint8_t *pResponseFrame)
+{
+	modbus_PduView_t request;
+	modbus_PduView_t response;
+	uint16_t transactionId = 0;
+
+	if(tcp)
+	{
+		test_Check(modbus_DecodeTcpView(pFrame, frameSize, &transactionId, &request), "request frame decodes");
+		modbus_PrepareTcpView(pResponseFrame, TEST_FRAME_SIZE, &response);
+	}
+	else
+	{
+		test_Check(modbus_DecodeRtuView(pFrame, frameSize, &request), "request frame decodes");
+		modbus_PrepareRtuView(pResponseFrame, TEST_FRAME_SIZE, &response);
+	}
+
+	if(!modbus_ProcessView(&s_slave, &request, &response))
+	{
+		return 0;
+	}
+
+	return tcp ? modbus_EncodeTcpView(pResponseFrame, transactionId, &response) : modbus_EncodeRtuView(pResponseFrame, &response);
+}
+
+//------------------------------------------------------------------------------
+// Hands a response frame to the master.
+static modbus_Master_Request_t *test_Match(modbus_Master_t *pMaster, uint8_t *pFrame, uint16_t frameSize, bool tcp, uint32_t nowMs)
+{
+	modbus_PduView_t response;
+	uint16_t transactionId = 0;
+
+	if(tcp)
+	{
+		test_Check(modbus_DecodeTcpView(pFrame, frameSize, &transactionId, &response), "response frame decodes");
+		return modbus_Master_MatchTcp(pMaster, transactionId, &response, nowMs);
+	}
+
+	test_Check(modbus_DecodeRtuView(pFrame, frameSize, &response), "response frame decodes");
+	return modbus_Master_MatchRtu(pMaster, &response, nowMs);
+}
+
+//------------------------------------------------------------------------------
+// Random request of one of the function codes the slave serves, sometimes behind the end of its data.
+static void test_BuildRandomRequest(modbus_Master_Request_t *pRequest, uint16_t *pData)
+{
+	static const modbus_FunctionCode_e FUNCTIONS[] =
+	{
+		MODBUS_FUNCTION_READCOILS,
+		MODBUS_FUNCTION_READDISCRETE,
+		MODBUS_FUNCTION_READHOLDING,
+		MODBUS_FUNCTION_READINPUT,
+		MODBUS_FUNCTION_WRITESINGLE_COIL,
+		MODBUS_FUNCTION_WRITESINGLE_REG,
+		MODBUS_FUNCTION_WRITEMULT_COILS,
+		MODBUS_FUNCTION_WRITEMULT_REGS
+	};
+
+	memset(pRequest, 0, sizeof(*pRequest));
+	pRequest->busAddress = TEST_BUS_ADDRESS;
+	pRequest->functionCode = FUNCTIONS[rand() % 8];
+	pRequest->pData = pData;
+
+	const bool isBit =
+		(pRequest->functionCode == MODBUS_FUNCTION_READCOILS) ||
+		(pRequest->functionCode == MODBUS_FUNCTION_READDISCRETE) ||
+		(pRequest->functionCode == MODBUS_FUNCTION_WRITESINGLE_COIL) ||
+		(pRequest->functionCode == MODBUS_FUNCTION_WRITEMULT_COILS);
+	const uint32_t count = isBit ? TEST_BIT_COUNT : TEST_REGISTER_COUNT;
+	uint16_t maxQuantity = 1;
+
+	switch(pRequest->functionCode)
+	{
+		case MODBUS_FUNCTION_READCOILS:
+		case MODBUS_FUNCTION_READDISCRETE:
+		{
+			maxQuantity = MODBUS_READ_BIT_MAX_QUANTITY;
+			break;
+		}
+
+		case MODBUS_FUNCTION_READHOLDING:
+		case MODBUS_FUNCTION_READINPUT:
+		{
+			maxQuantity = MODBUS_READ_REGISTER_MAX_QUANTITY;
+			break;
+		}
+
+		case MODBUS_FUNCTION_WRITEMULT_COILS:
+		{
+			maxQuantity = MODBUS_WRITE_BIT_MAX_QUANTITY;
+			break;
+		}
+
+		case MODBUS_FUNCTION_WRITEMULT_REGS:
+		{
+			maxQuantity = MODBUS_WRITE_REGISTER_MAX_QUANTITY;
+			break;
+		}
+
+		default:
+		{
+			// Single writes.
+			break;
+		}
+	}
+
+	pRequest->quantity = (uint16_t)(1 + (rand() % maxQuantity));
+	if(pRequest->quantity > count)
+	{
+		pRequest->quantity = (uint16_t)count;
+	}
+
+	// One in ten runs past the end of the slave's data.
+	pRequest->startAddress = ((rand() % 10) == 0) ?
+		(uint16_t)(count - pRequest->quantity + 1 + (rand() % 10)) :
+		(uint16_t)(rand() % (count - pRequest->quantity + 1));
+
+	for(uint32_t ctr = 0; ctr < MODBUS_PAYLOAD_SIZE / 2; ctr++)
+	{
+		pData[ctr] = (uint16_t)rand();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Checks a completed request against the slave's data.
+static void test_CheckRoundTrip(const modbus_Master_Request_t *pRequest)
+{
+	const uint8_t *pBits = pRequest->pData;
+	const uint16_t *pValues = pRequest->pData;
+	const uint32_t end = (uint32_t)pRequest->startAddress + pRequest->quantity;
+	const bool isBit =
+		(pRequest->functionCode == MODBUS_FUNCTION_READCOILS) ||
+		(pRequest->functionCode == MODBUS_FUNCTION_READDISCRETE) ||
+		(pRequest->functionCode == MODBUS_FUNCTION_WRITESINGLE_COIL) ||
+		(pRequest->functionCode == MODBUS_FUNCTION_WRITEMULT_COILS);
+
+	if(end > (isBit ? TEST_BIT_COUNT : TEST_REGISTER_COUNT))
+	{
+		test_Check(pRequest->result == MODBUS_MASTER_RESULT_EXCEPTION, "out of range result");
+		test_Check(pRequest->exception == MODBUS_EXCEPTION_ILLEGALDATAADDRESS, "out of range exception");
+		return;
+	}
+
+	test_Check(pRequest->result == MODBUS_MASTER_RESULT_SUCCESS, "round trip result");
+	test_Check(pRequest->exception == MODBUS_EXCEPTION_SUCCESS, "round trip exception");
+
+	bool match = true;
+	for(uint32_t ctr = 0; ctr < pRequest->quantity; ctr++)
+	{
+		const uint32_t address = pRequest->startAddress + ctr;
+
+		switch(pRequest->functionCode)
+		{
+			case MODBUS_FUNCTION_READCOILS:
+			case MODBUS_FUNCTION_WRITEMULT_COILS:
+			{
+				match = match && (test_GetBit(pBits, ctr) == (s_pCoils[address] == MODBUS_BIT_ON));
+				break;
+			}
+
+			case MODBUS_FUNCTION_READDISCRETE:
+			{
+				match = match && (test_GetBit(pBits, ctr) == (s_pDiscrete[address] == MODBUS_BIT_ON));
+				break;
+			}
+
+			case MODBUS_FUNCTION_WRITESINGLE_COIL:
+			{
+				match = match && ((pValues[0] != 0) == (s_pCoils[address] == MODBUS_BIT_ON));
+				break;
+			}
+
+			case MODBUS_FUNCTION_READINPUT:
+			{
+				match = match && (pValues[ctr] == s_pInput[address]);
+				break;
+			}
+
+			default:
+			{
+				match = match && (pValues[ctr] == s_pHolding[address]);
+				break;
+			}
+		}
+	}
+	test_Check(match, "round trip data");
+
+	// Read results have unused bits of the last byte cleared.
+	if(
+		((pRequest->functionCode == MODBUS_FUNCTION_READCOILS) || (pRequest->functionCode == MODBUS_FUNCTION_READDISCRETE)) &&
+		((pRequest->quantity % 8) != 0)
+	)
+	{
+		test_Check((pBits[pRequest->quantity / 8] >> (pRequest->quantity % 8)) == 0, "round trip bit padding");
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_RoundTrip(bool tcp)
+{
+	modbus_Master_t master;
+	modbus_Master_Request_t *ppSlots[TEST_SLOT_COUNT];
+	modbus_Master_Request_t request;
+	uint16_t pData[MODBUS_PAYLOAD_SIZE / 2];
+	uint8_t pFrame[TEST_FRAME_SIZE];
+	uint8_t pResponseFrame[TEST_FRAME_SIZE];
+
+	test_InitSlave();
+	modbus_Master_Init(&master, ppSlots, TEST_SLOT_COUNT);
+
+	for(uint32_t round = 0; round < TEST_RANDOM_ROUNDS; round++)
+	{
+		test_BuildRandomRequest(&request, pData);
+
+		const uint16_t frameSize = tcp ?
+			modbus_Master_EncodeTcp(&master, &request, pFrame, sizeof(pFrame), round) :
+			modbus_Master_EncodeRtu(&master, &request, pFrame, sizeof(pFrame), round);
+
+		test_Check(frameSize > 0, "request encoded");
+		test_Check((master.inFlightCount == 1) && (request.result == MODBUS_MASTER_RESULT_PENDING), "request in flight");
+
+		const uint16_t responseSize = test_Serve(pFrame, frameSize, tcp, pResponseFrame);
+		test_Check(responseSize > 0, "slave answered");
+
+		test_Check(test_Match(&master, pResponseFrame, responseSize, tcp, round) == &request, "response matched");
+		test_Check(master.inFlightCount == 0, "slot released");
+
+		test_CheckRoundTrip(&request);
+	}
+
+	test_Check(master.requestCount == TEST_RANDOM_ROUNDS, "requestCount");
+	test_Check(master.unmatchedCount == 0, "unmatchedCount");
+
+	// 0x17 is not served by the slave core, the exception has to come back as such.
+	uint16_t pWriteData[2] = { 1, 2 };
+	memset(&request, 0, sizeof(request));
+	request.busAddress = TEST_BUS_ADDRESS;
+	request.functionCode = MODBUS_FUNCTION_RWREG_MULT;
+	request.quantity = 2;
+	request.writeQuantity = 2;
+	request.pData = pData;
+	request.pWriteData = pWriteData;
+
+	const uint16_t frameSize = tcp ?
+		modbus_Master_EncodeTcp(&master, &request, pFrame, sizeof(pFrame), 0) :
+		modbus_Master_EncodeRtu(&master, &request, pFrame, sizeof(pFrame), 0);
+	const uint16_t responseSize = test_Serve(pFrame, frameSize, tcp, pResponseFrame);
+
+	test_Check(test_Match(&master, pResponseFrame, responseSize, tcp, 0) == &request, "0x17 matched");
+	test_Check((request.result == MODBUS_MASTER_RESULT_EXCEPTION) && (request.exception == MODBUS_EXCEPTION_ILLEGALFUNCTION), "0x17 exception");
+}
+
+//------------------------------------------------------------------------------
+// Builds request PDUs and parses hand-made responses.
+static void test_Parse(void)
+{
+	modbus_Master_Request_t request;
+	uint16_t pData[MODBUS_PAYLOAD_SIZE / 2];
+	uint8_t pPayload[MODBUS_PAYLOAD_SIZE];
+	modbus_PduView_t view = { .pPayload = pPayload, .payloadCapacity = MODBUS_PAYLOAD_SIZE };
+	modbus_PduView_t response = { .busAddress = TEST_BUS_ADDRESS, .pPayload = pPayload };
+
+	// 0x17 request layout.
+	uint16_t pWriteData[3] = { 0x1234, 0x5678, 0x9ABC };
+	memset(&request, 0, sizeof(request));
+	request.busAddress = TEST_BUS_ADDRESS;
+	request.functionCode = MODBUS_FUNCTION_RWREG_MULT;
+	request.startAddress = 0x0102;
+	request.quantity = 2;
+	request.writeStartAddress = 0x0304;
+	request.writeQuantity = 3;
+	request.pData = pData;
+	request.pWriteData = pWriteData;
+
+	static const uint8_t RW_REQUEST[] = { 0x01, 0x02, 0x00, 0x02, 0x03, 0x04, 0x00, 0x03, 0x06, 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC };
+	test_Check(modbus_Master_BuildRequest(&request, &view), "0x17 built");
+	test_Check((view.payloadSize == sizeof(RW_REQUEST)) && (memcmp(pPayload, RW_REQUEST, sizeof(RW_REQUEST)) == 0), "0x17 request layout");
+
+	static const uint8_t RW_RESPONSE[] = { 0x04, 0xAA, 0xBB, 0xCC, 0xDD };
+	memcpy(pPayload, RW_RESPONSE, sizeof(RW_RESPONSE));
+	response.functionCode = MODBUS_FUNCTION_RWREG_MULT;
+	response.payloadSize = sizeof(RW_RESPONSE);
+	test_Check(modbus_Master_ParseResponse(&request, &response) == MODBUS_MASTER_RESULT_SUCCESS, "0x17 parsed");
+	test_Check((pData[0] == 0xAABB) && (pData[1] == 0xCCDD), "0x17 data");
+
+	// Coil writes are sent as 0xFF00 / 0x0000, and the unused bits of 0x0F are cleared.
+	pData[0] = 1;
+	request.functionCode = MODBUS_FUNCTION_WRITESINGLE_COIL;
+	request.startAddress = 7;
+	test_Check(modbus_Master_BuildRequest(&request, &view) && (pPayload[2] == 0xFF) && (pPayload[3] == 0x00), "0x05 on");
+
+	pData[0] = 0xFFFF;
+	request.functionCode = MODBUS_FUNCTION_WRITEMULT_COILS;
+	request.quantity = 3;
+	test_Check(modbus_Master_BuildRequest(&request, &view) && (view.payloadSize == 6) && (pPayload[5] == 0x07), "0x0F padding");
+
+	// Invalid requests are not built.
+	const modbus_Master_Request_t valid =
+	{
+		.busAddress = TEST_BUS_ADDRESS, .functionCode = MODBUS_FUNCTION_READHOLDING,
+		.startAddress = 0, .quantity = 1, .pData = pData
+	};
+
+	request = valid;
+	request.quantity = 0;
+	test_Check(!modbus_Master_BuildRequest(&request, &view), "quantity 0");
+	request.quantity = MODBUS_READ_REGISTER_MAX_QUANTITY + 1;
+	test_Check(!modbus_Master_BuildRequest(&request, &view), "quantity over maximum");
+	request.startAddress = 0xFFFF;
+	request.quantity = 2;
+	test_Check(!modbus_Master_BuildRequest(&request, &view), "range beyond address space");
+	request = valid;
+	request.pData = NULL;
+	test_Check(!modbus_Master_BuildRequest(&request, &view), "no data");
+	request = valid;
+	request.functionCode = MODBUS_FUNCTION_READEXCEPTION;
+	test_Check(!modbus_Master_BuildRequest(&request, &view), "unsupported function code");
+	request = valid;
+	view.payloadCapacity = 3;
+	test_Check(!modbus_Master_BuildRequest(&request, &view), "view too small");
+	view.payloadCapacity = MODBUS_PAYLOAD_SIZE;
+
+	// Mismatched responses to a read of 3 registers.
+	request = valid;
+	request.quantity = 3;
+
+	static const uint8_t READ_RESPONSE[] = { 0x06, 0, 1, 0, 2, 0, 3 };
+	const struct
+	{
+		uint8_t busAddress;
+		uint8_t functionCode;
+		uint16_t payloadSize;
+		uint8_t byteCount;
+		modbus_Master_Result_e result;
+		const char *pName;
+	} CASES[] =
+	{
+		{ TEST_BUS_ADDRESS, 0x03, 7, 6, MODBUS_MASTER_RESULT_SUCCESS, "valid read" },
+		{ TEST_BUS_ADDRESS + 1, 0x03, 7, 6, MODBUS_MASTER_RESULT_INVALIDRESPONSE, "other unit" },
+		{ TEST_BUS_ADDRESS, 0x04, 7, 6, MODBUS_MASTER_RESULT_INVALIDRESPONSE, "other function code" },
+		{ TEST_BUS_ADDRESS, 0x84, 1, 2, MODBUS_MASTER_RESULT_INVALIDRESPONSE, "exception of other function code" },
+		{ TEST_BUS_ADDRESS, 0x83, 2, 2, MODBUS_MASTER_RESULT_INVALIDRESPONSE, "exception too long" },
+		{ TEST_BUS_ADDRESS, 0x83, 1, 2, MODBUS_MASTER_RESULT_EXCEPTION, "exception" },
+		{ TEST_BUS_ADDRESS, 0x03, 5, 4, MODBUS_MASTER_RESULT_INVALIDRESPONSE, "too few registers" },
+		{ TEST_BUS_ADDRESS, 0x03, 7, 4, MODBUS_MASTER_RESULT_INVALIDRESPONSE, "byte count mismatch" },
+		{ TEST_BUS_ADDRESS, 0x03, 6, 6, MODBUS_MASTER_RESULT_INVALIDRESPONSE, "truncated" },
+		{ TEST_BUS_ADDRESS, 0x03, 0, 6, MODBUS_MASTER_RESULT_INVALIDRESPONSE, "empty" },
+	};
+
+	for(uint32_t ctr = 0; ctr < sizeof(CASES) / sizeof(CASES[0]); ctr++)
+	{
+		memcpy(pPayload, READ_RESPONSE, sizeof(READ_RESPONSE));
+		pPayload[0] = CASES[ctr].byteCount;
+		response.busAddress = CASES[ctr].busAddress;
+		response.functionCode = CASES[ctr].functionCode;
+		response.payloadSize = CASES[ctr].payloadSize;
+
+		test_Check(modbus_Master_ParseResponse(&request, &response) == CASES[ctr].result, CASES[ctr].pName);
+		test_Check(request.result == CASES[ctr].result, CASES[ctr].pName);
+	}
+	test_Check(request.exception == MODBUS_EXCEPTION_SUCCESS, "exception cleared on failure");
+
+	// Bit reads: byte count and padding.
+	request = valid;
+	request.functionCode = MODBUS_FUNCTION_READCOILS;
+	request.quantity = 10;
+	response.busAddress = TEST_BUS_ADDRESS;
+	response.functionCode = MODBUS_FUNCTION_READCOILS;
+	pPayload[0] = 2;
+	pPayload[1] = 0xFF;
+	pPayload[2] = 0xFF;
+	response.payloadSize = 3;
+	test_Check(modbus_Master_ParseResponse(&request, &response) == MODBUS_MASTER_RESULT_SUCCESS, "bit read");
+	test_Check((((uint8_t *)pData)[0] == 0xFF) && (((uint8_t *)pData)[1] == 0x03), "bit read padding cleared");
+	pPayload[0] = 1;
+	response.payloadSize = 2;
+	test_Check(modbus_Master_ParseResponse(&request, &response) == MODBUS_MASTER_RESULT_INVALIDRESPONSE, "bit read too short");
+
+	// Write echoes have to repeat address and value / quantity.
+	static const struct
+	{
+		modbus_FunctionCode_e functionCode;
+		uint16_t value;
+	} ECHOES[] =
+	{
+		{ MODBUS_FUNCTION_WRITESINGLE_COIL, MODBUS_BIT_ON },
+		{ MODBUS_FUNCTION_WRITESINGLE_REG, 0xBEEF },
+		{ MODBUS_FUNCTION_WRITEMULT_COILS, 20 },
+		{ MODBUS_FUNCTION_WRITEMULT_REGS, 20 },
+	};
+
+	for(uint32_t ctr = 0; ctr < sizeof(ECHOES) / sizeof(ECHOES[0]); ctr++)
+	{
+		request = valid;
+		request.functionCode = ECHOES[ctr].functionCode;
+		request.startAddress = 0x0210;
+		request.quantity = 20;
+		pData[0] = 0xBEEF;
+
+		response.functionCode = ECHOES[ctr].functionCode;
+		response.payloadSize = 4;
+
+		const uint8_t pEcho[4] = { 0x02, 0x10, (uint8_t)(ECHOES[ctr].value >> 8), (uint8_t)ECHOES[ctr].value };
+
+		memcpy(pPayload, pEcho, 4);
+		test_Check(modbus_Master_ParseResponse(&request, &response) == MODBUS_MASTER_RESULT_SUCCESS, "echo");
+
+		pPayload[1] ^= 1;
+		test_Check(modbus_Master_ParseResponse(&request, &response) == MODBUS_MASTER_RESULT_INVALIDRESPONSE, "echo other address");
+
+		memcpy(pPayload, pEcho, 4);
+		pPayload[3] ^= 1;
+		test_Check(modbus_Master_ParseResponse(&request, &response) == MODBUS_MASTER_RESULT_INVALIDRESPONSE, "echo other value");
+
+		memcpy(pPayload, pEcho, 4);
+		response.payloadSize = 5;
+		test_Check(modbus_Master_ParseResponse(&request, &response) == MODBUS_MASTER_RESULT_INVALIDRESPONSE, "echo too long");
+	}
+}
+
+//------------------------------------------------------------------------------
+// Responses come back in a different order than the requests went out.
+static void test_OutOfOrder(void)
+{
+	modbus_Master_t master;
+	modbus_Master_Request_t *ppSlots[TEST_SLOT_COUNT];
+	modbus_Master_Request_t pRequests[TEST_SLOT_COUNT];
+	uint16_t ppData[TEST_SLOT_COUNT][MODBUS_PAYLOAD_SIZE / 2];
+	uint8_t ppFrames[TEST_SLOT_COUNT][TEST_FRAME_SIZE];
+	uint8_t ppResponses[TEST_SLOT_COUNT][TEST_FRAME_SIZE];
+	uint16_t pResponseSizes[TEST_SLOT_COUNT];
+
+	test_InitSlave();
+	modbus_Master_Init(&master, ppSlots, TEST_SLOT_COUNT);
+	master.nextTransactionId = 0xFFFE;
+
+	// Pipelined, all in flight at the same time, transaction IDs wrap.
+	for(uint32_t ctr = 0; ctr < TEST_SLOT_COUNT; ctr++)
+	{
+		memset(&pRequests[ctr], 0, sizeof(pRequests[ctr]));
+		pRequests[ctr].busAddress = TEST_BUS_ADDRESS;
+		pRequests[ctr].functionCode = MODBUS_FUNCTION_READHOLDING;
+		pRequests[ctr].startAddress = (uint16_t)(ctr * 10);
+		pRequests[ctr].quantity = (uint16_t)(1 + ctr);
+		pRequests[ctr].pData = ppData[ctr];
+
+		const uint16_t frameSize = modbus_Master_EncodeTcp(&master, &pRequests[ctr], ppFrames[ctr], TEST_FRAME_SIZE, 0);
+		pResponseSizes[ctr] = test_Serve(ppFrames[ctr], frameSize, true, ppResponses[ctr]);
+	}
+	test_Check(master.inFlightCount == TEST_SLOT_COUNT, "all in flight");
+	test_Check((pRequests[1].transactionId == 0xFFFF) && (pRequests[2].transactionId == 0), "transaction IDs wrap");
+
+	static const uint32_t ORDER[TEST_SLOT_COUNT] = { 2, 0, 3, 1 };
+	for(uint32_t ctr = 0; ctr < TEST_SLOT_COUNT; ctr++)
+	{
+		const uint32_t index = ORDER[ctr];
+
+		test_Check(test_Match(&master, ppResponses[index], pResponseSizes[index], true, 5) == &pRequests[index], "matched by transaction ID");
+		test_Check(pRequests[index].result == MODBUS_MASTER_RESULT_SUCCESS, "out of order result");
+		test_Check(memcmp(ppData[index], &s_pHolding[index * 10], pRequests[index].quantity * sizeof(uint16_t)) == 0, "out of order data");
+
+		// A pending request is left alone by the responses of the others.
+		if(ctr == 0)
+		{
+			test_Check(pRequests[0].result == MODBUS_MASTER_RESULT_PENDING, "others still pending");
+		}
+	}
+
+	// Duplicate and unknown transaction IDs.
+	test_Check(test_Match(&master, ppResponses[0], pResponseSizes[0], true, 5) == NULL, "duplicate response");
+	ppResponses[1][0] ^= 0x40;
+	test_Check(test_Match(&master, ppResponses[1], pResponseSizes[1], true, 5) == NULL, "unknown transaction ID");
+	test_Check(master.unmatchedCount == 2, "unmatchedCount");
+	test_Check(master.inFlightCount == 0, "all released");
+}
+
+//------------------------------------------------------------------------------
+// Several RTU requests in flight are answered oldest first, whatever slot they took.
+static void test_RtuOrder(void)
+{
+	modbus_Master_t master;
+	modbus_Master_Request_t *ppSlots[TEST_SLOT_COUNT];
+	modbus_Master_Request_t pRequests[3];
+	uint16_t ppData[3][MODBUS_PAYLOAD_SIZE / 2];
+	uint8_t pFrame[TEST_FRAME_SIZE];
+	uint8_t ppResponses[3][TEST_FRAME_SIZE];
+	uint16_t pResponseSizes[3];
+
+	test_InitSlave();
+	modbus_Master_Init(&master, ppSlots, TEST_SLOT_COUNT);
+	master.nextSequence = UINT32_MAX - 1;
+
+	// Occupy the first slot, so the requests do not sit in sequence order.
+	modbus_Master_Request_t blocker =
+	{
+		.busAddress = TEST_BUS_ADDRESS + 1, .functionCode = MODBUS_FUNCTION_READHOLDING,
+		.startAddress = 0, .quantity = 1, .pData = ppData[0]
+	};
+	modbus_Master_EncodeRtu(&master, &blocker, pFrame, sizeof(pFrame), 0);
+
+	for(uint32_t ctr = 0; ctr < 3; ctr++)
+	{
+		memset(&pRequests[ctr], 0, sizeof(pRequests[ctr]));
+		pRequests[ctr].busAddress = TEST_BUS_ADDRESS;
+		pRequests[ctr].functionCode = MODBUS_FUNCTION_READINPUT;
+		pRequests[ctr].startAddress = (uint16_t)(ctr * 20);
+		pRequests[ctr].quantity = 4;
+		pRequests[ctr].pData = ppData[ctr];
+
+		const uint16_t frameSize = modbus_Master_EncodeRtu(&master, &pRequests[ctr], pFrame, sizeof(pFrame), 0);
+		pResponseSizes[ctr] = test_Serve(pFrame, frameSize, false, ppResponses[ctr]);
+	}
+
+	// The blocker is oldest (sequence wraps after it), a response of another unit does not match it.
+	test_Check(test_Match(&master, ppResponses[0], pResponseSizes[0], false, 1) == NULL, "other unit not matched");
+	test_Check((master.unmatchedCount == 1) && (master.inFlightCount == 4), "nothing released");
+
+	modbus_Master_Request_t *pExpired = modbus_Master_Expire(&master, 1000, 100);
+	test_Check(pExpired != NULL, "expired");
+	test_Check(pExpired == &blocker, "blocker expired");
+
+	// Slot 0 is free now, and the first request lives in slot 1.
+	for(uint32_t ctr = 0; ctr < 3; ctr++)
+	{
+		test_Check(test_Match(&master, ppResponses[ctr], pResponseSizes[ctr], false, 1) == &pRequests[ctr], "matched oldest first");
+		test_Check(memcmp(ppData[ctr], &s_pInput[ctr * 20], 4 * sizeof(uint16_t)) == 0, "RTU data");
+	}
+
+	// Nothing in flight.
+	test_Check(test_Match(&master, ppResponses[0], pResponseSizes[0], false, 1) == NULL, "nothing in flight");
+	test_Check(master.unmatchedCount == 2, "unmatchedCount");
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Broadcast(void)
+{
+	modbus_Master_t master;
+	modbus_Master_Request_t *ppSlots[TEST_SLOT_COUNT];
+	modbus_Master_Request_t request;
+	uint16_t pData[MODBUS_PAYLOAD_SIZE / 2];
+	uint8_t pFrame[TEST_FRAME_SIZE];
+	uint8_t pResponseFrame[TEST_FRAME_SIZE];
+
+	test_InitSlave();
+	modbus_Master_Init(&master, ppSlots, TEST_SLOT_COUNT);
+
+	// Writes complete right away, the slave applies them without response.
+	memset(&request, 0, sizeof(request));
+	request.busAddress = MODBUS_BROADCAST_ADDRESS;
+	request.functionCode = MODBUS_FUNCTION_WRITEMULT_REGS;
+	request.startAddress = 50;
+	request.quantity = 3;
+	request.pData = pData;
+	request.result = MODBUS_MASTER_RESULT_TIMEOUT;
+	pData[0] = 0x1111;
+	pData[1] = 0x2222;
+	pData[2] = 0x3333;
+
+	const uint16_t frameSize = modbus_Master_EncodeRtu(&master, &request, pFrame, sizeof(pFrame), 42);
+	test_Check(frameSize > 0, "broadcast write encoded");
+	test_Check((request.result == MODBUS_MASTER_RESULT_SUCCESS) && (request.sentMs == 42), "broadcast write completed");
+	test_Check((master.inFlightCount == 0) && (master.requestCount == 1), "broadcast not in flight");
+	test_Check(test_Serve(pFrame, frameSize, false, pResponseFrame) == 0, "broadcast not answered");
+	test_Check((s_pHolding[50] == 0x1111) && (s_pHolding[52] == 0x3333), "broadcast applied");
+
+	// Reads and 0x17 have nobody to answer them.
+	request.functionCode = MODBUS_FUNCTION_READHOLDING;
+	test_Check(modbus_Master_EncodeRtu(&master, &request, pFrame, sizeof(pFrame), 0) == 0, "broadcast read rejected");
+	request.functionCode = MODBUS_FUNCTION_RWREG_MULT;
+	request.writeQuantity = 1;
+	request.pWriteData = pData;
+	test_Check(modbus_Master_EncodeRtu(&master, &request, pFrame, sizeof(pFrame), 0) == 0, "broadcast 0x17 rejected");
+
+	// Modbus TCP has no broadcasts, unit 0 is tracked like any other.
+	request.functionCode = MODBUS_FUNCTION_WRITESINGLE_REG;
+	test_Check(modbus_Master_EncodeTcp(&master, &request, pFrame, sizeof(pFrame), 0) > 0, "TCP unit 0 encoded");
+	test_Check((master.inFlightCount == 1) && (request.result == MODBUS_MASTER_RESULT_PENDING), "TCP unit 0 in flight");
+}
+
+//------------------------------------------------------------------------------
+// Sends `pRequest` at `sentMs` over TCP and, unless `answeredMs` is 0, lets the slave answer it at `answeredMs`.
+static void test_Exchange(modbus_Master_t *pMaster, modbus_Master_Request_t *pRequest, uint32_t sentMs, uint32_t answeredMs)
+{
+	uint8_t pFrame[TEST_FRAME_SIZE];
+	uint8_t pResponseFrame[TEST_FRAME_SIZE];
+
+	const uint16_t frameSize = modbus_Master_EncodeTcp(pMaster, pRequest, pFrame, sizeof(pFrame), sentMs);
+	test_Check(frameSize > 0, "exchange encoded");
+
+	if(answeredMs != 0)
+	{
+		const uint16_t responseSize = test_Serve(pFrame, frameSize, true, pResponseFrame);
+		test_Check(test_Match(pMaster, pResponseFrame, responseSize, true, answeredMs) == pRequest, "exchange matched");
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_InitEstimatorRequest(modbus_Master_Request_t *pRequest, uint16_t *pData, uint8_t maxRetries)
+{
+	memset(pRequest, 0, sizeof(*pRequest));
+	pRequest->busAddress = TEST_BUS_ADDRESS;
+	pRequest->functionCode = MODBUS_FUNCTION_READHOLDING;
+	pRequest->quantity = 1;
+	pRequest->pData = pData;
+	pRequest->maxRetries = maxRetries;
+}
+
+//------------------------------------------------------------------------------
+// Response times against RFC 6298 computed in floating point.
+static void test_Estimator(void)
+{
+	static modbus_Master_Unit_t s_pUnits[MODBUS_MASTER_UNIT_COUNT];
+
+	modbus_Master_t master;
+	modbus_Master_Request_t *ppSlots[TEST_SLOT_COUNT];
+	modbus_Master_Request_t request;
+	uint16_t pData[MODBUS_PAYLOAD_SIZE / 2];
+	modbus_Master_Unit_t *pUnit = &s_pUnits[TEST_BUS_ADDRESS];
+
+	test_InitSlave();
+	modbus_Master_Init(&master, ppSlots, TEST_SLOT_COUNT);
+	modbus_Master_SetUnits(&master, s_pUnits, 10, 1000);
+
+	test_Check((pUnit->timeoutMs == 1000) && (pUnit->sampleCount == 0), "timeout starts at maximum");
+	test_Check(modbus_Master_IsUnitReady(&master, TEST_BUS_ADDRESS, 0), "unit ready");
+
+	// First sample: SRTT = R, RTTVAR = R / 2.
+	test_InitEstimatorRequest(&request, pData, 0);
+	test_Exchange(&master, &request, 1000, 1100);
+
+	test_Check((pUnit->srttMs8 == (100 << 3)) && (pUnit->rttvarMs4 == (50 << 2)), "first sample");
+	test_Check(pUnit->timeoutMs == 300, "first timeout");
+	test_Check((pUnit->sampleCount == 1) && (pUnit->lastRttMs == 100) && (pUnit->minRttMs == 100) && (pUnit->maxRttMs == 100), "first sample stats");
+
+	// Following samples, timestamps wrap on the way.
+	double srtt = 100.0;
+	double rttvar = 50.0;
+	uint32_t nowMs = UINT32_MAX - 5000;
+	bool match = true;
+
+	for(uint32_t ctr = 0; ctr < 200; ctr++)
+	{
+		const uint32_t rttMs = (uint32_t)(20 + (rand() % 200));
+
+		test_Exchange(&master, &request, nowMs, nowMs + rttMs);
+		nowMs += rttMs + 10;
+
+		rttvar = (0.75 * rttvar) + (0.25 * ((srtt > rttMs) ? (srtt - rttMs) : (rttMs - srtt)));
+		srtt = (0.875 * srtt) + (0.125 * rttMs);
+
+		const double timeoutMs = srtt + (4.0 * rttvar);
+		const double expectedMs = (timeoutMs < 10.0) ? 10.0 : ((timeoutMs > 1000.0) ? 1000.0 : timeoutMs);
+
+		// The scaled integers truncate, which stays within a few milliseconds.
+		match = match && ((pUnit->timeoutMs + 4.0) >= expectedMs) && ((pUnit->timeoutMs - 4.0) <= expectedMs);
+	}
+	test_Check(match, "RFC 6298 timeout");
+	test_Check((pUnit->minRttMs >= 20) && (pUnit->maxRttMs < 220) && (pUnit->sampleCount == 201), "sample stats");
+
+	// Clamped to the minimum and the maximum.
+	for(uint32_t ctr = 0; ctr < 100; ctr++)
+	{
+		test_Exchange(&master, &request, nowMs, nowMs + 1);
+		nowMs += 2;
+	}
+	test_Check(pUnit->timeoutMs == 10, "clamped to minimum");
+	test_Check(pUnit->minRttMs == 1, "minimum sample");
+
+	test_Exchange(&master, &request, nowMs, nowMs + 5000);
+	nowMs += 5000;
+	test_Check(pUnit->timeoutMs == 1000, "clamped to maximum");
+	test_Check((pUnit->maxRttMs == 5000) && (pUnit->lastRttMs == 5000), "maximum sample");
+
+	// Exceptions prove the unit alive and are sampled, invalid responses are not.
+	const uint32_t sampleCount = pUnit->sampleCount;
+	request.startAddress = TEST_REGISTER_COUNT;
+	test_Exchange(&master, &request, nowMs, nowMs + 20);
+	test_Check((request.result == MODBUS_MASTER_RESULT_EXCEPTION) && (pUnit->sampleCount == (sampleCount + 1)), "exception sampled");
+
+	uint8_t pPayload[1] = { 0 };
+	const modbus_PduView_t invalid = { .busAddress = TEST_BUS_ADDRESS, .functionCode = MODBUS_FUNCTION_READHOLDING, .pPayload = pPayload, .payloadSize = 1 };
+	uint8_t pFrame[TEST_FRAME_SIZE];
+	modbus_Master_EncodeTcp(&master, &request, pFrame, sizeof(pFrame), nowMs);
+	test_Check(modbus_Master_MatchTcp(&master, request.transactionId, &invalid, nowMs + 20) == &request, "invalid matched");
+	test_Check((request.result == MODBUS_MASTER_RESULT_INVALIDRESPONSE) && (pUnit->sampleCount == (sampleCount + 1)), "invalid not sampled");
+
+	// Other units are not affected.
+	test_Check((s_pUnits[TEST_BUS_ADDRESS + 1].sampleCount == 0) && (s_pUnits[TEST_BUS_ADDRESS + 1].timeoutMs == 1000), "other unit untouched");
+}
+
+//------------------------------------------------------------------------------
+// Retries wait twice as long each time, and their responses are not sampled.
+static void test_Karn(void)
+{
+	static modbus_Master_Unit_t s_pUnits[MODBUS_MASTER_UNIT_COUNT];
+
+	modbus_Master_t master;
+	modbus_Master_Request_t *ppSlots[TEST_SLOT_COUNT];
+	modbus_Master_Request_t request;
+	uint16_t pData[MODBUS_PAYLOAD_SIZE / 2];
+	modbus_Master_Unit_t *pUnit = &s_pUnits[TEST_BUS_ADDRESS];
+
+	test_InitSlave();
+	modbus_Master_Init(&master, ppSlots, TEST_SLOT_COUNT);
+	modbus_Master_SetUnits(&master, s_pUnits, 10, 1000);
+
+	// Timeout 100 + 4 * 50 = 300 ms.
+	test_InitEstimatorRequest(&request, pData, 3);
+	test_Exchange(&master, &request, 0, 100);
+	test_Check(pUnit->timeoutMs == 300, "Karn initial timeout");
+
+	uint32_t sentMs = 1000;
+	test_Exchange(&master, &request, sentMs, 0);
+
+	for(uint8_t retry = 1; retry <= 3; retry++)
+	{
+		const uint32_t timeoutMs = ((300u << (retry - 1)) < 1000) ? (300u << (retry - 1)) : 1000;
+
+		test_Check(modbus_Master_Expire(&master, sentMs + timeoutMs - 1, 0) == NULL, "no expiry before the timeout");
+		test_Check(modbus_Master_Expire(&master, sentMs + timeoutMs, 0) == &request, "expired at the timeout");
+		test_Check(request.resend && (request.retryCount == retry) && (request.result == MODBUS_MASTER_RESULT_PENDING), "retry handed back");
+		test_Check((pUnit->retryCount == retry) && (pUnit->timeoutCount == retry) && (pUnit->failCount == 0), "retry counted");
+
+		// The response to the last retry may belong to any attempt, it completes the request but is not sampled.
+		sentMs += timeoutMs;
+		test_Exchange(&master, &request, sentMs, (retry == 3) ? (sentMs + 5) : 0);
+		test_Check(!request.resend && (request.retryCount == retry), "resent keeps retryCount");
+	}
+
+	test_Check(request.result == MODBUS_MASTER_RESULT_SUCCESS, "retry result");
+	test_Check((pUnit->sampleCount == 1) && (pUnit->srttMs8 == (100 << 3)) && (pUnit->lastRttMs == 100), "retry not sampled");
+	test_Check(pUnit->timeoutMs == 300, "retry keeps the timeout");
+
+	// Out of retries: completed with a timeout.
+	request.maxRetries = 0;
+	test_Exchange(&master, &request, 10000, 0);
+	test_Check(modbus_Master_Expire(&master, 10300, 0) == &request, "last attempt expired");
+	test_Check((request.result == MODBUS_MASTER_RESULT_TIMEOUT) && !request.resend, "timeout result");
+	test_Check((master.timeoutCount == 4) && (master.inFlightCount == 0), "timeout counted");
+
+	// Without units, the timeout passed to Expire() applies as is.
+	modbus_Master_Init(&master, ppSlots, TEST_SLOT_COUNT);
+	request.maxRetries = 1;
+	test_Exchange(&master, &request, 0, 0);
+	test_Check(modbus_Master_Expire(&master, 49, 50) == NULL, "fixed timeout not expired");
+	test_Check(modbus_Master_Expire(&master, 50, 50) == &request, "fixed timeout expired");
+	test_Exchange(&master, &request, 50, 0);
+	test_Check(modbus_Master_Expire(&master, 99, 50) == NULL, "fixed timeout not doubled, not expired");
+	test_Check(modbus_Master_Expire(&master, 100, 50) == &request, "fixed timeout not doubled");
+	test_Check(modbus_Master_IsUnitReady(&master, TEST_BUS_ADDRESS, 100), "always ready without units");
+}
+
+//------------------------------------------------------------------------------
+// Failing units are backed off exponentially and probed once the backoff expired.
+static void test_Backoff(void)
+{
+	static modbus_Master_Unit_t s_pUnits[MODBUS_MASTER_UNIT_COUNT];
+
+	modbus_Master_t master;
+	modbus_Master_Request_t *ppSlots[TEST_SLOT_COUNT];
+	modbus_Master_Request_t request;
+	modbus_Master_Request_t other;
+	uint16_t pData[MODBUS_PAYLOAD_SIZE / 2];
+	modbus_Master_Unit_t *pUnit = &s_pUnits[TEST_BUS_ADDRESS];
+
+	test_InitSlave();
+	modbus_Master_Init(&master, ppSlots, TEST_SLOT_COUNT);
+	modbus_Master_SetUnits(&master, s_pUnits, 10, 1000);
+
+	test_InitEstimatorRequest(&request, pData, 2);
+	test_InitEstimatorRequest(&other, pData, 0);
+	other.busAddress = TEST_BUS_ADDRESS + 1;
+
+	// The first failure uses up the retries, the timeout starts at the maximum.
+	uint32_t nowMs = 0;
+	test_Exchange(&master, &request, nowMs, 0);
+	nowMs += 1000;
+	test_Check(modbus_Master_Expire(&master, nowMs, 0) == &request, "first attempt expired");
+	test_Exchange(&master, &request, nowMs, 0);
+	nowMs += 1000;
+	test_Check(modbus_Master_Expire(&master, nowMs, 0) == &request, "retry expired at the maximum");
+	test_Exchange(&master, &request, nowMs, 0);
+	nowMs += 1000;
+	test_Check(modbus_Master_Expire(&master, nowMs, 0) == &request, "second retry expired");
+	test_Check((request.result == MODBUS_MASTER_RESULT_TIMEOUT) && (pUnit->failCount == 1), "unit failed");
+	test_Check(pUnit->backoffUntilMs == (nowMs + 1000), "first backoff");
+
+	// Every further failure doubles the backoff, up to MODBUS_MASTER_MAX_BACKOFF_SHIFT. A failing unit gets no retries.
+	for(uint32_t failure = 2; failure <= (MODBUS_MASTER_MAX_BACKOFF_SHIFT + 3); failure++)
+	{
+		test_Check(!modbus_Master_IsUnitReady(&master, TEST_BUS_ADDRESS, pUnit->backoffUntilMs - 1), "backed off");
+		test_Check(modbus_Master_IsUnitReady(&master, TEST_BUS_ADDRESS + 1, nowMs), "other unit ready");
+
+		nowMs = pUnit->backoffUntilMs;
+		test_Check(modbus_Master_IsUnitReady(&master, TEST_BUS_ADDRESS, nowMs), "probe allowed");
+
+		test_Exchange(&master, &request, nowMs, 0);
+		nowMs += 1000;
+		test_Check(modbus_Master_Expire(&master, nowMs, 0) == &request, "probe expired");
+		test_Check((request.result == MODBUS_MASTER_RESULT_TIMEOUT) && (request.retryCount == 0), "probe not retried");
+
+		const uint32_t shift = ((failure - 1) < MODBUS_MASTER_MAX_BACKOFF_SHIFT) ? (failure - 1) : MODBUS_MASTER_MAX_BACKOFF_SHIFT;
+		test_Check(pUnit->failCount == failure, "failCount");
+		test_Check(pUnit->backoffUntilMs == (nowMs + (1000u << shift)), "backoff doubled");
+	}
+	test_Check(pUnit->backoffUntilMs == (nowMs + (1000u << MODBUS_MASTER_MAX_BACKOFF_SHIFT)), "backoff capped");
+
+	// Requests to the other unit are not held up meanwhile.
+	test_Exchange(&master, &other, nowMs, 0);
+	test_Check(other.result == MODBUS_MASTER_RESULT_PENDING, "other unit sent");
+	test_Check(modbus_Master_Expire(&master, nowMs + 999, 0) == NULL, "other unit keeps its timeout");
+	modbus_Master_Expire(&master, nowMs + 1000, 0);
+
+	// A successful probe ends the backoff and takes a sample.
+	nowMs = pUnit->backoffUntilMs;
+	test_Exchange(&master, &request, nowMs, nowMs + 40);
+	test_Check((request.result == MODBUS_MASTER_RESULT_SUCCESS) && (pUnit->failCount == 0), "probe answered");
+	test_Check(modbus_Master_IsUnitReady(&master, TEST_BUS_ADDRESS, nowMs + 40), "ready again");
+	test_Check((pUnit->sampleCount == 1) && (pUnit->timeoutMs == 120), "probe sampled");
+
+	// And retries are back.
+	test_Exchange(&master, &request, nowMs + 100, 0);
+	test_Check((modbus_Master_Expire(&master, nowMs + 220, 0) == &request) && request.resend, "retries after recovery");
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_FullTable(void)
+{
+	modbus_Master_t master;
+	modbus_Master_Request_t *ppSlots[TEST_SLOT_COUNT];
+	modbus_Master_Request_t pRequests[TEST_SLOT_COUNT + 1];
+	uint16_t pData[MODBUS_PAYLOAD_SIZE / 2];
+	uint8_t pFrame[TEST_FRAME_SIZE];
+
+	modbus_Master_Init(&master, ppSlots, TEST_SLOT_COUNT);
+
+	for(uint32_t ctr = 0; ctr <= TEST_SLOT_COUNT; ctr++)
+	{
+		memset(&pRequests[ctr], 0, sizeof(pRequests[ctr]));
+		pRequests[ctr].busAddress = TEST_BUS_ADDRESS;
+		pRequests[ctr].functionCode = MODBUS_FUNCTION_READHOLDING;
+		pRequests[ctr].quantity = 1;
+		pRequests[ctr].pData = pData;
+	}
+
+	// Too small buffers and invalid requests take no slot.
+	test_Check(modbus_Master_EncodeTcp(&master, &pRequests[0], pFrame, MODBUS_TCP_HEADER_SIZE + 4, 0) == 0, "TCP buffer too small");
+	test_Check(modbus_Master_EncodeRtu(&master, &pRequests[0], pFrame, 7, 0) == 0, "RTU buffer too small");
+	pRequests[0].quantity = 0;
+	test_Check(modbus_Master_EncodeTcp(&master, &pRequests[0], pFrame, sizeof(pFrame), 0) == 0, "invalid request");
+	pRequests[0].quantity = 1;
+	test_Check((master.inFlightCount == 0) && (master.requestCount == 0) && (master.nextTransactionId == 0), "nothing tracked");
+
+	for(uint32_t ctr = 0; ctr < TEST_SLOT_COUNT; ctr++)
+	{
+		test_Check(modbus_Master_EncodeTcp(&master, &pRequests[ctr], pFrame, sizeof(pFrame), 0) > 0, "slot taken");
+	}
+
+	test_Check(modbus_Master_EncodeTcp(&master, &pRequests[TEST_SLOT_COUNT], pFrame, sizeof(pFrame), 0) == 0, "TCP table full");
+	test_Check(modbus_Master_EncodeRtu(&master, &pRequests[TEST_SLOT_COUNT], pFrame, sizeof(pFrame), 0) == 0, "RTU table full");
+	test_Check(master.inFlightCount == TEST_SLOT_COUNT, "table full count");
+
+	// A freed slot is used again.
+	uint8_t pResponse[3] = { 2, 0, 0 };
+	const modbus_PduView_t response = { .busAddress = TEST_BUS_ADDRESS, .functionCode = MODBUS_FUNCTION_READHOLDING, .pPayload = pResponse, .payloadSize = 3 };
+	test_Check(modbus_Master_MatchTcp(&master, pRequests[2].transactionId, &response, 0) == &pRequests[2], "slot freed");
+	test_Check(modbus_Master_EncodeTcp(&master, &pRequests[TEST_SLOT_COUNT], pFrame, sizeof(pFrame), 0) > 0, "freed slot reused");
+	test_Check(ppSlots[2] == &pRequests[TEST_SLOT_COUNT], "same slot");
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	srand(1);
+
+	test_RoundTrip(true);
+	test_RoundTrip(false);
+	test_Parse();
+	test_OutOfOrder();
+	test_RtuOrder();
+	test_Broadcast();
+	test_FullTable();
+	test_Estimator();
+	test_Karn();
+	test_Backoff();
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
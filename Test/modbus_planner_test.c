@@ -0,0 +1,483 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus_planner.h>
+
+/**
+ * Checks the request planner: merging within `maxGap` and the maximum
+ * quantity, hole learning and the replan, and scattering the data of the
+ * completed requests, also for bit ranges not starting on a byte boundary.
+ * The requests are answered from a reference device model instead of a slave.
+ */
+
+#define TEST_MAX_ITEMS			32
+#define TEST_MAX_REQUESTS		32
+#define TEST_MAX_HOLES			4
+#define TEST_BUFFER_SIZE		(TEST_MAX_REQUESTS * MODBUS_READ_REGISTER_MAX_QUANTITY)
+#define TEST_RANDOM_ROUNDS		2000
+
+
+
+static uint32_t s_failCount = 0;
+
+static modbus_Planner_Item_t s_pItems[TEST_MAX_ITEMS];
+static uint16_t s_pOrder[TEST_MAX_ITEMS];
+static modbus_Planner_Range_t s_pHoles[TEST_MAX_HOLES];
+static modbus_Master_Request_t s_pRequests[TEST_MAX_REQUESTS];
+static uint16_t s_pBuffer[TEST_BUFFER_SIZE];
+static uint16_t s_ppItemData[TEST_MAX_ITEMS][MODBUS_READ_BIT_MAX_QUANTITY / 16 + 1];
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s\n", pName);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Contents of the reference device, a register value or one bit.
+static uint16_t test_GetValue(uint8_t busAddress, modbus_FunctionCode_e functionCode, uint32_t address)
+{
+	uint32_t value = (address * 2654435761u) ^ ((uint32_t)busAddress << 24) ^ ((uint32_t)functionCode << 16);
+	value ^= value >> 15;
+
+	if((functionCode == MODBUS_FUNCTION_READCOILS) || (functionCode == MODBUS_FUNCTION_READDISCRETE))
+	{
+		return (uint16_t)(value & 1);
+	}
+	return (uint16_t)value;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_InitPlanner(modbus_Planner_t *pPlanner, uint16_t itemCount, uint16_t maxGap)
+{
+	memset(pPlanner, 0, sizeof(*pPlanner));
+	pPlanner->pItems = s_pItems;
+	pPlanner->itemCount = itemCount;
+	pPlanner->pOrder = s_pOrder;
+	pPlanner->pHoles = s_pHoles;
+	pPlanner->maxHoles = TEST_MAX_HOLES;
+	pPlanner->maxGap = maxGap;
+	pPlanner->pRequests = s_pRequests;
+	pPlanner->maxRequests = TEST_MAX_REQUESTS;
+	pPlanner->pBuffer = s_pBuffer;
+	pPlanner->bufferSize = TEST_BUFFER_SIZE;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_SetItem(uint16_t index, uint8_t busAddress, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
+{
+	modbus_Planner_Item_t *pItem = &s_pItems[index];
+
+	memset(pItem, 0, sizeof(*pItem));
+	pItem->range.busAddress = busAddress;
+	pItem->range.functionCode = functionCode;
+	pItem->range.startAddress = startAddress;
+	pItem->range.quantity = quantity;
+	pItem->pData = s_ppItemData[index];
+}
+
+//------------------------------------------------------------------------------
+// Completes a request like the master would after a successful response.
+static void test_Answer(modbus_Master_Request_t *pRequest)
+{
+	if((pRequest->functionCode == MODBUS_FUNCTION_READCOILS) || (pRequest->functionCode == MODBUS_FUNCTION_READDISCRETE))
+	{
+		uint8_t *pBitmap = pRequest->pData;
+		memset(pBitmap, 0, (pRequest->quantity + 7) / 8);
+
+		for(uint32_t ctr = 0; ctr < pRequest->quantity; ctr++)
+		{
+			if(test_GetValue(pRequest->busAddress, pRequest->functionCode, (uint32_t)pRequest->startAddress + ctr) != 0)
+			{
+				pBitmap[ctr / 8] |= (uint8_t)(1 << (ctr % 8));
+			}
+		}
+	}
+	else
+	{
+		uint16_t *pValues = pRequest->pData;
+
+		for(uint32_t ctr = 0; ctr < pRequest->quantity; ctr++)
+		{
+			pValues[ctr] = test_GetValue(pRequest->busAddress, pRequest->functionCode, (uint32_t)pRequest->startAddress + ctr);
+		}
+	}
+
+	pRequest->result = MODBUS_MASTER_RESULT_SUCCESS;
+	pRequest->exception = MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+// Compares the data scattered into an item with the reference device.
+static bool test_CheckItemData(const modbus_Planner_Item_t *pItem)
+{
+	const modbus_Planner_Range_t *pRange = &pItem->range;
+
+	for(uint32_t ctr = 0; ctr < pRange->quantity; ctr++)
+	{
+		const uint16_t expected = test_GetValue(pRange->busAddress, pRange->functionCode, (uint32_t)pRange->startAddress + ctr);
+		uint16_t value;
+
+		if((pRange->functionCode == MODBUS_FUNCTION_READCOILS) || (pRange->functionCode == MODBUS_FUNCTION_READDISCRETE))
+		{
+			value = (((const uint8_t *)pItem->pData)[ctr / 8] >> (ctr % 8)) & 1;
+		}
+		else
+		{
+			value = ((const uint16_t *)pItem->pData)[ctr];
+		}
+
+		if(value != expected)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Merge(void)
+{
+	modbus_Planner_t planner;
+
+	// Adjacent, within maxGap, other function code, other unit.
+	test_SetItem(0, 1, MODBUS_FUNCTION_READHOLDING, 10, 4);
+	test_SetItem(1, 1, MODBUS_FUNCTION_READHOLDING, 0, 4);
+	test_SetItem(2, 1, MODBUS_FUNCTION_READHOLDING, 4, 2);
+	test_SetItem(3, 1, MODBUS_FUNCTION_READINPUT, 6, 2);
+	test_SetItem(4, 2, MODBUS_FUNCTION_READHOLDING, 0, 2);
+	test_SetItem(5, 1, MODBUS_FUNCTION_READHOLDING, 11, 2);
+	test_InitPlanner(&planner, 6, 4);
+	planner.maxRetries = 3;
+
+	test_Check(modbus_Planner_Build(&planner), "merge build");
+	test_Check(planner.requestCount == 3, "merge request count");
+	test_Check((s_pRequests[0].startAddress == 0) && (s_pRequests[0].quantity == 14), "merge range");
+	test_Check(s_pRequests[1].functionCode == MODBUS_FUNCTION_READINPUT, "merge function code");
+	test_Check(s_pRequests[2].busAddress == 2, "merge unit");
+	test_Check(
+		(s_pItems[0].requestIndex == 0) && (s_pItems[1].requestIndex == 0) && (s_pItems[2].requestIndex == 0) &&
+		(s_pItems[3].requestIndex == 1) && (s_pItems[4].requestIndex == 2) && (s_pItems[5].requestIndex == 0),
+		"merge request index"
+	);
+	test_Check((s_pRequests[1].pData == &s_pBuffer[14]) && (s_pRequests[2].pData == &s_pBuffer[16]), "merge buffer layout");
+
+	for(uint16_t ctr = 0; ctr < planner.requestCount; ctr++)
+	{
+		test_Check((s_pRequests[ctr].maxRetries == 3) && (s_pRequests[ctr].retryCount == 0), "merge maxRetries");
+		test_Check(s_pRequests[ctr].result == MODBUS_MASTER_RESULT_PENDING, "merge pending");
+	}
+
+	// A gap of exactly maxGap merges, one more does not.
+	test_SetItem(0, 1, MODBUS_FUNCTION_READHOLDING, 0, 2);
+	test_SetItem(1, 1, MODBUS_FUNCTION_READHOLDING, 6, 2);
+	test_SetItem(2, 1, MODBUS_FUNCTION_READHOLDING, 13, 2);
+	test_InitPlanner(&planner, 3, 4);
+
+	test_Check(modbus_Planner_Build(&planner), "maxGap build");
+	test_Check(planner.requestCount == 2, "maxGap request count");
+	test_Check((s_pRequests[0].startAddress == 0) && (s_pRequests[0].quantity == 8), "maxGap merged");
+	test_Check((s_pRequests[1].startAddress == 13) && (s_pRequests[1].quantity == 2), "maxGap split");
+
+	// maxGap 0 still merges adjacent and overlapping items.
+	test_SetItem(0, 1, MODBUS_FUNCTION_READHOLDING, 0, 4);
+	test_SetItem(1, 1, MODBUS_FUNCTION_READHOLDING, 2, 4);
+	test_SetItem(2, 1, MODBUS_FUNCTION_READHOLDING, 6, 1);
+	test_SetItem(3, 1, MODBUS_FUNCTION_READHOLDING, 8, 1);
+	test_InitPlanner(&planner, 4, 0);
+
+	test_Check(modbus_Planner_Build(&planner), "overlap build");
+	test_Check((planner.requestCount == 2) && (s_pRequests[0].quantity == 7), "overlap merged");
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_QuantityLimit(void)
+{
+	modbus_Planner_t planner;
+
+	// Exactly the maximum merges.
+	test_SetItem(0, 1, MODBUS_FUNCTION_READHOLDING, 0, 100);
+	test_SetItem(1, 1, MODBUS_FUNCTION_READHOLDING, 100, MODBUS_READ_REGISTER_MAX_QUANTITY - 100);
+	test_InitPlanner(&planner, 2, 0);
+
+	test_Check(modbus_Planner_Build(&planner), "quantity build");
+	test_Check((planner.requestCount == 1) && (s_pRequests[0].quantity == MODBUS_READ_REGISTER_MAX_QUANTITY), "quantity at maximum");
+
+	// One more does not.
+	s_pItems[1].range.quantity++;
+	test_Check(modbus_Planner_Build(&planner), "quantity over build");
+	test_Check(planner.requestCount == 2, "quantity over maximum");
+
+	// Bit functions use their own maximum.
+	test_SetItem(0, 1, MODBUS_FUNCTION_READCOILS, 0, 1000);
+	test_SetItem(1, 1, MODBUS_FUNCTION_READCOILS, 1000, MODBUS_READ_BIT_MAX_QUANTITY - 1000);
+	test_InitPlanner(&planner, 2, 0);
+
+	test_Check(modbus_Planner_Build(&planner), "bit quantity build");
+	test_Check((planner.requestCount == 1) && (s_pRequests[0].quantity == MODBUS_READ_BIT_MAX_QUANTITY), "bit quantity at maximum");
+
+	s_pItems[1].range.quantity++;
+	test_Check(modbus_Planner_Build(&planner), "bit quantity over build");
+	test_Check(planner.requestCount == 2, "bit quantity over maximum");
+
+	// Items larger than one request, without data, at the end of the address space or of another function fail.
+	test_SetItem(0, 1, MODBUS_FUNCTION_READHOLDING, 0, MODBUS_READ_REGISTER_MAX_QUANTITY + 1);
+	test_InitPlanner(&planner, 1, 0);
+	test_Check(!modbus_Planner_Build(&planner), "item over maximum");
+
+	test_SetItem(0, 1, MODBUS_FUNCTION_READHOLDING, 0xFFFF, 2);
+	test_Check(!modbus_Planner_Build(&planner), "item beyond address space");
+
+	test_SetItem(0, 1, MODBUS_FUNCTION_WRITESINGLE_REG, 0, 1);
+	test_Check(!modbus_Planner_Build(&planner), "item of write function");
+
+	test_SetItem(0, 1, MODBUS_FUNCTION_READHOLDING, 0, 1);
+	s_pItems[0].pData = NULL;
+	test_Check(!modbus_Planner_Build(&planner), "item without data");
+
+	// Too few requests or too little buffer.
+	test_SetItem(0, 1, MODBUS_FUNCTION_READHOLDING, 0, 10);
+	test_SetItem(1, 2, MODBUS_FUNCTION_READHOLDING, 0, 10);
+	test_InitPlanner(&planner, 2, 0);
+	planner.maxRequests = 1;
+	test_Check(!modbus_Planner_Build(&planner), "requests too small");
+
+	test_InitPlanner(&planner, 2, 0);
+	planner.bufferSize = 19;
+	test_Check(!modbus_Planner_Build(&planner), "buffer too small");
+	planner.bufferSize = 20;
+	test_Check(modbus_Planner_Build(&planner), "buffer exactly large enough");
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Holes(void)
+{
+	modbus_Planner_t planner;
+
+	// Two gaps, [4, 8) and [10, 20), one hole covers both.
+	test_SetItem(0, 1, MODBUS_FUNCTION_READHOLDING, 0, 4);
+	test_SetItem(1, 1, MODBUS_FUNCTION_READHOLDING, 8, 2);
+	test_SetItem(2, 1, MODBUS_FUNCTION_READHOLDING, 20, 4);
+	test_SetItem(3, 1, MODBUS_FUNCTION_READHOLDING, 22, 4);
+	test_SetItem(4, 1, MODBUS_FUNCTION_READINPUT, 30, 4);
+	test_InitPlanner(&planner, 5, 10);
+
+	test_Check(modbus_Planner_Build(&planner), "hole build");
+	test_Check((planner.requestCount == 2) && (s_pRequests[0].quantity == 26), "hole merged");
+
+	s_pRequests[0].result = MODBUS_MASTER_RESULT_EXCEPTION;
+	s_pRequests[0].exception = MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	modbus_Planner_Scatter(&planner, &s_pRequests[0]);
+
+	test_Check(planner.replan, "hole replan");
+	test_Check(planner.holeCount == 1, "hole learned");
+	test_Check(
+		(s_pHoles[0].busAddress == 1) && (s_pHoles[0].functionCode == MODBUS_FUNCTION_READHOLDING) &&
+		(s_pHoles[0].startAddress == 4) && (s_pHoles[0].quantity == 16),
+		"hole range"
+	);
+	test_Check(
+		(s_pItems[0].result == MODBUS_MASTER_RESULT_EXCEPTION) && (s_pItems[3].exception == MODBUS_EXCEPTION_ILLEGALDATAADDRESS) &&
+		(s_pItems[4].result == MODBUS_MASTER_RESULT_PENDING),
+		"hole item results"
+	);
+
+	// The replan no longer reads across the hole, overlapping items still merge.
+	test_Check(modbus_Planner_Build(&planner), "replan build");
+	test_Check(!planner.replan, "replan cleared");
+	test_Check(planner.requestCount == 4, "replan request count");
+	test_Check((s_pRequests[0].startAddress == 0) && (s_pRequests[0].quantity == 4), "replan first");
+	test_Check((s_pRequests[1].startAddress == 8) && (s_pRequests[1].quantity == 2), "replan second");
+	test_Check((s_pRequests[2].startAddress == 20) && (s_pRequests[2].quantity == 6), "replan overlapping");
+	test_Check(s_pItems[0].result == MODBUS_MASTER_RESULT_PENDING, "replan resets results");
+
+	// The hole only applies to its unit and function code.
+	s_pItems[0].range.functionCode = MODBUS_FUNCTION_READINPUT;
+	s_pItems[1].range.functionCode = MODBUS_FUNCTION_READINPUT;
+	planner.maxGap = 20;
+	test_Check(modbus_Planner_Build(&planner), "hole other function build");
+	test_Check((s_pRequests[1].functionCode == MODBUS_FUNCTION_READINPUT) && (s_pRequests[1].quantity == 34), "hole other function merged");
+
+	// A failing request of overlapping items has no gaps, one of the items itself is not readable.
+	s_pRequests[0].result = MODBUS_MASTER_RESULT_EXCEPTION;
+	s_pRequests[0].exception = MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	modbus_Planner_Scatter(&planner, &s_pRequests[0]);
+	test_Check(!planner.replan && (planner.holeCount == 1), "no hole without gap");
+
+	// Other exceptions and timeouts do not learn holes either.
+	s_pRequests[1].result = MODBUS_MASTER_RESULT_EXCEPTION;
+	s_pRequests[1].exception = MODBUS_EXCEPTION_SLAVEDEVICEFAILURE;
+	modbus_Planner_Scatter(&planner, &s_pRequests[1]);
+	s_pRequests[1].result = MODBUS_MASTER_RESULT_TIMEOUT;
+	s_pRequests[1].exception = MODBUS_EXCEPTION_SUCCESS;
+	modbus_Planner_Scatter(&planner, &s_pRequests[1]);
+	test_Check(!planner.replan && (planner.holeCount == 1), "no hole from other failures");
+	test_Check(s_pItems[4].result == MODBUS_MASTER_RESULT_TIMEOUT, "timeout handed to items");
+
+	// No more holes than `maxHoles`.
+	planner.holeCount = TEST_MAX_HOLES;
+	s_pRequests[1].result = MODBUS_MASTER_RESULT_EXCEPTION;
+	s_pRequests[1].exception = MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	modbus_Planner_Scatter(&planner, &s_pRequests[1]);
+	test_Check(!planner.replan && (planner.holeCount == TEST_MAX_HOLES), "hole table full");
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Scatter(void)
+{
+	modbus_Planner_t planner;
+
+	// Registers, and bits starting and ending off byte boundaries of both the request and the items.
+	test_SetItem(0, 1, MODBUS_FUNCTION_READHOLDING, 100, 3);
+	test_SetItem(1, 1, MODBUS_FUNCTION_READHOLDING, 105, 7);
+	test_SetItem(2, 1, MODBUS_FUNCTION_READCOILS, 3, 5);
+	test_SetItem(3, 1, MODBUS_FUNCTION_READCOILS, 11, 13);
+	test_SetItem(4, 1, MODBUS_FUNCTION_READCOILS, 13, 1);
+	test_SetItem(5, 1, MODBUS_FUNCTION_READDISCRETE, 7, 17);
+	test_InitPlanner(&planner, 6, 8);
+
+	for(uint16_t ctr = 0; ctr < 6; ctr++)
+	{
+		memset(s_ppItemData[ctr], 0xA5, sizeof(s_ppItemData[ctr]));
+	}
+
+	test_Check(modbus_Planner_Build(&planner), "scatter build");
+	test_Check(planner.requestCount == 3, "scatter request count");
+	test_Check((s_pRequests[0].startAddress == 3) && (s_pRequests[0].quantity == 21), "scatter bit request");
+
+	for(uint16_t ctr = 0; ctr < planner.requestCount; ctr++)
+	{
+		test_Answer(&s_pRequests[ctr]);
+		modbus_Planner_Scatter(&planner, &s_pRequests[ctr]);
+	}
+
+	for(uint16_t ctr = 0; ctr < 6; ctr++)
+	{
+		test_Check(s_pItems[ctr].result == MODBUS_MASTER_RESULT_SUCCESS, "scatter result");
+		test_Check(test_CheckItemData(&s_pItems[ctr]), "scatter data");
+	}
+
+	// Unused bits of the last byte are cleared, bytes beyond are left alone.
+	const uint8_t *pBits = (const uint8_t *)s_ppItemData[3];
+	test_Check(((pBits[1] & 0xE0) == 0) && (pBits[2] == 0xA5), "scatter bit tail");
+
+	// A failed request only hands over its result.
+	memset(s_ppItemData[0], 0xA5, sizeof(s_ppItemData[0]));
+	s_pRequests[s_pItems[0].requestIndex].result = MODBUS_MASTER_RESULT_INVALIDRESPONSE;
+	modbus_Planner_Scatter(&planner, &s_pRequests[s_pItems[0].requestIndex]);
+	test_Check(s_pItems[0].result == MODBUS_MASTER_RESULT_INVALIDRESPONSE, "failed result");
+	test_Check(s_ppItemData[0][0] == 0xA5A5, "failed keeps data");
+}
+
+//------------------------------------------------------------------------------
+// Random items, answered by the reference device and checked item by item.
+static void test_Random(void)
+{
+	static const modbus_FunctionCode_e FUNCTIONS[] =
+	{
+		MODBUS_FUNCTION_READCOILS,
+		MODBUS_FUNCTION_READDISCRETE,
+		MODBUS_FUNCTION_READHOLDING,
+		MODBUS_FUNCTION_READINPUT
+	};
+
+	modbus_Planner_t planner;
+
+	for(uint32_t round = 0; round < TEST_RANDOM_ROUNDS; round++)
+	{
+		const uint16_t itemCount = (uint16_t)(1 + (rand() % 16));
+
+		for(uint16_t ctr = 0; ctr < itemCount; ctr++)
+		{
+			const modbus_FunctionCode_e functionCode = FUNCTIONS[rand() % 4];
+			const bool isBit = (functionCode == MODBUS_FUNCTION_READCOILS) || (functionCode == MODBUS_FUNCTION_READDISCRETE);
+			const uint16_t quantity = (uint16_t)(1 + (rand() % (isBit ? 40 : 20)));
+
+			test_SetItem(ctr, (uint8_t)(1 + (rand() % 2)), functionCode, (uint16_t)(rand() % 300), quantity);
+		}
+
+		test_InitPlanner(&planner, itemCount, (uint16_t)(rand() % 40));
+
+		if(!modbus_Planner_Build(&planner))
+		{
+			test_Check(false, "random build");
+			continue;
+		}
+
+		for(uint16_t ctr = 0; ctr < planner.requestCount; ctr++)
+		{
+			const modbus_Master_Request_t *pRequest = &s_pRequests[ctr];
+			const bool isBit = (pRequest->functionCode == MODBUS_FUNCTION_READCOILS) || (pRequest->functionCode == MODBUS_FUNCTION_READDISCRETE);
+
+			test_Check(pRequest->quantity <= (isBit ? MODBUS_READ_BIT_MAX_QUANTITY : MODBUS_READ_REGISTER_MAX_QUANTITY), "random quantity");
+		}
+
+		for(uint16_t ctr = 0; ctr < itemCount; ctr++)
+		{
+			const modbus_Planner_Range_t *pRange = &s_pItems[ctr].range;
+			const modbus_Master_Request_t *pRequest = &s_pRequests[s_pItems[ctr].requestIndex];
+
+			test_Check(
+				(pRequest->busAddress == pRange->busAddress) &&
+				(pRequest->functionCode == pRange->functionCode) &&
+				(pRequest->startAddress <= pRange->startAddress) &&
+				(((uint32_t)pRequest->startAddress + pRequest->quantity) >= ((uint32_t)pRange->startAddress + pRange->quantity)),
+				"random item inside request"
+			);
+		}
+
+		for(uint16_t ctr = 0; ctr < planner.requestCount; ctr++)
+		{
+			test_Answer(&s_pRequests[ctr]);
+			modbus_Planner_Scatter(&planner, &s_pRequests[ctr]);
+		}
+
+		for(uint16_t ctr = 0; ctr < itemCount; ctr++)
+		{
+			test_Check(s_pItems[ctr].result == MODBUS_MASTER_RESULT_SUCCESS, "random result");
+			test_Check(test_CheckItemData(&s_pItems[ctr]), "random data");
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	srand(1);
+
+	test_Merge();
+	test_QuantityLimit();
+	test_Holes();
+	test_Scatter();
+	test_Random();
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
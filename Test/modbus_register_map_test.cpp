@@ -0,0 +1,219 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus_register_map.hpp>
+
+/**
+ * Checks modbus::RegisterMap: typed get() / set() of every type in both word
+ * orders against the raw registers, readBytes() / writeBytes() on holes, at
+ * the edges of the map and with the access flags, and that a refused write
+ * leaves every register untouched.
+ *
+ * Built with TEST_OVERLAPPING_TAGS or TEST_TAG_OUT_OF_RANGE it must not
+ * compile, Test/run.sh checks that the static_asserts fire.
+ */
+
+
+
+namespace
+{
+
+#if defined(TEST_OVERLAPPING_TAGS)
+inline constexpr modbus::Tag kBrokenTags[] =
+{
+	{ 10, modbus::Type::Uint32 },
+	{ 11, modbus::Type::Uint16 },
+};
+modbus::RegisterMap<kBrokenTags> s_broken;
+#elif defined(TEST_TAG_OUT_OF_RANGE)
+inline constexpr modbus::Tag kBrokenTags[] =
+{
+	{ 0xFFFE, modbus::Type::Float64 },
+};
+modbus::RegisterMap<kBrokenTags> s_broken;
+#endif
+
+inline constexpr modbus::Tag kTags[] =
+{
+	{ 120, modbus::Type::Int16, modbus::Access::Read },
+	{ 100, modbus::Type::Float32, modbus::Access::Read },
+	{ 102, modbus::Type::Uint16 },
+	{ 103, modbus::Type::Int32, modbus::Access::ReadWrite, modbus::WordOrder::LowFirst },
+	{ 110, modbus::Type::Float64 },
+	{ 114, modbus::Type::Int64, modbus::Access::Write, modbus::WordOrder::LowFirst },
+	{ 121, modbus::Type::Uint32, modbus::Access::ReadWrite, modbus::WordOrder::LowFirst },
+	{ 130, modbus::Type::Uint64, modbus::Access::ReadWrite, modbus::WordOrder::HighFirst },
+	{ 134, modbus::Type::Float32, modbus::Access::Write, modbus::WordOrder::LowFirst },
+};
+
+using Map = modbus::RegisterMap<kTags>;
+
+static_assert(Map::firstAddress == 100, "first address");
+static_assert(Map::span == 36, "span up to the last register");
+static_assert(Map::registerCount == 22, "registers without the holes");
+
+uint32_t s_failCount = 0;
+
+//------------------------------------------------------------------------------
+//
+void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s\n", pName);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Big-endian bytes of `count` registers holding `bits`, in the given word order.
+void test_PutWords(uint64_t bits, uint32_t count, modbus::WordOrder wordOrder, uint8_t *pBytes)
+{
+	for(uint32_t ctr = 0; ctr < count; ctr++)
+	{
+		const uint32_t shift = 16 * ((wordOrder == modbus::WordOrder::HighFirst) ? (count - 1 - ctr) : ctr);
+		const uint16_t word = (uint16_t)(bits >> shift);
+
+		pBytes[2 * ctr] = (uint8_t)(word >> 8);
+		pBytes[(2 * ctr) + 1] = (uint8_t)word;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+template<typename Value>
+uint64_t test_GetBits(Value value)
+{
+	uint64_t bits = 0;
+	memcpy(&bits, &value, sizeof(value));
+	return (sizeof(value) == 8) ? bits : (bits & ((1ull << (8 * sizeof(value))) - 1));
+}
+
+//------------------------------------------------------------------------------
+// set() shows up in the registers in the word order of the tag, writeBytes()
+// comes back through get(). readBytes() / writeBytes() follow the access flags.
+template<uint16_t Address, typename Value>
+void test_RoundTrip(Map &map, Value value, uint32_t count, modbus::WordOrder wordOrder, modbus::Access access)
+{
+	const bool readable = ((uint8_t)access & (uint8_t)modbus::Access::Read) != 0;
+	const bool writable = ((uint8_t)access & (uint8_t)modbus::Access::Write) != 0;
+
+	uint8_t pExpected[8];
+	uint8_t pBytes[8];
+
+	test_PutWords(test_GetBits(value), count, wordOrder, pExpected);
+
+	map.template set<Address>(value);
+	test_Check(test_GetBits(map.template get<Address>()) == test_GetBits(value), "set, get");
+
+	memset(pBytes, 0xA5, sizeof(pBytes));
+	test_Check(map.readBytes(Address, (uint16_t)count, pBytes) == (readable ? MODBUS_EXCEPTION_SUCCESS : MODBUS_EXCEPTION_ILLEGALDATAADDRESS), "readBytes access");
+	test_Check(!readable || (memcmp(pBytes, pExpected, 2 * count) == 0), "set, readBytes word order");
+
+	map.template set<Address>((Value)0);
+	test_Check(map.writeBytes(Address, (uint16_t)count, pExpected) == (writable ? MODBUS_EXCEPTION_SUCCESS : MODBUS_EXCEPTION_ILLEGALDATAADDRESS), "writeBytes access");
+	test_Check(test_GetBits(map.template get<Address>()) == (writable ? test_GetBits(value) : 0), "writeBytes, get word order");
+}
+
+//------------------------------------------------------------------------------
+//
+void test_TypedAccess()
+{
+	static Map s_map;
+
+	test_RoundTrip<100>(s_map, 21.5f, 2, modbus::WordOrder::HighFirst, modbus::Access::Read);
+	test_RoundTrip<102>(s_map, (uint16_t)0xBEEF, 1, modbus::WordOrder::HighFirst, modbus::Access::ReadWrite);
+	test_RoundTrip<103>(s_map, (int32_t)-123456789, 2, modbus::WordOrder::LowFirst, modbus::Access::ReadWrite);
+	test_RoundTrip<110>(s_map, -1.0e-300, 4, modbus::WordOrder::HighFirst, modbus::Access::ReadWrite);
+	test_RoundTrip<114>(s_map, (int64_t)-0x0123456789ABCDEF, 4, modbus::WordOrder::LowFirst, modbus::Access::Write);
+	test_RoundTrip<120>(s_map, (int16_t)-2, 1, modbus::WordOrder::HighFirst, modbus::Access::Read);
+	test_RoundTrip<121>(s_map, (uint32_t)0x11223344, 2, modbus::WordOrder::LowFirst, modbus::Access::ReadWrite);
+	test_RoundTrip<130>(s_map, (uint64_t)0x0102030405060708, 4, modbus::WordOrder::HighFirst, modbus::Access::ReadWrite);
+	test_RoundTrip<134>(s_map, 3.25f, 2, modbus::WordOrder::LowFirst, modbus::Access::Write);
+
+	// Converted to the type of the tag.
+	s_map.set<102>(70000);
+	test_Check(s_map.get<102>() == (uint16_t)70000, "set converts");
+	s_map.set<110>(3);
+	test_Check(s_map.get<110>() == 3.0, "set converts to double");
+
+	// Explicit register layout of a low-first 32-bit value.
+	uint8_t pBytes[4];
+	s_map.set<121>(0xA1B2C3D4u);
+	test_Check(s_map.readBytes(121, 2, pBytes) == MODBUS_EXCEPTION_SUCCESS, "readBytes low first");
+	test_Check((pBytes[0] == 0xC3) && (pBytes[1] == 0xD4) && (pBytes[2] == 0xA1) && (pBytes[3] == 0xB2), "low first layout");
+}
+
+//------------------------------------------------------------------------------
+// Holes, the edges of the map and the access flags refuse the whole range.
+void test_ByteAccess()
+{
+	static Map s_map;
+
+	uint8_t pBytes[2 * 40];
+	uint8_t pBefore[2 * 40];
+
+	s_map.set<102>(0x1111);
+	s_map.set<103>(0x22223333);
+	s_map.set<110>(1.5);
+
+	// Readable ranges, across tags.
+	test_Check(s_map.readBytes(100, 5, pBytes) == MODBUS_EXCEPTION_SUCCESS, "read across tags");
+	test_Check((pBytes[4] == 0x11) && (pBytes[5] == 0x11) && (pBytes[6] == 0x33) && (pBytes[8] == 0x22), "read across tags values");
+	test_Check(s_map.readBytes(120, 3, pBytes) == MODBUS_EXCEPTION_SUCCESS, "read mixed access");
+	test_Check(s_map.readBytes(133, 1, pBytes) == MODBUS_EXCEPTION_SUCCESS, "read last readable");
+
+	// Holes and the edges.
+	const uint16_t ppRefused[][2] =
+	{
+		{ 99, 1 }, { 99, 2 }, { 104, 2 }, { 105, 1 }, { 109, 1 }, { 109, 2 }, { 118, 1 },
+		{ 123, 7 }, { 136, 1 }, { 135, 2 }, { 0, 1 }, { 0xFFFF, 1 }, { 100, 36 }
+	};
+	for(const auto &range : ppRefused)
+	{
+		test_Check(s_map.readBytes(range[0], range[1], pBytes) == MODBUS_EXCEPTION_ILLEGALDATAADDRESS, "read hole or outside");
+		test_Check(s_map.writeBytes(range[0], range[1], pBytes) == MODBUS_EXCEPTION_ILLEGALDATAADDRESS, "write hole or outside");
+	}
+
+	// Access flags: write-only tags are not read, read-only tags not written.
+	test_Check(s_map.readBytes(114, 1, pBytes) == MODBUS_EXCEPTION_ILLEGALDATAADDRESS, "read write-only");
+	test_Check(s_map.readBytes(133, 2, pBytes) == MODBUS_EXCEPTION_ILLEGALDATAADDRESS, "read into write-only");
+	test_Check(s_map.writeBytes(114, 4, pBytes) == MODBUS_EXCEPTION_SUCCESS, "write write-only");
+	test_Check(s_map.writeBytes(134, 2, pBytes) == MODBUS_EXCEPTION_SUCCESS, "write write-only float");
+	test_Check(s_map.writeBytes(101, 1, pBytes) == MODBUS_EXCEPTION_ILLEGALDATAADDRESS, "write read-only");
+	test_Check(s_map.writeBytes(121, 2, pBytes) == MODBUS_EXCEPTION_SUCCESS, "write read-write");
+	test_Check(s_map.writeBytes(120, 3, pBytes) == MODBUS_EXCEPTION_ILLEGALDATAADDRESS, "write into read-only");
+
+	// A refused write changes nothing, also where the range starts out writable.
+	test_Check(s_map.readBytes(100, 5, pBefore) == MODBUS_EXCEPTION_SUCCESS, "read before");
+	memset(pBytes, 0x5A, sizeof(pBytes));
+	test_Check(s_map.writeBytes(102, 4, pBytes) == MODBUS_EXCEPTION_ILLEGALDATAADDRESS, "write into hole");
+	test_Check(s_map.writeBytes(103, 9, pBytes) == MODBUS_EXCEPTION_ILLEGALDATAADDRESS, "write across hole");
+	test_Check(s_map.readBytes(100, 5, pBytes) == MODBUS_EXCEPTION_SUCCESS, "read after");
+	test_Check(memcmp(pBytes, pBefore, 10) == 0, "refused write changes nothing");
+	test_Check(s_map.get<110>() == 1.5, "refused write keeps other tags");
+
+	// Writable ranges across tags.
+	memset(pBytes, 0x5A, sizeof(pBytes));
+	test_Check(s_map.writeBytes(102, 3, pBytes) == MODBUS_EXCEPTION_SUCCESS, "write across tags");
+	test_Check((s_map.get<102>() == 0x5A5A) && (s_map.get<103>() == 0x5A5A5A5A), "write across tags values");
+}
+
+} // namespace
+
+
+
+//------------------------------------------------------------------------------
+//
+int main()
+{
+	test_TypedAccess();
+	test_ByteAccess();
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,435 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus_rtu.h>
+
+/**
+ * Replays timestamped byte streams into the RTU receiver and compares the
+ * frames it delivers with the ones the stream was built from. Every scenario
+ * runs with the computed timing (<= 19200 baud) and the fixed one above.
+ */
+
+#define TEST_MAX_BYTES			8192
+#define TEST_MAX_FRAMES			64
+#define TEST_RANDOM_FRAMES		40
+
+
+
+typedef struct
+{
+	uint8_t value;
+	uint32_t timestampUs;
+} test_Byte_t;
+
+typedef struct
+{
+	uint8_t pData[MODBUS_RTU_FRAME_SIZE];
+	uint16_t size;
+} test_Frame_t;
+
+/**
+ * Stream under construction and what the receiver made of it.
+ */
+typedef struct
+{
+	uint32_t charTimeUs;
+	uint32_t t15Us;
+	uint32_t t35Us;
+
+	test_Byte_t pBytes[TEST_MAX_BYTES];
+	uint32_t byteCount;
+	uint32_t lastUs;
+
+	test_Frame_t pExpected[TEST_MAX_FRAMES];
+	uint32_t expectedCount;
+
+	test_Frame_t pReceived[TEST_MAX_FRAMES];
+	uint32_t receivedCount;
+	uint32_t errorCount;
+} test_Stream_t;
+
+
+
+static uint32_t s_failCount = 0;
+static uint32_t s_baudRate = 0;
+static test_Stream_t s_stream;
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s (%u baud)\n", pName, (unsigned)s_baudRate);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Starts an empty stream at `startUs`, receiver initialised at the same time.
+static void test_StartStream(modbus_Rtu_Receiver_t *pReceiver, uint32_t startUs)
+{
+	modbus_Rtu_Init(pReceiver, s_baudRate, startUs);
+
+	memset(&s_stream, 0, sizeof(s_stream));
+	s_stream.charTimeUs = pReceiver->charTimeUs;
+	s_stream.t15Us = pReceiver->t15Us;
+	s_stream.t35Us = pReceiver->t35Us;
+	s_stream.lastUs = startUs;
+}
+
+//------------------------------------------------------------------------------
+// Appends bytes, the first one after `silenceUs` of silence, the others back-to-back.
+static void test_AppendBytes(const uint8_t *pData, uint16_t size, uint32_t silenceUs)
+{
+	for(uint16_t ctr = 0; ctr < size; ctr++)
+	{
+		s_stream.lastUs += s_stream.charTimeUs + ((ctr == 0) ? silenceUs : 0);
+		s_stream.pBytes[s_stream.byteCount].value = pData[ctr];
+		s_stream.pBytes[s_stream.byteCount].timestampUs = s_stream.lastUs;
+		s_stream.byteCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Random valid frame, appended to the stream and to the expected frames.
+static void test_AppendFrame(uint32_t silenceUs, uint16_t payloadSize)
+{
+	modbus_Pdu_t pdu;
+	pdu.busAddress = (uint8_t)(1 + (rand() % 247));
+	pdu.functionCode = (uint8_t)(1 + (rand() % 0x7F));
+	pdu.payloadSize = payloadSize;
+	for(uint16_t ctr = 0; ctr < payloadSize; ctr++)
+	{
+		pdu.pPayload[ctr] = (uint8_t)rand();
+	}
+
+	test_Frame_t *pFrame = &s_stream.pExpected[s_stream.expectedCount++];
+	pFrame->size = modbus_EncodeRtu(pFrame->pData, sizeof(pFrame->pData), &pdu);
+
+	test_AppendBytes(pFrame->pData, pFrame->size, silenceUs);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Collect(modbus_Rtu_Receiver_t *pReceiver, modbus_Rtu_Event_e event, bool release)
+{
+	if(event == MODBUS_RTU_EVENT_ERROR)
+	{
+		s_stream.errorCount++;
+		return;
+	}
+
+	if(event != MODBUS_RTU_EVENT_FRAME)
+	{
+		return;
+	}
+
+	modbus_PduView_t view;
+	test_Check(modbus_Rtu_GetFrame(pReceiver, &view), "GetFrame after event");
+
+	if(s_stream.receivedCount < TEST_MAX_FRAMES)
+	{
+		test_Frame_t *pFrame = &s_stream.pReceived[s_stream.receivedCount++];
+		pFrame->pData[0] = view.busAddress;
+		pFrame->pData[1] = (uint8_t)view.functionCode;
+		memcpy(&pFrame->pData[2], view.pPayload, view.payloadSize);
+		memcpy(&pFrame->pData[2 + view.payloadSize], &view.pPayload[view.payloadSize], 2);
+		pFrame->size = view.payloadSize + 4;
+	}
+
+	if(release)
+	{
+		modbus_Rtu_ReleaseFrame(pReceiver);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Feeds the stream, then polls once the bus has been silent for t3.5.
+// Without `release` every frame is dropped by the next byte instead.
+static void test_Replay(modbus_Rtu_Receiver_t *pReceiver, bool release)
+{
+	for(uint32_t ctr = 0; ctr < s_stream.byteCount; ctr++)
+	{
+		const test_Byte_t *pByte = &s_stream.pBytes[ctr];
+		test_Collect(pReceiver, modbus_Rtu_PutByte(pReceiver, pByte->value, pByte->timestampUs), release);
+	}
+
+	test_Check(modbus_Rtu_Poll(pReceiver, s_stream.lastUs + s_stream.t35Us - 1) == MODBUS_RTU_EVENT_NONE, "no end before t3.5");
+	test_Collect(pReceiver, modbus_Rtu_Poll(pReceiver, s_stream.lastUs + s_stream.t35Us), release);
+}
+
+//------------------------------------------------------------------------------
+//
+static bool test_IsExpected(uint32_t receivedIndex, uint32_t expectedIndex)
+{
+	const test_Frame_t *pReceived = &s_stream.pReceived[receivedIndex];
+	const test_Frame_t *pExpected = &s_stream.pExpected[expectedIndex];
+
+	return (pReceived->size == pExpected->size) && (memcmp(pReceived->pData, pExpected->pData, pExpected->size) == 0);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Timing(void)
+{
+	modbus_Rtu_Receiver_t receiver;
+	modbus_Rtu_Init(&receiver, s_baudRate, 0);
+
+	const uint32_t charTimeUs = (11 * 1000000UL) / s_baudRate;
+
+	test_Check(receiver.charTimeUs == charTimeUs, "character time");
+	if(s_baudRate > 19200)
+	{
+		test_Check((receiver.t15Us == 750) && (receiver.t35Us == 1750), "fixed timing");
+	}
+	else
+	{
+		test_Check((receiver.t15Us == (charTimeUs * 3) / 2) && (receiver.t35Us == (charTimeUs * 7) / 2), "computed timing");
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_BackToBack(uint32_t startUs, bool release)
+{
+	modbus_Rtu_Receiver_t receiver;
+	test_StartStream(&receiver, startUs);
+
+	// First frame right after the initial t3.5, all others exactly t3.5 apart.
+	for(uint32_t ctr = 0; ctr < TEST_RANDOM_FRAMES; ctr++)
+	{
+		test_AppendFrame(s_stream.t35Us, (uint16_t)(rand() % 64));
+	}
+	test_AppendFrame(s_stream.t35Us, MODBUS_PAYLOAD_SIZE);
+
+	test_Replay(&receiver, release);
+
+	test_Check(s_stream.errorCount == 0, "back-to-back errors");
+	test_Check(s_stream.receivedCount == s_stream.expectedCount, "back-to-back frame count");
+	test_Check(receiver.frameCount == s_stream.expectedCount, "back-to-back frameCount");
+	for(uint32_t ctr = 0; ctr < s_stream.receivedCount; ctr++)
+	{
+		test_Check(test_IsExpected(ctr, ctr), "back-to-back frame data");
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_PendingByte(void)
+{
+	modbus_Rtu_Receiver_t receiver;
+	modbus_PduView_t view;
+	test_StartStream(&receiver, 1000);
+
+	test_AppendFrame(s_stream.t35Us, 4);
+	test_AppendFrame(s_stream.t35Us, 4);
+
+	const test_Frame_t *pFirst = &s_stream.pExpected[0];
+	const test_Frame_t *pSecond = &s_stream.pExpected[1];
+
+	for(uint16_t ctr = 0; ctr < pFirst->size; ctr++)
+	{
+		test_Check(modbus_Rtu_PutByte(&receiver, s_stream.pBytes[ctr].value, s_stream.pBytes[ctr].timestampUs) == MODBUS_RTU_EVENT_NONE, "pending first frame");
+	}
+
+	// The first byte of the next frame ends the previous one and is held back.
+	const test_Byte_t *pByte = &s_stream.pBytes[pFirst->size];
+	test_Check(modbus_Rtu_PutByte(&receiver, pByte->value, pByte->timestampUs) == MODBUS_RTU_EVENT_FRAME, "pending frame event");
+	test_Check(receiver.pendingValid && (receiver.pendingByte == pSecond->pData[0]), "pending byte held");
+	test_Check(modbus_Rtu_GetFrame(&receiver, &view) && (view.payloadSize == 4) && (view.busAddress == pFirst->pData[0]), "pending frame intact");
+
+	modbus_Rtu_ReleaseFrame(&receiver);
+	test_Check(!receiver.pendingValid && (receiver.state == MODBUS_RTU_STATE_RECEPTION) && (receiver.frameSize == 1), "pending byte starts frame");
+	test_Check(!modbus_Rtu_GetFrame(&receiver, &view), "no frame while receiving");
+
+	// Releasing twice does not restart the frame.
+	modbus_Rtu_ReleaseFrame(&receiver);
+	test_Check(receiver.frameSize == 1, "second release ignored");
+
+	for(uint32_t ctr = pFirst->size + 1; ctr < s_stream.byteCount; ctr++)
+	{
+		modbus_Rtu_PutByte(&receiver, s_stream.pBytes[ctr].value, s_stream.pBytes[ctr].timestampUs);
+	}
+
+	// The pending byte is timed from its own arrival, not from the release.
+	test_Check(modbus_Rtu_Poll(&receiver, s_stream.lastUs + s_stream.t35Us) == MODBUS_RTU_EVENT_FRAME, "pending second frame");
+	test_Check(modbus_Rtu_GetFrame(&receiver, &view) && (view.busAddress == pSecond->pData[0]) && (view.payloadSize == 4), "pending second frame intact");
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_FrameError(void)
+{
+	modbus_Rtu_Receiver_t receiver;
+	test_StartStream(&receiver, 0);
+
+	// Gap of exactly t1.5 is still inside the frame.
+	test_AppendFrame(s_stream.t35Us, 10);
+	s_stream.pBytes[s_stream.byteCount - 5].timestampUs += s_stream.t15Us;
+	for(uint32_t ctr = s_stream.byteCount - 4; ctr < s_stream.byteCount; ctr++)
+	{
+		s_stream.pBytes[ctr].timestampUs += s_stream.t15Us;
+	}
+	s_stream.lastUs += s_stream.t15Us;
+
+	// Gap just over t1.5 and just under t3.5 breaks the frame, the next one after t3.5 is fine.
+	const uint32_t gaps[] = { s_stream.t15Us + 1, s_stream.t35Us - 1 };
+	for(uint32_t gapCtr = 0; gapCtr < 2; gapCtr++)
+	{
+		modbus_Pdu_t pdu = { .busAddress = 1, .functionCode = 3, .payloadSize = 4, .pPayload = { 0, 0, 0, 10 } };
+		uint8_t pFrame[8];
+		modbus_EncodeRtu(pFrame, sizeof(pFrame), &pdu);
+
+		test_AppendBytes(pFrame, 3, s_stream.t35Us);
+		test_AppendBytes(&pFrame[3], 5, gaps[gapCtr]);
+	}
+	test_AppendFrame(s_stream.t35Us, 2);
+
+	test_Replay(&receiver, true);
+
+	test_Check(s_stream.errorCount == 2, "frame error events");
+	test_Check((receiver.frameErrorCount == 2) && (receiver.crcErrorCount == 0), "frame error counters");
+	test_Check(s_stream.receivedCount == 2, "frame error frame count");
+	test_Check(test_IsExpected(0, 0) && test_IsExpected(1, 1), "frame error good frames");
+
+	// Too long for a frame.
+	uint8_t pLong[MODBUS_RTU_FRAME_SIZE + 1];
+	memset(pLong, 0x55, sizeof(pLong));
+
+	test_StartStream(&receiver, 0);
+	test_AppendBytes(pLong, sizeof(pLong), s_stream.t35Us);
+	test_AppendFrame(s_stream.t35Us, 0);
+	test_Replay(&receiver, true);
+
+	test_Check((s_stream.errorCount == 1) && (receiver.frameErrorCount == 1), "oversized frame error");
+	test_Check((s_stream.receivedCount == 1) && test_IsExpected(0, 0), "frame after oversized");
+
+	// Frames shorter than address, function code and CRC.
+	test_StartStream(&receiver, 0);
+	test_AppendBytes(pLong, 3, s_stream.t35Us);
+	test_AppendFrame(s_stream.t35Us, 0);
+	test_Replay(&receiver, true);
+
+	test_Check((s_stream.errorCount == 1) && (receiver.frameErrorCount == 1), "short frame error");
+	test_Check((s_stream.receivedCount == 1) && test_IsExpected(0, 0), "frame after short");
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_CrcError(void)
+{
+	modbus_Rtu_Receiver_t receiver;
+	test_StartStream(&receiver, 0);
+
+	// The broken frame is followed by the next one exactly t3.5 later, its first byte must not be lost.
+	test_AppendFrame(s_stream.t35Us, 6);
+	test_AppendFrame(s_stream.t35Us, 6);
+	test_AppendFrame(s_stream.t35Us, 6);
+	s_stream.pBytes[s_stream.pExpected[0].size + 3].value ^= 0x10;
+
+	test_Replay(&receiver, true);
+
+	test_Check(s_stream.errorCount == 1, "CRC error event");
+	test_Check((receiver.crcErrorCount == 1) && (receiver.frameErrorCount == 0), "CRC error counters");
+	test_Check(s_stream.receivedCount == 2, "CRC error frame count");
+	test_Check(test_IsExpected(0, 0) && test_IsExpected(1, 2), "CRC error good frames");
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Resync(void)
+{
+	modbus_Rtu_Receiver_t receiver;
+	uint8_t pNoise[300];
+
+	for(uint32_t ctr = 0; ctr < sizeof(pNoise); ctr++)
+	{
+		pNoise[ctr] = (uint8_t)rand();
+	}
+
+	// Receiver started in the middle of traffic: nothing is taken until t3.5 of silence.
+	test_StartStream(&receiver, 0);
+	test_AppendBytes(pNoise, 20, 0);
+	test_AppendBytes(&pNoise[20], 20, s_stream.t35Us - 1);
+	test_AppendFrame(s_stream.t35Us, 8);
+	test_Replay(&receiver, true);
+
+	test_Check(s_stream.errorCount == 0, "startup noise ignored");
+	test_Check((s_stream.receivedCount == 1) && test_IsExpected(0, 0), "startup resync");
+
+	// Or the first frame is seen once the receiver polled the silence.
+	test_StartStream(&receiver, 0);
+	test_Check(modbus_Rtu_Poll(&receiver, s_stream.t35Us) == MODBUS_RTU_EVENT_NONE, "idle poll");
+	test_Check(receiver.state == MODBUS_RTU_STATE_IDLE, "idle after poll");
+	s_stream.lastUs = s_stream.t35Us;
+	test_AppendFrame(0, 8);
+	test_Replay(&receiver, true);
+	test_Check((s_stream.receivedCount == 1) && test_IsExpected(0, 0), "frame after idle poll");
+
+	// Noise bursts between frames, some with gaps inside, each one costs one error.
+	test_StartStream(&receiver, 0);
+	uint32_t noiseCount = 0;
+	for(uint32_t ctr = 0; ctr < TEST_RANDOM_FRAMES; ctr++)
+	{
+		test_AppendFrame(s_stream.t35Us, (uint16_t)(rand() % 32));
+
+		if((ctr % 3) == 0)
+		{
+			const uint16_t size = (uint16_t)(5 + (rand() % 250));
+			const uint16_t split = (uint16_t)(rand() % size);
+
+			test_AppendBytes(pNoise, split, s_stream.t35Us);
+			test_AppendBytes(&pNoise[split], size - split, (split == 0) ? s_stream.t35Us : (rand() % s_stream.t35Us));
+			noiseCount++;
+		}
+	}
+	test_Replay(&receiver, false);
+
+	test_Check(s_stream.errorCount == noiseCount, "noise error count");
+	test_Check(s_stream.receivedCount == s_stream.expectedCount, "noise frame count");
+	for(uint32_t ctr = 0; ctr < s_stream.receivedCount; ctr++)
+	{
+		test_Check(test_IsExpected(ctr, ctr), "noise frame data");
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	static const uint32_t BAUD_RATES[] = { 1200, 9600, 19200, 38400, 115200 };
+
+	srand(1);
+
+	for(uint32_t ctr = 0; ctr < sizeof(BAUD_RATES) / sizeof(BAUD_RATES[0]); ctr++)
+	{
+		s_baudRate = BAUD_RATES[ctr];
+
+		test_Timing();
+		test_BackToBack(0, true);
+		test_BackToBack(0, false);
+		test_BackToBack(UINT32_MAX - 5000, true);
+		test_PendingByte();
+		test_FrameError();
+		test_CrcError();
+		test_Resync();
+	}
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
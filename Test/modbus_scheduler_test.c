@@ -0,0 +1,506 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus_scheduler.h>
+
+/**
+ * Checks the deadline scheduler: the phase offsets of new tasks, late polls
+ * skipping the missed cycles, the urgent FIFO, and random sequences of Add(), Submit(),
+ * Remove(), Next() and Complete() against a reference model, checking the
+ * heap invariant, earliest deadline first order, the urgent FIFO and the
+ * statistics after every step. Time starts close to the tick wrap.
+ */
+
+#define TEST_TASK_COUNT			24
+#define TEST_HEAP_SIZE			16
+#define TEST_RANDOM_ROUNDS		200000
+
+
+
+typedef struct
+{
+	bool periodic;
+	bool inFlight;							/**< Handed out by Next(), not completed yet. */
+	modbus_Scheduler_State_e state;
+	uint32_t dueMs;
+	uint32_t maxLateMs;
+	uint32_t missCount;
+	uint32_t updateCount;
+	uint32_t failCount;
+} test_Model_t;
+
+
+
+static uint32_t s_failCount = 0;
+
+static modbus_Scheduler_t s_scheduler;
+static modbus_Scheduler_Task_t *s_ppHeap[TEST_HEAP_SIZE];
+static modbus_Scheduler_Task_t s_pTasks[TEST_TASK_COUNT];
+static modbus_Master_Request_t s_pRequests[TEST_TASK_COUNT];
+
+static test_Model_t s_pModel[TEST_TASK_COUNT];
+static uint16_t s_pUrgent[TEST_TASK_COUNT];
+static uint16_t s_urgentCount = 0;
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s\n", pName);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static inline bool test_IsBefore(uint32_t aMs, uint32_t bMs)
+{
+	return (int32_t)(aMs - bMs) < 0;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_InitTasks(void)
+{
+	memset(s_pTasks, 0, sizeof(s_pTasks));
+	memset(s_pRequests, 0, sizeof(s_pRequests));
+	memset(s_pModel, 0, sizeof(s_pModel));
+	s_urgentCount = 0;
+
+	for(uint16_t ctr = 0; ctr < TEST_TASK_COUNT; ctr++)
+	{
+		s_pTasks[ctr].pRequest = &s_pRequests[ctr];
+		s_pRequests[ctr].pContext = &s_pTasks[ctr];
+	}
+
+	modbus_Scheduler_Init(&s_scheduler, s_ppHeap, TEST_HEAP_SIZE);
+}
+
+//------------------------------------------------------------------------------
+// New tasks with the same period are spread over it by the bit-reversed add count.
+static void test_Phase(void)
+{
+	const uint32_t nowMs = 1000;
+	const uint32_t pOffsetMs[8] = { 0, 400, 200, 600, 100, 500, 300, 700 };
+
+	test_InitTasks();
+
+	for(uint16_t ctr = 0; ctr < 8; ctr++)
+	{
+		s_pTasks[ctr].periodMs = 800;
+		test_Check(modbus_Scheduler_Add(&s_scheduler, &s_pTasks[ctr], nowMs), "phase add");
+		test_Check(s_pTasks[ctr].dueMs == (nowMs + pOffsetMs[ctr]), "phase offset");
+	}
+
+	// Handed out in deadline order, one every 100 ms.
+	for(uint32_t offsetMs = 0; offsetMs < 800; offsetMs += 100)
+	{
+		test_Check(modbus_Scheduler_GetWaitMs(&s_scheduler, nowMs + offsetMs - 1) == 1, "phase wait");
+
+		modbus_Scheduler_Task_t *pTask = modbus_Scheduler_Next(&s_scheduler, nowMs + offsetMs);
+		test_Check((pTask != NULL) && (pTask->dueMs == (nowMs + offsetMs)), "phase order");
+		test_Check(modbus_Scheduler_Next(&s_scheduler, nowMs + offsetMs) == NULL, "one per phase");
+	}
+
+	// A task without period or beyond the heap size is refused.
+	test_InitTasks();
+	test_Check(!modbus_Scheduler_Add(&s_scheduler, &s_pTasks[0], nowMs), "no period refused");
+
+	for(uint16_t ctr = 0; ctr <= TEST_HEAP_SIZE; ctr++)
+	{
+		s_pTasks[ctr].periodMs = 100;
+		test_Check(modbus_Scheduler_Add(&s_scheduler, &s_pTasks[ctr], nowMs) == (ctr < TEST_HEAP_SIZE), "heap size");
+	}
+	test_Check(!modbus_Scheduler_Add(&s_scheduler, &s_pTasks[0], nowMs), "added twice refused");
+}
+
+//------------------------------------------------------------------------------
+// A late poll keeps its grid, skipped cycles are counted.
+static void test_Late(void)
+{
+	modbus_Scheduler_Task_t *pTask = &s_pTasks[0];
+
+	test_InitTasks();
+	pTask->periodMs = 100;
+	test_Check(modbus_Scheduler_Add(&s_scheduler, pTask, UINT32_MAX - 50), "late add");
+	test_Check(pTask->dueMs == (UINT32_MAX - 50), "late first due");
+
+	// On time, over the wrap.
+	test_Check(modbus_Scheduler_Next(&s_scheduler, UINT32_MAX - 50) == pTask, "on time");
+	s_pRequests[0].result = MODBUS_MASTER_RESULT_SUCCESS;
+	modbus_Scheduler_Complete(&s_scheduler, pTask, UINT32_MAX - 40);
+	test_Check((pTask->dueMs == 49) && (pTask->missCount == 0) && (pTask->maxLateMs == 0), "next cycle");
+
+	// Picked up 30 ms late, still completed within the cycle.
+	test_Check(modbus_Scheduler_Next(&s_scheduler, 48) == NULL, "not due yet");
+	test_Check(modbus_Scheduler_Next(&s_scheduler, 79) == pTask, "picked up late");
+	modbus_Scheduler_Complete(&s_scheduler, pTask, 90);
+	test_Check((pTask->dueMs == 149) && (pTask->missCount == 0) && (pTask->maxLateMs == 30), "late within the cycle");
+
+	// Completed three and a half cycles late: three cycles skipped.
+	test_Check(modbus_Scheduler_Next(&s_scheduler, 149) == pTask, "due");
+	s_pRequests[0].result = MODBUS_MASTER_RESULT_TIMEOUT;
+	modbus_Scheduler_Complete(&s_scheduler, pTask, 499);
+	test_Check((pTask->dueMs == 549) && (pTask->missCount == 3), "cycles skipped");
+	test_Check((pTask->failCount == 1) && (pTask->updateCount == 2), "failure counted");
+
+	// Completed exactly on the next deadline: that one is missed too.
+	test_Check(modbus_Scheduler_Next(&s_scheduler, 560) == pTask, "due again");
+	s_pRequests[0].result = MODBUS_MASTER_RESULT_SUCCESS;
+	modbus_Scheduler_Complete(&s_scheduler, pTask, 649);
+	test_Check((pTask->dueMs == 749) && (pTask->missCount == 4) && (pTask->maxLateMs == 30), "deadline hit");
+	test_Check((pTask->updateCount == 3) && (pTask->maxAgeMs == (649 - 90)), "age");
+	test_Check(modbus_Scheduler_GetAge(pTask, 700) == 51, "get age");
+}
+
+//------------------------------------------------------------------------------
+// Urgent tasks are served in submit order before any due poll.
+static void test_Urgent(void)
+{
+	test_InitTasks();
+
+	s_pTasks[0].periodMs = 100;
+	test_Check(modbus_Scheduler_Add(&s_scheduler, &s_pTasks[0], 0), "urgent add");
+
+	for(uint16_t ctr = 1; ctr <= 3; ctr++)
+	{
+		test_Check(modbus_Scheduler_Submit(&s_scheduler, &s_pTasks[ctr]), "urgent submit");
+	}
+	test_Check(!modbus_Scheduler_Submit(&s_scheduler, &s_pTasks[3]), "submitted twice refused");
+	test_Check(modbus_Scheduler_GetWaitMs(&s_scheduler, 0) == 0, "urgent wait");
+
+	// The tail and the head removed, the queue goes on behind what is left.
+	modbus_Scheduler_Remove(&s_scheduler, &s_pTasks[3]);
+	test_Check(modbus_Scheduler_Submit(&s_scheduler, &s_pTasks[4]), "submit after removed tail");
+	modbus_Scheduler_Remove(&s_scheduler, &s_pTasks[1]);
+
+	// A scheduled periodic task jumps the queue of polls, not the urgent FIFO.
+	test_Check(modbus_Scheduler_Submit(&s_scheduler, &s_pTasks[0]), "periodic submit");
+	test_Check((s_scheduler.heapCount == 0) && (s_scheduler.periodicCount == 1), "periodic out of the heap");
+
+	test_Check(modbus_Scheduler_Next(&s_scheduler, 0) == &s_pTasks[2], "urgent first");
+	test_Check(modbus_Scheduler_Next(&s_scheduler, 0) == &s_pTasks[4], "urgent second");
+	test_Check(modbus_Scheduler_Next(&s_scheduler, 0) == &s_pTasks[0], "urgent periodic");
+	test_Check(modbus_Scheduler_Next(&s_scheduler, 0) == NULL, "urgent empty");
+	test_Check(modbus_Scheduler_GetWaitMs(&s_scheduler, 0) == UINT32_MAX, "nothing to wait for");
+
+	// A one-off write is done once completed, the periodic task goes back on its grid.
+	s_pRequests[0].result = MODBUS_MASTER_RESULT_SUCCESS;
+	s_pRequests[2].result = MODBUS_MASTER_RESULT_SUCCESS;
+	modbus_Scheduler_Complete(&s_scheduler, &s_pTasks[2], 5);
+	modbus_Scheduler_Complete(&s_scheduler, &s_pTasks[0], 5);
+	test_Check(s_pTasks[2].state == MODBUS_SCHEDULER_STATE_IDLE, "write done");
+	test_Check((s_pTasks[0].state == MODBUS_SCHEDULER_STATE_SCHEDULED) && (s_pTasks[0].dueMs == 100), "periodic back on its grid");
+
+	// Removed while running: not re-scheduled.
+	modbus_Scheduler_Remove(&s_scheduler, &s_pTasks[4]);
+	s_pRequests[4].result = MODBUS_MASTER_RESULT_SUCCESS;
+	modbus_Scheduler_Complete(&s_scheduler, &s_pTasks[4], 6);
+	test_Check((s_pTasks[4].state == MODBUS_SCHEDULER_STATE_IDLE) && (s_pTasks[4].updateCount == 1), "removed while running");
+	test_Check(modbus_Scheduler_GetWaitMs(&s_scheduler, 6) == 94, "wait for the poll");
+}
+
+//------------------------------------------------------------------------------
+// Heap structure and contents against the model.
+static void test_CheckHeap(void)
+{
+	uint16_t scheduledCount = 0;
+	uint16_t periodicCount = 0;
+
+	for(uint16_t ctr = 0; ctr < TEST_TASK_COUNT; ctr++)
+	{
+		scheduledCount += (s_pModel[ctr].state == MODBUS_SCHEDULER_STATE_SCHEDULED);
+		periodicCount += s_pModel[ctr].periodic;
+
+		test_Check(s_pTasks[ctr].state == s_pModel[ctr].state, "random state");
+		test_Check(s_pTasks[ctr].periodic == s_pModel[ctr].periodic, "random periodic");
+		test_Check((s_pTasks[ctr].missCount == s_pModel[ctr].missCount) && (s_pTasks[ctr].maxLateMs == s_pModel[ctr].maxLateMs), "random lateness");
+		test_Check((s_pTasks[ctr].updateCount == s_pModel[ctr].updateCount) && (s_pTasks[ctr].failCount == s_pModel[ctr].failCount), "random counts");
+
+		if(s_pModel[ctr].periodic && (s_pModel[ctr].state != MODBUS_SCHEDULER_STATE_IDLE))
+		{
+			test_Check(s_pTasks[ctr].dueMs == s_pModel[ctr].dueMs, "random due");
+		}
+	}
+
+	test_Check(s_scheduler.heapCount == scheduledCount, "random heap count");
+	test_Check(s_scheduler.periodicCount == periodicCount, "random periodic count");
+
+	for(uint16_t index = 0; index < s_scheduler.heapCount; index++)
+	{
+		const modbus_Scheduler_Task_t *pTask = s_ppHeap[index];
+
+		test_Check(pTask->heapIndex == index, "random heap index");
+		test_Check(pTask->state == MODBUS_SCHEDULER_STATE_SCHEDULED, "random heap state");
+
+		if(index > 0)
+		{
+			test_Check(!test_IsBefore(pTask->dueMs, s_ppHeap[(index - 1) / 2]->dueMs), "random heap order");
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_RandomNext(uint32_t nowMs)
+{
+	int32_t earliest = -1;
+	for(uint16_t ctr = 0; ctr < TEST_TASK_COUNT; ctr++)
+	{
+		if(
+			(s_pModel[ctr].state == MODBUS_SCHEDULER_STATE_SCHEDULED) &&
+			((earliest < 0) || test_IsBefore(s_pModel[ctr].dueMs, s_pModel[earliest].dueMs))
+		)
+		{
+			earliest = ctr;
+		}
+	}
+
+	int32_t expected = -1;
+	uint32_t waitMs = UINT32_MAX;
+
+	if(s_urgentCount > 0)
+	{
+		expected = s_pUrgent[0];
+		waitMs = 0;
+		s_urgentCount--;
+		memmove(&s_pUrgent[0], &s_pUrgent[1], s_urgentCount * sizeof(s_pUrgent[0]));
+	}
+	else if(earliest >= 0)
+	{
+		if(test_IsBefore(nowMs, s_pModel[earliest].dueMs))
+		{
+			waitMs = s_pModel[earliest].dueMs - nowMs;
+		}
+		else
+		{
+			expected = earliest;
+			waitMs = 0;
+		}
+	}
+
+	test_Check(modbus_Scheduler_GetWaitMs(&s_scheduler, nowMs) == waitMs, "random wait");
+
+	modbus_Scheduler_Task_t *pTask = modbus_Scheduler_Next(&s_scheduler, nowMs);
+	if(expected < 0)
+	{
+		test_Check(pTask == NULL, "random nothing due");
+		return;
+	}
+
+	test_Check(pTask != NULL, "random due");
+	if(pTask == NULL)
+	{
+		return;
+	}
+
+	// Equal deadlines may come in any order.
+	const uint16_t index = (uint16_t)(pTask - s_pTasks);
+	test_Model_t *pModel = &s_pModel[index];
+
+	if(s_pModel[expected].state == MODBUS_SCHEDULER_STATE_URGENT)
+	{
+		test_Check(index == expected, "random urgent FIFO");
+	}
+	else
+	{
+		test_Check((pModel->state == MODBUS_SCHEDULER_STATE_SCHEDULED) && (pModel->dueMs == s_pModel[expected].dueMs), "random EDF");
+
+		if((nowMs - pModel->dueMs) > pModel->maxLateMs)
+		{
+			pModel->maxLateMs = nowMs - pModel->dueMs;
+		}
+	}
+
+	pModel->state = MODBUS_SCHEDULER_STATE_RUNNING;
+	pModel->inFlight = true;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_RandomComplete(uint16_t index, uint32_t nowMs)
+{
+	test_Model_t *pModel = &s_pModel[index];
+
+	s_pRequests[index].result = ((rand() % 4) == 0) ? MODBUS_MASTER_RESULT_TIMEOUT : MODBUS_MASTER_RESULT_SUCCESS;
+	if(s_pRequests[index].result == MODBUS_MASTER_RESULT_SUCCESS)
+	{
+		pModel->updateCount++;
+	}
+	else
+	{
+		pModel->failCount++;
+	}
+
+	modbus_Scheduler_Complete(&s_scheduler, &s_pTasks[index], nowMs);
+	pModel->inFlight = false;
+
+	// Removed while running: only the statistics.
+	if(pModel->state != MODBUS_SCHEDULER_STATE_RUNNING)
+	{
+		return;
+	}
+
+	pModel->state = MODBUS_SCHEDULER_STATE_IDLE;
+	if(!pModel->periodic)
+	{
+		return;
+	}
+
+	uint32_t cycles = 0;
+	while(!test_IsBefore(nowMs, pModel->dueMs))
+	{
+		pModel->dueMs += s_pTasks[index].periodMs;
+		cycles++;
+	}
+	if(cycles > 0)
+	{
+		pModel->missCount += cycles - 1;
+	}
+
+	pModel->state = MODBUS_SCHEDULER_STATE_SCHEDULED;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Random(void)
+{
+	const uint32_t pPeriodMs[4] = { 50, 100, 250, 1000 };
+	uint32_t nowMs = UINT32_MAX - 100000;
+
+	test_InitTasks();
+
+	for(uint16_t ctr = 0; ctr < TEST_TASK_COUNT; ctr++)
+	{
+		s_pTasks[ctr].periodMs = ((ctr % 8) == 7) ? 0 : pPeriodMs[rand() % 4];
+	}
+
+	for(uint32_t round = 0; round < TEST_RANDOM_ROUNDS; round++)
+	{
+		const uint16_t index = (uint16_t)(rand() % TEST_TASK_COUNT);
+		modbus_Scheduler_Task_t *pTask = &s_pTasks[index];
+		test_Model_t *pModel = &s_pModel[index];
+
+		nowMs += (uint32_t)(rand() % 8);
+
+		switch(rand() % 8)
+		{
+			case 0:
+			{
+				const bool expected =
+					(pModel->state == MODBUS_SCHEDULER_STATE_IDLE) &&
+					!pModel->inFlight &&
+					(pTask->periodMs > 0) &&
+					(s_scheduler.periodicCount < TEST_HEAP_SIZE);
+
+				// A removed task still in flight must not be added again before it completed.
+				if(pModel->inFlight)
+				{
+					break;
+				}
+
+				test_Check(modbus_Scheduler_Add(&s_scheduler, pTask, nowMs) == expected, "random add");
+				if(expected)
+				{
+					test_Check((pTask->dueMs - nowMs) < pTask->periodMs, "random phase");
+					pModel->periodic = true;
+					pModel->state = MODBUS_SCHEDULER_STATE_SCHEDULED;
+					pModel->dueMs = pTask->dueMs;
+				}
+				break;
+			}
+
+			case 1:
+			{
+				const bool expected = (pModel->state == MODBUS_SCHEDULER_STATE_IDLE) || (pModel->state == MODBUS_SCHEDULER_STATE_SCHEDULED);
+
+				if(pModel->inFlight)
+				{
+					break;
+				}
+
+				test_Check(modbus_Scheduler_Submit(&s_scheduler, pTask) == expected, "random submit");
+				if(expected)
+				{
+					pModel->state = MODBUS_SCHEDULER_STATE_URGENT;
+					s_pUrgent[s_urgentCount++] = index;
+				}
+				break;
+			}
+
+			case 2:
+			{
+				if((rand() % 4) != 0)
+				{
+					break;
+				}
+
+				modbus_Scheduler_Remove(&s_scheduler, pTask);
+
+				for(uint16_t ctr = 0; ctr < s_urgentCount; ctr++)
+				{
+					if(s_pUrgent[ctr] == index)
+					{
+						s_urgentCount--;
+						memmove(&s_pUrgent[ctr], &s_pUrgent[ctr + 1], (s_urgentCount - ctr) * sizeof(s_pUrgent[0]));
+						break;
+					}
+				}
+
+				pModel->state = MODBUS_SCHEDULER_STATE_IDLE;
+				pModel->periodic = false;
+				break;
+			}
+
+			case 3:
+			case 4:
+			case 5:
+			{
+				test_RandomNext(nowMs);
+				break;
+			}
+
+			default:
+			{
+				if(pModel->inFlight)
+				{
+					test_RandomComplete(index, nowMs);
+				}
+				break;
+			}
+		}
+
+		test_CheckHeap();
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	srand(1);
+
+	test_Phase();
+	test_Late();
+	test_Urgent();
+	test_Random();
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
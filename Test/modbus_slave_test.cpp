@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus_slave.hpp>
+#include <ModbusEmbedded/modbus_bits.h>
+
+/**
+ * Checks modbus::Slave<Map>::process() against the C core: random requests,
+ * malformed ones included, go to a slave and to a plain instance with C block
+ * handlers over the same tables. Return value, response and the tables after
+ * every request must be identical, in place over the instance PDU and with
+ * separate request and response buffers. A map with only holding registers
+ * checks that the missing tables are still answered by the C core.
+ */
+
+#define TEST_ROUNDS					300000
+#define TEST_BUS_ADDRESS			7
+
+#define TEST_HOLDING_BASE			100
+#define TEST_HOLDING_COUNT			200
+#define TEST_INPUT_BASE				1000
+#define TEST_INPUT_COUNT			50
+#define TEST_COIL_BASE				3
+#define TEST_COIL_COUNT				2100
+#define TEST_DISCRETE_BASE			0
+#define TEST_DISCRETE_COUNT			40
+
+
+
+namespace
+{
+
+struct test_Write
+{
+	uint32_t count;
+	modbus_FunctionCode_e functionCode;
+	uint16_t startAddress;
+	uint16_t quantity;
+};
+
+struct FullMap
+{
+	modbus::Registers<TEST_HOLDING_BASE, TEST_HOLDING_COUNT> holding;
+	modbus::Registers<TEST_INPUT_BASE, TEST_INPUT_COUNT> input;
+	modbus::Bits<TEST_COIL_BASE, TEST_COIL_COUNT> coils;
+	modbus::Bits<TEST_DISCRETE_BASE, TEST_DISCRETE_COUNT> discrete;
+
+	test_Write lastWrite;
+
+	void onWrite(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
+	{
+		lastWrite = { lastWrite.count + 1, functionCode, startAddress, quantity };
+	}
+};
+
+struct HoldingMap
+{
+	modbus::Registers<TEST_HOLDING_BASE, TEST_HOLDING_COUNT> holding;
+};
+
+uint32_t s_failCount = 0;
+
+// Reference tables, served by the C core through the handlers below.
+uint16_t s_pHolding[TEST_HOLDING_COUNT];
+uint16_t s_pInput[TEST_INPUT_COUNT];
+uint8_t s_pCoilBitmap[(TEST_COIL_COUNT + 7) / 8];
+uint8_t s_pDiscreteBitmap[(TEST_DISCRETE_COUNT + 7) / 8];
+const modbus_Bits_t s_coils = { TEST_COIL_BASE, TEST_COIL_COUNT, s_pCoilBitmap };
+const modbus_Bits_t s_discrete = { TEST_DISCRETE_BASE, TEST_DISCRETE_COUNT, s_pDiscreteBitmap };
+test_Write s_lastWrite;
+
+//------------------------------------------------------------------------------
+//
+void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s\n", pName);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+void test_GenericFunction(modbus_Pdu_t *pRequest, modbus_Pdu_t *pResponse)
+{
+	(void)pRequest;
+	modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
+}
+
+//------------------------------------------------------------------------------
+//
+void test_NotifyWrite(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
+{
+	s_lastWrite = { s_lastWrite.count + 1, functionCode, startAddress, quantity };
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e test_ReadRegisterBlock(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint16_t *pValues)
+{
+	const bool holding = (functionCode == MODBUS_FUNCTION_READHOLDING);
+	const uint16_t base = holding ? TEST_HOLDING_BASE : TEST_INPUT_BASE;
+	const uint32_t count = holding ? TEST_HOLDING_COUNT : TEST_INPUT_COUNT;
+
+	if((startAddress < base) || (((uint32_t)startAddress + quantity) > (base + count)))
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	memcpy(pValues, &(holding ? s_pHolding : s_pInput)[startAddress - base], 2 * quantity);
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e test_ReadBitBlock(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pBits)
+{
+	return modbus_Bits_Read((functionCode == MODBUS_FUNCTION_READCOILS) ? &s_coils : &s_discrete, startAddress, quantity, pBits);
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e test_WriteRegisterBlock(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pData)
+{
+	if((startAddress < TEST_HOLDING_BASE) || (((uint32_t)startAddress + quantity) > (TEST_HOLDING_BASE + TEST_HOLDING_COUNT)))
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	for(uint16_t ctr = 0; ctr < quantity; ctr++)
+	{
+		s_pHolding[startAddress - TEST_HOLDING_BASE + ctr] = (uint16_t)((pData[2 * ctr] << 8) | pData[(2 * ctr) + 1]);
+	}
+
+	test_NotifyWrite(functionCode, startAddress, quantity);
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e test_WriteRegister(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+{
+	const uint8_t pData[2] = { (uint8_t)(value >> 8), (uint8_t)value };
+	return test_WriteRegisterBlock(functionCode, address, 1, pData);
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e test_WriteCoilBlock(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pData)
+{
+	const modbus_Exception_e result = modbus_Bits_Write(&s_coils, startAddress, quantity, pData);
+	if(result == MODBUS_EXCEPTION_SUCCESS)
+	{
+		test_NotifyWrite(functionCode, startAddress, quantity);
+	}
+
+	return result;
+}
+
+//------------------------------------------------------------------------------
+//
+modbus_Exception_e test_WriteCoil(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+{
+	const modbus_Exception_e result = modbus_Bits_WriteBit(&s_coils, address, value);
+	if(result == MODBUS_EXCEPTION_SUCCESS)
+	{
+		test_NotifyWrite(functionCode, address, 1);
+	}
+
+	return result;
+}
+
+//------------------------------------------------------------------------------
+// What the handlers of modbus::Slave answer for a table the map does not have.
+modbus_Exception_e test_ReadBitMissing(modbus_FunctionCode_e, uint16_t, uint16_t, uint8_t *)
+{
+	return MODBUS_EXCEPTION_ILLEGALFUNCTION;
+}
+
+modbus_Exception_e test_ReadRegisterMissing(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint16_t *pValues)
+{
+	return (functionCode == MODBUS_FUNCTION_READHOLDING) ? test_ReadRegisterBlock(functionCode, startAddress, quantity, pValues) : MODBUS_EXCEPTION_ILLEGALFUNCTION;
+}
+
+modbus_Exception_e test_WriteMissing(modbus_FunctionCode_e, uint16_t, uint16_t)
+{
+	return MODBUS_EXCEPTION_ILLEGALFUNCTION;
+}
+
+modbus_Exception_e test_WriteBlockMissing(modbus_FunctionCode_e, uint16_t, uint16_t, const uint8_t *)
+{
+	return MODBUS_EXCEPTION_ILLEGALFUNCTION;
+}
+
+const modbus_Handlers_t s_fullHandlers =
+{
+	&test_GenericFunction, nullptr, nullptr,
+	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+	&test_WriteCoil, &test_WriteRegister,
+	&test_ReadBitBlock, &test_ReadRegisterBlock, nullptr, &test_WriteCoilBlock, &test_WriteRegisterBlock
+};
+
+const modbus_Handlers_t s_holdingHandlers =
+{
+	&test_GenericFunction, nullptr, nullptr,
+	nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
+	&test_WriteMissing, &test_WriteRegister,
+	&test_ReadBitMissing, &test_ReadRegisterMissing, nullptr, &test_WriteBlockMissing, &test_WriteRegisterBlock
+};
+
+//------------------------------------------------------------------------------
+// Mostly well-formed requests around the tables, some with one field off.
+void test_SetRequest(modbus_PduView_t *pRequest)
+{
+	static const uint8_t pFunctionCodes[8] =
+	{
+		MODBUS_FUNCTION_READCOILS, MODBUS_FUNCTION_READDISCRETE, MODBUS_FUNCTION_READHOLDING, MODBUS_FUNCTION_READINPUT,
+		MODBUS_FUNCTION_WRITESINGLE_COIL, MODBUS_FUNCTION_WRITESINGLE_REG, MODBUS_FUNCTION_WRITEMULT_COILS, MODBUS_FUNCTION_WRITEMULT_REGS
+	};
+	static const uint8_t pBusAddresses[] = { TEST_BUS_ADDRESS, TEST_BUS_ADDRESS, TEST_BUS_ADDRESS, MODBUS_BROADCAST_ADDRESS, 9 };
+	static const uint16_t pBases[] = { TEST_HOLDING_BASE, TEST_INPUT_BASE, TEST_COIL_BASE, TEST_DISCRETE_BASE, 0xFFF0 };
+
+	const uint8_t functionCode = pFunctionCodes[rand() % sizeof(pFunctionCodes)];
+	const bool isBit = (functionCode == MODBUS_FUNCTION_READCOILS) || (functionCode == MODBUS_FUNCTION_READDISCRETE) || (functionCode == MODBUS_FUNCTION_WRITEMULT_COILS);
+	const uint16_t maxQuantity = isBit ? MODBUS_WRITE_BIT_MAX_QUANTITY : MODBUS_WRITE_REGISTER_MAX_QUANTITY;
+
+	const uint16_t startAddress = (uint16_t)(pBases[rand() % 5] + (rand() % 300) - 20);
+	uint16_t quantity = (uint16_t)(((rand() % 8) == 0) ? (rand() % 0x900) : (1 + (rand() % ((rand() % 2) ? 16 : maxQuantity))));
+	uint16_t value = (uint16_t)rand();
+
+	if(functionCode == MODBUS_FUNCTION_WRITESINGLE_COIL)
+	{
+		value = ((rand() % 8) == 0) ? value : (((rand() % 2) == 0) ? MODBUS_BIT_ON : MODBUS_BIT_OFF);
+	}
+
+	pRequest->busAddress = pBusAddresses[rand() % sizeof(pBusAddresses)];
+	pRequest->functionCode = (modbus_FunctionCode_e)functionCode;
+	pRequest->pPayload[0] = (uint8_t)(startAddress >> 8);
+	pRequest->pPayload[1] = (uint8_t)startAddress;
+
+	if((functionCode == MODBUS_FUNCTION_WRITEMULT_COILS) || (functionCode == MODBUS_FUNCTION_WRITEMULT_REGS))
+	{
+		// Write requests fit the payload, a wrong byte count is made up by the size.
+		quantity = (quantity > maxQuantity) ? (uint16_t)(maxQuantity + (rand() % 3)) : quantity;
+
+		uint16_t byteCount = isBit ? ((quantity + 7) / 8) : (2 * quantity);
+		byteCount = ((rand() % 8) == 0) ? (uint16_t)(byteCount + (rand() % 3) - 1) : byteCount;
+		byteCount = (byteCount > 0xFF) ? 0xFF : byteCount;
+
+		pRequest->pPayload[2] = (uint8_t)(quantity >> 8);
+		pRequest->pPayload[3] = (uint8_t)quantity;
+		pRequest->pPayload[4] = (uint8_t)byteCount;
+		for(uint16_t ctr = 0; ctr < byteCount; ctr++)
+		{
+			pRequest->pPayload[5 + ctr] = (uint8_t)rand();
+		}
+		pRequest->payloadSize = 5 + byteCount;
+	}
+	else
+	{
+		const uint16_t second = ((functionCode == MODBUS_FUNCTION_WRITESINGLE_COIL) || (functionCode == MODBUS_FUNCTION_WRITESINGLE_REG)) ? value : quantity;
+
+		pRequest->pPayload[2] = (uint8_t)(second >> 8);
+		pRequest->pPayload[3] = (uint8_t)second;
+		pRequest->payloadSize = 4;
+	}
+
+	if((rand() % 16) == 0)
+	{
+		pRequest->payloadSize = (uint16_t)(rand() % 8);
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+bool test_CheckResponse(const modbus_PduView_t &slave, const modbus_PduView_t &reference)
+{
+	return
+		(slave.busAddress == reference.busAddress) &&
+		(slave.functionCode == reference.functionCode) &&
+		(slave.payloadSize == reference.payloadSize) &&
+		(memcmp(slave.pPayload, reference.pPayload, reference.payloadSize) == 0);
+}
+
+//------------------------------------------------------------------------------
+// Same request to the slave and to the reference instance, in place over the
+// instance PDU in even rounds and with separate buffers in odd ones.
+template<typename Map>
+bool test_Process(modbus::Slave<Map> &slave, modbus_t *pReference, uint32_t round, const modbus_PduView_t &request, bool *pAnswered)
+{
+	static uint8_t s_pResponse[2][MODBUS_PAYLOAD_SIZE];
+
+	bool slaveResult;
+	bool referenceResult;
+	modbus_PduView_t slaveResponse;
+	modbus_PduView_t referenceResponse;
+
+	if((round % 2) == 0)
+	{
+		modbus_Pdu_t *pSlavePdu = MODBUS_REQUEST_PDU(&slave.instance());
+		modbus_Pdu_t *pReferencePdu = MODBUS_REQUEST_PDU(pReference);
+
+		for(modbus_Pdu_t *pPdu : { pSlavePdu, pReferencePdu })
+		{
+			pPdu->busAddress = request.busAddress;
+			pPdu->functionCode = (uint8_t)request.functionCode;
+			pPdu->payloadSize = request.payloadSize;
+			memcpy(pPdu->pPayload, request.pPayload, request.payloadSize);
+		}
+
+		slaveResult = slave.process();
+		referenceResult = modbus_ProcessData(pReference);
+		slaveResponse = modbus_GetPduView(MODBUS_RESPONSE_PDU(&slave.instance()));
+		referenceResponse = modbus_GetPduView(MODBUS_RESPONSE_PDU(pReference));
+	}
+	else
+	{
+		slaveResponse = { 0, (modbus_FunctionCode_e)0, s_pResponse[0], 0, MODBUS_PAYLOAD_SIZE };
+		referenceResponse = { 0, (modbus_FunctionCode_e)0, s_pResponse[1], 0, MODBUS_PAYLOAD_SIZE };
+
+		slaveResult = slave.process(request, slaveResponse);
+		referenceResult = modbus_ProcessView(pReference, &request, &referenceResponse);
+	}
+
+	*pAnswered = referenceResult && ((referenceResponse.functionCode & 0x80) == 0);
+	return (slaveResult == referenceResult) && (!referenceResult || test_CheckResponse(slaveResponse, referenceResponse));
+}
+
+//------------------------------------------------------------------------------
+//
+void test_Reset(void)
+{
+	for(uint32_t ctr = 0; ctr < TEST_HOLDING_COUNT; ctr++)
+	{
+		s_pHolding[ctr] = (uint16_t)rand();
+	}
+	for(uint32_t ctr = 0; ctr < TEST_INPUT_COUNT; ctr++)
+	{
+		s_pInput[ctr] = (uint16_t)rand();
+	}
+	for(uint32_t ctr = 0; ctr < sizeof(s_pCoilBitmap); ctr++)
+	{
+		s_pCoilBitmap[ctr] = (uint8_t)rand();
+	}
+	for(uint32_t ctr = 0; ctr < sizeof(s_pDiscreteBitmap); ctr++)
+	{
+		s_pDiscreteBitmap[ctr] = (uint8_t)rand();
+	}
+
+	s_lastWrite = {};
+}
+
+//------------------------------------------------------------------------------
+//
+void test_Full(void)
+{
+	static FullMap s_map;
+	static modbus::Slave<FullMap> s_slave(s_map, TEST_BUS_ADDRESS);
+	static modbus_t s_reference;
+	static uint8_t s_pRequest[MODBUS_PAYLOAD_SIZE];
+
+	test_Reset();
+	memcpy(s_map.holding.values, s_pHolding, sizeof(s_pHolding));
+	memcpy(s_map.input.values, s_pInput, sizeof(s_pInput));
+	memcpy(s_map.coils.values, s_pCoilBitmap, sizeof(s_pCoilBitmap));
+	memcpy(s_map.discrete.values, s_pDiscreteBitmap, sizeof(s_pDiscreteBitmap));
+	s_map.lastWrite = {};
+
+	s_reference.busAddress = TEST_BUS_ADDRESS;
+	s_reference.pHandlers = &s_fullHandlers;
+
+	uint32_t answeredCount = 0;
+	for(uint32_t round = 0; round < TEST_ROUNDS; round++)
+	{
+		// Modbus TCP treats unit 0 as a direct address, an instance at address 0 answers every unit.
+		const bool noBroadcast = (round / 1000) % 2;
+		const uint8_t busAddress = ((round / 2000) % 2) ? TEST_BUS_ADDRESS : MODBUS_BROADCAST_ADDRESS;
+		s_slave.instance().noBroadcast = noBroadcast;
+		s_slave.instance().busAddress = busAddress;
+		s_reference.noBroadcast = noBroadcast;
+		s_reference.busAddress = busAddress;
+
+		modbus_PduView_t request = { 0, (modbus_FunctionCode_e)0, s_pRequest, 0, MODBUS_PAYLOAD_SIZE };
+		test_SetRequest(&request);
+
+		bool answered = false;
+		test_Check(test_Process(s_slave, &s_reference, round, request, &answered), "full map, response");
+		test_Check(memcmp(s_map.holding.values, s_pHolding, sizeof(s_pHolding)) == 0, "full map, holding registers");
+		test_Check(memcmp(s_map.coils.values, s_pCoilBitmap, sizeof(s_pCoilBitmap)) == 0, "full map, coils");
+		test_Check(memcmp(&s_map.lastWrite, &s_lastWrite, sizeof(s_lastWrite)) == 0, "full map, onWrite");
+
+		answeredCount += answered ? 1 : 0;
+	}
+
+	// Function codes without a table in any map, answered by the C core.
+	modbus_PduView_t request = { TEST_BUS_ADDRESS, (modbus_FunctionCode_e)0x2B, s_pRequest, 0, MODBUS_PAYLOAD_SIZE };
+	bool answered = true;
+	test_Check(test_Process(s_slave, &s_reference, 1, request, &answered) && !answered, "full map, unknown function code");
+
+	// The random requests have to get past the checks often enough to mean something.
+	test_Check(answeredCount > (TEST_ROUNDS / 4), "full map, enough successful requests");
+	test_Check(s_lastWrite.count > (TEST_ROUNDS / 20), "full map, enough successful writes");
+}
+
+//------------------------------------------------------------------------------
+// Coils, discrete and input registers are not in the map, the C core answers them.
+void test_HoldingOnly(void)
+{
+	static HoldingMap s_map;
+	static modbus::Slave<HoldingMap> s_slave(s_map, TEST_BUS_ADDRESS);
+	static modbus_t s_reference;
+	static uint8_t s_pRequest[MODBUS_PAYLOAD_SIZE];
+
+	test_Reset();
+	memcpy(s_map.holding.values, s_pHolding, sizeof(s_pHolding));
+
+	s_reference.busAddress = TEST_BUS_ADDRESS;
+	s_reference.pHandlers = &s_holdingHandlers;
+
+	for(uint32_t round = 0; round < TEST_ROUNDS; round++)
+	{
+		const bool noBroadcast = (round / 1000) % 2;
+		s_slave.instance().noBroadcast = noBroadcast;
+		s_reference.noBroadcast = noBroadcast;
+
+		modbus_PduView_t request = { 0, (modbus_FunctionCode_e)0, s_pRequest, 0, MODBUS_PAYLOAD_SIZE };
+		test_SetRequest(&request);
+
+		bool answered = false;
+		test_Check(test_Process(s_slave, &s_reference, round, request, &answered), "holding only, response");
+		test_Check(memcmp(s_map.holding.values, s_pHolding, sizeof(s_pHolding)) == 0, "holding only, holding registers");
+	}
+}
+
+} // namespace
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+int main()
+{
+	srand(1);
+
+	test_Full();
+	test_HoldingOnly();
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,646 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include <ModbusEmbedded/modbus.h>
+#include <ModbusEmbedded/modbus_tcp_server.h>
+#include <ModbusEmbedded/modbus_host.h>
+
+/**
+ * Runs the epoll server over loopback: several clients pipelining requests
+ * split at random offsets, a stalled reader filling pTx, a broken MBAP header,
+ * unit 0 on a server that is not unit 0, and a host serving several units.
+ * Responses are compared byte for byte with those of a reference instance.
+ */
+
+#define TEST_BUS_ADDRESS			17
+#define TEST_CLIENT_COUNT			3
+#define TEST_SLOT_COUNT				TEST_CLIENT_COUNT
+#define TEST_REGION_SIZE			200
+#define TEST_REGISTER_COUNT			(TEST_CLIENT_COUNT * TEST_REGION_SIZE)
+#define TEST_REQUEST_COUNT			300
+#define TEST_STALL_REQUEST_COUNT	400
+#define TEST_STREAM_SIZE			(TEST_STALL_REQUEST_COUNT * MODBUS_TCP_FRAME_SIZE)
+#define TEST_MAX_POLLS				20000
+
+
+
+typedef struct
+{
+	int fd;
+
+	uint32_t txOffset;
+	uint32_t txSize;
+	uint8_t pTx[TEST_STREAM_SIZE];
+
+	uint32_t rxSize;
+	uint8_t pRx[TEST_STREAM_SIZE];
+
+	uint32_t expectedSize;
+	uint8_t pExpected[TEST_STREAM_SIZE];
+} test_Client_t;
+
+
+
+static uint16_t s_pRegisters[TEST_REGISTER_COUNT];
+static test_Client_t s_pClients[TEST_CLIENT_COUNT];
+static modbus_TcpServer_Connection_t s_pConnections[TEST_SLOT_COUNT];
+static uint32_t s_failCount = 0;
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s\n", pName);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_GenericFunction(modbus_Pdu_t *pRequest, modbus_Pdu_t *pResponse)
+{
+	(void)pRequest;
+	modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e test_ReadRegisters(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint16_t *pValues)
+{
+	(void)functionCode;
+
+	if(((uint32_t)startAddress + quantity) > TEST_REGISTER_COUNT)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	memcpy(pValues, &s_pRegisters[startAddress], quantity * sizeof(uint16_t));
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e test_WriteRegister(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+{
+	(void)functionCode;
+
+	if(address >= TEST_REGISTER_COUNT)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	s_pRegisters[address] = value;
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e test_WriteRegisters(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pData)
+{
+	(void)functionCode;
+
+	if(((uint32_t)startAddress + quantity) > TEST_REGISTER_COUNT)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	for(uint16_t ctr = 0; ctr < quantity; ctr++)
+	{
+		s_pRegisters[startAddress + ctr] = (uint16_t)(((uint16_t)pData[2 * ctr] << 8) | pData[(2 * ctr) + 1]);
+	}
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+static const modbus_Handlers_t s_handlers =
+{
+	.pGenericFunctionHandler = test_GenericFunction,
+	.pReadRegisterBlockHandler = test_ReadRegisters,
+	.pWriteRegisterHandler = test_WriteRegister,
+	.pWriteRegisterBlockHandler = test_WriteRegisters,
+};
+
+//------------------------------------------------------------------------------
+//
+static void test_InitInstance(modbus_t *pInstance)
+{
+	memset(pInstance, 0, sizeof(*pInstance));
+	pInstance->busAddress = TEST_BUS_ADDRESS;
+	pInstance->pHandlers = &s_handlers;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_PutWord(uint8_t *pData, uint16_t value)
+{
+	pData[0] = (uint8_t)(value >> 8);
+	pData[1] = (uint8_t)(value & 0xFF);
+}
+
+//------------------------------------------------------------------------------
+// Random request inside the client's own register region, so clients do not
+// depend on each other's writes. Some go to unit 0, some to another unit and
+// some are answered with an exception.
+static void test_BuildRequest(uint32_t clientIndex, modbus_Pdu_t *pPdu)
+{
+	const uint16_t base = (uint16_t)(clientIndex * TEST_REGION_SIZE);
+	const uint32_t kind = (uint32_t)(rand() % 10);
+	const uint32_t unit = (uint32_t)(rand() % 20);
+
+	pPdu->busAddress = (unit == 0) ? MODBUS_BROADCAST_ADDRESS : ((unit == 1) ? (TEST_BUS_ADDRESS + 1) : TEST_BUS_ADDRESS);
+
+	if(kind < 5)
+	{
+		const uint16_t quantity = (uint16_t)(1 + (rand() % MODBUS_READ_REGISTER_MAX_QUANTITY));
+		pPdu->functionCode = MODBUS_FUNCTION_READHOLDING;
+		test_PutWord(&pPdu->pPayload[0], (uint16_t)(base + (rand() % (TEST_REGION_SIZE - quantity + 1))));
+		test_PutWord(&pPdu->pPayload[2], quantity);
+		pPdu->payloadSize = 4;
+	}
+	else if(kind < 7)
+	{
+		const uint16_t quantity = (uint16_t)(1 + (rand() % MODBUS_WRITE_REGISTER_MAX_QUANTITY));
+		pPdu->functionCode = MODBUS_FUNCTION_WRITEMULT_REGS;
+		test_PutWord(&pPdu->pPayload[0], (uint16_t)(base + (rand() % (TEST_REGION_SIZE - quantity + 1))));
+		test_PutWord(&pPdu->pPayload[2], quantity);
+		pPdu->pPayload[4] = (uint8_t)(2 * quantity);
+		for(uint16_t ctr = 0; ctr < (2 * quantity); ctr++)
+		{
+			pPdu->pPayload[5 + ctr] = (uint8_t)rand();
+		}
+		pPdu->payloadSize = (uint16_t)(5 + (2 * quantity));
+	}
+	else if(kind < 9)
+	{
+		pPdu->functionCode = MODBUS_FUNCTION_WRITESINGLE_REG;
+		test_PutWord(&pPdu->pPayload[0], (uint16_t)(base + (rand() % TEST_REGION_SIZE)));
+		test_PutWord(&pPdu->pPayload[2], (uint16_t)rand());
+		pPdu->payloadSize = 4;
+	}
+	else
+	{
+		// Behind the last register.
+		pPdu->functionCode = MODBUS_FUNCTION_READHOLDING;
+		test_PutWord(&pPdu->pPayload[0], (uint16_t)(TEST_REGISTER_COUNT + (rand() % 100)));
+		test_PutWord(&pPdu->pPayload[2], 1);
+		pPdu->payloadSize = 4;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Appends the request to the client's send stream, and its response, if any,
+// as the reference instance builds it to the expected stream.
+static void test_AddRequest(test_Client_t *pClient, modbus_t *pReference, uint16_t transactionId, modbus_Pdu_t *pRequest)
+{
+	pClient->txSize += modbus_EncodeTcp(&pClient->pTx[pClient->txSize], MODBUS_TCP_FRAME_SIZE, transactionId, pRequest);
+
+	*MODBUS_REQUEST_PDU(pReference) = *pRequest;
+	if(modbus_ProcessData(pReference))
+	{
+		pClient->expectedSize += modbus_EncodeTcp(&pClient->pExpected[pClient->expectedSize], MODBUS_TCP_FRAME_SIZE, transactionId, MODBUS_RESPONSE_PDU(pReference));
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static int test_Connect(uint16_t port, int receiveBufferSize)
+{
+	const int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0)
+	{
+		return -1;
+	}
+
+	if(receiveBufferSize > 0)
+	{
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+	}
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if(connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_ResetClient(test_Client_t *pClient, int fd)
+{
+	pClient->fd = fd;
+	pClient->txOffset = 0;
+	pClient->txSize = 0;
+	pClient->rxSize = 0;
+	pClient->expectedSize = 0;
+}
+
+//------------------------------------------------------------------------------
+// Sends the next piece of the request stream, at most `maxChunk` bytes.
+static void test_SendChunk(test_Client_t *pClient, uint32_t maxChunk)
+{
+	if(pClient->txOffset >= pClient->txSize)
+	{
+		return;
+	}
+
+	uint32_t size = 1 + (uint32_t)(rand() % maxChunk);
+	if(size > (pClient->txSize - pClient->txOffset))
+	{
+		size = pClient->txSize - pClient->txOffset;
+	}
+
+	const ssize_t sent = send(pClient->fd, &pClient->pTx[pClient->txOffset], size, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if(sent > 0)
+	{
+		pClient->txOffset += (uint32_t)sent;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Returns false once the server closed the connection.
+static bool test_Receive(test_Client_t *pClient)
+{
+	while(pClient->rxSize < TEST_STREAM_SIZE)
+	{
+		const ssize_t size = recv(pClient->fd, &pClient->pRx[pClient->rxSize], TEST_STREAM_SIZE - pClient->rxSize, MSG_DONTWAIT);
+		if(size == 0)
+		{
+			return false;
+		}
+
+		if(size < 0)
+		{
+			return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR));
+		}
+
+		pClient->rxSize += (uint32_t)size;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool test_WaitForConnections(modbus_TcpServer_t *pServer, uint32_t connectionCount, uint32_t rejectedCount)
+{
+	for(uint32_t ctr = 0; ctr < 1000; ctr++)
+	{
+		if((pServer->connectionCount == connectionCount) && (pServer->rejectedCount == rejectedCount))
+		{
+			return true;
+		}
+		modbus_TcpServer_Poll(pServer, 1);
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_TcpServer_Connection_t *test_GetConnection(void)
+{
+	for(uint32_t ctr = 0; ctr < TEST_SLOT_COUNT; ctr++)
+	{
+		if(s_pConnections[ctr].fd >= 0)
+		{
+			return &s_pConnections[ctr];
+		}
+	}
+
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+// All clients pipeline their whole stream in random chunks while the server runs.
+static void test_Pipelined(void)
+{
+	modbus_t instance;
+	modbus_t reference;
+	modbus_TcpServer_t server;
+
+	test_InitInstance(&instance);
+	test_InitInstance(&reference);
+	reference.noBroadcast = true;
+
+	memset(s_pRegisters, 0, sizeof(s_pRegisters));
+	for(uint32_t client = 0; client < TEST_CLIENT_COUNT; client++)
+	{
+		test_ResetClient(&s_pClients[client], -1);
+		for(uint32_t ctr = 0; ctr < TEST_REQUEST_COUNT; ctr++)
+		{
+			modbus_Pdu_t request;
+			test_BuildRequest(client, &request);
+			test_AddRequest(&s_pClients[client], &reference, (uint16_t)((client << 12) + ctr), &request);
+		}
+	}
+	memset(s_pRegisters, 0, sizeof(s_pRegisters));
+
+	if(!modbus_TcpServer_Init(&server, &instance, "127.0.0.1", 0, s_pConnections, TEST_SLOT_COUNT))
+	{
+		test_Check(false, "modbus_TcpServer_Init");
+		return;
+	}
+
+	const uint16_t port = modbus_TcpServer_GetPort(&server);
+	for(uint32_t client = 0; client < TEST_CLIENT_COUNT; client++)
+	{
+		s_pClients[client].fd = test_Connect(port, 0);
+	}
+	test_Check(test_WaitForConnections(&server, TEST_CLIENT_COUNT, 0), "clients accepted");
+
+	// One client more than there are slots.
+	const int rejectedFd = test_Connect(port, 0);
+	test_Check(test_WaitForConnections(&server, TEST_CLIENT_COUNT, 1), "client beyond the slots rejected");
+
+	for(uint32_t poll = 0; poll < TEST_MAX_POLLS; poll++)
+	{
+		bool done = true;
+		for(uint32_t client = 0; client < TEST_CLIENT_COUNT; client++)
+		{
+			test_Client_t *pClient = &s_pClients[client];
+
+			test_SendChunk(pClient, 300);
+			modbus_TcpServer_Poll(&server, 1);
+			test_Check(test_Receive(pClient), "connection kept open");
+
+			done = done && (pClient->rxSize >= pClient->expectedSize);
+		}
+
+		if(done)
+		{
+			break;
+		}
+	}
+
+	for(uint32_t client = 0; client < TEST_CLIENT_COUNT; client++)
+	{
+		test_Client_t *pClient = &s_pClients[client];
+		test_Check(pClient->rxSize == pClient->expectedSize, "response stream size");
+		test_Check(memcmp(pClient->pRx, pClient->pExpected, pClient->expectedSize) == 0, "response stream content");
+		close(pClient->fd);
+	}
+
+	uint8_t byte;
+	test_Check(recv(rejectedFd, &byte, 1, 0) == 0, "rejected client closed");
+	close(rejectedFd);
+
+	test_Check(server.requestCount == (TEST_CLIENT_COUNT * TEST_REQUEST_COUNT), "requestCount");
+	test_Check(server.protocolErrorCount == 0, "protocolErrorCount");
+	// Unit 0 requests only match the reference if the server switched broadcasts off.
+	test_Check(instance.noBroadcast, "noBroadcast forced");
+
+	modbus_TcpServer_Close(&server);
+}
+
+//------------------------------------------------------------------------------
+// A client that does not read fills the socket buffers and then pTx. The server has
+// to stop processing and reading until the client catches up, and lose nothing.
+static void test_Backpressure(void)
+{
+	modbus_t instance;
+	modbus_t reference;
+	modbus_TcpServer_t server;
+	test_Client_t *pClient = &s_pClients[0];
+
+	test_InitInstance(&instance);
+	test_InitInstance(&reference);
+	reference.noBroadcast = true;
+
+	test_ResetClient(pClient, -1);
+	for(uint32_t ctr = 0; ctr < TEST_STALL_REQUEST_COUNT; ctr++)
+	{
+		modbus_Pdu_t request;
+		request.busAddress = TEST_BUS_ADDRESS;
+		request.functionCode = MODBUS_FUNCTION_READHOLDING;
+		test_PutWord(&request.pPayload[0], (uint16_t)(ctr % (TEST_REGISTER_COUNT - MODBUS_READ_REGISTER_MAX_QUANTITY)));
+		test_PutWord(&request.pPayload[2], MODBUS_READ_REGISTER_MAX_QUANTITY);
+		request.payloadSize = 4;
+		test_AddRequest(pClient, &reference, (uint16_t)ctr, &request);
+	}
+
+	if(!modbus_TcpServer_Init(&server, &instance, "127.0.0.1", 0, s_pConnections, TEST_SLOT_COUNT))
+	{
+		test_Check(false, "modbus_TcpServer_Init");
+		return;
+	}
+
+	pClient->fd = test_Connect(modbus_TcpServer_GetPort(&server), 1024);
+	test_Check(test_WaitForConnections(&server, 1, 0), "client accepted");
+
+	modbus_TcpServer_Connection_t *pConnection = test_GetConnection();
+	if(pConnection == NULL)
+	{
+		test_Check(false, "connection slot");
+		modbus_TcpServer_Close(&server);
+		return;
+	}
+
+	// Small socket buffers, so pTx fills after a few dozen responses.
+	const int sendBufferSize = 4096;
+	setsockopt(pConnection->fd, SOL_SOCKET, SO_SNDBUF, &sendBufferSize, sizeof(sendBufferSize));
+
+	for(uint32_t poll = 0; (poll < 1000) && (pClient->txOffset < pClient->txSize); poll++)
+	{
+		test_SendChunk(pClient, MODBUS_TCP_FRAME_SIZE);
+		modbus_TcpServer_Poll(&server, 1);
+	}
+	for(uint32_t poll = 0; poll < 20; poll++)
+	{
+		modbus_TcpServer_Poll(&server, 1);
+	}
+
+	test_Check(pClient->txOffset == pClient->txSize, "all requests sent");
+	test_Check(server.requestCount < TEST_STALL_REQUEST_COUNT, "processing stalled");
+	test_Check((MODBUS_TCP_SERVER_TX_BUFFER_SIZE - pConnection->txSize) < MODBUS_TCP_FRAME_SIZE, "pTx full");
+	test_Check(pConnection->rxSize == MODBUS_TCP_SERVER_RX_BUFFER_SIZE, "pRx full");
+	test_Check(pConnection->events == EPOLLOUT, "waiting for EPOLLOUT only");
+
+	for(uint32_t poll = 0; (poll < TEST_MAX_POLLS) && (pClient->rxSize < pClient->expectedSize); poll++)
+	{
+		test_Check(test_Receive(pClient), "connection kept open");
+		modbus_TcpServer_Poll(&server, 1);
+	}
+
+	test_Check(pClient->rxSize == pClient->expectedSize, "stalled response stream size");
+	test_Check(memcmp(pClient->pRx, pClient->pExpected, pClient->expectedSize) == 0, "stalled response stream content");
+	test_Check(server.requestCount == TEST_STALL_REQUEST_COUNT, "stalled requestCount");
+	test_Check(pConnection->events == EPOLLIN, "reading again");
+
+	close(pClient->fd);
+	modbus_TcpServer_Close(&server);
+}
+
+//------------------------------------------------------------------------------
+// A valid request, then an ADU with protocol ID 1, which cannot be resynchronized.
+static void test_BadHeader(void)
+{
+	modbus_t instance;
+	modbus_t reference;
+	modbus_TcpServer_t server;
+	test_Client_t *pClient = &s_pClients[0];
+	modbus_Pdu_t request;
+
+	test_InitInstance(&instance);
+	test_InitInstance(&reference);
+	reference.noBroadcast = true;
+
+	request.busAddress = TEST_BUS_ADDRESS;
+	request.functionCode = MODBUS_FUNCTION_READHOLDING;
+	test_PutWord(&request.pPayload[0], 0);
+	test_PutWord(&request.pPayload[2], 10);
+	request.payloadSize = 4;
+
+	test_ResetClient(pClient, -1);
+	test_AddRequest(pClient, &reference, 1, &request);
+
+	if(!modbus_TcpServer_Init(&server, &instance, "127.0.0.1", 0, s_pConnections, TEST_SLOT_COUNT))
+	{
+		test_Check(false, "modbus_TcpServer_Init");
+		return;
+	}
+
+	pClient->fd = test_Connect(modbus_TcpServer_GetPort(&server), 0);
+	test_Check(test_WaitForConnections(&server, 1, 0), "client accepted");
+
+	for(uint32_t poll = 0; (poll < 1000) && (pClient->rxSize < pClient->expectedSize); poll++)
+	{
+		test_SendChunk(pClient, MODBUS_TCP_FRAME_SIZE);
+		modbus_TcpServer_Poll(&server, 1);
+		test_Check(test_Receive(pClient), "connection kept open");
+	}
+	test_Check((pClient->rxSize == pClient->expectedSize) && (memcmp(pClient->pRx, pClient->pExpected, pClient->expectedSize) == 0), "response before the broken header");
+
+	uint8_t pBroken[MODBUS_TCP_FRAME_SIZE];
+	const uint16_t brokenSize = modbus_EncodeTcp(pBroken, sizeof(pBroken), 2, &request);
+	pBroken[3] = 1;
+	test_Check(send(pClient->fd, pBroken, brokenSize, MSG_NOSIGNAL) == brokenSize, "send broken header");
+
+	bool closed = false;
+	for(uint32_t poll = 0; (poll < 1000) && !closed; poll++)
+	{
+		modbus_TcpServer_Poll(&server, 1);
+		closed = !test_Receive(pClient);
+	}
+
+	test_Check(closed, "connection closed on broken header");
+	test_Check(pClient->rxSize == pClient->expectedSize, "no response to the broken header");
+	test_Check(server.protocolErrorCount == 1, "protocolErrorCount");
+	test_Check(server.connectionCount == 0, "connection slot released");
+
+	close(pClient->fd);
+	modbus_TcpServer_Close(&server);
+}
+
+//------------------------------------------------------------------------------
+// A host behind the server's process hook: units 0 and TEST_BUS_ADDRESS answer
+// like the reference, the unit in between is unknown and answered by the gateway.
+static void test_Host(void)
+{
+	modbus_Host_t host;
+	modbus_Host_Unit_t unit = { .pHandlers = &s_handlers, .pContext = NULL };
+	modbus_t reference;
+	modbus_TcpServer_t server;
+	test_Client_t *pClient = &s_pClients[0];
+
+	modbus_Host_Init(&host);
+	modbus_Host_SetUnit(&host, MODBUS_BROADCAST_ADDRESS, &unit);
+	modbus_Host_SetUnit(&host, TEST_BUS_ADDRESS, &unit);
+	host.gatewayExceptions = true;
+
+	test_InitInstance(&reference);
+	reference.noBroadcast = true;
+
+	memset(s_pRegisters, 0, sizeof(s_pRegisters));
+	test_ResetClient(pClient, -1);
+	for(uint32_t ctr = 0; ctr < TEST_REQUEST_COUNT; ctr++)
+	{
+		modbus_Pdu_t request;
+		test_BuildRequest(0, &request);
+
+		if(request.busAddress != (TEST_BUS_ADDRESS + 1))
+		{
+			test_AddRequest(pClient, &reference, (uint16_t)ctr, &request);
+			continue;
+		}
+
+		pClient->txSize += modbus_EncodeTcp(&pClient->pTx[pClient->txSize], MODBUS_TCP_FRAME_SIZE, (uint16_t)ctr, &request);
+
+		request.functionCode |= 0x80;
+		request.pPayload[0] = MODBUS_EXCEPTION_GATEWAYDEVICEFAILEDTORESP;
+		request.payloadSize = 1;
+		pClient->expectedSize += modbus_EncodeTcp(&pClient->pExpected[pClient->expectedSize], MODBUS_TCP_FRAME_SIZE, (uint16_t)ctr, &request);
+	}
+	memset(s_pRegisters, 0, sizeof(s_pRegisters));
+
+	if(!modbus_TcpServer_Init(&server, &host.instance, "127.0.0.1", 0, s_pConnections, TEST_SLOT_COUNT))
+	{
+		test_Check(false, "modbus_TcpServer_Init");
+		return;
+	}
+	server.pProcessHandler = modbus_Host_Process;
+	server.pProcessContext = &host;
+
+	pClient->fd = test_Connect(modbus_TcpServer_GetPort(&server), 0);
+	test_Check(test_WaitForConnections(&server, 1, 0), "client accepted");
+
+	for(uint32_t poll = 0; (poll < TEST_MAX_POLLS) && (pClient->rxSize < pClient->expectedSize); poll++)
+	{
+		test_SendChunk(pClient, 300);
+		modbus_TcpServer_Poll(&server, 1);
+		test_Check(test_Receive(pClient), "connection kept open");
+	}
+
+	test_Check(pClient->rxSize == pClient->expectedSize, "host response stream size");
+	test_Check(memcmp(pClient->pRx, pClient->pExpected, pClient->expectedSize) == 0, "host response stream content");
+	test_Check(host.instance.noBroadcast, "host noBroadcast forced");
+	test_Check(server.requestCount == TEST_REQUEST_COUNT, "host requestCount");
+	test_Check((host.requestCount + host.unknownUnitCount) == TEST_REQUEST_COUNT, "host unit counters");
+	test_Check(host.unknownUnitCount > 0, "host unknown units");
+
+	close(pClient->fd);
+	modbus_TcpServer_Close(&server);
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	srand(1);
+
+	test_Pipelined();
+	test_Backpressure();
+	test_BadHeader();
+	test_Host();
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
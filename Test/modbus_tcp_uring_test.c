@@ -0,0 +1,537 @@
+// The backend is included directly, so its completion handlers can be fed
+// completions the kernel under test would never produce. It has to come
+// first, as it sets _GNU_SOURCE.
+#include <ModbusEmbedded/Src/modbus_TcpUring.c>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <ModbusEmbedded/modbus.h>
+#include <ModbusEmbedded/modbus_tcp_uring.h>
+
+/**
+ * Runs the io_uring backend over loopback: pipelined requests, the multishot
+ * recv being cancelled while pTx is full and re-armed afterwards, a client
+ * overflowing the stash, and the fallback from fixed to plain buffers when a
+ * send completes with -EINVAL. Test/run.sh builds it with MODBUS_TCP_URING.
+ */
+
+#define TEST_BUS_ADDRESS			17
+#define TEST_SLOT_COUNT				3
+#define TEST_REGISTER_COUNT			600
+#define TEST_REQUEST_COUNT			300
+#define TEST_STALL_REQUEST_COUNT	400
+#define TEST_FLOOD_REQUEST_COUNT	2000
+#define TEST_STREAM_SIZE			(TEST_FLOOD_REQUEST_COUNT * MODBUS_TCP_FRAME_SIZE)
+#define TEST_MAX_POLLS				20000
+
+
+
+typedef struct
+{
+	int fd;
+
+	uint32_t txOffset;
+	uint32_t txSize;
+	uint8_t pTx[TEST_STREAM_SIZE];
+
+	uint32_t rxSize;
+	uint8_t pRx[TEST_STREAM_SIZE];
+
+	uint32_t expectedSize;
+	uint8_t pExpected[TEST_STREAM_SIZE];
+} test_Client_t;
+
+
+
+static uint16_t s_pRegisters[TEST_REGISTER_COUNT];
+static test_Client_t s_client;
+static modbus_TcpUring_Connection_t s_pConnections[TEST_SLOT_COUNT];
+static uint32_t s_failCount = 0;
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s\n", pName);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_GenericFunction(modbus_Pdu_t *pRequest, modbus_Pdu_t *pResponse)
+{
+	(void)pRequest;
+	modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e test_ReadRegisters(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint16_t *pValues)
+{
+	(void)functionCode;
+
+	if(((uint32_t)startAddress + quantity) > TEST_REGISTER_COUNT)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	memcpy(pValues, &s_pRegisters[startAddress], quantity * sizeof(uint16_t));
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e test_WriteRegisters(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pData)
+{
+	(void)functionCode;
+
+	if(((uint32_t)startAddress + quantity) > TEST_REGISTER_COUNT)
+	{
+		return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+	}
+
+	for(uint16_t ctr = 0; ctr < quantity; ctr++)
+	{
+		s_pRegisters[startAddress + ctr] = (uint16_t)(((uint16_t)pData[2 * ctr] << 8) | pData[(2 * ctr) + 1]);
+	}
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+static const modbus_Handlers_t s_handlers =
+{
+	.pGenericFunctionHandler = test_GenericFunction,
+	.pReadRegisterBlockHandler = test_ReadRegisters,
+	.pWriteRegisterBlockHandler = test_WriteRegisters,
+};
+
+//------------------------------------------------------------------------------
+//
+static void test_InitInstance(modbus_t *pInstance)
+{
+	memset(pInstance, 0, sizeof(*pInstance));
+	pInstance->busAddress = TEST_BUS_ADDRESS;
+	pInstance->noBroadcast = true;
+	pInstance->pHandlers = &s_handlers;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_PutWord(uint8_t *pData, uint16_t value)
+{
+	pData[0] = (uint8_t)(value >> 8);
+	pData[1] = (uint8_t)(value & 0xFF);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_BuildRead(modbus_Pdu_t *pPdu, uint16_t startAddress, uint16_t quantity)
+{
+	pPdu->busAddress = TEST_BUS_ADDRESS;
+	pPdu->functionCode = MODBUS_FUNCTION_READHOLDING;
+	test_PutWord(&pPdu->pPayload[0], startAddress);
+	test_PutWord(&pPdu->pPayload[2], quantity);
+	pPdu->payloadSize = 4;
+}
+
+//------------------------------------------------------------------------------
+// Random FC 0x03 or FC 0x10, some of them out of range.
+static void test_BuildRequest(modbus_Pdu_t *pPdu)
+{
+	const uint16_t quantity = (uint16_t)(1 + (rand() % MODBUS_WRITE_REGISTER_MAX_QUANTITY));
+	const uint16_t startAddress = (uint16_t)(rand() % (TEST_REGISTER_COUNT + 50));
+
+	test_BuildRead(pPdu, startAddress, quantity);
+
+	if((rand() % 3) == 0)
+	{
+		pPdu->functionCode = MODBUS_FUNCTION_WRITEMULT_REGS;
+		pPdu->pPayload[4] = (uint8_t)(2 * quantity);
+		for(uint16_t ctr = 0; ctr < (2 * quantity); ctr++)
+		{
+			pPdu->pPayload[5 + ctr] = (uint8_t)rand();
+		}
+		pPdu->payloadSize = (uint16_t)(5 + (2 * quantity));
+	}
+}
+
+//------------------------------------------------------------------------------
+// Appends the request to the send stream and the reference response to the expected stream.
+static void test_AddRequest(test_Client_t *pClient, modbus_t *pReference, uint16_t transactionId, modbus_Pdu_t *pRequest)
+{
+	pClient->txSize += modbus_EncodeTcp(&pClient->pTx[pClient->txSize], MODBUS_TCP_FRAME_SIZE, transactionId, pRequest);
+
+	*MODBUS_REQUEST_PDU(pReference) = *pRequest;
+	if(modbus_ProcessData(pReference))
+	{
+		pClient->expectedSize += modbus_EncodeTcp(&pClient->pExpected[pClient->expectedSize], MODBUS_TCP_FRAME_SIZE, transactionId, MODBUS_RESPONSE_PDU(pReference));
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static int test_Connect(uint16_t port, int receiveBufferSize)
+{
+	const int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0)
+	{
+		return -1;
+	}
+
+	if(receiveBufferSize > 0)
+	{
+		setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize));
+	}
+
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if(connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_ResetClient(test_Client_t *pClient)
+{
+	pClient->fd = -1;
+	pClient->txOffset = 0;
+	pClient->txSize = 0;
+	pClient->rxSize = 0;
+	pClient->expectedSize = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_SendChunk(test_Client_t *pClient, uint32_t maxChunk)
+{
+	if(pClient->txOffset >= pClient->txSize)
+	{
+		return;
+	}
+
+	uint32_t size = 1 + (uint32_t)(rand() % maxChunk);
+	if(size > (pClient->txSize - pClient->txOffset))
+	{
+		size = pClient->txSize - pClient->txOffset;
+	}
+
+	const ssize_t sent = send(pClient->fd, &pClient->pTx[pClient->txOffset], size, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if(sent > 0)
+	{
+		pClient->txOffset += (uint32_t)sent;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Returns false once the server closed the connection.
+static bool test_Receive(test_Client_t *pClient)
+{
+	while(pClient->rxSize < TEST_STREAM_SIZE)
+	{
+		const ssize_t size = recv(pClient->fd, &pClient->pRx[pClient->rxSize], TEST_STREAM_SIZE - pClient->rxSize, MSG_DONTWAIT);
+		if(size == 0)
+		{
+			return false;
+		}
+
+		if(size < 0)
+		{
+			return ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR));
+		}
+
+		pClient->rxSize += (uint32_t)size;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_TcpUring_Connection_t *test_Accept(modbus_TcpUring_t *pServer, test_Client_t *pClient, int receiveBufferSize)
+{
+	pClient->fd = test_Connect(modbus_TcpUring_GetPort(pServer), receiveBufferSize);
+
+	for(uint32_t ctr = 0; (ctr < 1000) && (pServer->connectionCount == 0); ctr++)
+	{
+		modbus_TcpUring_Poll(pServer, 1);
+	}
+
+	for(uint32_t ctr = 0; ctr < TEST_SLOT_COUNT; ctr++)
+	{
+		if(s_pConnections[ctr].base.fd >= 0)
+		{
+			// One more round, so the first recv is armed.
+			modbus_TcpUring_Poll(pServer, 0);
+			return &s_pConnections[ctr];
+		}
+	}
+
+	test_Check(false, "client accepted");
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+// Random requests sent in random chunks, responses compared byte for byte.
+static void test_Pipelined(modbus_TcpUring_t *pServer, modbus_t *pReference)
+{
+	test_Client_t *pClient = &s_client;
+
+	// The reference writes the same registers, so they are reset once it is done.
+	memset(s_pRegisters, 0, sizeof(s_pRegisters));
+	test_ResetClient(pClient);
+	for(uint32_t ctr = 0; ctr < TEST_REQUEST_COUNT; ctr++)
+	{
+		modbus_Pdu_t request;
+		test_BuildRequest(&request);
+		test_AddRequest(pClient, pReference, (uint16_t)ctr, &request);
+	}
+	memset(s_pRegisters, 0, sizeof(s_pRegisters));
+
+	if(test_Accept(pServer, pClient, 0) == NULL)
+	{
+		return;
+	}
+
+	for(uint32_t poll = 0; (poll < TEST_MAX_POLLS) && (pClient->rxSize < pClient->expectedSize); poll++)
+	{
+		test_SendChunk(pClient, 300);
+		modbus_TcpUring_Poll(pServer, 1);
+		test_Check(test_Receive(pClient), "connection kept open");
+	}
+
+	test_Check(pClient->rxSize == pClient->expectedSize, "response stream size");
+	test_Check(memcmp(pClient->pRx, pClient->pExpected, pClient->expectedSize) == 0, "response stream content");
+
+	close(pClient->fd);
+	for(uint32_t ctr = 0; (ctr < 1000) && (pServer->connectionCount > 0); ctr++)
+	{
+		modbus_TcpUring_Poll(pServer, 1);
+	}
+	test_Check(pServer->connectionCount == 0, "slot released after close");
+}
+
+//------------------------------------------------------------------------------
+// A client that does not read fills pTx. The multishot recv has to be cancelled
+// while data waits in the stash, and re-armed once the client catches up.
+static void test_CancelRearm(modbus_TcpUring_t *pServer, modbus_t *pReference)
+{
+	test_Client_t *pClient = &s_client;
+
+	test_ResetClient(pClient);
+	for(uint32_t ctr = 0; ctr < TEST_STALL_REQUEST_COUNT; ctr++)
+	{
+		modbus_Pdu_t request;
+		test_BuildRead(&request, (uint16_t)(ctr % (TEST_REGISTER_COUNT - MODBUS_READ_REGISTER_MAX_QUANTITY)), MODBUS_READ_REGISTER_MAX_QUANTITY);
+		test_AddRequest(pClient, pReference, (uint16_t)ctr, &request);
+	}
+
+	modbus_TcpUring_Connection_t *pConnection = test_Accept(pServer, pClient, 1024);
+	if(pConnection == NULL)
+	{
+		return;
+	}
+
+	const int sendBufferSize = 4096;
+	setsockopt(pConnection->base.fd, SOL_SOCKET, SO_SNDBUF, &sendBufferSize, sizeof(sendBufferSize));
+
+	const uint32_t requestCount = pServer->requestCount;
+
+	// One chunk per round, so the stash never holds more than the cancel lets through.
+	for(uint32_t poll = 0; (poll < 1000) && (pClient->txOffset < pClient->txSize); poll++)
+	{
+		test_SendChunk(pClient, MODBUS_TCP_FRAME_SIZE);
+		modbus_TcpUring_Poll(pServer, 1);
+	}
+	for(uint32_t poll = 0; poll < 20; poll++)
+	{
+		modbus_TcpUring_Poll(pServer, 1);
+	}
+
+	test_Check(pClient->txOffset == pClient->txSize, "all requests sent");
+	test_Check((pServer->requestCount - requestCount) < TEST_STALL_REQUEST_COUNT, "processing stalled");
+	test_Check(pConnection->stashCount > 0, "data held in the stash");
+	test_Check(!pConnection->recvActive && !pConnection->cancelActive, "recv cancelled");
+	test_Check(!pConnection->closing, "connection kept open while stalled");
+
+	for(uint32_t poll = 0; (poll < TEST_MAX_POLLS) && (pClient->rxSize < pClient->expectedSize); poll++)
+	{
+		test_Check(test_Receive(pClient), "connection kept open");
+		modbus_TcpUring_Poll(pServer, 1);
+	}
+	modbus_TcpUring_Poll(pServer, 0);
+
+	test_Check(pClient->rxSize == pClient->expectedSize, "stalled response stream size");
+	test_Check(memcmp(pClient->pRx, pClient->pExpected, pClient->expectedSize) == 0, "stalled response stream content");
+	test_Check(pConnection->stashCount == 0, "stash drained");
+	test_Check(pConnection->recvActive, "recv re-armed");
+
+	close(pClient->fd);
+	for(uint32_t ctr = 0; (ctr < 1000) && (pServer->connectionCount > 0); ctr++)
+	{
+		modbus_TcpUring_Poll(pServer, 1);
+	}
+}
+
+//------------------------------------------------------------------------------
+// All requests in one write: the multishot recv completes buffer after buffer in
+// a single round, more than the stash holds, and the connection is dropped.
+static void test_StashOverflow(modbus_TcpUring_t *pServer, modbus_t *pReference)
+{
+	test_Client_t *pClient = &s_client;
+
+	test_ResetClient(pClient);
+	for(uint32_t ctr = 0; ctr < TEST_FLOOD_REQUEST_COUNT; ctr++)
+	{
+		modbus_Pdu_t request;
+		test_BuildRead(&request, 0, MODBUS_READ_REGISTER_MAX_QUANTITY);
+		test_AddRequest(pClient, pReference, (uint16_t)ctr, &request);
+	}
+
+	// More receive buffers than stash entries, and more data than pRx and pTx take.
+	test_Check((pClient->txSize / MODBUS_TCP_URING_BUFFER_SIZE) > (2 * MODBUS_TCP_URING_STASH_SIZE), "flood size");
+
+	if(test_Accept(pServer, pClient, 0) == NULL)
+	{
+		return;
+	}
+
+	const uint32_t requestCount = pServer->requestCount;
+	test_Check(send(pClient->fd, pClient->pTx, pClient->txSize, MSG_NOSIGNAL) == (ssize_t)pClient->txSize, "send flood");
+
+	for(uint32_t poll = 0; (poll < 1000) && (pServer->connectionCount > 0); poll++)
+	{
+		modbus_TcpUring_Poll(pServer, 1);
+	}
+
+	test_Check(pServer->connectionCount == 0, "connection closed on stash overflow");
+	test_Check((pServer->requestCount - requestCount) < TEST_FLOOD_REQUEST_COUNT, "flood not answered");
+	test_Check(pServer->protocolErrorCount == 0, "not counted as protocol error");
+
+	bool closed = false;
+	for(uint32_t poll = 0; (poll < 1000) && !closed; poll++)
+	{
+		closed = !test_Receive(pClient);
+	}
+	test_Check(closed, "client sees the close");
+
+	close(pClient->fd);
+}
+
+//------------------------------------------------------------------------------
+// Kernels that accept fixed buffers only for zero-copy sends fail plain sends from
+// the registered pTx with -EINVAL. The backend has to resend without fixed buffers
+// and keep the connection. Any other failure, or -EINVAL without fixed buffers,
+// closes it.
+static void test_FixedBufferFallback(modbus_TcpUring_t *pServer, modbus_t *pReference)
+{
+	test_Client_t *pClient = &s_client;
+	modbus_Pdu_t request;
+
+	test_ResetClient(pClient);
+	test_BuildRead(&request, 10, 20);
+	test_AddRequest(pClient, pReference, 7, &request);
+
+	modbus_TcpUring_Connection_t *pConnection = test_Accept(pServer, pClient, 0);
+	if(pConnection == NULL)
+	{
+		return;
+	}
+
+	// As if the response had been built and its send had just failed.
+	memcpy(pConnection->base.pTx, pClient->pExpected, pClient->expectedSize);
+	pConnection->base.txOffset = 0;
+	pConnection->base.txSize = pClient->expectedSize;
+	pConnection->sendActive = true;
+	pServer->fixedBuffers = true;
+
+	struct io_uring_cqe cqe;
+	memset(&cqe, 0, sizeof(cqe));
+	cqe.user_data = (uint64_t)(uintptr_t)pConnection | MODBUS_TCP_URING_OP_SEND;
+	cqe.res = -EINVAL;
+	modbus_TcpUring_HandleSend(pServer, pConnection, &cqe);
+
+	test_Check(!pServer->fixedBuffers, "fixed buffers switched off");
+	test_Check(pConnection->sendActive && !pConnection->closing, "send resubmitted");
+
+	for(uint32_t poll = 0; (poll < 1000) && (pClient->rxSize < pClient->expectedSize); poll++)
+	{
+		modbus_TcpUring_Poll(pServer, 1);
+		test_Check(test_Receive(pClient), "connection kept open");
+	}
+	test_Check((pClient->rxSize == pClient->expectedSize) && (memcmp(pClient->pRx, pClient->pExpected, pClient->expectedSize) == 0), "response after fallback");
+
+	// Without fixed buffers -EINVAL is a real failure.
+	pConnection->base.txSize = pClient->expectedSize;
+	pConnection->sendActive = true;
+	modbus_TcpUring_HandleSend(pServer, pConnection, &cqe);
+	test_Check(pConnection->closing, "closed on -EINVAL without fixed buffers");
+
+	for(uint32_t poll = 0; (poll < 1000) && (pServer->connectionCount > 0); poll++)
+	{
+		modbus_TcpUring_Poll(pServer, 1);
+	}
+	test_Check(pServer->connectionCount == 0, "slot released");
+
+	close(pClient->fd);
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	modbus_t instance;
+	modbus_t reference;
+	modbus_TcpUring_t server;
+
+	srand(1);
+	test_InitInstance(&instance);
+	test_InitInstance(&reference);
+
+	if(!modbus_TcpUring_Init(&server, &instance, "127.0.0.1", 0, s_pConnections, TEST_SLOT_COUNT))
+	{
+		printf("SKIP: io_uring with provided buffer rings is not available\n");
+		return 0;
+	}
+
+	test_Pipelined(&server, &reference);
+	test_CancelRearm(&server, &reference);
+	test_StashOverflow(&server, &reference);
+	test_FixedBufferFallback(&server, &reference);
+
+	test_Check(server.protocolErrorCount == 0, "protocolErrorCount");
+	modbus_TcpUring_Close(&server);
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
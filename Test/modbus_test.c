@@ -0,0 +1,378 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ModbusEmbedded/modbus.h>
+#include <ModbusEmbedded/modbus_host.h>
+
+/**
+ * Checks the addressing rules of the slave core and the host: only the write
+ * functions 0x05, 0x06, 0x0F and 0x10 are accepted as broadcasts, applied
+ * without response, every other broadcast is dropped before its handler runs.
+ * With `noBroadcast` set, address 0 is a direct address that gets answered.
+ * An instance at address 0 accepts requests for every address.
+ */
+
+#define TEST_BUS_ADDRESS		17
+#define TEST_UNIT_COUNT			3
+
+
+
+static uint32_t s_failCount = 0;
+
+static uint32_t s_readCount = 0;
+static uint32_t s_writeCount = 0;
+static uint32_t s_genericCount = 0;
+
+static modbus_Host_t s_host;
+static modbus_Host_Unit_t s_pUnits[TEST_UNIT_COUNT];
+static uint32_t s_pUnitWriteCounts[TEST_UNIT_COUNT];
+
+static const uint8_t s_pWriteFunctions[4] =
+{
+	MODBUS_FUNCTION_WRITESINGLE_COIL,
+	MODBUS_FUNCTION_WRITESINGLE_REG,
+	MODBUS_FUNCTION_WRITEMULT_COILS,
+	MODBUS_FUNCTION_WRITEMULT_REGS
+};
+
+static const uint8_t s_pReadFunctions[4] =
+{
+	MODBUS_FUNCTION_READCOILS,
+	MODBUS_FUNCTION_READDISCRETE,
+	MODBUS_FUNCTION_READHOLDING,
+	MODBUS_FUNCTION_READINPUT
+};
+
+
+
+//------------------------------------------------------------------------------
+//
+void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber)
+{
+	printf("MODBUS_ASSERT() failed at [ %s : %u ].\n", pFileName, (unsigned)lineNumber);
+	exit(1);
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_Check(bool condition, const char *pName)
+{
+	if(!condition)
+	{
+		if(s_failCount < 10)
+		{
+			printf("FAIL %s\n", pName);
+		}
+		s_failCount++;
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static void test_GenericFunction(modbus_Pdu_t *pRequest, modbus_Pdu_t *pResponse)
+{
+	(void)pRequest;
+
+	s_genericCount++;
+	pResponse->payloadSize = 0;
+}
+
+//------------------------------------------------------------------------------
+//
+static modbus_Exception_e test_Read(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t *pValue)
+{
+	(void)functionCode;
+	(void)address;
+
+	s_readCount++;
+	*pValue = 0;
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+//------------------------------------------------------------------------------
+// Counts per host unit as well, `pContext` is the index of the unit.
+static modbus_Exception_e test_Write(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+{
+	(void)functionCode;
+	(void)address;
+	(void)value;
+
+	s_writeCount++;
+
+	const modbus_Host_Unit_t *pUnit = modbus_Host_GetActiveUnit(&s_host);
+	if(pUnit != NULL)
+	{
+		s_pUnitWriteCounts[(uintptr_t)pUnit->pContext]++;
+	}
+	return MODBUS_EXCEPTION_SUCCESS;
+}
+
+static const modbus_Handlers_t s_handlers =
+{
+	.pGenericFunctionHandler = test_GenericFunction,
+	.pReadCoilHandler = test_Read,
+	.pReadDiscreteHandler = test_Read,
+	.pReadHoldingRegisterHandler = test_Read,
+	.pReadInputRegisterHandler = test_Read,
+	.pWriteCoilHandler = test_Write,
+	.pWriteRegisterHandler = test_Write,
+};
+
+//------------------------------------------------------------------------------
+// A valid request of one coil or register at address 0 for any of the supported
+// functions, otherwise a payload of four zero bytes.
+static void test_BuildRequest(modbus_Pdu_t *pPdu, uint8_t busAddress, uint8_t functionCode)
+{
+	memset(pPdu, 0, sizeof(*pPdu));
+	pPdu->busAddress = busAddress;
+	pPdu->functionCode = functionCode;
+	pPdu->payloadSize = 4;
+
+	switch(functionCode)
+	{
+		case MODBUS_FUNCTION_READCOILS:
+		case MODBUS_FUNCTION_READDISCRETE:
+		case MODBUS_FUNCTION_READHOLDING:
+		case MODBUS_FUNCTION_READINPUT:
+		{
+			pPdu->pPayload[3] = 1;
+			break;
+		}
+
+		case MODBUS_FUNCTION_WRITESINGLE_COIL:
+		{
+			pPdu->pPayload[2] = 0xFF;
+			break;
+		}
+
+		case MODBUS_FUNCTION_WRITESINGLE_REG:
+		{
+			pPdu->pPayload[3] = 0x2A;
+			break;
+		}
+
+		case MODBUS_FUNCTION_WRITEMULT_COILS:
+		{
+			pPdu->pPayload[3] = 1;
+			pPdu->pPayload[4] = 1;
+			pPdu->pPayload[5] = 0x01;
+			pPdu->payloadSize = 6;
+			break;
+		}
+
+		case MODBUS_FUNCTION_WRITEMULT_REGS:
+		{
+			pPdu->pPayload[3] = 1;
+			pPdu->pPayload[4] = 2;
+			pPdu->pPayload[6] = 0x2A;
+			pPdu->payloadSize = 7;
+			break;
+		}
+
+		default:
+		{
+			break;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+//
+static bool test_IsWrite(uint8_t functionCode)
+{
+	return memchr(s_pWriteFunctions, functionCode, sizeof(s_pWriteFunctions)) != NULL;
+}
+
+//------------------------------------------------------------------------------
+//
+static bool test_IsRead(uint8_t functionCode)
+{
+	return memchr(s_pReadFunctions, functionCode, sizeof(s_pReadFunctions)) != NULL;
+}
+
+//------------------------------------------------------------------------------
+// Broadcasts: the four writes are applied without response, anything else is
+// dropped without reaching a handler. Also through modbus_ProcessData().
+static void test_Broadcast(void)
+{
+	modbus_t instance;
+	const uint8_t pInstanceAddresses[2] = { TEST_BUS_ADDRESS, MODBUS_BROADCAST_ADDRESS };
+
+	for(uint16_t ctr = 0; ctr < 2; ctr++)
+	{
+		memset(&instance, 0, sizeof(instance));
+		instance.busAddress = pInstanceAddresses[ctr];
+		instance.pHandlers = &s_handlers;
+
+		for(uint16_t functionCode = 0; functionCode < 0x100; functionCode++)
+		{
+			modbus_Pdu_t request;
+			test_BuildRequest(&request, MODBUS_BROADCAST_ADDRESS, (uint8_t)functionCode);
+			modbus_PduView_t requestView = modbus_GetPduView(&request);
+			modbus_Pdu_t response;
+			modbus_PduView_t responseView = modbus_GetPduView(&response);
+
+			const uint32_t writeCount = s_writeCount;
+			const uint32_t readCount = s_readCount;
+			const uint32_t genericCount = s_genericCount;
+
+			test_Check(!modbus_ProcessView(&instance, &requestView, &responseView), "broadcast not answered");
+			test_Check(s_writeCount == (writeCount + test_IsWrite((uint8_t)functionCode)), "broadcast write applied");
+			test_Check((s_readCount == readCount) && (s_genericCount == genericCount), "broadcast read dropped");
+
+			*MODBUS_REQUEST_PDU(&instance) = request;
+			test_Check(!modbus_ProcessData(&instance), "broadcast data not answered");
+			test_Check(s_writeCount == (writeCount + (2 * test_IsWrite((uint8_t)functionCode))), "broadcast data write applied");
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Direct requests, address 0 with `noBroadcast`, and an instance at address 0
+// answering every address.
+static void test_Direct(void)
+{
+	modbus_t instance;
+	const uint8_t pRequestAddresses[4] = { MODBUS_BROADCAST_ADDRESS, 1, TEST_BUS_ADDRESS, 0xFF };
+	const uint8_t pFunctionCodes[9] =
+	{
+		MODBUS_FUNCTION_READCOILS, MODBUS_FUNCTION_READDISCRETE, MODBUS_FUNCTION_READHOLDING, MODBUS_FUNCTION_READINPUT,
+		MODBUS_FUNCTION_WRITESINGLE_COIL, MODBUS_FUNCTION_WRITESINGLE_REG, MODBUS_FUNCTION_WRITEMULT_COILS, MODBUS_FUNCTION_WRITEMULT_REGS,
+		MODBUS_FUNCTION_READ_DEVICEID
+	};
+
+	for(uint16_t config = 0; config < 4; config++)
+	{
+		const uint8_t instanceAddress = (config & 1) ? MODBUS_BROADCAST_ADDRESS : TEST_BUS_ADDRESS;
+		const bool noBroadcast = (config & 2) != 0;
+
+		memset(&instance, 0, sizeof(instance));
+		instance.busAddress = instanceAddress;
+		instance.noBroadcast = noBroadcast;
+		instance.pHandlers = &s_handlers;
+
+		for(uint16_t addressIndex = 0; addressIndex < 4; addressIndex++)
+		{
+			const uint8_t busAddress = pRequestAddresses[addressIndex];
+
+			// Broadcasts are covered above.
+			if((busAddress == MODBUS_BROADCAST_ADDRESS) && !noBroadcast)
+			{
+				continue;
+			}
+
+			const bool addressed =
+				(busAddress == MODBUS_BROADCAST_ADDRESS) ||
+				(instanceAddress == MODBUS_BROADCAST_ADDRESS) ||
+				(busAddress == instanceAddress);
+
+			for(uint16_t ctr = 0; ctr < sizeof(pFunctionCodes); ctr++)
+			{
+				const uint8_t functionCode = pFunctionCodes[ctr];
+				modbus_Pdu_t request;
+				test_BuildRequest(&request, busAddress, functionCode);
+				modbus_PduView_t requestView = modbus_GetPduView(&request);
+				modbus_Pdu_t response;
+				modbus_PduView_t responseView = modbus_GetPduView(&response);
+
+				const uint32_t writeCount = s_writeCount;
+				const uint32_t readCount = s_readCount;
+
+				const bool respond = modbus_ProcessView(&instance, &requestView, &responseView);
+				test_Check(respond == addressed, "direct answered");
+				test_Check(s_writeCount == (writeCount + (addressed && test_IsWrite(functionCode))), "direct write");
+				test_Check(s_readCount == (readCount + (addressed && test_IsRead(functionCode))), "direct read");
+
+				if(respond)
+				{
+					const bool supported = test_IsWrite(functionCode) || test_IsRead(functionCode);
+
+					test_Check(responseView.busAddress == busAddress, "response address");
+					test_Check(responseView.functionCode == (supported ? functionCode : (functionCode | 0x80)), "response function code");
+				}
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// The host fans broadcast writes out to every unit but unit 0, or, with
+// `noBroadcast`, routes address 0 to unit 0 alone.
+static void test_Host(void)
+{
+	const uint8_t pUnitAddresses[TEST_UNIT_COUNT] = { 0, 1, TEST_BUS_ADDRESS };
+
+	modbus_Host_Init(&s_host);
+	for(uint16_t ctr = 0; ctr < TEST_UNIT_COUNT; ctr++)
+	{
+		s_pUnits[ctr].pHandlers = &s_handlers;
+		s_pUnits[ctr].pContext = (void *)(uintptr_t)ctr;
+		modbus_Host_SetUnit(&s_host, pUnitAddresses[ctr], &s_pUnits[ctr]);
+	}
+
+	for(uint16_t functionCode = 0; functionCode < 0x100; functionCode++)
+	{
+		modbus_Pdu_t request;
+		test_BuildRequest(&request, MODBUS_BROADCAST_ADDRESS, (uint8_t)functionCode);
+		modbus_PduView_t requestView = modbus_GetPduView(&request);
+		modbus_Pdu_t response;
+		modbus_PduView_t responseView = modbus_GetPduView(&response);
+
+		const bool write = test_IsWrite((uint8_t)functionCode);
+		const uint32_t readCount = s_readCount;
+		const uint32_t genericCount = s_genericCount;
+		memset(s_pUnitWriteCounts, 0, sizeof(s_pUnitWriteCounts));
+
+		test_Check(!modbus_Host_ProcessView(&s_host, &requestView, &responseView), "host broadcast not answered");
+		test_Check((s_pUnitWriteCounts[0] == 0) && (s_pUnitWriteCounts[1] == write) && (s_pUnitWriteCounts[2] == write), "host broadcast units");
+		test_Check((s_readCount == readCount) && (s_genericCount == genericCount), "host broadcast read dropped");
+	}
+
+	s_host.instance.noBroadcast = true;
+
+	for(uint16_t ctr = 0; ctr < 8; ctr++)
+	{
+		const uint8_t functionCode = (ctr < 4) ? s_pWriteFunctions[ctr] : s_pReadFunctions[ctr - 4];
+		modbus_Pdu_t request;
+		test_BuildRequest(&request, MODBUS_BROADCAST_ADDRESS, functionCode);
+		modbus_PduView_t requestView = modbus_GetPduView(&request);
+		modbus_Pdu_t response;
+		modbus_PduView_t responseView = modbus_GetPduView(&response);
+
+		const bool write = test_IsWrite(functionCode);
+		const uint32_t readCount = s_readCount;
+		memset(s_pUnitWriteCounts, 0, sizeof(s_pUnitWriteCounts));
+
+		test_Check(modbus_Host_ProcessView(&s_host, &requestView, &responseView), "host unit 0 answered");
+		test_Check((responseView.busAddress == 0) && (responseView.functionCode == functionCode), "host unit 0 response");
+		test_Check((s_pUnitWriteCounts[0] == write) && (s_pUnitWriteCounts[1] == 0) && (s_pUnitWriteCounts[2] == 0), "host unit 0 alone");
+		test_Check(s_readCount == (readCount + !write), "host unit 0 read");
+	}
+
+	// Without unit 0, address 0 is an unknown unit.
+	modbus_Host_SetUnit(&s_host, 0, NULL);
+
+	modbus_Pdu_t request;
+	test_BuildRequest(&request, MODBUS_BROADCAST_ADDRESS, MODBUS_FUNCTION_WRITESINGLE_REG);
+	modbus_PduView_t requestView = modbus_GetPduView(&request);
+	modbus_Pdu_t response;
+	modbus_PduView_t responseView = modbus_GetPduView(&response);
+
+	const uint32_t writeCount = s_writeCount;
+	const uint32_t unknownUnitCount = s_host.unknownUnitCount;
+	test_Check(!modbus_Host_ProcessView(&s_host, &requestView, &responseView), "host without unit 0");
+	test_Check((s_writeCount == writeCount) && (s_host.unknownUnitCount == (unknownUnitCount + 1)), "host unit 0 unknown");
+}
+
+//------------------------------------------------------------------------------
+//
+int main(void)
+{
+	test_Broadcast();
+	test_Direct();
+	test_Host();
+
+	printf("%s: %u failures\n", (s_failCount == 0) ? "PASS" : "FAIL", (unsigned)s_failCount);
+	return (s_failCount == 0) ? 0 : 1;
+}
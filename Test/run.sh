@@ -0,0 +1,101 @@
+#!/bin/sh
+#
+# Builds and runs the tests with the host compiler, stops at the first failure.
+# Usage: Test/run.sh [additional compiler flags]
+#
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+BUILD=$(mktemp -d)
+trap 'rm -rf "$BUILD"' EXIT
+
+# The sources include <ModbusEmbedded/...>, which is the checkout itself.
+mkdir -p "$BUILD/include"
+ln -s "$ROOT" "$BUILD/include/ModbusEmbedded"
+
+CC=${CC:-cc}
+CXX=${CXX:-c++}
+CFLAGS="-std=gnu11 -O2 -Wall -I$BUILD/include $*"
+
+# Once per CRC engine.
+for ENGINE in "" "-DMODBUS_CRC_SLICING8" "-DMODBUS_CRC_CLMUL" "-DMODBUS_CRC_SLICING8 -DMODBUS_CRC_CLMUL"
+do
+	echo "== modbus_checksum ${ENGINE:-(table)}"
+	$CC $CFLAGS $ENGINE -o "$BUILD/checksum" "$ROOT/Test/modbus_checksum_test.c" "$ROOT/Src/modbus_checksum.c"
+	"$BUILD/checksum"
+done
+
+# With the SSE2 path (where available) and with the lookup tables only.
+for HEX_FLAGS in "" "-U__SSE2__"
+do
+	echo "== modbus_hex ${HEX_FLAGS:-(default)}"
+	$CC $CFLAGS $HEX_FLAGS -o "$BUILD/hex" "$ROOT/Test/modbus_hex_test.c" "$ROOT/Src/modbus_hex.c"
+	"$BUILD/hex"
+done
+
+# Slave core and framing, linked into the protocol level tests below.
+CORE="$ROOT/Src/modbus.c $ROOT/Src/modbus_Bits.c $ROOT/Src/modbus_data_frames.c $ROOT/Src/modbus_checksum.c $ROOT/Src/modbus_hex.c"
+
+echo "== modbus"
+$CC $CFLAGS -o "$BUILD/modbus" "$ROOT/Test/modbus_test.c" "$ROOT/Src/modbus_Host.c" $CORE
+"$BUILD/modbus"
+
+echo "== modbus_data_frames"
+$CC $CFLAGS -o "$BUILD/data_frames" "$ROOT/Test/modbus_data_frames_test.c" $CORE
+"$BUILD/data_frames"
+
+echo "== modbus_TcpServer"
+$CC $CFLAGS -o "$BUILD/tcp_server" "$ROOT/Test/modbus_tcp_server_test.c" "$ROOT/Src/modbus_TcpServer.c" "$ROOT/Src/modbus_Host.c" $CORE
+"$BUILD/tcp_server"
+
+echo "== modbus_TcpUring"
+$CC $CFLAGS -DMODBUS_TCP_URING -o "$BUILD/tcp_uring" "$ROOT/Test/modbus_tcp_uring_test.c" "$ROOT/Src/modbus_TcpServer.c" $CORE
+"$BUILD/tcp_uring"
+
+echo "== modbus_Planner"
+$CC $CFLAGS -o "$BUILD/planner" "$ROOT/Test/modbus_planner_test.c" "$ROOT/Src/modbus_Planner.c" "$ROOT/Src/modbus_Bits.c"
+"$BUILD/planner"
+
+echo "== modbus_Scheduler"
+$CC $CFLAGS -o "$BUILD/scheduler" "$ROOT/Test/modbus_scheduler_test.c" "$ROOT/Src/modbus_Scheduler.c"
+"$BUILD/scheduler"
+
+echo "== modbus_Ascii"
+$CC $CFLAGS -o "$BUILD/ascii" "$ROOT/Test/modbus_ascii_test.c" "$ROOT/Src/modbus_Ascii.c" "$ROOT/Src/modbus_hex.c" "$ROOT/Src/modbus_checksum.c"
+"$BUILD/ascii"
+
+echo "== modbus::RegisterMap"
+$CXX -std=c++17 -O2 -Wall -I"$BUILD/include" -o "$BUILD/register_map" "$ROOT/Test/modbus_register_map_test.cpp"
+"$BUILD/register_map"
+
+# Broken tag lists must fail the build, on the intended static_assert.
+for BROKEN in "TEST_OVERLAPPING_TAGS:register map tags overlap" "TEST_TAG_OUT_OF_RANGE:register map tag outside the address space"
+do
+	echo "== modbus::RegisterMap -D${BROKEN%%:*} must not compile"
+	if $CXX -std=c++17 -fsyntax-only -I"$BUILD/include" -D"${BROKEN%%:*}" "$ROOT/Test/modbus_register_map_test.cpp" 2>"$BUILD/broken.log"
+	then
+		echo "FAIL: compiled"
+		exit 1
+	fi
+	if ! grep -q "${BROKEN#*:}" "$BUILD/broken.log"
+	then
+		cat "$BUILD/broken.log"
+		echo "FAIL: static_assert \"${BROKEN#*:}\" did not fire"
+		exit 1
+	fi
+	echo "PASS: static_assert fired"
+done
+
+echo "== modbus::Slave<Map>"
+$CC $CFLAGS -c -o "$BUILD/modbus.o" "$ROOT/Src/modbus.c"
+$CC $CFLAGS -c -o "$BUILD/modbus_Bits.o" "$ROOT/Src/modbus_Bits.c"
+$CXX -std=c++17 -O2 -Wall -I"$BUILD/include" -o "$BUILD/slave" "$ROOT/Test/modbus_slave_test.cpp" "$BUILD/modbus.o" "$BUILD/modbus_Bits.o"
+"$BUILD/slave"
+
+echo "== modbus_Rtu"
+$CC $CFLAGS -o "$BUILD/rtu" "$ROOT/Test/modbus_rtu_test.c" "$ROOT/Src/modbus_Rtu.c" $CORE
+"$BUILD/rtu"
+
+echo "== modbus_Master"
+$CC $CFLAGS -o "$BUILD/master" "$ROOT/Test/modbus_master_test.c" "$ROOT/Src/modbus_Master.c" $CORE
+"$BUILD/master"
@@ -18,12 +18,38 @@ typedef void(* modbus_GenericFunctionCallback_t)(modbus_Pdu_t *, modbus_Pdu_t *)
 typedef modbus_Exception_e(* modbus_ReadCallback_t)(modbus_FunctionCode_e, uint16_t, uint16_t *);
 typedef modbus_Exception_e(* modbus_WriteCallback_t)(modbus_FunctionCode_e, uint16_t, uint16_t);
 
+/**
+ * Block Handler, called once per request with (functionCode, startAddress, quantity, pValues).
+ * Has to fill all `quantity` registers at once.
+ */
+typedef modbus_Exception_e(* modbus_ReadBlockCallback_t)(modbus_FunctionCode_e, uint16_t, uint16_t, uint16_t *);
+
+/**
+ * Block Handler, called once per request with (functionCode, startAddress, quantity, pBits).
+ * Has to fill `pBits` packed LSB first (bit 0 of byte 0 is `startAddress`). The buffer is
+ * zeroed beforehand and unused bits of the last byte are masked afterwards.
+ */
+typedef modbus_Exception_e(* modbus_ReadBitBlockCallback_t)(modbus_FunctionCode_e, uint16_t, uint16_t, uint8_t *);
+
+/**
+ * Block Handler, called once per request with (functionCode, startAddress, quantity, pByteBuffer).
+ * Has to fill `2 * quantity` bytes of big-endian registers straight into the response payload.
+ */
+typedef modbus_Exception_e(* modbus_ReadBytesCallback_t)(modbus_FunctionCode_e, uint16_t, uint16_t, uint8_t *);
+
+/**
+ * Block Handler, called once per request with (functionCode, startAddress, quantity, pData).
+ * `pData` points straight into the request payload (registers big-endian, coils packed LSB first),
+ * so the whole range can be checked and applied as a single commit.
+ */
+typedef modbus_Exception_e(* modbus_WriteBlockCallback_t)(modbus_FunctionCode_e, uint16_t, uint16_t, const uint8_t *);
+
+/**
+ * Callback table of a slave. Not tied to an instance, so one const table
+ * can be shared by any number of instances and host units.
+ */
 typedef struct
 {
-    uint8_t busAddress;
-    modbus_Pdu_t pduRequest;
-    modbus_Pdu_t pduResponse;
-
     modbus_GenericFunctionCallback_t pGenericFunctionHandler;
     modbus_ReadCallback_t pGenericReadHandler;
     modbus_WriteCallback_t pGenericWriteHandler;
@@ -38,6 +64,16 @@ typedef struct
     modbus_WriteCallback_t pWriteCoilHandler;				// 0x05, 0x0F
     modbus_WriteCallback_t pWriteRegisterHandler;			// 0x06, 0x10, 0x17
 
+    /**
+     * Optional Block Handlers. If set, they are used instead of
+     * the per-register Handlers above.
+     */
+    modbus_ReadBitBlockCallback_t pReadBitBlockHandler;		// 0x01, 0x02
+    modbus_ReadBlockCallback_t pReadRegisterBlockHandler;	// 0x03, 0x04
+    modbus_ReadBytesCallback_t pReadRegisterBytesHandler;	// 0x03, 0x04 (preferred over pReadRegisterBlockHandler)
+    modbus_WriteBlockCallback_t pWriteCoilBlockHandler;		// 0x0F
+    modbus_WriteBlockCallback_t pWriteRegisterBlockHandler;	// 0x10
+
     /**
      * Special Handlers for:
      * - 0x08 Diagnostics
@@ -48,23 +84,135 @@ typedef struct
      * - 0x15 Write File Record
      * - 0x16 Mask Write Register
      */
-} modbus_t;
+} modbus_Handlers_t;
 
+typedef struct
+{
+    uint8_t busAddress;										// MODBUS_BROADCAST_ADDRESS accepts requests for any address
+    bool noBroadcast;										// Unit 0 is a direct address (Modbus TCP) instead of broadcast
 
+    /**
+     * The response is built in place over the request. The union is named so
+     * plain C99 compilers accept it, access it through MODBUS_REQUEST_PDU() /
+     * MODBUS_RESPONSE_PDU().
+     */
+    union
+    {
+        modbus_Pdu_t request;
+        modbus_Pdu_t response;
+    } pdu;
 
-void modbus_ProcessData(modbus_t *pInstance);
+    const modbus_Handlers_t *pHandlers;
+} modbus_t;
 
+#define MODBUS_REQUEST_PDU(pInstance)		(&(pInstance)->pdu.request)
+#define MODBUS_RESPONSE_PDU(pInstance)		(&(pInstance)->pdu.response)
+
+
+
+/**
+ * Processes the request PDU of `pInstance` into its response PDU. Returns false if there
+ * is no response to send: requests for other bus addresses are dropped before looking at
+ * them, broadcast writes are applied without response and broadcast reads are dropped.
+ * With `noBroadcast` set, requests for address 0 are answered like direct ones.
+ */
+bool modbus_ProcessData(modbus_t *pInstance);
+
+/**
+ * Same as modbus_ProcessData(), but works on views, so requests can be processed
+ * right inside the receive buffer and responses built right inside the transmit buffer.
+ * The response view needs a capacity of at least MODBUS_PAYLOAD_SIZE, it may share
+ * its payload with the request.
+ */
+bool modbus_ProcessView(modbus_t *pInstance, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse);
+
+/**
+ * Request processing in the form of modbus_ProcessView(), for transports that serve
+ * something else than a single instance, e.g. modbus_Host_Process() with its host as context.
+ */
+typedef bool(* modbus_ProcessCallback_t)(void *, const modbus_PduView_t *, modbus_PduView_t *);
+modbus_PduView_t modbus_GetPduView(modbus_Pdu_t *pPdu);
+
+/**
+ * Turns the response into an exception response with `exceptionCode`, for a PDU or a view.
+ */
 void modbus_SetExceptionResponse(modbus_Exception_e exceptionCode, modbus_Pdu_t *pResponsePdu);
+void modbus_SetExceptionView(modbus_Exception_e exceptionCode, modbus_PduView_t *pResponsePdu);
 
 uint16_t modbus_EncodeAscii(char *pBuffer, uint16_t bufferSize, modbus_Pdu_t *pPdu);
 bool modbus_DecodeAscii(const char *pData, uint16_t dataSize, modbus_Pdu_t *pPdu);
 
+/**
+ * Hex codec used by the ASCII framing. Encoding writes `2 * dataSize` upper-case
+ * characters. Decoding accepts either case and fails on odd counts or non-hex input.
+ */
+void modbus_HexEncode(const uint8_t *pData, uint16_t dataSize, char *pBuffer);
+bool modbus_HexDecode(const char *pBuffer, uint16_t charCount, uint8_t *pData);
+int8_t modbus_HexToNibble(char value);
+
 uint16_t modbus_EncodeRtu(uint8_t *pBuffer, uint16_t bufferSize, modbus_Pdu_t *pPdu);
 bool modbus_DecodeRtu(const uint8_t *pData, uint16_t dataSize, modbus_Pdu_t *pPdu);
 
+/**
+ * Same as modbus_DecodeRtu(), but drops frames not addressed to `busAddress`
+ * (or broadcast) before looking at the rest of the frame.
+ */
+bool modbus_DecodeRtuAddressed(const uint8_t *pData, uint16_t dataSize, uint8_t busAddress, modbus_Pdu_t *pPdu);
+
+/**
+ * Zero-copy RTU framing:
+ * - modbus_DecodeRtuView() checks a received frame and points `pView` into it.
+ * - modbus_PrepareRtuView() points `pView` into a transmit buffer, leaving room for address and CRC.
+ * - modbus_EncodeRtuView() completes the frame around a view prepared that way, returns its size.
+ */
+bool modbus_DecodeRtuView(uint8_t *pData, uint16_t dataSize, modbus_PduView_t *pView);
+void modbus_PrepareRtuView(uint8_t *pBuffer, uint16_t bufferSize, modbus_PduView_t *pView);
+uint16_t modbus_EncodeRtuView(uint8_t *pBuffer, const modbus_PduView_t *pView);
+
+/**
+ * Modbus TCP framing. The unit identifier of the MBAP header is mapped to
+ * `busAddress`, there is no checksum. modbus_DecodeTcp() expects exactly one ADU.
+ */
+uint16_t modbus_EncodeTcp(uint8_t *pBuffer, uint16_t bufferSize, uint16_t transactionId, modbus_Pdu_t *pPdu);
+bool modbus_DecodeTcp(const uint8_t *pData, uint16_t dataSize, uint16_t *pTransactionId, modbus_Pdu_t *pPdu);
+
+/**
+ * Zero-copy TCP framing, same usage as the RTU view functions.
+ */
+bool modbus_DecodeTcpView(uint8_t *pData, uint16_t dataSize, uint16_t *pTransactionId, modbus_PduView_t *pView);
+void modbus_PrepareTcpView(uint8_t *pBuffer, uint16_t bufferSize, modbus_PduView_t *pView);
+uint16_t modbus_EncodeTcpView(uint8_t *pBuffer, uint16_t transactionId, const modbus_PduView_t *pView);
+
+/**
+ * Takes the next ADU out of a receive buffer holding any number of back-to-back ADUs,
+ * starting at `*pOffset`. On MODBUS_TCP_SPLIT_FRAME `pView` points into `pData` and
+ * `*pOffset` is moved behind the ADU. On MODBUS_TCP_SPLIT_INCOMPLETE the bytes from
+ * `*pOffset` on have to be kept for the next read.
+ */
+modbus_TcpSplit_e modbus_SplitTcp(uint8_t *pData, uint32_t dataSize, uint32_t *pOffset, uint16_t *pTransactionId, modbus_PduView_t *pView);
+
 uint16_t modbus_GenerateCrc(modbus_Pdu_t *pPdu);
 uint8_t modbus_GenerateLrc(modbus_Pdu_t *pPdu);
 
+/**
+ * Streaming checksums over raw bytes: Init(), Update() per chunk, Final().
+ * Running a frame through Update() including its transmitted checksum
+ * (CRC low byte first) leaves MODBUS_CRC_RESIDUE / MODBUS_LRC_RESIDUE,
+ * so a frame can be validated as soon as its last byte arrives.
+ */
+#define MODBUS_CRC_RESIDUE		0x0000
+#define MODBUS_LRC_RESIDUE		0x00
+
+uint16_t modbus_CrcInit(void);
+uint16_t modbus_CrcUpdate(uint16_t crc, const uint8_t *pData, uint32_t dataSize);
+uint16_t modbus_CrcUpdateByte(uint16_t crc, uint8_t value);
+uint16_t modbus_CrcFinal(uint16_t crc);
+
+uint8_t modbus_LrcInit(void);
+uint8_t modbus_LrcUpdate(uint8_t lrc, const uint8_t *pData, uint32_t dataSize);
+uint8_t modbus_LrcUpdateByte(uint8_t lrc, uint8_t value);
+uint8_t modbus_LrcFinal(uint8_t lrc);
+
 
 
 void modbus_AssertFailedHandler(const char *pFileName, uint32_t lineNumber);
@@ -0,0 +1,84 @@
+
+#ifndef __INCLUDE_MODBUS_ASCII_H
+#define __INCLUDE_MODBUS_ASCII_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ModbusEmbedded/modbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+#define MODBUS_ASCII_DEFAULT_TIMEOUT_MS		1000
+
+
+
+/**
+ * Character-fed ASCII frame receiver.
+ *
+ * Feed every received character with its arrival timestamp (milliseconds, free
+ * running and allowed to wrap). Hex pairs are decoded and added to the LRC as
+ * they arrive, so the frame is checked and ready as soon as LF is received.
+ * A ':' always starts a new frame, anything unexpected drops the current frame
+ * until the next ':'. Gaps longer than `timeoutMs` between characters drop the
+ * frame as well, either on the next character or in modbus_Ascii_Poll().
+ *
+ * After MODBUS_ASCII_EVENT_FRAME, the frame can be read with modbus_Ascii_GetFrame()
+ * until modbus_Ascii_ReleaseFrame() or the next modbus_Ascii_PutChar().
+ */
+typedef enum
+{
+	MODBUS_ASCII_STATE_IDLE = 0,
+	MODBUS_ASCII_STATE_RECEPTION,
+	MODBUS_ASCII_STATE_WAITEND,
+	MODBUS_ASCII_STATE_READY,
+
+	MODBUS_ASCII_STATE_LIMIT
+} modbus_Ascii_State_e;
+
+typedef enum
+{
+	MODBUS_ASCII_EVENT_NONE = 0,
+	MODBUS_ASCII_EVENT_FRAME,
+	MODBUS_ASCII_EVENT_ERROR
+} modbus_Ascii_Event_e;
+
+typedef struct
+{
+	uint32_t timeoutMs;
+
+	modbus_Ascii_State_e state;
+	uint32_t lastCharMs;
+
+	uint8_t highNibble;
+	bool highNibbleValid;
+
+	uint8_t lrc;
+	uint16_t frameSize;
+	uint8_t pFrame[MODBUS_PAYLOAD_SIZE + 3];
+
+	uint32_t frameCount;
+	uint32_t lrcErrorCount;
+	uint32_t frameErrorCount;
+} modbus_Ascii_Receiver_t;
+
+
+
+void modbus_Ascii_Init(modbus_Ascii_Receiver_t *pReceiver, uint32_t timeoutMs);
+
+modbus_Ascii_Event_e modbus_Ascii_PutChar(modbus_Ascii_Receiver_t *pReceiver, char value, uint32_t timestampMs);
+modbus_Ascii_Event_e modbus_Ascii_Poll(modbus_Ascii_Receiver_t *pReceiver, uint32_t nowMs);
+
+bool modbus_Ascii_GetFrame(modbus_Ascii_Receiver_t *pReceiver, modbus_PduView_t *pView);
+void modbus_Ascii_ReleaseFrame(modbus_Ascii_Receiver_t *pReceiver);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_MODBUS_ASCII_H */
@@ -0,0 +1,42 @@
+
+#ifndef __INCLUDE_MODBUS_BITS_H
+#define __INCLUDE_MODBUS_BITS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ModbusEmbedded/modbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/**
+ * Bitmap store for coils / discrete inputs.
+ * Bits are packed LSB first, bit 0 of `pBitmap[0]` is `startAddress`.
+ * `pBitmap` needs to hold at least (bitCount + 7) / 8 bytes.
+ */
+typedef struct
+{
+	uint16_t startAddress;
+	uint16_t bitCount;
+
+	uint8_t *pBitmap;
+} modbus_Bits_t;
+
+
+
+modbus_Exception_e modbus_Bits_Read(const modbus_Bits_t *pBits, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer);
+modbus_Exception_e modbus_Bits_Write(const modbus_Bits_t *pBits, uint16_t startAddress, uint16_t quantity, const uint8_t *pByteBuffer);
+
+modbus_Exception_e modbus_Bits_ReadBit(const modbus_Bits_t *pBits, uint16_t address, uint16_t *pValue);
+modbus_Exception_e modbus_Bits_WriteBit(const modbus_Bits_t *pBits, uint16_t address, uint16_t value);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_MODBUS_BITS_H */
@@ -21,6 +21,21 @@ typedef enum
 	MODBUS_BUFFER_ACCESS_LIMIT
 } modbus_Buffer_Access_e;
 
+/**
+ * NATIVE: `pDataBuffer` holds the value in host (little-endian) layout,
+ *         e.g. a pointer to a `float` variable.
+ * WIRE:   `pDataBuffer` holds the registers in Modbus wire order (big-endian,
+ *         first register first), so range access is a plain copy.
+ *         Use the typed accessors below to read/write native values.
+ */
+typedef enum
+{
+	MODBUS_BUFFER_BYTEORDER_NATIVE = 0,
+	MODBUS_BUFFER_BYTEORDER_WIRE,
+
+	MODBUS_BUFFER_BYTEORDER_LIMIT
+} modbus_Buffer_ByteOrder_e;
+
 typedef struct
 {
 	uint16_t startAddress;
@@ -28,19 +43,56 @@ typedef struct
 
 	uint8_t *pDataBuffer;
 	uint32_t dataSizeBytes;
+
+	modbus_Buffer_ByteOrder_e byteOrder;
 } modbus_Buffer_Datapoint_t;
 
+/**
+ * `pIndex` is optional. If set, it holds `arraySize` indices into `pArray`,
+ * sorted by `startAddress` (see modbus_Buffer_BuildIndex()), and lookups use
+ * binary search instead of a linear scan. It may live in ROM.
+ */
 typedef struct
 {
 	const modbus_Buffer_Datapoint_t *pArray;
 	const uint32_t arraySize;
+	const uint16_t *pIndex;
 } modbus_Buffer_t;
 
 
 
+bool modbus_Buffer_BuildIndex(const modbus_Buffer_Datapoint_t *pArray, uint32_t arraySize, uint16_t *pIndex);
+
 modbus_Exception_e modbus_Buffer_ReadRegister(const modbus_Buffer_t *pBuffer, uint16_t registerAddress, uint16_t *pRegisterBuffer);
 modbus_Exception_e modbus_Buffer_WriteRegister(const modbus_Buffer_t *pBuffer, uint16_t registerAddress, uint16_t registerValue);
 
+/**
+ * Range access, resolving the start address once and walking forward across datapoints.
+ * modbus_Buffer_WriteRange() takes big-endian register bytes (request payload layout)
+ * and checks the whole range before writing anything.
+ */
+modbus_Exception_e modbus_Buffer_ReadRange(const modbus_Buffer_t *pBuffer, uint16_t startAddress, uint16_t quantity, uint16_t *pRegisterBuffer);
+modbus_Exception_e modbus_Buffer_WriteRange(const modbus_Buffer_t *pBuffer, uint16_t startAddress, uint16_t quantity, const uint8_t *pByteBuffer);
+
+/**
+ * Same as modbus_Buffer_ReadRange(), but fills big-endian register bytes (response payload layout).
+ */
+modbus_Exception_e modbus_Buffer_ReadRangeBytes(const modbus_Buffer_t *pBuffer, uint16_t startAddress, uint16_t quantity, uint8_t *pByteBuffer);
+
+/**
+ * Typed access to a datapoint's value, converting from/to its byte order.
+ * `valueSize` has to match `dataSizeBytes`.
+ */
+bool modbus_Buffer_GetValue(const modbus_Buffer_Datapoint_t *pDatapoint, void *pValue, uint32_t valueSize);
+bool modbus_Buffer_SetValue(const modbus_Buffer_Datapoint_t *pDatapoint, const void *pValue, uint32_t valueSize);
+
+bool modbus_Buffer_GetFloat(const modbus_Buffer_Datapoint_t *pDatapoint, float *pValue);
+bool modbus_Buffer_SetFloat(const modbus_Buffer_Datapoint_t *pDatapoint, float value);
+bool modbus_Buffer_GetInt32(const modbus_Buffer_Datapoint_t *pDatapoint, int32_t *pValue);
+bool modbus_Buffer_SetInt32(const modbus_Buffer_Datapoint_t *pDatapoint, int32_t value);
+bool modbus_Buffer_GetUint32(const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t *pValue);
+bool modbus_Buffer_SetUint32(const modbus_Buffer_Datapoint_t *pDatapoint, uint32_t value);
+
 
 
 #ifdef __cplusplus
@@ -14,17 +14,54 @@ extern "C" {
 #define MODBUS_PDU_SIZE         253
 #define MODBUS_PAYLOAD_SIZE     (MODBUS_PDU_SIZE)
 
+#define MODBUS_RTU_FRAME_SIZE   (MODBUS_PAYLOAD_SIZE + 4)
 
+#define MODBUS_TCP_HEADER_SIZE  7
+#define MODBUS_TCP_FRAME_SIZE   (MODBUS_PAYLOAD_SIZE + MODBUS_TCP_HEADER_SIZE + 1)
+#define MODBUS_TCP_PROTOCOL_ID  0
 
+#define MODBUS_BROADCAST_ADDRESS    0
+
+
+
+/**
+ * Packed to 258 bytes, the function code is kept as a byte (modbus_FunctionCode_e,
+ * with 0x80 set for exception responses).
+ */
 typedef struct
 {
     uint8_t busAddress;
-    modbus_FunctionCode_e functionCode;
+    uint8_t functionCode;
+    uint16_t payloadSize;
 
     uint8_t pPayload[MODBUS_PAYLOAD_SIZE];
-    uint16_t payloadSize;
 } modbus_Pdu_t;
 
+/**
+ * PDU that lives in an external buffer, e.g. directly inside a received or
+ * to-be-sent frame. `pPayload` points behind the function code and
+ * `payloadCapacity` is the space available there.
+ */
+typedef struct
+{
+    uint8_t busAddress;
+    modbus_FunctionCode_e functionCode;
+
+    uint8_t *pPayload;
+    uint16_t payloadSize;
+    uint16_t payloadCapacity;
+} modbus_PduView_t;
+
+/**
+ * Result of splitting a TCP receive buffer into ADUs.
+ */
+typedef enum
+{
+    MODBUS_TCP_SPLIT_FRAME,         /**< Complete ADU found, offset moved behind it. */
+    MODBUS_TCP_SPLIT_INCOMPLETE,    /**< Remaining bytes are only part of an ADU, wait for more data. */
+    MODBUS_TCP_SPLIT_ERROR          /**< Invalid MBAP header, stream cannot be resynchronized. */
+} modbus_TcpSplit_e;
+
 
 
 #ifdef __cplusplus
@@ -46,6 +46,7 @@ typedef enum
 
 #define MODBUS_WRITE_BIT_MAX_QUANTITY		0x07B0
 #define MODBUS_WRITE_REGISTER_MAX_QUANTITY	0x007B
+#define MODBUS_RW_WRITE_REGISTER_MAX_QUANTITY	0x0079
 
 #define MODBUS_BIT_ON						0xFF00
 #define MODBUS_BIT_OFF						0x0000
@@ -0,0 +1,85 @@
+
+#ifndef __INCLUDE_MODBUS_HOST_H
+#define __INCLUDE_MODBUS_HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ModbusEmbedded/modbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+#define MODBUS_HOST_UNIT_COUNT		256
+
+/**
+ * One virtual slave. Units are owned by the caller and can share one
+ * const handler table, `pContext` tells them apart inside the callbacks
+ * (see modbus_Host_GetActiveUnit()).
+ */
+typedef struct
+{
+	const modbus_Handlers_t *pHandlers;
+	void *pContext;
+} modbus_Host_Unit_t;
+
+/**
+ * Serves any number of virtual slaves behind one bus or connection.
+ * Requests are routed by bus address through a direct table, and all units
+ * share the request / response PDUs of `instance`.
+ */
+typedef struct
+{
+	modbus_t instance;
+	modbus_Host_Unit_t *ppUnits[MODBUS_HOST_UNIT_COUNT];
+	const modbus_Host_Unit_t *pActiveUnit;
+
+	bool gatewayExceptions;						/**< Answer unknown units with GATEWAY DEVICE FAILED TO RESPOND instead of staying silent. */
+
+	uint32_t requestCount;
+	uint32_t unknownUnitCount;
+} modbus_Host_t;
+
+
+
+void modbus_Host_Init(modbus_Host_t *pHost);
+
+/**
+ * Puts `pUnit` at `busAddress`, NULL removes the unit.
+ * A unit at address 0 is only reachable with `instance.noBroadcast` set (Modbus TCP),
+ * otherwise address 0 is the broadcast address.
+ */
+void modbus_Host_SetUnit(modbus_Host_t *pHost, uint8_t busAddress, modbus_Host_Unit_t *pUnit);
+
+/**
+ * Same as modbus_ProcessView(), for the unit at the bus address of the request.
+ * Broadcast writes are applied by every unit, unless `instance.noBroadcast` is set,
+ * then unit 0 is addressed like any other. Returns false if there is no response to send.
+ */
+bool modbus_Host_ProcessView(modbus_Host_t *pHost, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse);
+
+/**
+ * modbus_Host_ProcessView() as modbus_ProcessCallback_t, `pContext` is the modbus_Host_t.
+ * Lets the TCP servers serve a host, see their `pProcessHandler`.
+ */
+bool modbus_Host_Process(void *pContext, const modbus_PduView_t *pRequest, modbus_PduView_t *pResponse);
+
+/**
+ * Same as modbus_ProcessData(), on the PDUs of `pHost->instance`.
+ */
+bool modbus_Host_ProcessData(modbus_Host_t *pHost);
+
+/**
+ * Returns the unit whose request is being processed, for use inside the callbacks.
+ */
+const modbus_Host_Unit_t *modbus_Host_GetActiveUnit(const modbus_Host_t *pHost);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_MODBUS_HOST_H */
@@ -0,0 +1,170 @@
+
+#ifndef __INCLUDE_MODBUS_MASTER_H
+#define __INCLUDE_MODBUS_MASTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ModbusEmbedded/modbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+typedef enum
+{
+	MODBUS_MASTER_RESULT_PENDING = 0,
+	MODBUS_MASTER_RESULT_SUCCESS,
+	MODBUS_MASTER_RESULT_EXCEPTION,			/**< Device answered with `exception`. */
+	MODBUS_MASTER_RESULT_INVALIDRESPONSE,	/**< Response does not fit the request. */
+	MODBUS_MASTER_RESULT_TIMEOUT
+} modbus_Master_Result_e;
+
+/**
+ * One request, owned by the caller and referenced by the master while it is in flight.
+ *
+ * `pData` by function code:
+ * - 0x01, 0x02: receives `quantity` bits, packed LSB first.
+ * - 0x03, 0x04: receives `quantity` registers.
+ * - 0x05, 0x06: one uint16_t value to write (0x05: non-zero switches the coil on).
+ * - 0x0F: `quantity` bits to write, packed LSB first.
+ * - 0x10: `quantity` registers to write.
+ * - 0x17: receives `quantity` registers, `pWriteData` holds `writeQuantity` registers to write.
+ */
+typedef struct
+{
+	uint8_t busAddress;
+	modbus_FunctionCode_e functionCode;
+	uint16_t startAddress;
+	uint16_t quantity;
+	void *pData;
+
+	uint16_t writeStartAddress;
+	uint16_t writeQuantity;
+	const uint16_t *pWriteData;
+
+	void *pContext;
+	uint8_t maxRetries;
+
+	// Set by the master.
+	uint8_t retryCount;						/**< Kept while a request handed back by modbus_Master_Expire() is sent again. */
+	bool resend;							/**< Set by modbus_Master_Expire() on a request to send again, cleared once encoded. */
+	uint16_t transactionId;
+	uint32_t sequence;
+	uint32_t sentMs;
+	modbus_Master_Result_e result;
+	modbus_Exception_e exception;
+} modbus_Master_Request_t;
+
+#define MODBUS_MASTER_UNIT_COUNT			256
+#define MODBUS_MASTER_MAX_BACKOFF_SHIFT		6
+
+/**
+ * Response time of one unit, estimated like the TCP retransmission timer
+ * (RFC 6298): timeout = SRTT + 4 * RTTVAR, doubled on each retry.
+ * A unit whose requests fail in a row is backed off exponentially, so it does
+ * not hold up the others.
+ */
+typedef struct
+{
+	uint32_t srttMs8;						/**< Smoothed response time, times 8. */
+	uint32_t rttvarMs4;						/**< Mean deviation, times 4. */
+	uint32_t timeoutMs;
+	uint32_t sampleCount;
+
+	uint32_t lastRttMs;
+	uint32_t minRttMs;
+	uint32_t maxRttMs;
+
+	uint32_t timeoutCount;
+	uint32_t retryCount;
+	uint8_t failCount;						/**< Requests failed in a row. */
+	uint32_t backoffUntilMs;
+} modbus_Master_Unit_t;
+
+/**
+ * Transaction table of one connection (TCP) or bus (RTU).
+ * `ppSlots` is supplied by the caller, its size is the number of requests
+ * that can be in flight at the same time.
+ */
+typedef struct
+{
+	modbus_Master_Request_t **ppSlots;
+	uint16_t slotCount;
+	uint16_t inFlightCount;
+
+	uint16_t nextTransactionId;
+	uint32_t nextSequence;
+
+	modbus_Master_Unit_t *pUnits;
+	uint32_t minTimeoutMs;
+	uint32_t maxTimeoutMs;
+
+	uint32_t requestCount;
+	uint32_t timeoutCount;
+	uint32_t unmatchedCount;
+} modbus_Master_t;
+
+
+
+/**
+ * Request PDU / response parsing, independent of the transaction table.
+ * modbus_Master_ParseResponse() writes read data straight into `pData` and sets
+ * `result` and `exception` of the request.
+ */
+bool modbus_Master_BuildRequest(const modbus_Master_Request_t *pRequest, modbus_PduView_t *pView);
+modbus_Master_Result_e modbus_Master_ParseResponse(modbus_Master_Request_t *pRequest, const modbus_PduView_t *pResponse);
+
+void modbus_Master_Init(modbus_Master_t *pMaster, modbus_Master_Request_t **ppSlots, uint16_t slotCount);
+
+/**
+ * Enables adaptive timeouts. `pUnits` holds MODBUS_MASTER_UNIT_COUNT entries,
+ * indexed by bus address. Timeouts start at `maxTimeoutMs` and follow the
+ * measured response times within `minTimeoutMs` and `maxTimeoutMs`.
+ */
+void modbus_Master_SetUnits(modbus_Master_t *pMaster, modbus_Master_Unit_t *pUnits, uint32_t minTimeoutMs, uint32_t maxTimeoutMs);
+
+/**
+ * Returns false while the unit is backed off. Skip its requests instead of
+ * sending them, once the backoff expired the next request probes the unit.
+ */
+bool modbus_Master_IsUnitReady(const modbus_Master_t *pMaster, uint8_t busAddress, uint32_t nowMs);
+
+/**
+ * Encode `pRequest` into `pBuffer` and put it in flight. Returns the frame size,
+ * 0 if the request is invalid, the buffer too small or no slot is free.
+ * Several requests can be encoded back-to-back and sent with one write.
+ * RTU broadcasts are completed right away, as they get no response, and only
+ * accepted for writes.
+ */
+uint16_t modbus_Master_EncodeTcp(modbus_Master_t *pMaster, modbus_Master_Request_t *pRequest, uint8_t *pBuffer, uint16_t bufferSize, uint32_t nowMs);
+uint16_t modbus_Master_EncodeRtu(modbus_Master_t *pMaster, modbus_Master_Request_t *pRequest, uint8_t *pBuffer, uint16_t bufferSize, uint32_t nowMs);
+
+/**
+ * Match a received response to its request, by transaction ID (TCP) or as
+ * the oldest request in flight (RTU), and parse it. The response time feeds
+ * the estimator of the unit, unless the request was retried.
+ * Returns the completed request, NULL if nothing matched.
+ */
+modbus_Master_Request_t *modbus_Master_MatchTcp(modbus_Master_t *pMaster, uint16_t transactionId, const modbus_PduView_t *pResponse, uint32_t nowMs);
+modbus_Master_Request_t *modbus_Master_MatchRtu(modbus_Master_t *pMaster, const modbus_PduView_t *pResponse, uint32_t nowMs);
+
+/**
+ * Returns one request in flight for longer than its timeout, NULL if there is none.
+ * The timeout is the one of the unit with modbus_Master_SetUnits(), `timeoutMs` otherwise.
+ *
+ * A request with retries left, whose unit is not backed off, is returned still
+ * pending with `resend` set and `retryCount` incremented: encode and send it again.
+ * Encoding a request without `resend` starts a new transaction with `retryCount` 0.
+ * Otherwise it is completed with MODBUS_MASTER_RESULT_TIMEOUT.
+ */
+modbus_Master_Request_t *modbus_Master_Expire(modbus_Master_t *pMaster, uint32_t nowMs, uint32_t timeoutMs);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_MODBUS_MASTER_H */
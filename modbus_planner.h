@@ -0,0 +1,99 @@
+
+#ifndef __INCLUDE_MODBUS_PLANNER_H
+#define __INCLUDE_MODBUS_PLANNER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ModbusEmbedded/modbus_master.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/**
+ * Address range of one unit and read function code (0x01 - 0x04).
+ */
+typedef struct
+{
+	uint8_t busAddress;
+	modbus_FunctionCode_e functionCode;
+	uint16_t startAddress;
+	uint16_t quantity;
+} modbus_Planner_Range_t;
+
+/**
+ * Data wanted by one consumer. `pData` receives `range.quantity` registers,
+ * or bits packed LSB first, once the request it was planned into completed.
+ */
+typedef struct
+{
+	modbus_Planner_Range_t range;
+	void *pData;
+
+	// Set by the planner.
+	uint16_t requestIndex;
+	modbus_Master_Result_e result;
+	modbus_Exception_e exception;
+} modbus_Planner_Item_t;
+
+/**
+ * Merges the items into as few read requests as possible.
+ *
+ * Items of the same unit and function code are merged as long as the request
+ * stays within the maximum quantity, the space between them is at most `maxGap`
+ * registers / bits and that space does not touch one of the `pHoles`.
+ * A merged request failing with ILLEGAL DATA ADDRESS adds a hole spanning its gaps
+ * to `pHoles` (while `holeCount < maxHoles`) and sets `replan`, so the next
+ * modbus_Planner_Build() does not read across them again.
+ *
+ * All memory is supplied by the caller:
+ * - `pOrder` holds `itemCount` indices, used to sort the items.
+ * - `pRequests` receives the planned requests, send them through modbus_Master_t.
+ *   Each of them gets `maxRetries`.
+ * - `pBuffer` holds the data of all requests, `bufferSize` counts uint16_t.
+ */
+typedef struct
+{
+	modbus_Planner_Item_t *pItems;
+	uint16_t itemCount;
+	uint16_t *pOrder;
+
+	modbus_Planner_Range_t *pHoles;
+	uint16_t holeCount;
+	uint16_t maxHoles;
+
+	uint16_t maxGap;
+
+	modbus_Master_Request_t *pRequests;
+	uint16_t maxRequests;
+	uint16_t requestCount;
+	uint8_t maxRetries;
+
+	uint16_t *pBuffer;
+	uint32_t bufferSize;
+
+	bool replan;
+} modbus_Planner_t;
+
+
+
+/**
+ * Plans the requests. Fails if an item is invalid or larger than one request,
+ * or if `pRequests` / `pBuffer` are too small.
+ */
+bool modbus_Planner_Build(modbus_Planner_t *pPlanner);
+
+/**
+ * Hands the result of a completed request (one of `pRequests`) to its items.
+ */
+void modbus_Planner_Scatter(modbus_Planner_t *pPlanner, const modbus_Master_Request_t *pRequest);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_MODBUS_PLANNER_H */
@@ -0,0 +1,407 @@
+
+#ifndef __INCLUDE_MODBUS_REGISTER_MAP_HPP
+#define __INCLUDE_MODBUS_REGISTER_MAP_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+#include <array>
+#include <iterator>
+#include <ModbusEmbedded/modbus.h>
+
+/**
+ * Register map compiled at build time (C++17).
+ *
+ *     inline constexpr modbus::Tag kTags[] =
+ *     {
+ *         { 100, modbus::Type::Float32, modbus::Access::Read },
+ *         { 102, modbus::Type::Uint16, modbus::Access::ReadWrite },
+ *         { 200, modbus::Type::Int32, modbus::Access::ReadWrite, modbus::WordOrder::LowFirst },
+ *     };
+ *
+ *     modbus::RegisterMap<kTags> holding;
+ *     holding.set<100>(21.5f);
+ *
+ * Overlapping tags and tags outside the address space fail the build.
+ * The lookup table maps every address between the first and the last tag
+ * straight to its register, it is constexpr and lives in ROM, nothing is set
+ * up at runtime. It takes 4 bytes per address of that span, so keep tags of
+ * one map close together. The map can be used as a table of modbus::Slave<Map>.
+ */
+namespace modbus
+{
+
+
+
+enum class Type : uint8_t
+{
+	Uint16,
+	Int16,
+	Uint32,
+	Int32,
+	Float32,
+	Uint64,
+	Int64,
+	Float64
+};
+
+/**
+ * Order of the registers of multi-register values, the bytes of each
+ * register are always big-endian.
+ */
+enum class WordOrder : uint8_t
+{
+	HighFirst,
+	LowFirst
+};
+
+enum class Access : uint8_t
+{
+	Read = 1,
+	Write = 2,
+	ReadWrite = 3
+};
+
+struct Tag
+{
+	uint16_t address;
+	Type type;
+	Access access = Access::ReadWrite;
+	WordOrder wordOrder = WordOrder::HighFirst;
+};
+
+
+
+namespace detail
+{
+
+constexpr uint32_t GetRegisterCount(Type type)
+{
+	switch(type)
+	{
+		case Type::Uint16:
+		case Type::Int16:
+		{
+			return 1;
+		}
+
+		case Type::Uint32:
+		case Type::Int32:
+		case Type::Float32:
+		{
+			return 2;
+		}
+
+		default:
+		{
+			return 4;
+		}
+	}
+}
+
+template<Type T> struct ValueType;
+template<> struct ValueType<Type::Uint16> { using type = uint16_t; };
+template<> struct ValueType<Type::Int16> { using type = int16_t; };
+template<> struct ValueType<Type::Uint32> { using type = uint32_t; };
+template<> struct ValueType<Type::Int32> { using type = int32_t; };
+template<> struct ValueType<Type::Float32> { using type = float; };
+template<> struct ValueType<Type::Uint64> { using type = uint64_t; };
+template<> struct ValueType<Type::Int64> { using type = int64_t; };
+template<> struct ValueType<Type::Float64> { using type = double; };
+
+template<typename List>
+constexpr bool AreInRange(const List &tags)
+{
+	for(size_t ctr = 0; ctr < std::size(tags); ctr++)
+	{
+		if((tags[ctr].address + GetRegisterCount(tags[ctr].type)) > 0x10000)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+template<typename List>
+constexpr bool AreDisjoint(const List &tags)
+{
+	for(size_t first = 0; first < std::size(tags); first++)
+	{
+		for(size_t second = first + 1; second < std::size(tags); second++)
+		{
+			const uint32_t firstEnd = tags[first].address + GetRegisterCount(tags[first].type);
+			const uint32_t secondEnd = tags[second].address + GetRegisterCount(tags[second].type);
+
+			if((tags[first].address < secondEnd) && (tags[second].address < firstEnd))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+template<typename List>
+constexpr uint32_t GetFirstAddress(const List &tags)
+{
+	uint32_t address = 0xFFFF;
+	for(size_t ctr = 0; ctr < std::size(tags); ctr++)
+	{
+		address = (tags[ctr].address < address) ? tags[ctr].address : address;
+	}
+
+	return address;
+}
+
+template<typename List>
+constexpr uint32_t GetEndAddress(const List &tags)
+{
+	uint32_t address = 0;
+	for(size_t ctr = 0; ctr < std::size(tags); ctr++)
+	{
+		const uint32_t end = tags[ctr].address + GetRegisterCount(tags[ctr].type);
+		address = (end > address) ? end : address;
+	}
+
+	return address;
+}
+
+/**
+ * Registers are stored in address order without the holes, so the registers
+ * of a tag start behind those of all tags at lower addresses.
+ */
+template<typename List>
+constexpr uint32_t GetSlot(const List &tags, size_t index)
+{
+	uint32_t slot = 0;
+	for(size_t ctr = 0; ctr < std::size(tags); ctr++)
+	{
+		if(tags[ctr].address < tags[index].address)
+		{
+			slot += GetRegisterCount(tags[ctr].type);
+		}
+	}
+
+	return slot;
+}
+
+template<typename List>
+constexpr uint32_t GetEndSlot(const List &tags)
+{
+	uint32_t slot = 0;
+	for(size_t ctr = 0; ctr < std::size(tags); ctr++)
+	{
+		slot += GetRegisterCount(tags[ctr].type);
+	}
+
+	return slot;
+}
+
+template<typename List>
+constexpr size_t FindTag(const List &tags, uint16_t address)
+{
+	for(size_t ctr = 0; ctr < std::size(tags); ctr++)
+	{
+		if(tags[ctr].address == address)
+		{
+			return ctr;
+		}
+	}
+
+	return std::size(tags);
+}
+
+} // namespace detail
+
+
+
+template<const auto &Tags>
+class RegisterMap
+{
+	static constexpr size_t tagCount = std::size(Tags);
+
+	static_assert(tagCount > 0, "register map without tags");
+	static_assert(detail::AreInRange(Tags), "register map tag outside the address space");
+	static_assert(detail::AreDisjoint(Tags), "register map tags overlap");
+
+public:
+	static constexpr uint16_t firstAddress = (uint16_t)detail::GetFirstAddress(Tags);
+	static constexpr uint32_t span = detail::GetEndAddress(Tags) - firstAddress;
+	static constexpr uint32_t registerCount = detail::GetEndSlot(Tags);
+
+	// Slot UINT16_MAX marks the holes, it must not be a register.
+	static_assert(registerCount < 0x10000, "register map covers the whole address space");
+
+	/**
+	 * Lookup table entry of one address, `slot` is UINT16_MAX for holes.
+	 */
+	struct Entry
+	{
+		uint16_t slot;
+		uint8_t access;
+	};
+
+	static constexpr std::array<Entry, span> table = []()
+	{
+		std::array<Entry, span> entries {};
+		for(uint32_t ctr = 0; ctr < span; ctr++)
+		{
+			entries[ctr] = Entry { UINT16_MAX, 0 };
+		}
+
+		for(size_t tag = 0; tag < tagCount; tag++)
+		{
+			const uint32_t slot = detail::GetSlot(Tags, tag);
+			for(uint32_t ctr = 0; ctr < detail::GetRegisterCount(Tags[tag].type); ctr++)
+			{
+				entries[Tags[tag].address - firstAddress + ctr] = Entry { (uint16_t)(slot + ctr), (uint8_t)Tags[tag].access };
+			}
+		}
+
+		return entries;
+	}();
+
+	/**
+	 * Fills `2 * quantity` bytes of big-endian registers.
+	 */
+	modbus_Exception_e readBytes(uint16_t startAddress, uint16_t quantity, uint8_t *pBytes) const
+	{
+		if(!IsAccessible(startAddress, quantity, Access::Read))
+		{
+			return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+		}
+
+		for(uint16_t ctr = 0; ctr < quantity; ctr++)
+		{
+			const uint16_t value = m_registers[table[startAddress - firstAddress + ctr].slot];
+			pBytes[2 * ctr] = (uint8_t)(value >> 8);
+			pBytes[2 * ctr + 1] = (uint8_t)value;
+		}
+
+		return MODBUS_EXCEPTION_SUCCESS;
+	}
+
+	/**
+	 * Takes big-endian register bytes, checks the whole range before writing anything.
+	 */
+	modbus_Exception_e writeBytes(uint16_t startAddress, uint16_t quantity, const uint8_t *pBytes)
+	{
+		if(!IsAccessible(startAddress, quantity, Access::Write))
+		{
+			return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+		}
+
+		for(uint16_t ctr = 0; ctr < quantity; ctr++)
+		{
+			m_registers[table[startAddress - firstAddress + ctr].slot] = (uint16_t)((pBytes[2 * ctr] << 8) | pBytes[2 * ctr + 1]);
+		}
+
+		return MODBUS_EXCEPTION_SUCCESS;
+	}
+
+	/**
+	 * Typed access to the tag at `Address`, converting from / to its word order.
+	 */
+	template<uint16_t Address>
+	auto get() const
+	{
+		constexpr size_t index = detail::FindTag(Tags, Address);
+		static_assert(index < tagCount, "no tag at this address");
+
+		using Value = typename detail::ValueType<Tags[index].type>::type;
+		constexpr uint32_t count = detail::GetRegisterCount(Tags[index].type);
+		constexpr uint32_t slot = detail::GetSlot(Tags, index);
+
+		uint64_t bits = 0;
+		for(uint32_t ctr = 0; ctr < count; ctr++)
+		{
+			const uint32_t word = (Tags[index].wordOrder == WordOrder::HighFirst) ? ctr : (count - 1 - ctr);
+			bits = (bits << 16) | m_registers[slot + word];
+		}
+
+		Value value;
+		if constexpr(sizeof(Value) == 2)
+		{
+			const uint16_t narrow = (uint16_t)bits;
+			memcpy(&value, &narrow, sizeof(value));
+		}
+		else if constexpr(sizeof(Value) == 4)
+		{
+			const uint32_t narrow = (uint32_t)bits;
+			memcpy(&value, &narrow, sizeof(value));
+		}
+		else
+		{
+			memcpy(&value, &bits, sizeof(value));
+		}
+
+		return value;
+	}
+
+	template<uint16_t Address, typename Value>
+	void set(Value value)
+	{
+		constexpr size_t index = detail::FindTag(Tags, Address);
+		static_assert(index < tagCount, "no tag at this address");
+
+		using Stored = typename detail::ValueType<Tags[index].type>::type;
+		constexpr uint32_t count = detail::GetRegisterCount(Tags[index].type);
+		constexpr uint32_t slot = detail::GetSlot(Tags, index);
+
+		const Stored stored = (Stored)value;
+		uint64_t bits = 0;
+		if constexpr(sizeof(Stored) == 2)
+		{
+			uint16_t narrow;
+			memcpy(&narrow, &stored, sizeof(narrow));
+			bits = narrow;
+		}
+		else if constexpr(sizeof(Stored) == 4)
+		{
+			uint32_t narrow;
+			memcpy(&narrow, &stored, sizeof(narrow));
+			bits = narrow;
+		}
+		else
+		{
+			memcpy(&bits, &stored, sizeof(bits));
+		}
+
+		for(uint32_t ctr = 0; ctr < count; ctr++)
+		{
+			const uint32_t word = (Tags[index].wordOrder == WordOrder::HighFirst) ? (count - 1 - ctr) : ctr;
+			m_registers[slot + word] = (uint16_t)bits;
+			bits >>= 16;
+		}
+	}
+
+private:
+	uint16_t m_registers[registerCount] {};
+
+	static bool IsAccessible(uint16_t startAddress, uint16_t quantity, Access access)
+	{
+		if((startAddress < firstAddress) || (((uint32_t)startAddress + quantity) > (firstAddress + span)))
+		{
+			return false;
+		}
+
+		for(uint16_t ctr = 0; ctr < quantity; ctr++)
+		{
+			const Entry &entry = table[startAddress - firstAddress + ctr];
+			if((entry.slot == UINT16_MAX) || ((entry.access & (uint8_t)access) == 0))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+
+
+
+} // namespace modbus
+
+#endif /* __INCLUDE_MODBUS_REGISTER_MAP_HPP */
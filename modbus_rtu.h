@@ -0,0 +1,84 @@
+
+#ifndef __INCLUDE_MODBUS_RTU_H
+#define __INCLUDE_MODBUS_RTU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ModbusEmbedded/modbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/**
+ * Byte-fed RTU frame receiver.
+ *
+ * Feed every received byte with the timestamp of its arrival (end of character,
+ * in microseconds, free running and allowed to wrap). Frames end after t3.5 of
+ * silence, which is detected either by the next byte or by modbus_Rtu_Poll(),
+ * e.g. from a timer armed for `t35Us` after the last byte.
+ * A gap longer than t1.5 inside a frame marks it broken, it is dropped once the
+ * bus has been silent for t3.5 again.
+ *
+ * After MODBUS_RTU_EVENT_FRAME, the frame can be read with modbus_Rtu_GetFrame()
+ * until modbus_Rtu_ReleaseFrame() or the next modbus_Rtu_PutByte().
+ */
+typedef enum
+{
+	MODBUS_RTU_STATE_INIT = 0,
+	MODBUS_RTU_STATE_IDLE,
+	MODBUS_RTU_STATE_RECEPTION,
+	MODBUS_RTU_STATE_READY,
+
+	MODBUS_RTU_STATE_LIMIT
+} modbus_Rtu_State_e;
+
+typedef enum
+{
+	MODBUS_RTU_EVENT_NONE = 0,
+	MODBUS_RTU_EVENT_FRAME,
+	MODBUS_RTU_EVENT_ERROR
+} modbus_Rtu_Event_e;
+
+typedef struct
+{
+	uint32_t charTimeUs;
+	uint32_t t15Us;
+	uint32_t t35Us;
+
+	modbus_Rtu_State_e state;
+	uint32_t lastByteUs;
+	bool frameError;
+
+	bool pendingValid;
+	uint8_t pendingByte;
+	uint32_t pendingByteUs;
+
+	uint16_t crc;
+	uint16_t frameSize;
+	uint8_t pFrame[MODBUS_RTU_FRAME_SIZE];
+
+	uint32_t frameCount;
+	uint32_t crcErrorCount;
+	uint32_t frameErrorCount;
+} modbus_Rtu_Receiver_t;
+
+
+
+void modbus_Rtu_Init(modbus_Rtu_Receiver_t *pReceiver, uint32_t baudRate, uint32_t nowUs);
+
+modbus_Rtu_Event_e modbus_Rtu_PutByte(modbus_Rtu_Receiver_t *pReceiver, uint8_t value, uint32_t timestampUs);
+modbus_Rtu_Event_e modbus_Rtu_Poll(modbus_Rtu_Receiver_t *pReceiver, uint32_t nowUs);
+
+bool modbus_Rtu_GetFrame(modbus_Rtu_Receiver_t *pReceiver, modbus_PduView_t *pView);
+void modbus_Rtu_ReleaseFrame(modbus_Rtu_Receiver_t *pReceiver);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_MODBUS_RTU_H */
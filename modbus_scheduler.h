@@ -0,0 +1,128 @@
+
+#ifndef __INCLUDE_MODBUS_SCHEDULER_H
+#define __INCLUDE_MODBUS_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ModbusEmbedded/modbus_master.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+typedef enum
+{
+	MODBUS_SCHEDULER_STATE_IDLE = 0,
+	MODBUS_SCHEDULER_STATE_SCHEDULED,	/**< Waiting in the timer heap. */
+	MODBUS_SCHEDULER_STATE_URGENT,		/**< Waiting in the urgent queue. */
+	MODBUS_SCHEDULER_STATE_RUNNING		/**< Handed out by modbus_Scheduler_Next(), not completed yet. */
+} modbus_Scheduler_State_e;
+
+/**
+ * One poll (or write) of one device, owned by the caller.
+ * `pRequest->pContext` can point back to the task, to find it again when the
+ * master completes the request.
+ */
+typedef struct modbus_Scheduler_Task_s
+{
+	modbus_Master_Request_t *pRequest;
+	uint32_t periodMs;
+
+	// Set by the scheduler.
+	modbus_Scheduler_State_e state;
+	bool periodic;							/**< Added with modbus_Scheduler_Add(), until removed. */
+	uint32_t dueMs;
+	uint16_t heapIndex;
+	struct modbus_Scheduler_Task_s *pNextUrgent;
+
+	// Staleness statistics.
+	uint32_t lastUpdateMs;					/**< Time of the last successful completion. */
+	uint32_t maxAgeMs;						/**< Longest time between two successful completions. */
+	uint32_t maxLateMs;						/**< Longest time a poll waited past its deadline. */
+	uint32_t updateCount;
+	uint32_t failCount;
+	uint32_t missCount;						/**< Poll cycles skipped because the previous one ran late. */
+} modbus_Scheduler_Task_t;
+
+/**
+ * Deadline scheduler for periodic polls of many devices.
+ *
+ * Periodic tasks wait in a min-heap keyed by their deadline and are handed out
+ * earliest deadline first. New tasks get a phase offset within their period
+ * from the bit-reversed count of all tasks added so far (0, 1/2, 1/4, 3/4, ...),
+ * so tasks added in a row with the same period are spread evenly over it.
+ * The count is shared by all periods, tasks with different periods added in
+ * turns are spread less evenly.
+ * A late poll keeps its grid, it skips the missed cycles instead of firing
+ * them back-to-back.
+ * Urgent tasks (writes) go to a FIFO that is served before any poll.
+ *
+ * `ppHeap` is supplied by the caller, its size is the number of periodic tasks.
+ */
+typedef struct
+{
+	modbus_Scheduler_Task_t **ppHeap;
+	uint16_t heapSize;
+	uint16_t heapCount;
+	uint16_t periodicCount;					/**< Periodic tasks, also those out of the heap while running or urgent. */
+
+	modbus_Scheduler_Task_t *pUrgentHead;
+	modbus_Scheduler_Task_t *pUrgentTail;
+
+	uint16_t addCount;
+} modbus_Scheduler_t;
+
+
+
+void modbus_Scheduler_Init(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t **ppHeap, uint16_t heapSize);
+
+/**
+ * Adds a periodic task, first due within one period from `nowMs`.
+ * Fails if the task is not idle, has no period or there are `heapSize` periodic tasks already.
+ */
+bool modbus_Scheduler_Add(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask, uint32_t nowMs);
+
+/**
+ * Queues a task to run before any poll. An idle task runs once, a scheduled
+ * periodic task is taken out of the heap and continues on its grid once completed.
+ * Fails if the task is already queued or running.
+ */
+bool modbus_Scheduler_Submit(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask);
+
+/**
+ * Takes the task out of the scheduler. A running task is not re-scheduled
+ * by modbus_Scheduler_Complete().
+ */
+void modbus_Scheduler_Remove(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask);
+
+/**
+ * Returns the next task to send, NULL if none is due.
+ * Call again as long as the master has free slots.
+ */
+modbus_Scheduler_Task_t *modbus_Scheduler_Next(modbus_Scheduler_t *pScheduler, uint32_t nowMs);
+
+/**
+ * Updates the statistics from `pRequest->result` and re-schedules periodic tasks.
+ */
+void modbus_Scheduler_Complete(modbus_Scheduler_t *pScheduler, modbus_Scheduler_Task_t *pTask, uint32_t nowMs);
+
+/**
+ * Returns the time until the next task is due, 0 if one is due already
+ * and UINT32_MAX if there is none.
+ */
+uint32_t modbus_Scheduler_GetWaitMs(const modbus_Scheduler_t *pScheduler, uint32_t nowMs);
+
+/**
+ * Returns the time since the last successful completion, UINT32_MAX if there was none.
+ */
+uint32_t modbus_Scheduler_GetAge(const modbus_Scheduler_Task_t *pTask, uint32_t nowMs);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __INCLUDE_MODBUS_SCHEDULER_H */
@@ -0,0 +1,739 @@
+
+#ifndef __INCLUDE_MODBUS_SLAVE_HPP
+#define __INCLUDE_MODBUS_SLAVE_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+#include <ModbusEmbedded/modbus.h>
+
+/**
+ * Storage class of the active map pointer of modbus::Slave, see there.
+ * Define as empty on single-threaded targets without TLS support.
+ */
+#ifndef MODBUS_SLAVE_THREAD_LOCAL
+#define MODBUS_SLAVE_THREAD_LOCAL thread_local
+#endif
+
+/**
+ * Header-only C++17 layer over the C core.
+ *
+ * The register map is a plain struct whose tables are known at compile time:
+ *
+ *     struct Map
+ *     {
+ *         modbus::Registers<0, 100> holding;		// 0x03, 0x06, 0x10
+ *         modbus::Registers<1000, 16> input;		// 0x04
+ *         modbus::Bits<0, 64> coils;				// 0x01, 0x05, 0x0F
+ *         modbus::Bits<0, 32> discrete;			// 0x02
+ *
+ *         // Optional, called after a write has been applied.
+ *         void onWrite(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity);
+ *     };
+ *
+ * Register tables can be any type with readBytes() / writeBytes() like
+ * modbus::Registers, e.g. a modbus::RegisterMap (modbus_register_map.hpp).
+ * Every table is optional, function codes without a table are answered with
+ * ILLEGAL FUNCTION. modbus::Slave<Map>::process() switches on the function code
+ * itself and serves the tables of `Map` without any indirect call: range check
+ * and copy loop compile down to direct loads and stores. Broadcasts and the
+ * remaining function codes go through the C core, with a handler table made of
+ * block handlers specialized for `Map`.
+ */
+namespace modbus
+{
+
+
+
+template<uint16_t Base, uint32_t Count>
+struct Registers
+{
+	static_assert((Count > 0) && ((Base + Count) <= 0x10000), "register table outside the address space");
+
+	static constexpr uint16_t base = Base;
+	static constexpr uint32_t count = Count;
+
+	uint16_t values[Count];
+
+	/**
+	 * Fills `2 * quantity` bytes of big-endian registers.
+	 */
+	modbus_Exception_e readBytes(uint16_t startAddress, uint16_t quantity, uint8_t *pBytes) const
+	{
+		if((startAddress < Base) || (((uint32_t)startAddress + quantity) > (Base + Count)))
+		{
+			return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+		}
+
+		const uint16_t *pValues = &values[startAddress - Base];
+		for(uint16_t ctr = 0; ctr < quantity; ctr++)
+		{
+			pBytes[2 * ctr] = (uint8_t)(pValues[ctr] >> 8);
+			pBytes[2 * ctr + 1] = (uint8_t)pValues[ctr];
+		}
+
+		return MODBUS_EXCEPTION_SUCCESS;
+	}
+
+	/**
+	 * Takes big-endian register bytes.
+	 */
+	modbus_Exception_e writeBytes(uint16_t startAddress, uint16_t quantity, const uint8_t *pBytes)
+	{
+		if((startAddress < Base) || (((uint32_t)startAddress + quantity) > (Base + Count)))
+		{
+			return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+		}
+
+		uint16_t *pValues = &values[startAddress - Base];
+		for(uint16_t ctr = 0; ctr < quantity; ctr++)
+		{
+			pValues[ctr] = (uint16_t)((pBytes[2 * ctr] << 8) | pBytes[2 * ctr + 1]);
+		}
+
+		return MODBUS_EXCEPTION_SUCCESS;
+	}
+};
+
+/**
+ * Bits packed LSB first, bit 0 of `values[0]` is `Base`.
+ */
+template<uint16_t Base, uint32_t Count>
+struct Bits
+{
+	static_assert((Count > 0) && ((Base + Count) <= 0x10000), "bit table outside the address space");
+
+	static constexpr uint16_t base = Base;
+	static constexpr uint32_t count = Count;
+	static constexpr uint32_t byteCount = (Count + 7) / 8;
+
+	uint8_t values[byteCount];
+
+	bool get(uint16_t address) const
+	{
+		const uint32_t offset = address - Base;
+		return (values[offset / 8] >> (offset % 8)) & 1;
+	}
+
+	void set(uint16_t address, bool value)
+	{
+		const uint32_t offset = address - Base;
+		const uint8_t mask = (uint8_t)(1 << (offset % 8));
+		values[offset / 8] = value ? (uint8_t)(values[offset / 8] | mask) : (uint8_t)(values[offset / 8] & ~mask);
+	}
+};
+
+
+
+namespace detail
+{
+
+template<typename M, typename = void> struct HasHolding : std::false_type {};
+template<typename M> struct HasHolding<M, std::void_t<decltype(std::declval<M &>().holding)>> : std::true_type {};
+
+template<typename M, typename = void> struct HasInput : std::false_type {};
+template<typename M> struct HasInput<M, std::void_t<decltype(std::declval<M &>().input)>> : std::true_type {};
+
+template<typename M, typename = void> struct HasCoils : std::false_type {};
+template<typename M> struct HasCoils<M, std::void_t<decltype(std::declval<M &>().coils)>> : std::true_type {};
+
+template<typename M, typename = void> struct HasDiscrete : std::false_type {};
+template<typename M> struct HasDiscrete<M, std::void_t<decltype(std::declval<M &>().discrete)>> : std::true_type {};
+
+template<typename M, typename = void> struct HasOnWrite : std::false_type {};
+template<typename M> struct HasOnWrite<M, std::void_t<decltype(std::declval<M &>().onWrite(MODBUS_FUNCTION_WRITESINGLE_REG, uint16_t(0), uint16_t(0)))>> : std::true_type {};
+
+template<typename Table>
+inline bool IsInRange(uint16_t startAddress, uint16_t quantity)
+{
+	return (startAddress >= Table::base) && (((uint32_t)startAddress + quantity) <= (Table::base + Table::count));
+}
+
+template<typename Table>
+inline void ReadBits(const Table &table, uint16_t startAddress, uint16_t quantity, uint8_t *pBits)
+{
+	const uint32_t offset = startAddress - Table::base;
+	const uint8_t *pSource = &table.values[offset / 8];
+	const uint8_t shift = offset % 8;
+	const uint16_t byteCount = (quantity + 7) / 8;
+
+	if(shift == 0)
+	{
+		memcpy(pBits, pSource, byteCount);
+		return;
+	}
+
+	// The last source byte is only read if the range reaches into it.
+	const uint32_t sourceCount = ((offset + quantity + 7) / 8) - (offset / 8);
+	for(uint16_t ctr = 0; ctr < byteCount; ctr++)
+	{
+		const uint8_t high = ((uint32_t)ctr + 1 < sourceCount) ? pSource[ctr + 1] : 0;
+		pBits[ctr] = (uint8_t)((pSource[ctr] >> shift) | (high << (8 - shift)));
+	}
+}
+
+} // namespace detail
+
+
+
+/**
+ * Slave serving `Map`. Any number of slaves can share one map type.
+ */
+template<typename Map>
+class Slave
+{
+public:
+	/**
+	 * The C handlers carry no context, so they reach `map` through one pointer per
+	 * map type (and thread), set by process() for the duration of the request:
+	 * - Slaves on different threads are independent, as long as the pointer is
+	 *   thread-local (see MODBUS_SLAVE_THREAD_LOCAL).
+	 * - process() restores the previous pointer when it returns, so a slave may be
+	 *   processed from an interrupt that preempted another slave of the same map type.
+	 * - Without thread-local storage, slaves of one map type must not be processed
+	 *   from several threads at once.
+	 */
+	explicit Slave(Map &map, uint8_t busAddress = MODBUS_BROADCAST_ADDRESS) :
+		m_map(map)
+	{
+		m_instance.busAddress = busAddress;
+		m_instance.pHandlers = &handlers;
+	}
+
+	/**
+	 * See modbus_ProcessView(). Requests for this unit with a function code that
+	 * has a table in `Map` are answered right here, with the same checks and
+	 * exception codes as the C core. Broadcasts, requests for other units and
+	 * everything else go through modbus_ProcessView() and `handlers`.
+	 */
+	bool process(const modbus_PduView_t &request, modbus_PduView_t &response)
+	{
+		if(IsDirect(request) && ProcessDirect(m_map, request, response))
+		{
+			return true;
+		}
+
+		const ActiveMap active(m_map);
+		return modbus_ProcessView(&m_instance, &request, &response);
+	}
+
+	/**
+	 * See modbus_ProcessData(), works on the PDU of instance().
+	 */
+	bool process()
+	{
+		const modbus_PduView_t request = modbus_GetPduView(MODBUS_REQUEST_PDU(&m_instance));
+		modbus_PduView_t response = modbus_GetPduView(MODBUS_RESPONSE_PDU(&m_instance));
+
+		if(!process(request, response))
+		{
+			return false;
+		}
+
+		MODBUS_RESPONSE_PDU(&m_instance)->busAddress = response.busAddress;
+		MODBUS_RESPONSE_PDU(&m_instance)->functionCode = (uint8_t)response.functionCode;
+		MODBUS_RESPONSE_PDU(&m_instance)->payloadSize = response.payloadSize;
+		return true;
+	}
+
+	modbus_t &instance()
+	{
+		return m_instance;
+	}
+
+	Map &map()
+	{
+		return m_map;
+	}
+
+	static const modbus_Handlers_t handlers;
+
+private:
+	Map &m_map;
+	modbus_t m_instance {};
+
+	static inline MODBUS_SLAVE_THREAD_LOCAL Map *s_pActiveMap = nullptr;
+
+	struct ActiveMap
+	{
+		explicit ActiveMap(Map &map) :
+			pPrevious(s_pActiveMap)
+		{
+			s_pActiveMap = &map;
+		}
+
+		~ActiveMap()
+		{
+			s_pActiveMap = pPrevious;
+		}
+
+		Map *const pPrevious;
+	};
+
+	/**
+	 * Requests the C core would answer as addressed to this unit. Broadcasts
+	 * and requests for other units are left to it.
+	 */
+	bool IsDirect(const modbus_PduView_t &request) const
+	{
+		if(request.busAddress == MODBUS_BROADCAST_ADDRESS)
+		{
+			return m_instance.noBroadcast;
+		}
+
+		return (m_instance.busAddress == MODBUS_BROADCAST_ADDRESS) || (request.busAddress == m_instance.busAddress);
+	}
+
+	/**
+	 * Switch on the function code of a request for this unit. Returns false,
+	 * without touching the response, for anything the C core has to answer.
+	 */
+	static bool ProcessDirect(Map &map, const modbus_PduView_t &request, modbus_PduView_t &response)
+	{
+		switch(request.functionCode)
+		{
+			case MODBUS_FUNCTION_READCOILS:
+			{
+				if constexpr(detail::HasCoils<Map>::value)
+				{
+					ProcessReadBits(map.coils, request, response);
+					return true;
+				}
+				break;
+			}
+
+			case MODBUS_FUNCTION_READDISCRETE:
+			{
+				if constexpr(detail::HasDiscrete<Map>::value)
+				{
+					ProcessReadBits(map.discrete, request, response);
+					return true;
+				}
+				break;
+			}
+
+			case MODBUS_FUNCTION_READHOLDING:
+			{
+				if constexpr(detail::HasHolding<Map>::value)
+				{
+					ProcessReadRegisters(map.holding, request, response);
+					return true;
+				}
+				break;
+			}
+
+			case MODBUS_FUNCTION_READINPUT:
+			{
+				if constexpr(detail::HasInput<Map>::value)
+				{
+					ProcessReadRegisters(map.input, request, response);
+					return true;
+				}
+				break;
+			}
+
+			case MODBUS_FUNCTION_WRITESINGLE_COIL:
+			case MODBUS_FUNCTION_WRITESINGLE_REG:
+			{
+				if((request.functionCode == MODBUS_FUNCTION_WRITESINGLE_COIL) ? detail::HasCoils<Map>::value : detail::HasHolding<Map>::value)
+				{
+					ProcessWriteSingle(map, request, response);
+					return true;
+				}
+				break;
+			}
+
+			case MODBUS_FUNCTION_WRITEMULT_COILS:
+			case MODBUS_FUNCTION_WRITEMULT_REGS:
+			{
+				if((request.functionCode == MODBUS_FUNCTION_WRITEMULT_COILS) ? detail::HasCoils<Map>::value : detail::HasHolding<Map>::value)
+				{
+					ProcessWriteMultiple(map, request, response);
+					return true;
+				}
+				break;
+			}
+
+			default:
+			{
+				break;
+			}
+		}
+
+		return false;
+	}
+
+	static uint16_t GetWord(const uint8_t *pBytes)
+	{
+		return (uint16_t)((pBytes[0] << 8) | pBytes[1]);
+	}
+
+	/**
+	 * Response of the writes: echo of the two words of the request.
+	 */
+	static void SetWriteResponse(modbus_PduView_t &response, modbus_FunctionCode_e functionCode, uint16_t first, uint16_t second)
+	{
+		response.functionCode = functionCode;
+		response.payloadSize = 4;
+		response.pPayload[0] = (uint8_t)(first >> 8);
+		response.pPayload[1] = (uint8_t)first;
+		response.pPayload[2] = (uint8_t)(second >> 8);
+		response.pPayload[3] = (uint8_t)second;
+	}
+
+	template<typename Table>
+	static void ProcessReadBits(const Table &table, const modbus_PduView_t &request, modbus_PduView_t &response)
+	{
+		response.busAddress = request.busAddress;
+		response.functionCode = request.functionCode;
+
+		if(request.payloadSize != 4)
+		{
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &response);
+			return;
+		}
+
+		const uint16_t startAddress = GetWord(&request.pPayload[0]);
+		const uint16_t quantity = GetWord(&request.pPayload[2]);
+		if((quantity < 1) || (quantity > MODBUS_READ_BIT_MAX_QUANTITY))
+		{
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &response);
+			return;
+		}
+
+		const modbus_Exception_e result = ReadBitTable(table, startAddress, quantity, &response.pPayload[1]);
+		if(result != MODBUS_EXCEPTION_SUCCESS)
+		{
+			modbus_SetExceptionView(result, &response);
+			return;
+		}
+
+		const uint16_t byteCount = (quantity + 7) / 8;
+		if((quantity % 8) != 0)
+		{
+			response.pPayload[byteCount] &= (uint8_t)((1 << (quantity % 8)) - 1);
+		}
+
+		response.pPayload[0] = (uint8_t)byteCount;
+		response.payloadSize = 1 + byteCount;
+	}
+
+	template<typename Table>
+	static void ProcessReadRegisters(const Table &table, const modbus_PduView_t &request, modbus_PduView_t &response)
+	{
+		response.busAddress = request.busAddress;
+		response.functionCode = request.functionCode;
+
+		if(request.payloadSize != 4)
+		{
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &response);
+			return;
+		}
+
+		const uint16_t startAddress = GetWord(&request.pPayload[0]);
+		const uint16_t quantity = GetWord(&request.pPayload[2]);
+		if((quantity < 1) || (quantity > MODBUS_READ_REGISTER_MAX_QUANTITY))
+		{
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &response);
+			return;
+		}
+
+		const modbus_Exception_e result = table.readBytes(startAddress, quantity, &response.pPayload[1]);
+		if(result != MODBUS_EXCEPTION_SUCCESS)
+		{
+			modbus_SetExceptionView(result, &response);
+			return;
+		}
+
+		response.pPayload[0] = (uint8_t)(2 * quantity);
+		response.payloadSize = 1 + (2 * quantity);
+	}
+
+	static void ProcessWriteSingle(Map &map, const modbus_PduView_t &request, modbus_PduView_t &response)
+	{
+		const modbus_FunctionCode_e functionCode = request.functionCode;
+
+		response.busAddress = request.busAddress;
+		response.functionCode = functionCode;
+
+		if(request.payloadSize != 4)
+		{
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &response);
+			return;
+		}
+
+		const uint16_t address = GetWord(&request.pPayload[0]);
+		const uint16_t value = GetWord(&request.pPayload[2]);
+
+		modbus_Exception_e result = MODBUS_EXCEPTION_ILLEGALFUNCTION;
+		if(functionCode == MODBUS_FUNCTION_WRITESINGLE_COIL)
+		{
+			if((value != MODBUS_BIT_ON) && (value != MODBUS_BIT_OFF))
+			{
+				modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &response);
+				return;
+			}
+
+			result = WriteCoil(map, functionCode, address, value);
+		}
+		else
+		{
+			result = WriteRegister(map, functionCode, address, value);
+		}
+
+		if(result != MODBUS_EXCEPTION_SUCCESS)
+		{
+			modbus_SetExceptionView(result, &response);
+			return;
+		}
+
+		SetWriteResponse(response, functionCode, address, value);
+	}
+
+	static void ProcessWriteMultiple(Map &map, const modbus_PduView_t &request, modbus_PduView_t &response)
+	{
+		const modbus_FunctionCode_e functionCode = request.functionCode;
+
+		response.busAddress = request.busAddress;
+		response.functionCode = functionCode;
+
+		if(request.payloadSize < 5)
+		{
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &response);
+			return;
+		}
+
+		const uint16_t startAddress = GetWord(&request.pPayload[0]);
+		const uint16_t quantity = GetWord(&request.pPayload[2]);
+		const uint8_t byteCount = request.pPayload[4];
+		if(request.payloadSize != (5 + byteCount))
+		{
+			modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &response);
+			return;
+		}
+
+		modbus_Exception_e result = MODBUS_EXCEPTION_ILLEGALFUNCTION;
+		if(functionCode == MODBUS_FUNCTION_WRITEMULT_COILS)
+		{
+			if((byteCount != ((quantity + 7) / 8)) || (quantity < 1) || (quantity > MODBUS_WRITE_BIT_MAX_QUANTITY))
+			{
+				modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &response);
+				return;
+			}
+
+			result = WriteCoils(map, functionCode, startAddress, quantity, &request.pPayload[5]);
+		}
+		else
+		{
+			if((byteCount != (quantity * 2)) || (quantity < 1) || (quantity > MODBUS_WRITE_REGISTER_MAX_QUANTITY))
+			{
+				modbus_SetExceptionView(MODBUS_EXCEPTION_ILLEGALDATAVALUE, &response);
+				return;
+			}
+
+			result = WriteRegisters(map, functionCode, startAddress, quantity, &request.pPayload[5]);
+		}
+
+		if(result != MODBUS_EXCEPTION_SUCCESS)
+		{
+			modbus_SetExceptionView(result, &response);
+			return;
+		}
+
+		SetWriteResponse(response, functionCode, startAddress, quantity);
+	}
+
+	/**
+	 * Table access shared by the direct path and the C handlers below.
+	 */
+	static void NotifyWrite(Map &map, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity)
+	{
+		if constexpr(detail::HasOnWrite<Map>::value)
+		{
+			map.onWrite(functionCode, startAddress, quantity);
+		}
+		else
+		{
+			(void)map;
+			(void)functionCode;
+			(void)startAddress;
+			(void)quantity;
+		}
+	}
+
+	template<typename Table>
+	static modbus_Exception_e ReadBitTable(const Table &table, uint16_t startAddress, uint16_t quantity, uint8_t *pBits)
+	{
+		if(!detail::IsInRange<Table>(startAddress, quantity))
+		{
+			return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+		}
+
+		detail::ReadBits(table, startAddress, quantity, pBits);
+		return MODBUS_EXCEPTION_SUCCESS;
+	}
+
+	static modbus_Exception_e WriteRegister(Map &map, modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+	{
+		const uint8_t bytes[2] = { (uint8_t)(value >> 8), (uint8_t)value };
+		return WriteRegisters(map, functionCode, address, 1, bytes);
+	}
+
+	static modbus_Exception_e WriteRegisters(Map &map, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pData)
+	{
+		if constexpr(detail::HasHolding<Map>::value)
+		{
+			const modbus_Exception_e result = map.holding.writeBytes(startAddress, quantity, pData);
+			if(result == MODBUS_EXCEPTION_SUCCESS)
+			{
+				NotifyWrite(map, functionCode, startAddress, quantity);
+			}
+
+			return result;
+		}
+		else
+		{
+			(void)map;
+			(void)functionCode;
+			(void)startAddress;
+			(void)quantity;
+			(void)pData;
+			return MODBUS_EXCEPTION_ILLEGALFUNCTION;
+		}
+	}
+
+	static modbus_Exception_e WriteCoil(Map &map, modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+	{
+		const uint8_t bits = (value == MODBUS_BIT_ON) ? 1 : 0;
+		return WriteCoils(map, functionCode, address, 1, &bits);
+	}
+
+	static modbus_Exception_e WriteCoils(Map &map, modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pData)
+	{
+		if constexpr(detail::HasCoils<Map>::value)
+		{
+			using Table = decltype(Map::coils);
+			if(!detail::IsInRange<Table>(startAddress, quantity))
+			{
+				return MODBUS_EXCEPTION_ILLEGALDATAADDRESS;
+			}
+
+			for(uint16_t ctr = 0; ctr < quantity; ctr++)
+			{
+				map.coils.set((uint16_t)(startAddress + ctr), (pData[ctr / 8] >> (ctr % 8)) & 1);
+			}
+
+			NotifyWrite(map, functionCode, startAddress, quantity);
+			return MODBUS_EXCEPTION_SUCCESS;
+		}
+		else
+		{
+			(void)map;
+			(void)functionCode;
+			(void)startAddress;
+			(void)quantity;
+			(void)pData;
+			return MODBUS_EXCEPTION_ILLEGALFUNCTION;
+		}
+	}
+
+	/**
+	 * Handlers for the C core, on the active map.
+	 */
+	static void GenericFunction(modbus_Pdu_t *pRequest, modbus_Pdu_t *pResponse)
+	{
+		(void)pRequest;
+		modbus_SetExceptionResponse(MODBUS_EXCEPTION_ILLEGALFUNCTION, pResponse);
+	}
+
+	static modbus_Exception_e ReadRegisterBytes(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pBytes)
+	{
+		if(functionCode == MODBUS_FUNCTION_READHOLDING)
+		{
+			if constexpr(detail::HasHolding<Map>::value)
+			{
+				return s_pActiveMap->holding.readBytes(startAddress, quantity, pBytes);
+			}
+		}
+		else
+		{
+			if constexpr(detail::HasInput<Map>::value)
+			{
+				return s_pActiveMap->input.readBytes(startAddress, quantity, pBytes);
+			}
+		}
+
+		return MODBUS_EXCEPTION_ILLEGALFUNCTION;
+	}
+
+	static modbus_Exception_e ReadBitBlock(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, uint8_t *pBits)
+	{
+		if(functionCode == MODBUS_FUNCTION_READCOILS)
+		{
+			if constexpr(detail::HasCoils<Map>::value)
+			{
+				return ReadBitTable(s_pActiveMap->coils, startAddress, quantity, pBits);
+			}
+		}
+		else
+		{
+			if constexpr(detail::HasDiscrete<Map>::value)
+			{
+				return ReadBitTable(s_pActiveMap->discrete, startAddress, quantity, pBits);
+			}
+		}
+
+		return MODBUS_EXCEPTION_ILLEGALFUNCTION;
+	}
+
+	static modbus_Exception_e WriteSingleRegister(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+	{
+		return WriteRegister(*s_pActiveMap, functionCode, address, value);
+	}
+
+	static modbus_Exception_e WriteSingleBit(modbus_FunctionCode_e functionCode, uint16_t address, uint16_t value)
+	{
+		return WriteCoil(*s_pActiveMap, functionCode, address, value);
+	}
+
+	static modbus_Exception_e WriteRegisterBlock(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pData)
+	{
+		return WriteRegisters(*s_pActiveMap, functionCode, startAddress, quantity, pData);
+	}
+
+	static modbus_Exception_e WriteBitBlock(modbus_FunctionCode_e functionCode, uint16_t startAddress, uint16_t quantity, const uint8_t *pData)
+	{
+		return WriteCoils(*s_pActiveMap, functionCode, startAddress, quantity, pData);
+	}
+};
+
+template<typename Map>
+const modbus_Handlers_t Slave<Map>::handlers =
+{
+	&GenericFunction,			// pGenericFunctionHandler
+	nullptr,					// pGenericReadHandler
+	nullptr,					// pGenericWriteHandler
+
+	nullptr,					// pReadCoilHandler
+	nullptr,					// pReadDiscreteHandler
+	nullptr,					// pReadHoldingRegisterHandler
+	nullptr,					// pReadInputRegisterHandler
+	nullptr,					// pReadFifoQueueHandler
+	nullptr,					// pReadExceptionStatusHandler
+
+	&WriteSingleBit,			// pWriteCoilHandler
+	&WriteSingleRegister,		// pWriteRegisterHandler
+
+	&ReadBitBlock,				// pReadBitBlockHandler
+	nullptr,					// pReadRegisterBlockHandler
+	&ReadRegisterBytes,			// pReadRegisterBytesHandler
+	&WriteBitBlock,				// pWriteCoilBlockHandler
+	&WriteRegisterBlock			// pWriteRegisterBlockHandler
+};
+
+
+
+} // namespace modbus
+
+#endif /* __INCLUDE_MODBUS_SLAVE_HPP */
@@ -0,0 +1,112 @@
+
+#ifndef __INCLUDE_MODBUS_TCP_SERVER_H
+#define __INCLUDE_MODBUS_TCP_SERVER_H
+
+#ifdef __linux__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ModbusEmbedded/modbus.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+#define MODBUS_TCP_SERVER_RX_BUFFER_SIZE	(4 * MODBUS_TCP_FRAME_SIZE)
+#define MODBUS_TCP_SERVER_TX_BUFFER_SIZE	(4 * MODBUS_TCP_FRAME_SIZE)
+#define MODBUS_TCP_SERVER_MAX_EVENTS		64
+
+/**
+ * State of one client connection. Requests are taken straight out of `pRx` and
+ * responses are built straight into `pTx`, so pipelined requests are answered
+ * in order without any further copies.
+ */
+typedef struct modbus_TcpServer_Connection_s
+{
+	int fd;
+	uint32_t events;
+
+	uint32_t rxSize;
+	uint8_t pRx[MODBUS_TCP_SERVER_RX_BUFFER_SIZE];
+
+	uint32_t txOffset;
+	uint32_t txSize;
+	uint8_t pTx[MODBUS_TCP_SERVER_TX_BUFFER_SIZE];
+
+	struct modbus_TcpServer_Connection_s *pNextFree;
+} modbus_TcpServer_Connection_t;
+
+/**
+ * Single threaded Modbus TCP slave, serving any number of clients from one
+ * epoll loop with non-blocking sockets. Connection slots are supplied by the
+ * caller, the server does not allocate memory. Clients beyond the number of
+ * slots are accepted and closed right away.
+ *
+ * Requests go to modbus_ProcessView() on `pInstance`. Set `pProcessHandler` after
+ * Init to serve something else, e.g. modbus_Host_Process() with the host as
+ * `pProcessContext` and its `instance` as `pInstance`.
+ */
+typedef struct
+{
+	modbus_t *pInstance;
+	modbus_ProcessCallback_t pProcessHandler;
+	void *pProcessContext;
+
+	int listenFd;
+	int epollFd;
+
+	modbus_TcpServer_Connection_t *pConnections;
+	uint32_t maxConnections;
+	modbus_TcpServer_Connection_t *pFreeConnections;
+
+	uint32_t connectionCount;
+	uint32_t requestCount;
+	uint32_t rejectedCount;
+	uint32_t protocolErrorCount;
+} modbus_TcpServer_t;
+
+
+
+/**
+ * Opens the listening socket. `pBindAddress` is an IPv4 address, NULL for any.
+ * Port 0 picks a free port, see modbus_TcpServer_GetPort().
+ */
+bool modbus_TcpServer_Init(modbus_TcpServer_t *pServer, modbus_t *pInstance, const char *pBindAddress, uint16_t port, modbus_TcpServer_Connection_t *pConnections, uint32_t maxConnections);
+void modbus_TcpServer_Close(modbus_TcpServer_t *pServer);
+
+uint16_t modbus_TcpServer_GetPort(const modbus_TcpServer_t *pServer);
+
+/**
+ * Opens a non-blocking listening socket, shared with the other TCP backends.
+ * Returns the file descriptor, -1 on failure.
+ */
+int modbus_TcpServer_Listen(const char *pBindAddress, uint16_t port);
+
+/**
+ * Waits up to `timeoutMs` (-1 forever) for socket events and handles them.
+ * Returns false on a failure of the event loop itself.
+ */
+bool modbus_TcpServer_Poll(modbus_TcpServer_t *pServer, int timeoutMs);
+
+/**
+ * Processes all complete requests in `pRx` while there is room for their responses
+ * in `pTx`, then moves the remaining bytes to the front of `pRx`. Requests without
+ * response (see modbus_ProcessView()) add nothing to `pTx`. Sets `noBroadcast` on
+ * `pInstance`, unit 0 is answered like any direct request.
+ * Requests go to `pProcessHandler` if set, to modbus_ProcessView() on `pInstance` otherwise.
+ * Independent of the event loop. Returns the number of requests processed,
+ * or -1 if the stream is broken and the connection has to be closed.
+ */
+int32_t modbus_TcpServer_ProcessConnection(modbus_t *pInstance, modbus_ProcessCallback_t pProcessHandler, void *pProcessContext, modbus_TcpServer_Connection_t *pConnection);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __linux__ */
+
+#endif /* __INCLUDE_MODBUS_TCP_SERVER_H */
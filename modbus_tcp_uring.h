@@ -0,0 +1,134 @@
+
+#ifndef __INCLUDE_MODBUS_TCP_URING_H
+#define __INCLUDE_MODBUS_TCP_URING_H
+
+#if defined(__linux__) && defined(MODBUS_TCP_URING)
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <ModbusEmbedded/modbus_tcp_server.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+#define MODBUS_TCP_URING_QUEUE_SIZE		1024
+#define MODBUS_TCP_URING_BUFFER_COUNT	1024		// Power of two.
+#define MODBUS_TCP_URING_BUFFER_SIZE	1024
+#define MODBUS_TCP_URING_STASH_SIZE		8
+
+/**
+ * Received buffer that did not fit into `pRx` yet, it is handed back to
+ * the kernel once it has been consumed.
+ */
+typedef struct
+{
+	uint16_t bufferId;
+	uint16_t offset;
+	uint16_t size;
+} modbus_TcpUring_Stash_t;
+
+/**
+ * Connection slot, processing is shared with the epoll server through `base`.
+ */
+typedef struct modbus_TcpUring_Connection_s
+{
+	modbus_TcpServer_Connection_t base;
+
+	bool recvActive;
+	bool sendActive;
+	bool cancelActive;
+	bool closing;
+
+	uint8_t stashHead;
+	uint8_t stashCount;
+	modbus_TcpUring_Stash_t pStash[MODBUS_TCP_URING_STASH_SIZE];
+
+	struct modbus_TcpUring_Connection_s *pNextFree;
+} modbus_TcpUring_Connection_t;
+
+/**
+ * io_uring backend of the Modbus TCP slave, built with MODBUS_TCP_URING.
+ *
+ * Connections are accepted with a multishot accept and read with multishot recv
+ * into a ring of buffers registered with the kernel. Responses are sent from
+ * `pTx`, which is registered as fixed buffer when the memlock limit allows.
+ * All operations queued while handling completions go out together with the
+ * next wait, so a loop iteration costs one io_uring_enter() however many
+ * requests it answers.
+ */
+typedef struct
+{
+	modbus_t *pInstance;
+	modbus_ProcessCallback_t pProcessHandler;		/**< Same as in modbus_TcpServer_t. */
+	void *pProcessContext;
+
+	int listenFd;
+	int ringFd;
+	bool acceptActive;
+	bool fixedBuffers;
+
+	// Submission queue
+	uint32_t *pSqHead;
+	uint32_t *pSqTail;
+	uint32_t sqMask;
+	uint32_t sqEntries;
+	uint32_t sqTail;
+	uint32_t sqPending;
+	struct io_uring_sqe *pSqes;
+
+	// Completion queue
+	uint32_t *pCqHead;
+	uint32_t *pCqTail;
+	uint32_t cqMask;
+	struct io_uring_cqe *pCqes;
+
+	void *pRingMemory;
+	uint32_t ringMemorySize;
+	void *pSqeMemory;
+	uint32_t sqeMemorySize;
+
+	// Provided receive buffers
+	struct io_uring_buf_ring *pBufferRing;
+	uint8_t *pBuffers;
+	uint16_t bufferTail;
+
+	modbus_TcpUring_Connection_t *pConnections;
+	uint32_t maxConnections;
+	modbus_TcpUring_Connection_t *pFreeConnections;
+
+	uint32_t connectionCount;
+	uint32_t requestCount;
+	uint32_t rejectedCount;
+	uint32_t protocolErrorCount;
+	uint32_t enterCount;
+} modbus_TcpUring_t;
+
+
+
+/**
+ * Same usage as modbus_TcpServer_Init(). Needs Linux 6.0 (multishot recv),
+ * fails on kernels without provided buffer rings.
+ */
+bool modbus_TcpUring_Init(modbus_TcpUring_t *pServer, modbus_t *pInstance, const char *pBindAddress, uint16_t port, modbus_TcpUring_Connection_t *pConnections, uint32_t maxConnections);
+void modbus_TcpUring_Close(modbus_TcpUring_t *pServer);
+
+uint16_t modbus_TcpUring_GetPort(const modbus_TcpUring_t *pServer);
+
+bool modbus_TcpUring_Poll(modbus_TcpUring_t *pServer, int timeoutMs);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __linux__ && MODBUS_TCP_URING */
+
+#endif /* __INCLUDE_MODBUS_TCP_URING_H */